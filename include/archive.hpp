@@ -0,0 +1,56 @@
+#ifndef _ARCHIVE_HPP_
+#define _ARCHIVE_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Static libraries in the `ar` format, GNU and BSD flavours.
+namespace archive {
+
+struct Member {
+    std::string_view name;
+    // Offset of the member header in the archive.
+    size_t offset;
+    std::span<const uint8_t> data;
+};
+
+struct Symbol {
+    std::string_view name;
+    uint32_t member;
+};
+
+[[nodiscard]] bool isArchive(std::span<const uint8_t> data) noexcept;
+
+class Archive {
+  public:
+    explicit Archive(std::vector<uint8_t> &&data);
+    [[nodiscard]] static Archive fromFile(std::string_view filepath);
+
+    // Object files in archive order. Their data points into the archive.
+    [[nodiscard]] const std::vector<Member> &getMembers() const noexcept;
+    // The archive symbol table, sorted by name. Empty when the archive
+    // has none.
+    [[nodiscard]] const std::vector<Symbol> &getSymbols() const noexcept;
+    // The member defining `symbol` according to the symbol table.
+    [[nodiscard]] std::optional<size_t>
+    findMember(std::string_view symbol) const noexcept;
+    // Parses member `idx` in place, without copying it. The result views
+    // the archive and must not outlive it.
+    [[nodiscard]] std::unique_ptr<binary::Elf64> openMember(size_t idx) const;
+
+  private:
+    void readSymbolTable(std::span<const uint8_t> table, size_t wordSize);
+
+    std::vector<uint8_t> data_;
+    std::vector<Member> members_;
+    std::vector<Symbol> symbols_;
+};
+
+} // namespace archive
+
+#endif
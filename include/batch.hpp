@@ -0,0 +1,29 @@
+#ifndef _BATCH_HPP_
+#define _BATCH_HPP_
+
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace batch {
+
+struct Options {
+    std::vector<std::string> paths;
+    size_t jobs;
+    // When set, every input gets its own `<dir>/<n>_<sanitized path>.txt`,
+    // n being its position in `paths`. Otherwise all listings go to stdout,
+    // one block per file in the order the files finish.
+    std::optional<std::string> outputDir;
+};
+
+[[nodiscard]] std::vector<std::string> readPathList(std::istream &input);
+
+// Processes every path on a pool of `options.jobs` workers and returns the
+// number of files that failed.
+[[nodiscard]] size_t run(const Options &options);
+
+} // namespace batch
+
+#endif
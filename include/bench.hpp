@@ -0,0 +1,43 @@
+#ifndef _BENCH_HPP_
+#define _BENCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Throughput comparison against objdump: both tools run as child processes
+// on the same corpus, timed from spawn to exit, with the peak RSS the
+// kernel reports for them.
+namespace bench {
+
+struct Options {
+    // Files, or directories searched recursively for ELF files with a
+    // symbol table.
+    std::vector<std::string> paths;
+    // The corpus takes this many of the files found, evenly spaced in path
+    // order so that reruns pick the same ones.
+    size_t files;
+    // The highest thread count; disasmer is timed at 1, 2, 4... up to it.
+    size_t jobs;
+    // Every measurement is the median of this many runs.
+    size_t runs;
+    // Instructions in each synthetic binary, none when zero.
+    uint64_t synthetic;
+    // Where the synthetic binaries are written.
+    std::string workDir;
+};
+
+// Writes a relocatable x86-64 object of `instructions` instructions from a
+// fixed, seeded mix, split into functions of about `perFunction`.
+void writeSyntheticObject(const std::string &path, uint64_t instructions,
+                          uint64_t perFunction, uint64_t seed);
+
+// Measures the corpus and writes the report, progress going to stderr.
+// Returns the number of inputs disasmer failed on.
+[[nodiscard]] size_t run(const Options &options, std::ostream &report);
+
+} // namespace bench
+
+#endif
@@ -1,11 +1,18 @@
 #ifndef _BINARY_HPP_
 #define _BINARY_HPP_
 
+#include <cstddef>
 #include <cstdint>
 #include <elf.h>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace binary {
@@ -16,6 +23,85 @@ struct Function {
 	size_t size;
 };
 
+// Functions in address order, stored column-wise: names as offsets into the
+// string table, addresses as 32-bit deltas from a full address kept every
+// BlockSize functions, and 32-bit sizes. The rare values that do not fit
+// are kept aside. Indexing builds a Function on the fly.
+class FunctionTable {
+  public:
+    struct Entry {
+        uint64_t address;
+        uint64_t size;
+        uint32_t name;
+    };
+
+    class Iterator {
+      public:
+        using value_type = Function;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        Iterator(const FunctionTable *table, size_t idx) noexcept
+            : table_(table), idx_(idx) {}
+
+        [[nodiscard]] Function operator*() const noexcept {
+            return (*table_)[idx_];
+        }
+        Iterator &operator++() noexcept {
+            idx_++;
+            return *this;
+        }
+        Iterator operator++(int) noexcept {
+            Iterator old = *this;
+            idx_++;
+            return old;
+        }
+        [[nodiscard]] bool operator==(const Iterator &) const = default;
+
+      private:
+        const FunctionTable *table_ = nullptr;
+        size_t idx_ = 0;
+    };
+
+    FunctionTable() = default;
+    // Sorts `entries` by address, equal ones keeping their order. Names are
+    // offsets into `strings`, which must outlive the table.
+    FunctionTable(std::vector<Entry> entries,
+                  std::span<const uint8_t> strings);
+
+    [[nodiscard]] size_t size() const noexcept { return names_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return names_.empty(); }
+    [[nodiscard]] Function operator[](size_t idx) const noexcept {
+        return Function{getName(idx), getAddress(idx), getSize(idx)};
+    }
+    [[nodiscard]] std::string_view getName(size_t idx) const noexcept;
+    [[nodiscard]] uint64_t getAddress(size_t idx) const noexcept;
+    [[nodiscard]] uint64_t getSize(size_t idx) const noexcept;
+    [[nodiscard]] Iterator begin() const noexcept { return {this, 0}; }
+    [[nodiscard]] Iterator end() const noexcept { return {this, size()}; }
+
+  private:
+    static constexpr size_t BlockSize = 64;
+    static constexpr uint32_t Wide = UINT32_MAX;
+
+    std::span<const uint8_t> strings_;
+    std::vector<uint32_t> names_;
+    std::vector<uint64_t> bases_;
+    std::vector<uint32_t> deltas_;
+    std::vector<uint32_t> sizes_;
+    // (index, value) of the deltas and sizes stored as Wide, by index.
+    std::vector<std::pair<uint32_t, uint64_t>> wideDeltas_;
+    std::vector<std::pair<uint32_t, uint64_t>> wideSizes_;
+};
+
+// A dynamic relocation. `symbol` indexes the dynamic symbol table.
+struct Relocation {
+	uint64_t offset;
+	uint32_t type;
+	uint32_t symbol;
+	int64_t addend;
+};
+
 class Binary {
   public:
     enum class Type {
@@ -34,20 +120,23 @@ class Binary {
 
     virtual ~Binary() = default;
 
-	const std::vector<uint8_t> &getData() const noexcept;
+	[[nodiscard]] std::span<const uint8_t> getData() const noexcept;
 
   protected:
     using ReaderFn =
-        std::function<uint64_t(size_t, size_t, const std::vector<uint8_t> &)>;
+        std::function<uint64_t(size_t, size_t, std::span<const uint8_t>)>;
 
     [[nodiscard]] Binary(Type type, std::vector<uint8_t> &&data,
                          ReaderFn reader);
-
-    std::vector<uint8_t> &getData() noexcept;
+    // Views `data` without owning it, e.g. a member of an archive.
+    [[nodiscard]] Binary(Type type, std::span<const uint8_t> data,
+                         ReaderFn reader);
 
   private:
     Type type_;
-    std::vector<uint8_t> data_;
+    // Empty for views.
+    std::vector<uint8_t> storage_;
+    std::span<const uint8_t> data_;
     ReaderFn reader_;
 };
 
@@ -77,27 +166,95 @@ class Elf32 : public Binary {
 class Elf64 : public Binary {
   public:
     explicit Elf64(std::vector<uint8_t> &&data);
+    // Views `data`, which must outlive the object.
+    explicit Elf64(std::span<const uint8_t> data);
 
     [[nodiscard]] Elf64_Ehdr getHeader() const noexcept;
     [[nodiscard]] Elf64_Shdr getSectionHeader(size_t idx) const noexcept;
 	[[nodiscard]] std::string_view getSectionName(size_t idx) const noexcept;
+	[[nodiscard]] std::optional<size_t> findSection(std::string_view name) const noexcept;
+	// Contents of section `idx`, empty for SHT_NOBITS. SHF_COMPRESSED
+	// sections are decompressed on first use and kept.
+	[[nodiscard]] std::span<const uint8_t> getSectionData(size_t idx) const;
+	// Decompresses the compressed ones among `sections` up front, in
+	// parallel.
+	void decompressSections(std::span<const size_t> sections, size_t jobs) const;
+	// Symbols are read from the file on each call rather than kept. Out of
+	// range indices, or a binary without a symbol table, give a zeroed symbol.
 	[[nodiscard]] Elf64_Sym getSymbol(size_t idx) const noexcept;
-	[[nodiscard]] const std::vector<Function> &getFunctions() const noexcept;
+	// Functions of the symbol table, in address order.
+	[[nodiscard]] const FunctionTable &getFunctions() const noexcept;
 	[[nodiscard]] const std::span<const uint8_t> getFunctionCode(size_t idx) const noexcept;
+	// The function whose [offset, offset + size) contains `address`.
+	[[nodiscard]] std::optional<size_t> findFunction(uint64_t address) const;
+	// Translates a virtual address into a file offset through the allocated
+	// sections. Addresses in SHT_NOBITS sections have no file contents.
+	[[nodiscard]] std::optional<size_t> getFileOffset(uint64_t address) const noexcept;
+	// The file contents backing [address, address + size), or an empty span
+	// when the range is not entirely inside one section.
+	[[nodiscard]] std::span<const uint8_t> getBytesAt(uint64_t address, size_t size) const noexcept;
+
+	[[nodiscard]] size_t getDynamicSymbolCount() const noexcept;
+	[[nodiscard]] Elf64_Sym getDynamicSymbol(size_t idx) const noexcept;
+	[[nodiscard]] std::string_view getDynamicSymbolName(size_t idx) const noexcept;
+	// Looks a defined dynamic symbol up through .gnu.hash or .hash, falling
+	// back to a linear scan when the file has neither.
+	[[nodiscard]] std::optional<size_t> findDynamicSymbol(std::string_view name) const noexcept;
+
+	// Relocations from .rela.dyn and .rela.plt, sorted by offset.
+	[[nodiscard]] const std::vector<Relocation> &getRelocations() const noexcept;
+	[[nodiscard]] const Relocation *findRelocation(uint64_t address) const noexcept;
+	// The imported symbol reached through the PLT stub or GOT slot at
+	// `address`, as `name@plt` / `name@got`, or an empty view.
+	[[nodiscard]] std::string_view getImportName(uint64_t address) const noexcept;
 
   private:
 
 	[[nodiscard]] std::string_view getStringFromTable(size_t tableIdx, size_t offset) const noexcept;
+	void parse();
+	void readHashTables(size_t dynsymIdx);
+	void readRelocations();
+	void indexImports();
+	// Entries of symbol table `section` that are inside the file.
+	[[nodiscard]] size_t countSymbols(size_t section) const noexcept;
+	[[nodiscard]] Elf64_Sym readSymbol(size_t section, size_t idx) const noexcept;
+
+	struct GnuHashTable {
+		uint32_t symbolOffset;
+		uint32_t bloomShift;
+		std::vector<uint64_t> bloom;
+		std::vector<uint32_t> buckets;
+		std::vector<uint32_t> chains;
+	};
+
+	struct SysvHashTable {
+		std::vector<uint32_t> buckets;
+		std::vector<uint32_t> chains;
+	};
+
+	struct DecompressedSection {
+		std::once_flag once;
+		std::unique_ptr<uint8_t[]> data;
+		size_t size = 0;
+	};
 
     Elf64_Ehdr header_;
     std::vector<Elf64_Shdr> sectionHeaders_;
-	std::vector<Elf64_Sym> symtab_;
-	std::vector<Elf64_Sym> dynsymtab_;
-	std::vector<Function> functions_;
+	std::optional<size_t> symtabIdx_;
+	std::optional<size_t> dynsymIdx_;
+	FunctionTable functions_;
+	std::optional<GnuHashTable> gnuHash_;
+	std::optional<SysvHashTable> sysvHash_;
+	std::vector<Relocation> relocations_;
+	std::unordered_map<uint64_t, std::string> importNames_;
+	mutable std::unique_ptr<DecompressedSection[]> decompressed_;
 
-	size_t strtabIdx_;
+	std::optional<size_t> dynstrIdx_;
 };
 
+[[nodiscard]] std::vector<uint8_t> readFile(std::string_view filepath);
+// Parses a file already in memory, as read by readFile.
+[[nodiscard]] std::unique_ptr<Binary> fromData(std::vector<uint8_t> data);
 [[nodiscard]] std::unique_ptr<Binary> fromFile(std::string_view filepath);
 
 } // namespace binary
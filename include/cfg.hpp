@@ -0,0 +1,69 @@
+#ifndef _CFG_HPP_
+#define _CFG_HPP_
+
+#include <cstdint>
+#include <disassemble.hpp>
+#include <jumptable.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Basic blocks and control flow graph of a single function.
+namespace cfg {
+
+// A maximal straight run of instructions. Offsets are relative to the start
+// of the function, instruction indices to the decoded instructions the
+// graph was built from.
+struct Block {
+    uint32_t firstInstruction;
+    uint32_t instructionCount;
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Blocks are in address order. Edges are stored in compressed sparse row
+// form: the successors of block i are `successors_[successorOffsets_[i],
+// successorOffsets_[i + 1])`, likewise for predecessors.
+class Graph {
+  public:
+    // `instructions` is the linear decode of one function, as produced by
+    // disassemble::X86_64::decode. Calls fall through; jumps leaving the
+    // function end a block without successors, and so do indirect jumps
+    // other than those through one of `tables`, whose targets are the
+    // successors of their block.
+    [[nodiscard]] static Graph
+    build(std::span<const disassemble::X86_64::Instruction> instructions,
+          std::span<const jumptable::Table> tables = {});
+    // Same as above, reusing the storage of this graph.
+    void assign(std::span<const disassemble::X86_64::Instruction> instructions,
+                std::span<const jumptable::Table> tables = {});
+
+    [[nodiscard]] const std::vector<Block> &getBlocks() const noexcept;
+    [[nodiscard]] std::span<const uint32_t>
+    successors(size_t block) const noexcept;
+    [[nodiscard]] std::span<const uint32_t>
+    predecessors(size_t block) const noexcept;
+
+    // The block holding instruction `instruction`.
+    [[nodiscard]] size_t blockOf(size_t instruction) const noexcept;
+    // The block starting exactly at `address`.
+    [[nodiscard]] std::optional<size_t>
+    blockAt(uint64_t address) const noexcept;
+
+  private:
+    uint64_t address_ = 0;
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> successorOffsets_;
+    std::vector<uint32_t> successors_;
+    std::vector<uint32_t> predecessorOffsets_;
+    std::vector<uint32_t> predecessors_;
+    // Scratch space of assign, kept to reuse its storage: the first
+    // instruction of every block, then the next free slot of every
+    // predecessor row.
+    std::vector<uint32_t> leaders_;
+    std::vector<uint32_t> next_;
+};
+
+} // namespace cfg
+
+#endif
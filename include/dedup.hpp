@@ -0,0 +1,65 @@
+#ifndef _DEDUP_HPP_
+#define _DEDUP_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <span>
+#include <vector>
+
+// Detection of functions with identical code.
+namespace dedup {
+
+struct Fingerprint {
+    // Hash of the bytes with branch displacements and RIP-relative
+    // displacements zeroed.
+    uint64_t bytes;
+    // Hash of what those displacements point to: absolute addresses for
+    // targets outside the function, offsets into it otherwise.
+    uint64_t targets;
+    uint64_t size;
+
+    friend bool operator==(const Fingerprint &,
+                           const Fingerprint &) = default;
+    friend auto operator<=>(const Fingerprint &,
+                            const Fingerprint &) = default;
+};
+
+// Computes fingerprints, reusing its buffers from one function to the next.
+class Fingerprinter {
+  public:
+    [[nodiscard]] Fingerprint operator()(std::span<const uint8_t> code,
+                                         uint64_t address);
+
+  private:
+    std::vector<disassemble::X86_64::Instruction> instructions_;
+    std::vector<uint8_t> masked_;
+};
+
+// Functions grouped by fingerprint. Symbols sharing an address count as a
+// single function; the others of a group are copies of the same code. Code
+// is only compared on x86-64: elsewhere, only symbols sharing an address
+// are grouped.
+class Groups {
+  public:
+    [[nodiscard]] static Groups build(const binary::Elf64 &elf, size_t jobs);
+
+    [[nodiscard]] size_t size() const noexcept;
+    // Function indices of group `group`, in address order. The first is
+    // the one to decode for the whole group.
+    [[nodiscard]] std::span<const uint32_t>
+    members(size_t group) const noexcept;
+    [[nodiscard]] size_t groupOf(size_t function) const noexcept;
+    // Number of distinct addresses in `group`.
+    [[nodiscard]] size_t copies(size_t group) const noexcept;
+
+  private:
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> members_;
+    std::vector<uint32_t> copies_;
+    std::vector<uint32_t> groupOf_;
+};
+
+} // namespace dedup
+
+#endif
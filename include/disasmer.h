@@ -0,0 +1,132 @@
+#ifndef _DISASMER_H_
+#define _DISASMER_H_
+
+/*
+ * C interface to libdisasmer.
+ *
+ * The structs below are part of the ABI: fields are only ever appended, and
+ * DISASMER_API_VERSION is bumped when that happens. Functions returning int
+ * return 0 on success and -1 on failure, with the reason available from
+ * disasmer_last_error() on the calling thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISASMER_API_VERSION 2
+
+typedef struct disasmer_binary disasmer_binary;
+
+typedef struct disasmer_function {
+    /* Points into the binary's string table; valid until disasmer_close. */
+    const char *name;
+    uint64_t address;
+    uint64_t size;
+} disasmer_function;
+
+enum disasmer_operand_kind {
+    DISASMER_OPERAND_NONE = 0,
+    DISASMER_OPERAND_REGISTER = 1,
+    DISASMER_OPERAND_MEMORY = 2,
+    DISASMER_OPERAND_IMMEDIATE = 3,
+    DISASMER_OPERAND_TARGET = 4,
+};
+
+#define DISASMER_REGISTER_RIP 16
+#define DISASMER_REGISTER_NONE 0xff
+
+enum disasmer_segment {
+    DISASMER_SEGMENT_NONE = 0,
+    DISASMER_SEGMENT_CS = 1,
+    DISASMER_SEGMENT_SS = 2,
+    DISASMER_SEGMENT_DS = 3,
+    DISASMER_SEGMENT_ES = 4,
+    DISASMER_SEGMENT_FS = 5,
+    DISASMER_SEGMENT_GS = 6,
+};
+
+typedef struct disasmer_operand {
+    uint8_t kind;
+    /* Access size in bytes. */
+    uint8_t size;
+    /* The register itself, or the base register of a memory operand. */
+    uint8_t base;
+    uint8_t index;
+    uint8_t scale;
+    /* Displacement, immediate or absolute branch target. */
+    int64_t value;
+} disasmer_operand;
+
+typedef struct disasmer_instruction {
+    uint64_t address;
+    /* 0 for unimplemented instructions; see disasmer_mnemonic_name. */
+    uint16_t mnemonic;
+    uint8_t length;
+    uint8_t opcode_map;
+    uint8_t opcode;
+    uint8_t prefixes;
+    uint8_t operand_count;
+    disasmer_operand operands[3];
+    /* Segment override of the memory operand, since API version 2. */
+    uint8_t segment;
+} disasmer_instruction;
+
+int disasmer_api_version(void);
+const char *disasmer_last_error(void);
+
+int disasmer_open(const char *path, disasmer_binary **binary);
+void disasmer_close(disasmer_binary *binary);
+
+size_t disasmer_function_count(const disasmer_binary *binary);
+int disasmer_get_function(const disasmer_binary *binary, size_t index,
+                          disasmer_function *function);
+int disasmer_find_function(const disasmer_binary *binary, const char *name,
+                           size_t *index);
+/*
+ * Finds a function by name, falling back to the defined dynamic symbols
+ * (through .gnu.hash or .hash) for names missing from the symbol table, as
+ * in stripped libraries. Since API version 2.
+ */
+int disasmer_find_symbol(const disasmer_binary *binary, const char *name,
+                         disasmer_function *symbol);
+
+/*
+ * Decodes function `index` into `instructions`, writing at most `capacity`
+ * records. Returns the total number of instructions in the function, so a
+ * first call with a capacity of 0 tells how much room is needed; returns
+ * (size_t)-1 on failure, which includes binaries for other machines than
+ * x86-64. Decoding restarts at the targets of the function's jump tables,
+ * which are recovered on the first call.
+ */
+size_t disasmer_decode_function(const disasmer_binary *binary, size_t index,
+                                disasmer_instruction *instructions,
+                                size_t capacity);
+
+/*
+ * Same as disasmer_decode_function, over raw x86-64 code at `address`.
+ * Returns (size_t)-1 when memory runs out.
+ */
+size_t disasmer_decode(const uint8_t *code, size_t size, uint64_t address,
+                       disasmer_instruction *instructions, size_t capacity);
+
+const char *disasmer_mnemonic_name(uint16_t mnemonic);
+const char *disasmer_register_name(uint8_t reg, uint8_t size);
+
+/*
+ * Writes the textual form of `instruction` as a NUL-terminated string,
+ * truncated to `size` bytes. Returns the untruncated length, or (size_t)-1
+ * when the segment or an operand's kind or register is unknown, or when
+ * memory runs out.
+ */
+size_t disasmer_format_instruction(const disasmer_instruction *instruction,
+                                   char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
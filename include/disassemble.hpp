@@ -1,9 +1,19 @@
 #ifndef _DISASSEMBLE_HPP_
 #define _DISASSEMBLE_HPP_
 
+#include <array>
+#include <concepts>
 #include <cstdint>
+#include <elf.h>
+#include <format>
+#include <functional>
+#include <iosfwd>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace disassemble {
 
@@ -12,8 +22,652 @@ enum class ReadingMode {
     MSB,
 };
 
-std::string disassembleX86_64(const std::span<const uint8_t> code, ReadingMode readingMode);
+namespace X86_64 {
 
+enum class Register : uint8_t {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+    RIP,
+    // Legacy high byte registers, only reachable without a REX prefix.
+    AH,
+    CH,
+    DH,
+    BH,
+    None = 0xff,
 };
 
+// Jcc, SETcc and CMOVcc each occupy 16 consecutive entries in condition code
+// order, so `mnemonic - Jo` is the condition encoded in the opcode.
+enum class Mnemonic : uint16_t {
+    Unknown,
+    Add,
+    Or,
+    Adc,
+    Sbb,
+    And,
+    Sub,
+    Xor,
+    Cmp,
+    Test,
+    Not,
+    Neg,
+    Mul,
+    Imul,
+    Div,
+    Idiv,
+    Inc,
+    Dec,
+    Rol,
+    Ror,
+    Rcl,
+    Rcr,
+    Shl,
+    Shr,
+    Sar,
+    Mov,
+    Movsxd,
+    Movzx,
+    Movsx,
+    Lea,
+    Xchg,
+    Push,
+    Pop,
+    Cbw,
+    Cwde,
+    Cdqe,
+    Cwd,
+    Cdq,
+    Cqo,
+    Call,
+    Jmp,
+    Ret,
+    Leave,
+    Nop,
+    Pause,
+    Int3,
+    Hlt,
+    Ud2,
+    Syscall,
+    Endbr64,
+    Jo,
+    Jno,
+    Jb,
+    Jae,
+    Je,
+    Jne,
+    Jbe,
+    Ja,
+    Js,
+    Jns,
+    Jp,
+    Jnp,
+    Jl,
+    Jge,
+    Jle,
+    Jg,
+    Seto,
+    Setno,
+    Setb,
+    Setae,
+    Sete,
+    Setne,
+    Setbe,
+    Seta,
+    Sets,
+    Setns,
+    Setp,
+    Setnp,
+    Setl,
+    Setge,
+    Setle,
+    Setg,
+    Cmovo,
+    Cmovno,
+    Cmovb,
+    Cmovae,
+    Cmove,
+    Cmovne,
+    Cmovbe,
+    Cmova,
+    Cmovs,
+    Cmovns,
+    Cmovp,
+    Cmovnp,
+    Cmovl,
+    Cmovge,
+    Cmovle,
+    Cmovg,
+    Count,
+};
+
+enum class OperandKind : uint8_t {
+    None,
+    Register,
+    Memory,
+    Immediate,
+    // A branch destination, already resolved to an absolute address.
+    Target,
+};
+
+enum class Segment : uint8_t {
+    None,
+    CS,
+    SS,
+    DS,
+    ES,
+    FS,
+    GS,
+};
+
+struct Operand {
+    OperandKind kind = OperandKind::None;
+    // Access size in bytes.
+    uint8_t size = 0;
+    // The register itself for Register operands, the base for Memory ones.
+    Register base = Register::None;
+    Register index = Register::None;
+    uint8_t scale = 1;
+    // Displacement, immediate or branch target depending on `kind`.
+    int64_t value = 0;
+};
+
+namespace Prefix {
+constexpr uint8_t Lock = 1 << 0;
+constexpr uint8_t Rep = 1 << 1;
+constexpr uint8_t Repne = 1 << 2;
+constexpr uint8_t OperandSize = 1 << 3;
+constexpr uint8_t AddressSize = 1 << 4;
+constexpr uint8_t Rex = 1 << 5;
+constexpr uint8_t Vex = 1 << 6;
+constexpr uint8_t Evex = 1 << 7;
+} // namespace Prefix
+
+constexpr size_t MaxInstructionLength = 15;
+
+// One decoded instruction. Opcode maps are numbered as in the manuals:
+// 0 for one byte opcodes, 1 for 0F, 2 for 0F 38 and 3 for 0F 3A.
+struct Instruction {
+    uint64_t address = 0;
+    Mnemonic mnemonic = Mnemonic::Unknown;
+    uint8_t length = 0;
+    uint8_t opcodeMap = 0;
+    uint8_t opcode = 0;
+    uint8_t prefixes = 0;
+    Segment segment = Segment::None;
+    uint8_t operandCount = 0;
+    std::array<Operand, 3> operands;
+
+    [[nodiscard]] std::span<const Operand> getOperands() const noexcept {
+        return std::span(operands).first(operandCount);
+    }
+
+    // The destination of a direct call, jump or conditional jump.
+    [[nodiscard]] std::optional<uint64_t> branchTarget() const noexcept;
+
+    // The absolute address referenced by a RIP-relative memory operand.
+    [[nodiscard]] std::optional<uint64_t> ripTarget() const noexcept;
+};
+
+static_assert(sizeof(Instruction) == 64);
+
+[[nodiscard]] std::string_view mnemonicName(Mnemonic mnemonic) noexcept;
+[[nodiscard]] std::string_view registerName(Register reg,
+                                            size_t size) noexcept;
+
+[[nodiscard]] bool isConditionalJump(Mnemonic mnemonic) noexcept;
+// Calls, jumps and returns: anything ending a straight line of code.
+[[nodiscard]] bool isControlFlow(Mnemonic mnemonic) noexcept;
+
+// Decodes the instruction at `code[offset]`, `address` being the address of
+// `code[0]`. Unknown opcodes still get their correct length so decoding can
+// carry on after them. Throws std::out_of_range unless `offset` is inside
+// `code`.
+[[nodiscard]] Instruction decodeInstruction(std::span<const uint8_t> code,
+                                            size_t offset, uint64_t address,
+                                            ReadingMode readingMode);
+
+[[nodiscard]] std::vector<Instruction>
+decode(std::span<const uint8_t> code, uint64_t address,
+       ReadingMode readingMode);
+// Same as above, reusing the storage of `out` (which is cleared first).
+void decode(std::span<const uint8_t> code, uint64_t address,
+            ReadingMode readingMode, std::vector<Instruction> &out);
+
+// Names the destination of calls and jumps in listings, be it a direct
+// target or the memory slot of an indirect one. Returns an empty view for
+// addresses without a name.
+using SymbolResolver = std::function<std::string_view(uint64_t)>;
+
+// Appends the textual form of `ins` (tab indented, newline terminated).
+void formatInstruction(std::string &out, const Instruction &ins,
+                       const SymbolResolver &resolver = {});
+
+} // namespace X86_64
+
+namespace AArch64 {
+
+// General purpose registers are numbered as encoded, X0 + n. Number 31 is
+// either SP or the zero register depending on the instruction, so it has
+// two entries. SIMD and floating point registers are V0 + n.
+enum class Register : uint8_t {
+    X0 = 0,
+    X29 = 29,
+    X30 = 30,
+    SP = 31,
+    ZR = 32,
+    V0 = 33,
+    None = 0xff,
+};
+
+// B.cond occupies 16 consecutive entries in condition code order, so
+// `mnemonic - Beq` is the condition encoded in the instruction.
+enum class Mnemonic : uint16_t {
+    Unknown,
+    Adr,
+    Adrp,
+    Add,
+    Adds,
+    Sub,
+    Subs,
+    Cmp,
+    Cmn,
+    Neg,
+    Negs,
+    Adc,
+    Adcs,
+    Sbc,
+    Sbcs,
+    And,
+    Ands,
+    Orr,
+    Eor,
+    Bic,
+    Bics,
+    Orn,
+    Eon,
+    Tst,
+    Mvn,
+    Mov,
+    Movz,
+    Movn,
+    Movk,
+    Sbfm,
+    Bfm,
+    Ubfm,
+    Asr,
+    Lsl,
+    Lsr,
+    Ror,
+    Sxtb,
+    Sxth,
+    Sxtw,
+    Uxtb,
+    Uxth,
+    Sbfx,
+    Ubfx,
+    Sbfiz,
+    Ubfiz,
+    Bfi,
+    Bfc,
+    Bfxil,
+    Extr,
+    Csel,
+    Csinc,
+    Csinv,
+    Csneg,
+    Cset,
+    Csetm,
+    Cinc,
+    Cinv,
+    Cneg,
+    Ccmp,
+    Ccmn,
+    Madd,
+    Msub,
+    Mul,
+    Mneg,
+    Smaddl,
+    Smsubl,
+    Smnegl,
+    Smull,
+    Umaddl,
+    Umsubl,
+    Umnegl,
+    Umull,
+    Smulh,
+    Umulh,
+    Udiv,
+    Sdiv,
+    Rbit,
+    Rev16,
+    Rev32,
+    Rev,
+    Clz,
+    Cls,
+    B,
+    Bl,
+    Br,
+    Blr,
+    Ret,
+    Retaa,
+    Retab,
+    Cbz,
+    Cbnz,
+    Tbz,
+    Tbnz,
+    Svc,
+    Hvc,
+    Smc,
+    Brk,
+    Hlt,
+    Udf,
+    Nop,
+    Yield,
+    Wfe,
+    Wfi,
+    Sev,
+    Hint,
+    Paciaz,
+    Paciasp,
+    Pacibsp,
+    Autiaz,
+    Autiasp,
+    Autibsp,
+    Bti,
+    Dsb,
+    Dmb,
+    Isb,
+    Mrs,
+    Msr,
+    Ldr,
+    Ldrb,
+    Ldrh,
+    Ldrsb,
+    Ldrsh,
+    Ldrsw,
+    Str,
+    Strb,
+    Strh,
+    Ldur,
+    Ldurb,
+    Ldurh,
+    Ldursb,
+    Ldursh,
+    Ldursw,
+    Stur,
+    Sturb,
+    Sturh,
+    Prfm,
+    Prfum,
+    Ldp,
+    Ldpsw,
+    Stp,
+    Ldnp,
+    Stnp,
+    Ldxr,
+    Ldaxr,
+    Stxr,
+    Stlxr,
+    Ldar,
+    Stlr,
+    Ldxrb,
+    Ldaxrb,
+    Stxrb,
+    Stlxrb,
+    Ldarb,
+    Stlrb,
+    Ldxrh,
+    Ldaxrh,
+    Stxrh,
+    Stlxrh,
+    Ldarh,
+    Stlrh,
+    Beq,
+    Bne,
+    Bhs,
+    Blo,
+    Bmi,
+    Bpl,
+    Bvs,
+    Bvc,
+    Bhi,
+    Bls,
+    Bge,
+    Blt,
+    Bgt,
+    Ble,
+    Bal,
+    Bnv,
+    Count,
+};
+
+enum class OperandKind : uint8_t {
+    None,
+    Register,
+    Immediate,
+    // A shift amount, bit number or field width, written in decimal.
+    Number,
+    Memory,
+    // A branch or literal address, already resolved.
+    Target,
+    Condition,
+    // `value` is op0:op1:CRn:CRm:op2 as in MRS and MSR.
+    SystemRegister,
+    // The CRm option of DMB and DSB.
+    Barrier,
+    // The prefetch operation of PRFM.
+    Prefetch,
+};
+
+// Shifts of register and immediate operands, extensions of register and
+// index operands.
+enum class Extend : uint8_t {
+    None,
+    Lsl,
+    Lsr,
+    Asr,
+    Ror,
+    Uxtb,
+    Uxth,
+    Uxtw,
+    Uxtx,
+    Sxtb,
+    Sxth,
+    Sxtw,
+    Sxtx,
+};
+
+enum class Indexing : uint8_t {
+    Offset,
+    // [base, #offset]!
+    PreIndex,
+    // [base], #offset
+    PostIndex,
+};
+
+struct Operand {
+    OperandKind kind = OperandKind::None;
+    // Register width in bytes: 4 or 8 for W and X, 1 to 16 for B to Q.
+    uint8_t size = 0;
+    // The register itself for Register operands, the base for Memory ones.
+    Register base = Register::None;
+    Register index = Register::None;
+    Extend extend = Extend::None;
+    uint8_t amount = 0;
+    Indexing indexing = Indexing::Offset;
+    // Immediate, offset, target or condition code depending on `kind`.
+    int64_t value = 0;
+};
+
+// Every instruction is four bytes long.
+constexpr size_t InstructionLength = 4;
+
+struct Instruction {
+    uint64_t address = 0;
+    uint32_t encoding = 0;
+    Mnemonic mnemonic = Mnemonic::Unknown;
+    uint8_t operandCount = 0;
+    std::array<Operand, 4> operands;
+
+    [[nodiscard]] std::span<const Operand> getOperands() const noexcept {
+        return std::span(operands).first(operandCount);
+    }
+
+    // The destination of a direct or conditional branch.
+    [[nodiscard]] std::optional<uint64_t> branchTarget() const noexcept;
+};
+
+static_assert(sizeof(Instruction) == 80);
+
+[[nodiscard]] std::string_view mnemonicName(Mnemonic mnemonic) noexcept;
+[[nodiscard]] std::string_view registerName(Register reg,
+                                            size_t size) noexcept;
+
+// Branches and returns: anything ending a straight line of code.
+[[nodiscard]] bool isControlFlow(Mnemonic mnemonic) noexcept;
+
+// Decodes one instruction word found at `address`.
+[[nodiscard]] Instruction decodeInstruction(uint32_t word,
+                                            uint64_t address) noexcept;
+// Decodes the instruction at `code[offset]`, `address` being the address of
+// `code[0]`. Fewer than four bytes decode as Unknown. Throws
+// std::out_of_range unless `offset` is inside `code`.
+[[nodiscard]] Instruction decodeInstruction(std::span<const uint8_t> code,
+                                            size_t offset, uint64_t address);
+
+// Decodes every whole instruction word of `code`, reusing the storage of
+// `out` (which is cleared first).
+void decode(std::span<const uint8_t> code, uint64_t address,
+            std::vector<Instruction> &out);
+
+using X86_64::SymbolResolver;
+
+// Appends the textual form of `ins` (tab indented, newline terminated).
+void formatInstruction(std::string &out, const Instruction &ins,
+                       const SymbolResolver &resolver = {});
+
+} // namespace AArch64
+
+// An instruction set listings can be specialized on. Its members are
+// static, so code templated on it calls the decoder and formatter directly
+// rather than through a virtual call per instruction.
+template <typename T>
+concept Isa = requires(std::span<const uint8_t> code, size_t offset,
+                       uint64_t address, std::string &out,
+                       const typename T::Instruction &ins,
+                       std::vector<typename T::Instruction> &instructions,
+                       const X86_64::SymbolResolver &resolver) {
+    { T::Machine } -> std::convertible_to<uint16_t>;
+    T::decode(code, address, instructions);
+    {
+        T::decodeInstruction(code, offset, address)
+    } -> std::same_as<typename T::Instruction>;
+    { T::length(ins) } -> std::convertible_to<size_t>;
+    T::format(out, ins, resolver);
+};
+
+struct X86_64Isa {
+    using Instruction = X86_64::Instruction;
+    static constexpr uint16_t Machine = EM_X86_64;
+
+    static void decode(std::span<const uint8_t> code, uint64_t address,
+                       std::vector<Instruction> &out) {
+        X86_64::decode(code, address, ReadingMode::LSB, out);
+    }
+    [[nodiscard]] static Instruction
+    decodeInstruction(std::span<const uint8_t> code, size_t offset,
+                      uint64_t address) {
+        return X86_64::decodeInstruction(code, offset, address,
+                                         ReadingMode::LSB);
+    }
+    [[nodiscard]] static size_t length(const Instruction &ins) noexcept {
+        return ins.length;
+    }
+    static void format(std::string &out, const Instruction &ins,
+                       const X86_64::SymbolResolver &resolver) {
+        X86_64::formatInstruction(out, ins, resolver);
+    }
+};
+
+struct AArch64Isa {
+    using Instruction = AArch64::Instruction;
+    static constexpr uint16_t Machine = EM_AARCH64;
+
+    static void decode(std::span<const uint8_t> code, uint64_t address,
+                       std::vector<Instruction> &out) {
+        AArch64::decode(code, address, out);
+    }
+    [[nodiscard]] static Instruction
+    decodeInstruction(std::span<const uint8_t> code, size_t offset,
+                      uint64_t address) {
+        return AArch64::decodeInstruction(code, offset, address);
+    }
+    [[nodiscard]] static size_t length(const Instruction &) noexcept {
+        return AArch64::InstructionLength;
+    }
+    static void format(std::string &out, const Instruction &ins,
+                       const X86_64::SymbolResolver &resolver) {
+        AArch64::formatInstruction(out, ins, resolver);
+    }
+};
+
+static_assert(Isa<X86_64Isa> && Isa<AArch64Isa>);
+
+// Calls `fn` with the Isa of ELF machine `machine`, so that everything `fn`
+// instantiates is specialized for it.
+template <typename Fn> decltype(auto) withIsa(uint16_t machine, Fn &&fn) {
+    switch (machine) {
+    case X86_64Isa::Machine:
+        return fn(X86_64Isa{});
+    case AArch64Isa::Machine:
+        return fn(AArch64Isa{});
+    default:
+        throw std::runtime_error(
+            std::format("Unsupported machine type {}", machine));
+    }
+}
+
+// Analyses built on the x86-64 decoder alone (cross references, IR, search,
+// patching...) call this first, so that code of other machines is rejected
+// rather than decoded as x86-64.
+inline void requireX86_64(uint16_t machine) {
+    if (machine != X86_64Isa::Machine) {
+        throw std::runtime_error(
+            std::format("Unsupported machine type {}", machine));
+    }
+}
+
+// The machine this program runs on, which is that of code read from the
+// memory of other processes.
+#if defined(__x86_64__)
+constexpr uint16_t HostMachine = EM_X86_64;
+#elif defined(__aarch64__)
+constexpr uint16_t HostMachine = EM_AARCH64;
+#else
+constexpr uint16_t HostMachine = EM_NONE;
+#endif
+
+std::string disassembleX86_64(const std::span<const uint8_t> code,
+                              ReadingMode readingMode, uint64_t address = 0,
+                              const X86_64::SymbolResolver &resolver = {});
+void disassembleX86_64(std::ostream &out, const std::span<const uint8_t> code,
+                       ReadingMode readingMode, uint64_t address = 0,
+                       const X86_64::SymbolResolver &resolver = {});
+
+}; // namespace disassemble
+
 #endif
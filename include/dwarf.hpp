@@ -0,0 +1,79 @@
+#ifndef _DWARF_HPP_
+#define _DWARF_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Source locations from the DWARF line tables (.debug_line).
+namespace dwarf {
+
+struct Location {
+    std::string_view file;
+    uint32_t line;
+};
+
+// Maps addresses to source lines, decoding a unit's line program only when
+// an address inside it is first looked up. Units are found through
+// .debug_aranges; without it, the first lookup decodes every unit.
+// Lookups may come from several threads.
+class LineIndex {
+  public:
+    explicit LineIndex(const binary::Elf64 &elf);
+
+    [[nodiscard]] std::optional<Location> find(uint64_t address);
+    // Line programs decoded so far.
+    [[nodiscard]] size_t getDecodedUnitCount() const;
+
+  private:
+    // Where (file, line) changes; line 0 ends a sequence.
+    struct Row {
+        uint64_t address;
+        uint32_t file;
+        uint32_t line;
+    };
+
+    struct Unit {
+        std::once_flag once;
+        std::vector<std::string> files;
+        std::vector<Row> rows;
+    };
+
+    struct Range {
+        uint64_t start;
+        uint64_t end;
+        // Offset of the line program in .debug_line.
+        uint64_t line;
+    };
+
+    void readRanges();
+    [[nodiscard]] std::optional<uint64_t> lineOffset(uint64_t info) const;
+    Unit &unitAt(uint64_t lineOffset);
+    void decode(uint64_t lineOffset, Unit &unit) const;
+    [[nodiscard]] std::optional<Location> findIn(const Unit &unit,
+                                                 uint64_t address) const;
+
+    const binary::Elf64 &elf_;
+    std::optional<size_t> info_;
+    std::optional<size_t> abbrev_;
+    std::optional<size_t> line_;
+    std::optional<size_t> str_;
+    std::optional<size_t> lineStr_;
+
+    mutable std::mutex mutex_;
+    bool rangesRead_ = false;
+    // Sorted by start.
+    std::vector<Range> ranges_;
+    std::unordered_map<uint64_t, std::unique_ptr<Unit>> units_;
+    bool allDecoded_ = false;
+};
+
+} // namespace dwarf
+
+#endif
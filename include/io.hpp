@@ -0,0 +1,105 @@
+#ifndef _IO_HPP_
+#define _IO_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reading files ahead of the code that parses them: reads are split into
+// chunks and kept in flight through io_uring, or a small pool of threads
+// calling pread where io_uring is unavailable.
+namespace io {
+
+// A queue between pipeline stages. push blocks while `capacity` items are
+// waiting, pop blocks until an item arrives or the queue is closed.
+template <typename T> class Queue {
+  public:
+    explicit Queue(size_t capacity) : capacity_(capacity) {}
+
+    void push(T item) {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+    }
+
+    // Empty once the queue is closed and drained.
+    [[nodiscard]] std::optional<T> pop() {
+        std::unique_lock lock(mutex_);
+        notEmpty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        return take();
+    }
+
+    [[nodiscard]] std::optional<T> tryPop() {
+        std::lock_guard lock(mutex_);
+        return take();
+    }
+
+    void close() {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+  private:
+    std::optional<T> take() {
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return item;
+    }
+
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+struct Loaded {
+    // Into the paths given to the Reader.
+    size_t index;
+    std::vector<uint8_t> data;
+    // Empty when the file was read.
+    std::string error;
+};
+
+class Reader {
+  public:
+    // Starts reading `paths` in order on a thread of its own, keeping at
+    // most `ahead` files read or in flight that next() has not returned,
+    // and past the first, at most `budget` bytes.
+    Reader(std::vector<std::string> paths, size_t ahead,
+           size_t budget = size_t(256) << 20);
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+    // Stops reading and waits for the reads in flight.
+    ~Reader();
+
+    // The next file to finish, in completion order. Empty once every file
+    // has been returned.
+    [[nodiscard]] std::optional<Loaded> next();
+    [[nodiscard]] bool usesIoUring() const noexcept;
+
+  private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+// Reads a whole file with its chunks read in parallel.
+[[nodiscard]] std::vector<uint8_t> readFile(std::string_view filepath);
+
+} // namespace io
+
+#endif
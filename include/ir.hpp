@@ -0,0 +1,173 @@
+#ifndef _IR_HPP_
+#define _IR_HPP_
+
+#include <array>
+#include <binary.hpp>
+#include <cfg.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Register transfer representation of x86-64 code (`RAX += 15` rather than
+// `add rax, 0xf`).
+namespace ir {
+
+enum class Opcode : uint8_t {
+    // Removed by simplification; never present in a finished Function.
+    Nop,
+    Const,
+    Get,
+    Put,
+    Load,
+    Store,
+    Add,
+    Sub,
+    Mul,
+    And,
+    Or,
+    Xor,
+    Shl,
+    Shr,
+    Sar,
+    Rol,
+    Ror,
+    Not,
+    Trunc,
+    Zext,
+    Sext,
+    Flags,
+    Cond,
+    Select,
+    Jump,
+    Branch,
+    Call,
+    Return,
+    // An instruction without a model, kept opaque.
+    Intrinsic,
+};
+
+namespace Flag {
+constexpr uint8_t CF = 1 << 0;
+constexpr uint8_t PF = 1 << 1;
+constexpr uint8_t AF = 1 << 2;
+constexpr uint8_t ZF = 1 << 3;
+constexpr uint8_t SF = 1 << 4;
+constexpr uint8_t OF = 1 << 5;
+constexpr uint8_t All = CF | PF | AF | ZF | SF | OF;
+// Set in Flags ops whose effect depends on a runtime shift count: they may
+// leave the flags untouched.
+constexpr uint8_t Partial = 1 << 6;
+} // namespace Flag
+
+constexpr uint32_t NoValue = 0xffffffff;
+
+// Every op defines the value named by its index in the function. `a`, `b`
+// and `c` are indices of earlier ops unless noted:
+//   Const       value is `b:a`
+//   Get, Put    `aux` is the disassemble Register; Put writes `a`. A 4 byte
+//               Put zero extends into the full register, 1 and 2 byte ones
+//               keep the upper bits.
+//   Load        `aux` is the Segment, `a` the address
+//   Store       `aux` is the Segment, `a` the address, `b` the value
+//   Flags       `aux` holds the Flag mask written and, in its high byte, the
+//               Opcode computing them from `a` and `b` into `c`
+//   Cond        `aux` is the condition code (Jcc order), `a` the Flags op
+//               it tests when known in the block, or NoValue
+//   Select      `a` ? `b` : `c`
+//   Jump        to `a`
+//   Branch      to `b` when `a`
+//   Call        `a`
+//   Intrinsic   `aux` is the Mnemonic, `a` the instruction index
+struct Op {
+    Opcode opcode = Opcode::Nop;
+    // Size of the result in bytes.
+    uint8_t size = 0;
+    uint16_t aux = 0;
+    uint32_t a = NoValue;
+    uint32_t b = NoValue;
+    uint32_t c = NoValue;
+
+    [[nodiscard]] uint64_t constant() const noexcept {
+        return (uint64_t)b << 32 | a;
+    }
+};
+
+static_assert(sizeof(Op) == 16);
+
+// The lifted form of one function. The ops of instruction i are
+// `getOps()[offsets[i], offsets[i + 1])`; instructions may also refer to
+// constants defined by earlier ones.
+class Function {
+  public:
+    [[nodiscard]] const std::vector<Op> &getOps() const noexcept;
+    [[nodiscard]] size_t getInstructionCount() const noexcept;
+    // Index of the first op of `instruction`.
+    [[nodiscard]] size_t firstOp(size_t instruction) const noexcept;
+    [[nodiscard]] std::span<const Op> ops(size_t instruction) const noexcept;
+
+  private:
+    friend class Lifter;
+
+    std::vector<Op> ops_;
+    std::vector<uint32_t> instructionOffsets_;
+};
+
+// Lifts functions one at a time. Its scratch storage, like that of the
+// Function passed in, is reused, so a Lifter per thread lifts any number
+// of functions without allocating once warmed up.
+class Lifter {
+  public:
+    // `graph` must have been built from `instructions`.
+    void lift(std::span<const disassemble::X86_64::Instruction> instructions,
+              const cfg::Graph &graph, Function &out);
+
+  private:
+    void liftInstruction(const disassemble::X86_64::Instruction &ins,
+                         size_t index);
+    void removeDeadFlags(const cfg::Graph &graph,
+                         std::span<const disassemble::X86_64::Instruction>
+                             instructions);
+    void removeUnused();
+
+    uint32_t emit(Op op);
+    uint32_t constant(uint64_t value, size_t size);
+    uint32_t binary(Opcode opcode, size_t size, uint32_t left, uint32_t right);
+    uint32_t unary(Opcode opcode, size_t size, uint32_t value);
+    uint32_t get(disassemble::X86_64::Register reg, size_t size);
+    void put(disassemble::X86_64::Register reg, size_t size, uint32_t value);
+    uint32_t address(const disassemble::X86_64::Operand &operand);
+    uint32_t read(const disassemble::X86_64::Operand &operand, size_t size);
+    void write(const disassemble::X86_64::Operand &operand, uint32_t value);
+    void flags(Opcode opcode, uint8_t mask, uint32_t left, uint32_t right,
+               uint32_t result);
+    uint32_t condition(uint8_t cc);
+    void forget();
+
+    Function *out_ = nullptr;
+    const disassemble::X86_64::Instruction *ins_ = nullptr;
+    // Constant held by each general purpose register, or NoValue.
+    std::array<uint32_t, 16> registers_;
+    uint32_t lastFlags_ = NoValue;
+    std::vector<uint32_t> uses_;
+};
+
+// Appends one line per statement of `instruction` (tab indented, newline
+// terminated). Values used by a statement are printed inline, as of the
+// start of the instruction.
+void formatInstruction(std::string &out, const Function &function,
+                       size_t instruction,
+                       const disassemble::X86_64::SymbolResolver &resolver = {});
+
+// Decodes and lifts every function of `elf` on `jobs` threads, calling
+// `callback` from the worker threads as each one is done. The graph and
+// the Function are only valid during the call.
+void liftAll(const binary::Elf64 &elf, size_t jobs,
+             const std::function<void(size_t function, const cfg::Graph &,
+                                      const Function &)> &callback);
+
+} // namespace ir
+
+#endif
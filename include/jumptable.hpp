@@ -0,0 +1,81 @@
+#ifndef _JUMPTABLE_HPP_
+#define _JUMPTABLE_HPP_
+
+#include <binary.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+// Switch tables behind indirect jumps, recognised from the few instruction
+// sequences compilers emit for them rather than by symbolic execution:
+//
+//     jmp qword [index*8 + table]
+//     mov reg, qword [index*8 + table] / jmp reg
+//     lea base, [rip + table] / movsxd reg, dword [base + index*4]
+//         add reg, base / jmp reg
+//
+// The entry count comes from the `cmp index, imm` / `ja` guarding the jump.
+namespace jumptable {
+
+struct Table {
+    // Address of the indirect jump.
+    uint64_t jump;
+    uint64_t address;
+    uint8_t entrySize;
+    // Entries are signed offsets from `address` rather than addresses.
+    bool relative;
+    // The entry count comes from a bounds check. Otherwise entries are read
+    // for as long as they point into the function.
+    bool bounded;
+    // In table order, repeats included. Targets outside the function are
+    // left out.
+    std::vector<uint64_t> targets;
+};
+
+// The tables used by the indirect jumps in `instructions`, the linear
+// decode of function `function`.
+[[nodiscard]] std::vector<Table>
+recover(const binary::Elf64 &elf, size_t function,
+        std::span<const disassemble::X86_64::Instruction> instructions);
+
+// Decodes function `function` into `out` so that every target of `tables`
+// starts an instruction: when one falls inside an instruction of the linear
+// decode, decoding restarts there.
+void decode(const binary::Elf64 &elf, size_t function,
+            std::span<const Table> tables,
+            std::vector<disassemble::X86_64::Instruction> &out);
+
+// Decodes function `function` into `out` and recovers its tables into
+// `tables`, redecoding when a target was not on an instruction boundary.
+void decode(const binary::Elf64 &elf, size_t function,
+            std::vector<disassemble::X86_64::Instruction> &out,
+            std::vector<Table> &tables);
+
+// The tables of every function of a binary, recovered the first time the
+// function is decoded. Later decodes reuse them. Functions may be decoded
+// from several threads.
+class Cache {
+  public:
+    explicit Cache(const binary::Elf64 &elf);
+
+    // Decodes function `function` into `out` and returns its tables.
+    [[nodiscard]] std::span<const Table>
+    decode(size_t function, std::vector<disassemble::X86_64::Instruction> &out);
+
+  private:
+    struct Entry {
+        std::once_flag once;
+        std::vector<Table> tables;
+    };
+
+    const binary::Elf64 &elf_;
+    std::unique_ptr<Entry[]> entries_;
+};
+
+} // namespace jumptable
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef _LISTING_HPP_
+#define _LISTING_HPP_
+
+#include <archive.hpp>
+#include <binary.hpp>
+#include <cstdint>
+#include <dedup.hpp>
+#include <disassemble.hpp>
+#include <dwarf.hpp>
+#include <iosfwd>
+#include <mix.hpp>
+#include <patch.hpp>
+#include <process.hpp>
+#include <profile.hpp>
+#include <query.hpp>
+#include <search.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace listing {
+
+// Instruction storage reused from one listing to the next, one vector per
+// instruction set.
+using DecodeBuffers =
+    std::tuple<std::vector<disassemble::X86_64::Instruction>,
+               std::vector<disassemble::AArch64::Instruction>>;
+
+// Writes the disassembly of `main`, which is what `disasmer <file>` prints.
+void writeMainListing(std::ostream &out, const binary::Binary &bin);
+// Same as above, appending to `text` and decoding into `buffers`, so that
+// callers listing many files reuse both.
+void appendMainListing(std::string &text, const binary::Binary &bin,
+                       DecodeBuffers &buffers);
+
+// Writes the disassembly of function `function`.
+void writeFunction(std::ostream &out, const binary::Elf64 &elf,
+                   size_t function);
+
+// Writes every function of every member of `archive`, members being
+// decoded in parallel and written in archive order.
+void writeArchive(std::ostream &out, const archive::Archive &archive,
+                  size_t jobs);
+
+// One line per section with its address and size. Compressed sections are
+// decompressed, in parallel, to report their real size.
+void writeSections(std::ostream &out, const binary::Elf64 &elf, size_t jobs);
+
+// Writes the disassembly of function `function` with the source line of
+// each run of instructions, quoting the line when the file is readable.
+void writeFunctionSource(std::ostream &out, const binary::Elf64 &elf,
+                         size_t function, dwarf::LineIndex &lines);
+
+// Writes the basic blocks of function `function` with their successors.
+void writeFunctionGraph(std::ostream &out, const binary::Elf64 &elf,
+                        size_t function);
+
+// Writes function `function` lifted to register transfers, block by block.
+void writeFunctionIR(std::ostream &out, const binary::Elf64 &elf,
+                     size_t function);
+
+// Same as writeFunctionIR for every function, lifted in parallel and
+// written in function order.
+void writeLiftedFunctions(std::ostream &out, const binary::Elf64 &elf,
+                          size_t jobs);
+
+// Writes the disassembly of function `function`, annotating every
+// instruction with the registers live after it and the ones it writes for
+// nothing.
+void writeFunctionLiveness(std::ostream &out, const binary::Elf64 &elf,
+                           size_t function);
+
+// Groups of identical functions, the most bytes duplicated first, and the
+// total that deduplication would save.
+void writeIdenticalFunctions(std::ostream &out, const binary::Elf64 &elf,
+                             const dedup::Groups &groups);
+
+// Writes the disassembly of every function. Each group of identical
+// functions is decoded and formatted once, under the names of all its
+// members.
+void writeAllFunctions(std::ostream &out, const binary::Elf64 &elf,
+                       const dedup::Groups &groups, size_t jobs);
+
+// Writes the disassembly of the `limit` hottest functions of `profile`,
+// each instruction with its share of the function's samples.
+void writeProfile(std::ostream &out, const binary::Elf64 &elf,
+                  const profile::Profile &profile, size_t limit, size_t jobs);
+
+// One line per captured mapping of a process, with the symbols known.
+void writeProcessMappings(std::ostream &out, const process::Snapshot &snapshot,
+                          const process::Symbols &symbols);
+
+// Writes the disassembly of [address, address + size) as read from a
+// process, naming call and jump targets through `symbols`.
+void writeProcessMemory(std::ostream &out, const process::Snapshot &snapshot,
+                        const process::Symbols &symbols, uint64_t address,
+                        size_t size);
+
+// Each write with the instructions it replaces (-) and the new ones (+).
+void writePatches(std::ostream &out, const binary::Elf64 &elf,
+                  std::span<const patch::Write> writes);
+
+// Writes the disassembly of [start, end) under `label`, decoding only those
+// bytes and writing as it goes.
+void writeRange(std::ostream &out, const query::Image &image,
+                std::string_view label, uint64_t start, uint64_t end);
+
+// One line per match with its address, location and either the bytes or,
+// for instruction matches, the instructions matched.
+void writeMatches(std::ostream &out, const binary::Elf64 &elf,
+                  std::span<const search::Match> matches, bool instructions);
+
+// The instruction mix of a whole binary: mnemonics, prefixes, operand forms
+// and the opcodes the decoder has no model for, then the `limit` largest
+// functions with their own counts.
+void writeInstructionMix(std::ostream &out, const binary::Elf64 &elf,
+                         const mix::Mix &mix, size_t limit);
+
+// `name+0xoffset` for addresses inside a known function, or the bare
+// address.
+[[nodiscard]] std::string describeAddress(const binary::Elf64 &elf,
+                                          uint64_t address);
+
+} // namespace listing
+
+#endif
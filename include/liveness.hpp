@@ -0,0 +1,97 @@
+#ifndef _LIVENESS_HPP_
+#define _LIVENESS_HPP_
+
+#include <cfg.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+// Register def/use and liveness of a single function.
+namespace liveness {
+
+// Bit i is general purpose register i (RAX = 0 ... R15 = 15), followed by
+// the arithmetic flags. High byte registers count as their full register.
+using RegisterSet = uint64_t;
+
+namespace Registers {
+constexpr RegisterSet General = 0xffff;
+constexpr RegisterSet CF = 1ull << 16;
+constexpr RegisterSet PF = 1ull << 17;
+constexpr RegisterSet AF = 1ull << 18;
+constexpr RegisterSet ZF = 1ull << 19;
+constexpr RegisterSet SF = 1ull << 20;
+constexpr RegisterSet OF = 1ull << 21;
+constexpr RegisterSet Flags = CF | PF | AF | ZF | SF | OF;
+// System V: preserved across calls, and the ones carrying arguments.
+constexpr RegisterSet CalleeSaved =
+    1 << 3 | 1 << 4 | 1 << 5 | 1 << 12 | 1 << 13 | 1 << 14 | 1 << 15;
+constexpr RegisterSet Arguments = 1 << 7 | 1 << 6 | 1 << 2 | 1 << 1 |
+                                  1 << 8 | 1 << 9;
+} // namespace Registers
+
+[[nodiscard]] constexpr RegisterSet
+registerBit(disassemble::X86_64::Register reg) noexcept {
+    using disassemble::X86_64::Register;
+    if (reg <= Register::R15) {
+        return 1ull << (size_t)reg;
+    }
+    if (reg >= Register::AH && reg <= Register::BH) {
+        return 1ull << ((size_t)reg - (size_t)Register::AH);
+    }
+    return 0;
+}
+
+struct Effects {
+    RegisterSet uses = 0;
+    RegisterSet defs = 0;
+};
+
+// Registers read and written by `ins`. Calls follow the System V calling
+// convention; instructions without a model read everything.
+[[nodiscard]] Effects effects(const disassemble::X86_64::Instruction &ins);
+
+// Appends the names of the general purpose registers in `set`, space
+// separated.
+void formatRegisterSet(std::string &out, RegisterSet set);
+
+class Analysis {
+  public:
+    // `graph` must have been built from `instructions`. Storage is reused
+    // between runs.
+    void run(std::span<const disassemble::X86_64::Instruction> instructions,
+             const cfg::Graph &graph);
+
+    [[nodiscard]] RegisterSet liveIn(size_t block) const noexcept;
+    [[nodiscard]] RegisterSet liveOut(size_t block) const noexcept;
+    // Registers live right after `instruction` executes.
+    [[nodiscard]] RegisterSet liveAfter(size_t instruction) const noexcept;
+    // General purpose registers written by `instruction` that nothing reads
+    // afterwards. Calls never have any: their definitions are clobbers.
+    [[nodiscard]] RegisterSet
+    deadDefinitions(size_t instruction) const noexcept;
+    // Callee saved registers pushed and popped by the function without
+    // being written anywhere else, making the save unnecessary.
+    [[nodiscard]] RegisterSet uselessSaves() const noexcept;
+
+  private:
+    struct BlockSets {
+        RegisterSet uses;
+        RegisterSet defs;
+        RegisterSet in;
+        RegisterSet out;
+    };
+
+    std::vector<BlockSets> blocks_;
+    std::vector<Effects> effects_;
+    std::vector<RegisterSet> liveAfter_;
+    std::vector<uint8_t> isCall_;
+    std::vector<uint32_t> worklist_;
+    std::vector<uint8_t> queued_;
+    RegisterSet uselessSaves_ = 0;
+};
+
+} // namespace liveness
+
+#endif
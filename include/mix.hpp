@@ -0,0 +1,77 @@
+#ifndef _MIX_HPP_
+#define _MIX_HPP_
+
+#include <array>
+#include <binary.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <string>
+#include <vector>
+
+// Instruction mix statistics: what a binary's code is made of, counted
+// straight from decoded instructions.
+namespace mix {
+
+// Operand forms are the kinds of up to three operands, base 5.
+constexpr size_t OperandKinds = 5;
+constexpr size_t FormCount = OperandKinds * OperandKinds * OperandKinds;
+
+struct Counts {
+    uint64_t instructions = 0;
+    uint64_t bytes = 0;
+    // SSE and AVX: VEX/EVEX encoded, 0F 38/0F 3A or the vector parts of 0F.
+    uint64_t simd = 0;
+    // Pushes, pops, calls, returns and memory operands based on rsp or rbp.
+    uint64_t stack = 0;
+    uint64_t memoryOperands = 0;
+    uint64_t ripRelative = 0;
+    std::array<uint64_t, (size_t)disassemble::X86_64::Mnemonic::Count>
+        mnemonics{};
+    // One per disassemble::X86_64::Prefix bit.
+    std::array<uint64_t, 8> prefixes{};
+    // Indexed by disassemble::X86_64::Segment.
+    std::array<uint64_t, 7> segments{};
+    std::array<uint64_t, FormCount> forms{};
+    // Opcodes decoded without a model, by opcode map and opcode.
+    std::array<std::array<uint64_t, 256>, 4> unknown{};
+    uint64_t unknownVex = 0;
+
+    void add(const disassemble::X86_64::Instruction &ins) noexcept;
+    Counts &operator+=(const Counts &other) noexcept;
+};
+
+struct FunctionMix {
+    uint32_t instructions = 0;
+    uint32_t unknown = 0;
+    uint32_t locked = 0;
+    uint32_t simd = 0;
+    uint32_t stack = 0;
+    uint32_t memoryOperands = 0;
+    // The most frequent mnemonics with their counts, most frequent first.
+    std::array<disassemble::X86_64::Mnemonic, 3> top{};
+    std::array<uint32_t, 3> topCounts{};
+};
+
+// `r, m`-style name of an operand form.
+[[nodiscard]] std::string formName(size_t form);
+
+class Mix {
+  public:
+    // Decodes every function on `jobs` workers, each counting into its own
+    // totals, merged at the end. Code covered by several symbols counts
+    // once in the totals but in full for each of its functions.
+    [[nodiscard]] static Mix build(const binary::Elf64 &elf, size_t jobs);
+
+    [[nodiscard]] const Counts &getTotals() const noexcept;
+    // Indexed like elf.getFunctions().
+    [[nodiscard]] const std::vector<FunctionMix> &
+    getFunctions() const noexcept;
+
+  private:
+    Counts totals_;
+    std::vector<FunctionMix> functions_;
+};
+
+} // namespace mix
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+[[nodiscard]] inline size_t defaultJobCount() noexcept {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Calls fn(item, worker) for every item in [0, count) using `jobs` threads,
+// the calling thread included. Items are handed out one at a time, so
+// uneven work balances itself. fn must not throw.
+template <typename Fn> void forEach(size_t count, size_t jobs, Fn &&fn) {
+    jobs = std::clamp<size_t>(jobs, 1, std::max<size_t>(count, 1));
+    std::atomic<size_t> next = 0;
+    auto worker = [&](size_t workerIdx) {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i, workerIdx);
+        }
+    };
+    std::vector<std::jthread> threads;
+    threads.reserve(jobs - 1);
+    for (size_t w = 1; w < jobs; w++) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+}
+
+// Sorts `items` by sorting one run per job in parallel and then merging
+// neighbouring runs pairwise, each round of merges running in parallel.
+template <typename T, typename Compare>
+void sort(std::vector<T> &items, size_t jobs, Compare compare) {
+    // Small inputs are not worth the threads.
+    size_t runs = std::clamp<size_t>(jobs, 1, items.size() / 4096 + 1);
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t i = 0; i <= runs; i++) {
+        bounds[i] = items.size() * i / runs;
+    }
+    auto at = [&](size_t run) { return items.begin() + bounds[run]; };
+    forEach(runs, runs, [&](size_t run, size_t) {
+        std::sort(at(run), at(run + 1), compare);
+    });
+    for (size_t width = 1; width < runs; width *= 2) {
+        size_t merges = (runs + 2 * width - 1) / (2 * width);
+        forEach(merges, jobs, [&](size_t merge, size_t) {
+            size_t low = merge * 2 * width;
+            size_t middle = std::min(low + width, runs);
+            size_t high = std::min(low + 2 * width, runs);
+            if (middle < high) {
+                std::inplace_merge(at(low), at(middle), at(high), compare);
+            }
+        });
+    }
+}
+
+} // namespace parallel
+
+#endif
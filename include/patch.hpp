@@ -0,0 +1,75 @@
+#ifndef _PATCH_HPP_
+#define _PATCH_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Rewriting instructions of an ELF file through a writable mapping.
+namespace patch {
+
+// New instructions for `address`. Empty bytes turn the instruction at
+// `address` into NOPs.
+struct Edit {
+    uint64_t address;
+    std::vector<uint8_t> bytes;
+};
+
+// An edit checked against the code. It covers whole instructions, the room
+// the new ones leave being filled with NOPs.
+struct Write {
+    uint64_t address;
+    // Where `address` is in the file.
+    size_t offset;
+    std::vector<uint8_t> original;
+    std::vector<uint8_t> bytes;
+};
+
+// Checks `edits` against the decoded instructions of the functions they land
+// in and orders them by address. Throws std::runtime_error for an edit that
+// does not start on an instruction boundary, does not decode to whole
+// instructions, runs past the end of its function or overlaps another one.
+// New instructions the decoder does not know are refused unless `force`.
+[[nodiscard]] std::vector<Write> plan(const binary::Elf64 &elf,
+                                      std::span<const Edit> edits,
+                                      bool force = false);
+
+enum class Mapping {
+    // Changes reach the file; only the touched pages are written back.
+    Shared,
+    // Changes stay in copy-on-write pages and the file is left alone.
+    Private,
+};
+
+// A file mapped writable, with writes applied to it.
+class PatchedFile {
+  public:
+    // Throws std::runtime_error, before changing anything, when the file no
+    // longer holds the original bytes of every write.
+    [[nodiscard]] static PatchedFile apply(std::string_view path,
+                                           std::span<const Write> writes,
+                                           Mapping mapping);
+
+    PatchedFile(PatchedFile &&other) noexcept;
+    PatchedFile &operator=(PatchedFile &&other) = delete;
+    ~PatchedFile();
+
+    // The patched contents, e.g. for an Elf64 view of the result.
+    [[nodiscard]] std::span<const uint8_t> getData() const noexcept;
+
+  private:
+    PatchedFile(uint8_t *data, size_t size) noexcept;
+
+    uint8_t *data_;
+    size_t size_;
+};
+
+// Copies `from` to `to` with copy_file_range, so that filesystems able to
+// share extents do not duplicate the data.
+void copyFile(std::string_view from, std::string_view to);
+
+} // namespace patch
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef _PROCESS_HPP_
+#define _PROCESS_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+// Code of a running process, read through process_vm_readv.
+namespace process {
+
+struct Mapping {
+    uint64_t start;
+    uint64_t end;
+    // Offset of `start` in the mapped file.
+    uint64_t offset;
+    bool executable;
+    // File name, `[name]` for special mappings, empty for anonymous ones.
+    std::string path;
+};
+
+// The mappings listed in /proc/<pid>/maps, in address order.
+[[nodiscard]] std::vector<Mapping> readMappings(pid_t pid);
+
+// A copy of the executable mappings of a process, taken in as few
+// process_vm_readv calls as the kernel allows.
+class Snapshot {
+  public:
+    struct Options {
+        // Keep the process stopped (SIGSTOP) only while reading. A process
+        // that was already stopped is left stopped.
+        bool stop = false;
+        // Mappings beyond this many bytes in total are left out.
+        size_t maxBytes = size_t(1) << 30;
+        // When set, only [address, address + size) is read, clipped to the
+        // executable mapping holding `address`, instead of every mapping.
+        std::optional<uint64_t> address;
+        size_t size = 0;
+    };
+
+    [[nodiscard]] static Snapshot capture(pid_t pid, const Options &options);
+
+    // Executable mappings that could be read, in address order.
+    [[nodiscard]] const std::vector<Mapping> &getMappings() const noexcept;
+    // The captured bytes of [address, address + size), or an empty span
+    // when the range is not inside one captured mapping.
+    [[nodiscard]] std::span<const uint8_t>
+    getBytes(uint64_t address, size_t size) const noexcept;
+    // The captured mapping containing `address`.
+    [[nodiscard]] const Mapping *findMapping(uint64_t address) const noexcept;
+
+  private:
+    std::vector<Mapping> mappings_;
+    // Where each mapping starts in memory_.
+    std::vector<size_t> positions_;
+    std::vector<uint8_t> memory_;
+};
+
+struct Symbol {
+    uint64_t address;
+    uint64_t size;
+    std::string_view name;
+};
+
+// Names for the addresses of a process: the symbol tables of its mapped ELF
+// files, relocated to where they are loaded, and /tmp/perf-<pid>.map as
+// written by JIT compilers.
+class Symbols {
+  public:
+    [[nodiscard]] static Symbols load(pid_t pid,
+                                      std::span<const Mapping> mappings);
+
+    // The symbol whose [address, address + size) contains `address`.
+    [[nodiscard]] std::optional<Symbol> find(uint64_t address) const;
+    [[nodiscard]] std::optional<Symbol> find(std::string_view name) const;
+    // `name@plt` / `name@got` for the import stubs and slots of the mapped
+    // files, or an empty view.
+    [[nodiscard]] std::string_view findImport(uint64_t address) const;
+    [[nodiscard]] size_t getModuleCount() const noexcept;
+    [[nodiscard]] size_t getJitSymbolCount() const noexcept;
+
+  private:
+    struct Module {
+        std::unique_ptr<binary::Binary> file;
+        const binary::Elf64 *elf;
+        // Runtime address minus file address.
+        uint64_t bias;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    std::vector<Module> modules_;
+    std::string jitNames_;
+    // Sorted by address; names point into jitNames_.
+    std::vector<Symbol> jitSymbols_;
+};
+
+} // namespace process
+
+#endif
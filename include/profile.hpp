@@ -0,0 +1,66 @@
+#ifndef _PROFILE_HPP_
+#define _PROFILE_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Sampling profiles attributed to the functions and instructions of a
+// binary.
+namespace profile {
+
+struct Sample {
+    uint64_t address;
+    uint64_t count;
+};
+
+// Reads `perf script` output or lines of `address count` (a lone address
+// counting once), addresses being hex with or without `0x`. For perf
+// callchains only the leaf frame counts. Returns one sample per address, in
+// address order.
+[[nodiscard]] std::vector<Sample> parseSamples(std::string_view text,
+                                               size_t jobs);
+
+struct FunctionProfile {
+    uint32_t function;
+    uint64_t count;
+};
+
+class Profile {
+  public:
+    // Attributes `samples` (as returned by parseSamples) to the functions
+    // of `elf` after subtracting `bias`, the load address of the binary.
+    [[nodiscard]] static Profile build(const binary::Elf64 &elf,
+                                       std::vector<Sample> &&samples,
+                                       uint64_t bias);
+
+    [[nodiscard]] uint64_t getTotal() const noexcept;
+    // Samples outside every known function.
+    [[nodiscard]] uint64_t getUnattributed() const noexcept;
+    // Functions with samples, hottest first.
+    [[nodiscard]] const std::vector<FunctionProfile> &
+    getFunctions() const noexcept;
+    // The samples within [offset, offset + size) of `function`, in address
+    // order.
+    [[nodiscard]] std::span<const Sample>
+    samplesIn(const binary::Function &function) const noexcept;
+
+  private:
+    std::vector<Sample> samples_;
+    std::vector<FunctionProfile> functions_;
+    uint64_t total_ = 0;
+    uint64_t unattributed_ = 0;
+};
+
+// Sets counts[i] to the samples falling inside instructions[i]. Both spans
+// must be in address order.
+void countInstructions(
+    std::span<const disassemble::X86_64::Instruction> instructions,
+    std::span<const Sample> samples, std::vector<uint64_t> &counts);
+
+} // namespace profile
+
+#endif
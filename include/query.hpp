@@ -0,0 +1,70 @@
+#ifndef _QUERY_HPP_
+#define _QUERY_HPP_
+
+#include <cstdint>
+#include <elf.h>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Single lookups in ELF files too big to parse whole: the file is mapped,
+// only its headers are read up front, and a query touches just the symbol
+// table and code it needs.
+namespace query {
+
+struct Symbol {
+    std::string_view name;
+    uint64_t address;
+    uint64_t size;
+};
+
+class Image {
+  public:
+    [[nodiscard]] static Image open(std::string_view path);
+
+    Image(Image &&other) noexcept;
+    Image &operator=(Image &&other) = delete;
+    ~Image();
+
+    // Searches the string table for the name first, so that the symbol
+    // table is only compared by offset: both are read sequentially. Uses
+    // .dynsym when the file has no .symtab.
+    [[nodiscard]] std::optional<Symbol>
+    findFunction(std::string_view name) const;
+    // The function whose [address, address + size) contains `address`.
+    [[nodiscard]] std::optional<Symbol> functionAt(uint64_t address) const;
+    // The file contents of [address, address + size) through the loadable
+    // segments, or the sections when there are none. Empty when the range
+    // is not entirely inside one of them.
+    [[nodiscard]] std::span<const uint8_t>
+    getBytes(uint64_t address, size_t size) const noexcept;
+    // The ELF e_machine of the file.
+    [[nodiscard]] uint16_t getMachine() const noexcept;
+
+  private:
+    Image(const uint8_t *data, size_t size);
+
+    struct SymbolTable {
+        std::span<const uint8_t> symbols;
+        std::span<const uint8_t> names;
+    };
+
+    [[nodiscard]] std::span<const uint8_t>
+    getSection(const Elf64_Shdr &section) const noexcept;
+    [[nodiscard]] std::optional<SymbolTable> getSymbolTable() const noexcept;
+    [[nodiscard]] uint64_t getAddress(const Elf64_Sym &symbol) const noexcept;
+    [[nodiscard]] std::string_view
+    getName(const SymbolTable &table, uint32_t offset) const noexcept;
+
+    const uint8_t *data_;
+    size_t size_;
+    std::vector<Elf64_Phdr> segments_;
+    std::vector<Elf64_Shdr> sections_;
+    bool relocatable_ = false;
+    uint16_t machine_ = EM_NONE;
+};
+
+} // namespace query
+
+#endif
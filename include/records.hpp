@@ -0,0 +1,103 @@
+#ifndef _RECORDS_HPP_
+#define _RECORDS_HPP_
+
+#include <array>
+#include <binary.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+
+// Machine-readable listings written straight from decoded instructions:
+// fixed-size binary records meant to be mmap'd, and JSON Lines.
+namespace records {
+
+// Binary files are a Header, `functionCount` FunctionEntry, the function
+// names and then one InstructionRecord per instruction up to the end of the
+// file, all little-endian and 8-byte aligned.
+constexpr std::array<char, 8> Magic = {'D', 'I', 'S', 'A', 'S', 'M',
+                                       'R', '\0'};
+constexpr uint32_t Version = 1;
+
+struct Header {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t functionCount;
+    uint64_t functionsOffset;
+    uint64_t namesOffset;
+    uint64_t recordsOffset;
+};
+
+struct FunctionEntry {
+    uint64_t address;
+    uint64_t size;
+    // Into the names, which are not NUL terminated.
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+struct OperandRecord {
+    // Displacement, immediate or branch target depending on `kind`.
+    int64_t value;
+    // disassemble::X86_64::OperandKind and Register values.
+    uint8_t kind;
+    uint8_t size;
+    uint8_t base;
+    uint8_t index;
+    uint8_t scale;
+    uint8_t reserved[3];
+};
+
+enum class TargetKind : uint8_t {
+    None,
+    Branch,
+    RipRelative,
+};
+
+struct InstructionRecord {
+    uint64_t address;
+    // The branch destination or RIP-relative address, see `targetKind`.
+    uint64_t target;
+    uint32_t function;
+    // disassemble::X86_64::Mnemonic.
+    uint16_t mnemonic;
+    uint8_t length;
+    uint8_t opcodeMap;
+    uint8_t opcode;
+    uint8_t prefixes;
+    uint8_t segment;
+    uint8_t operandCount;
+    TargetKind targetKind;
+    uint8_t reserved[3];
+    OperandRecord operands[3];
+};
+
+static_assert(sizeof(Header) == 48);
+static_assert(sizeof(FunctionEntry) == 24);
+static_assert(sizeof(InstructionRecord) == 80);
+
+// Writes every function of `elf` as binary records. Functions are decoded
+// `jobs` at a time and written in order.
+void writeRecords(std::ostream &out, const binary::Elf64 &elf, size_t jobs);
+
+// One JSON object per instruction and line, e.g.
+// {"function":"main","address":4409,"length":3,"mnemonic":"cmp",
+//  "operands":[{"kind":"register","size":4,"register":"edi"},...]}
+void writeJsonLines(std::ostream &out, const binary::Elf64 &elf, size_t jobs);
+
+// A view of a binary record file, checked against its header.
+struct RecordFile {
+    std::span<const FunctionEntry> functions;
+    std::span<const InstructionRecord> instructions;
+    std::span<const char> names;
+
+    [[nodiscard]] static RecordFile open(std::span<const uint8_t> data);
+
+    [[nodiscard]] std::string_view
+    functionName(const FunctionEntry &function) const noexcept;
+};
+
+} // namespace records
+
+#endif
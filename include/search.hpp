@@ -0,0 +1,107 @@
+#ifndef _SEARCH_HPP_
+#define _SEARCH_HPP_
+
+#include <array>
+#include <binary.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Byte and instruction pattern search over the code of a binary.
+namespace search {
+
+struct Match {
+    uint64_t address;
+    // Bytes covered by the match.
+    size_t size;
+};
+
+// Hex bytes separated by spaces, `?` standing for any nibble:
+// "48 8b 05 ?? ?? ?? ?? ff d0". At least one byte must be fully fixed.
+class BytePattern {
+  public:
+    [[nodiscard]] static BytePattern parse(std::string_view text);
+
+    [[nodiscard]] size_t size() const noexcept;
+    [[nodiscard]] bool matches(const uint8_t *data) const noexcept;
+
+  private:
+    friend std::vector<Match> findBytes(const binary::Elf64 &,
+                                        const BytePattern &, size_t);
+
+    std::vector<uint8_t> bytes_;
+    std::vector<uint8_t> mask_;
+    // Fully fixed bytes checked first, sixteen positions at a time.
+    size_t firstAnchor_ = 0;
+    size_t lastAnchor_ = 0;
+};
+
+// Every occurrence of `pattern` in the executable sections, in address
+// order.
+[[nodiscard]] std::vector<Match>
+findBytes(const binary::Elf64 &elf, const BytePattern &pattern, size_t jobs);
+
+// Instructions separated by `;`, each a mnemonic (or `*`) and optionally
+// its operands: "mov reg, [rip+X]; call reg". Without operands any are
+// accepted. Operands are
+//   *                any operand
+//   rax, ecx, ...    that register
+//   reg, reg1, ...   any register, the same one wherever the name repeats
+//   imm, X           any immediate or branch target
+//   0x10, -8         that immediate or branch target
+//   mem, [*]         any memory operand
+//   [base], [base+X], [base+0x10], [base-8]
+//                    memory without an index, `base` being rip, a register
+//                    or a register variable
+class InstructionPattern {
+  public:
+    [[nodiscard]] static InstructionPattern parse(std::string_view text);
+
+    [[nodiscard]] size_t size() const noexcept;
+    // Whether the pattern matches `instructions` starting at `index`.
+    [[nodiscard]] bool
+    matchesAt(std::span<const disassemble::X86_64::Instruction> instructions,
+              size_t index) const noexcept;
+
+    struct Operand {
+        enum class Kind : uint8_t {
+            Any,
+            Register,
+            Immediate,
+            Memory,
+        };
+        Kind kind = Kind::Any;
+        // Register operands and memory bases: a fixed register (with its
+        // size for registers), a variable, or neither for any.
+        disassemble::X86_64::Register reg =
+            disassemble::X86_64::Register::None;
+        uint8_t size = 0;
+        int8_t variable = -1;
+        // Any memory operand, index included.
+        bool anyMemory = false;
+        // Immediate value or displacement; none matches any.
+        std::optional<int64_t> value;
+    };
+
+    struct Step {
+        std::optional<disassemble::X86_64::Mnemonic> mnemonic;
+        bool anyOperands = false;
+        std::vector<Operand> operands;
+    };
+
+  private:
+    std::vector<Step> steps_;
+};
+
+// Starts of every match of `pattern` within the functions of `elf`, in
+// address order.
+[[nodiscard]] std::vector<Match>
+findInstructions(const binary::Elf64 &elf, const InstructionPattern &pattern,
+                 size_t jobs);
+
+} // namespace search
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef _SERVER_HPP_
+#define _SERVER_HPP_
+
+#include <binary.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// A local query server keeping parsed binaries warm between requests.
+//
+// Requests are single lines, answered with either `ok <length>\n` followed
+// by <length> bytes of payload or `error <message>\n`:
+//
+//     function <file> <name>      disassembly of one function
+//     range <file> <start> <end>  disassembly of [start, end), hex addresses
+//     functions <file>            `<address> <size> <name>` per function
+//
+// A connection may send any number of requests.
+namespace server {
+
+// Finished listings by function index. Once they take more than `budget`
+// bytes the least recently used ones are dropped.
+class ListingCache {
+  public:
+    explicit ListingCache(size_t budget);
+
+    [[nodiscard]] std::optional<std::string> find(size_t function);
+    void insert(size_t function, std::string listing);
+
+  private:
+    using LruList = std::list<std::pair<size_t, std::string>>;
+
+    size_t budget_;
+    size_t bytes_ = 0;
+    std::mutex mutex_;
+    LruList lru_;
+    std::unordered_map<size_t, LruList::iterator> index_;
+};
+
+class BinaryCache {
+  public:
+    // Listing bytes kept per binary.
+    static constexpr size_t ListingBudget = 16 << 20;
+
+    struct Entry {
+        std::unique_ptr<binary::Binary> binary;
+        std::filesystem::file_time_type modified;
+        std::uintmax_t fileSize;
+        std::unordered_map<std::string_view, size_t> symbols;
+        ListingCache listings{ListingBudget};
+    };
+
+    explicit BinaryCache(size_t capacity);
+
+    // Returns the cached entry for `path`, (re)loading it when it is not
+    // cached yet or when the file changed on disk since it was loaded.
+    [[nodiscard]] std::shared_ptr<Entry> get(const std::string &path);
+
+  private:
+    using LruList = std::list<std::pair<std::string, std::shared_ptr<Entry>>>;
+
+    size_t capacity_;
+    std::mutex mutex_;
+    LruList lru_;
+    std::unordered_map<std::string, LruList::iterator> index_;
+};
+
+struct Options {
+    std::string socketPath;
+    size_t cacheCapacity;
+};
+
+// Serves requests until the process is killed. Every client gets its own
+// thread; all of them share one cache.
+[[noreturn]] void serve(const Options &options);
+
+// Answers a single request line against `cache`.
+[[nodiscard]] std::string handleRequest(BinaryCache &cache,
+                                        std::string_view request);
+
+// Sends one request and returns its payload, throwing on `error` replies.
+[[nodiscard]] std::string query(const std::string &socketPath,
+                                std::string_view request);
+
+} // namespace server
+
+#endif
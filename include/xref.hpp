@@ -0,0 +1,69 @@
+#ifndef _XREF_HPP_
+#define _XREF_HPP_
+
+#include <binary.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Cross references and call graph of a whole binary.
+namespace xref {
+
+enum class Kind : uint8_t {
+    Call,
+    Jump,
+    // RIP-relative memory operand, including lea.
+    Data,
+};
+
+struct Reference {
+    uint64_t from;
+    uint64_t to;
+    // Function containing `from`.
+    uint32_t function;
+    Kind kind;
+};
+
+// All tables are in compressed sparse row form: row i of a table is
+// `values[offsets[i], offsets[i + 1])`.
+class Index {
+  public:
+    // Decodes every function on `jobs` threads.
+    [[nodiscard]] static Index build(const binary::Elf64 &elf, size_t jobs);
+
+    // References made by instructions of function `function`, in address
+    // order.
+    [[nodiscard]] std::span<const Reference>
+    referencesFrom(size_t function) const noexcept;
+
+    // Indices into getReferences() of everything referencing `address`.
+    [[nodiscard]] std::span<const uint32_t>
+    referencesTo(uint64_t address) const noexcept;
+
+    // Function indices, sorted and without duplicates.
+    [[nodiscard]] std::span<const uint32_t>
+    callees(size_t function) const noexcept;
+    [[nodiscard]] std::span<const uint32_t>
+    callers(size_t function) const noexcept;
+
+    [[nodiscard]] const std::vector<Reference> &getReferences() const noexcept;
+
+  private:
+    // Grouped by function, ordered by address within each function.
+    std::vector<Reference> references_;
+    std::vector<uint32_t> referenceOffsets_;
+
+    // Distinct targets, sorted, each with the references to it.
+    std::vector<uint64_t> targets_;
+    std::vector<uint32_t> incomingOffsets_;
+    std::vector<uint32_t> incoming_;
+
+    std::vector<uint32_t> calleeOffsets_;
+    std::vector<uint32_t> callees_;
+    std::vector<uint32_t> callerOffsets_;
+    std::vector<uint32_t> callers_;
+};
+
+} // namespace xref
+
+#endif
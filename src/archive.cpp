@@ -0,0 +1,199 @@
+#include <archive.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <elf.h>
+#include <format>
+#include <stdexcept>
+
+namespace archive {
+
+namespace {
+
+constexpr std::string_view Magic = "!<arch>\n";
+constexpr std::string_view ThinMagic = "!<thin>\n";
+constexpr size_t HeaderSize = 60;
+
+[[nodiscard]] std::string_view text(std::span<const uint8_t> bytes) noexcept {
+    return std::string_view(reinterpret_cast<const char *>(bytes.data()),
+                            bytes.size());
+}
+
+[[nodiscard]] std::string_view trimRight(std::string_view field) noexcept {
+    while (!field.empty() && field.back() == ' ') {
+        field.remove_suffix(1);
+    }
+    return field;
+}
+
+[[nodiscard]] std::optional<size_t> parseDecimal(std::string_view field) {
+    field = trimRight(field);
+    size_t value;
+    auto [end, ec] =
+        std::from_chars(field.data(), field.data() + field.size(), value);
+    if (field.empty() || ec != std::errc() ||
+        end != field.data() + field.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+[[nodiscard]] uint64_t readBigEndian(std::span<const uint8_t> bytes) noexcept {
+    uint64_t value = 0;
+    for (uint8_t byte : bytes) {
+        value = value << 8 | byte;
+    }
+    return value;
+}
+
+} // namespace
+
+bool isArchive(std::span<const uint8_t> data) noexcept {
+    return text(data).starts_with(Magic);
+}
+
+Archive::Archive(std::vector<uint8_t> &&data) : data_(std::move(data)) {
+    if (text(data_).starts_with(ThinMagic)) {
+        throw std::runtime_error("Thin archives are not supported");
+    }
+    if (!isArchive(data_)) {
+        throw std::runtime_error("Not an archive");
+    }
+
+    std::span<const uint8_t> symbolTable;
+    size_t wordSize = 0;
+    std::string_view longNames;
+    size_t position = Magic.size();
+    while (position + HeaderSize <= data_.size()) {
+        std::string_view header =
+            text(std::span(data_).subspan(position, HeaderSize));
+        auto size = parseDecimal(header.substr(48, 10));
+        if (header.substr(58, 2) != "`\n" || !size.has_value() ||
+            size.value() > data_.size() - position - HeaderSize) {
+            throw std::runtime_error(
+                std::format("Malformed archive member at {}", position));
+        }
+        std::span<const uint8_t> contents =
+            std::span(data_).subspan(position + HeaderSize, size.value());
+        std::string_view name = trimRight(header.substr(0, 16));
+
+        if (name.starts_with("#1/")) {
+            // BSD: the name precedes the contents.
+            auto length = parseDecimal(name.substr(3));
+            if (!length.has_value() || length.value() > contents.size()) {
+                throw std::runtime_error(
+                    std::format("Malformed archive member at {}", position));
+            }
+            name = text(contents.first(length.value()));
+            name = name.substr(0, name.find('\0'));
+            contents = contents.subspan(length.value());
+        }
+
+        if (name == "/") {
+            symbolTable = contents;
+            wordSize = 4;
+        } else if (name == "/SYM64/") {
+            symbolTable = contents;
+            wordSize = 8;
+        } else if (name == "//") {
+            longNames = text(contents);
+        } else if (name.starts_with("__.SYMDEF")) {
+            // BSD symbol tables index by a layout not worth supporting;
+            // lookups fall back to scanning.
+        } else {
+            if (name.size() > 1 && name.front() == '/') {
+                // GNU: an offset into the long name table.
+                auto offset = parseDecimal(name.substr(1));
+                if (!offset.has_value() || offset.value() > longNames.size()) {
+                    throw std::runtime_error(std::format(
+                        "Malformed archive member name {}", name));
+                }
+                name = longNames.substr(offset.value());
+                name = name.substr(0, std::min(name.find("/\n"),
+                                               name.find('\n')));
+            } else if (name.ends_with('/')) {
+                name.remove_suffix(1);
+            }
+            members_.push_back(Member{name, position, contents});
+        }
+        position += HeaderSize + size.value();
+        position += position & 1;
+    }
+
+    if (wordSize != 0) {
+        readSymbolTable(symbolTable, wordSize);
+    }
+}
+
+void Archive::readSymbolTable(std::span<const uint8_t> table,
+                              size_t wordSize) {
+    if (table.size() < wordSize) {
+        return;
+    }
+    uint64_t count = readBigEndian(table.first(wordSize));
+    if (count > (table.size() - wordSize) / wordSize) {
+        throw std::runtime_error("Malformed archive symbol table");
+    }
+    std::string_view names =
+        text(table.subspan(wordSize * (count + 1)));
+    symbols_.reserve(count);
+    for (size_t i = 0; i < count && !names.empty(); i++) {
+        uint64_t offset =
+            readBigEndian(table.subspan(wordSize * (i + 1), wordSize));
+        size_t length = std::min(names.find('\0'), names.size());
+        std::string_view name = names.substr(0, length);
+        names.remove_prefix(std::min(length + 1, names.size()));
+        // Entries point at member headers.
+        auto member = std::lower_bound(
+            members_.begin(), members_.end(), offset,
+            [](const Member &member, uint64_t offset) {
+                return member.offset < offset;
+            });
+        if (member != members_.end() && member->offset == offset) {
+            symbols_.push_back(
+                Symbol{name, (uint32_t)(member - members_.begin())});
+        }
+    }
+    std::stable_sort(symbols_.begin(), symbols_.end(),
+                     [](const Symbol &a, const Symbol &b) {
+                         return a.name < b.name;
+                     });
+}
+
+Archive Archive::fromFile(std::string_view filepath) {
+    return Archive(binary::readFile(filepath));
+}
+
+const std::vector<Member> &Archive::getMembers() const noexcept {
+    return members_;
+}
+
+const std::vector<Symbol> &Archive::getSymbols() const noexcept {
+    return symbols_;
+}
+
+std::optional<size_t>
+Archive::findMember(std::string_view symbol) const noexcept {
+    auto it = std::lower_bound(symbols_.begin(), symbols_.end(), symbol,
+                               [](const Symbol &entry, std::string_view name) {
+                                   return entry.name < name;
+                               });
+    if (it == symbols_.end() || it->name != symbol) {
+        return std::nullopt;
+    }
+    return it->member;
+}
+
+std::unique_ptr<binary::Elf64> Archive::openMember(size_t idx) const {
+    const Member &member = members_[idx];
+    if (member.data.size() < EI_NIDENT ||
+        std::memcmp(member.data.data(), ELFMAG, SELFMAG) != 0 ||
+        member.data[EI_CLASS] != ELFCLASS64) {
+        throw std::runtime_error(
+            std::format("{}: not a 64-bit ELF object", member.name));
+    }
+    return std::make_unique<binary::Elf64>(member.data);
+}
+
+} // namespace archive
@@ -0,0 +1,122 @@
+#include <batch.hpp>
+
+#include <atomic>
+#include <binary.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <io.hpp>
+#include <istream>
+#include <listing.hpp>
+#include <mutex>
+#include <parallel.hpp>
+#include <print>
+#include <stdexcept>
+#include <thread>
+
+namespace batch {
+
+std::vector<std::string> readPathList(std::istream &input) {
+    std::vector<std::string> paths;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty()) {
+            paths.push_back(std::move(line));
+        }
+    }
+    return paths;
+}
+
+// `<index>_<input with slashes as underscores>.txt`. The index keeps the
+// names apart when two inputs only differ by slashes and underscores, or
+// are listed twice.
+[[nodiscard]] std::filesystem::path outputPathFor(const std::string &dir,
+                                                  size_t index,
+                                                  std::string_view input) {
+    std::string name = std::format("{}_", index);
+    name.reserve(name.size() + input.size() + 4);
+    for (char c : input) {
+        name.push_back(c == '/' ? '_' : c);
+    }
+    name += ".txt";
+    return std::filesystem::path(dir) / name;
+}
+
+size_t run(const Options &options) {
+    if (options.outputDir.has_value()) {
+        std::filesystem::create_directories(options.outputDir.value());
+    }
+
+    // Files are read ahead by the reader, parsed and listed by the workers
+    // and written by a thread of their own, with bounded queues between
+    // the stages so that none of them waits on another's I/O.
+    io::Reader reader(options.paths, 2 * options.jobs);
+    struct Output {
+        size_t index;
+        std::string text;
+    };
+    io::Queue<Output> outputs(options.jobs);
+    // Written buffers go back to the workers. At most 2 * jobs + 1 are in
+    // use, so pushing never blocks.
+    io::Queue<std::string> spare(2 * options.jobs + 1);
+    // Decoded instructions stay with the worker from one file to the next.
+    std::vector<listing::DecodeBuffers> buffers(options.jobs);
+    std::mutex errorMutex;
+    std::atomic<size_t> failures = 0;
+
+    std::jthread writer([&] {
+        while (auto output = outputs.pop()) {
+            const std::string &path = options.paths[output->index];
+            const std::string &text = output->text;
+            if (options.outputDir.has_value()) {
+                std::ofstream file(
+                    outputPathFor(options.outputDir.value(),
+                                  output->index, path),
+                    std::ios::binary);
+                file.write(text.data(), text.size());
+                if (!file) {
+                    failures++;
+                    std::lock_guard lock(errorMutex);
+                    std::println(stderr, "{}: Unable to write output", path);
+                }
+            } else {
+                std::print("==> {} <==\n", path);
+                std::fwrite(text.data(), 1, text.size(), stdout);
+            }
+            output->text.clear();
+            spare.push(std::move(output->text));
+        }
+    });
+
+    parallel::forEach(
+        options.paths.size(), options.jobs, [&](size_t, size_t worker) {
+            // Every item takes whichever file finished loading next.
+            io::Loaded loaded = reader.next().value();
+            const std::string &path = options.paths[loaded.index];
+            // A written buffer, so the allocation made for earlier files is
+            // reused instead of growing a fresh string each time.
+            std::string text = spare.tryPop().value_or(std::string());
+            text.clear();
+            try {
+                if (!loaded.error.empty()) {
+                    throw std::runtime_error(loaded.error);
+                }
+                auto bin = binary::fromData(std::move(loaded.data));
+                listing::appendMainListing(text, *bin, buffers[worker]);
+                outputs.push(Output{loaded.index, std::move(text)});
+            } catch (const std::exception &e) {
+                failures++;
+                spare.push(std::move(text));
+                std::lock_guard lock(errorMutex);
+                std::println(stderr, "{}: {}", path, e.what());
+            }
+        });
+
+    outputs.close();
+    writer.join();
+    std::fflush(stdout);
+    return failures;
+}
+
+} // namespace batch
@@ -0,0 +1,741 @@
+#include <bench.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <print>
+#include <random>
+#include <spawn.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace bench {
+
+namespace {
+
+using namespace std::literals;
+
+// Common instructions of compiled code, each complete and position
+// independent: branches and calls go to the next instruction.
+constexpr std::array Patterns = {
+    "\x48\x89\xc7"sv,             // mov rdi, rax
+    "\x48\x8b\x47\x08"sv,         // mov rax, [rdi + 0x8]
+    "\x48\x8d\x44\x24\x10"sv,     // lea rax, [rsp + 0x10]
+    "\x48\x01\xd8"sv,             // add rax, rbx
+    "\x48\x83\xec\x18"sv,         // sub rsp, 0x18
+    "\x31\xc0"sv,                 // xor eax, eax
+    "\x85\xc0"sv,                 // test eax, eax
+    "\x39\xd1"sv,                 // cmp ecx, edx
+    "\x74\x00"sv,                 // je
+    "\xe8\x00\x00\x00\x00"sv,     // call
+    "\x53"sv,                     // push rbx
+    "\x5b"sv,                     // pop rbx
+    "\x0f\xaf\xc1"sv,             // imul eax, ecx
+    "\xc1\xe0\x03"sv,             // shl eax, 0x3
+    "\x0f\xb6\x07"sv,             // movzx eax, byte ptr [rdi]
+    "\x48\x63\xc6"sv,             // movsxd rax, esi
+    "\x0f\x28\xc1"sv,             // movaps xmm0, xmm1
+    "\xf2\x0f\x58\xc1"sv,         // addsd xmm0, xmm1
+    "\x66\x0f\xef\xc0"sv,         // pxor xmm0, xmm0
+    "\x0f\x1f\x44\x00\x00"sv,     // nop dword ptr [rax + rax]
+};
+
+// Prefix words both tools may print before the mnemonic.
+constexpr std::array Prefixes = {"lock"sv,  "rep"sv,     "repz"sv,
+                                 "repe"sv,  "repnz"sv,   "repne"sv,
+                                 "bnd"sv,   "notrack"sv, "data16"sv,
+                                 "addr32"sv, "cs"sv,     "ds"sv};
+
+template <typename T> void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void align(std::string &out, size_t alignment) {
+    out.resize((out.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+struct Timing {
+    double seconds = 0;
+    uint64_t peakKib = 0;
+    bool ok = false;
+};
+
+// Runs `args` with stderr discarded, handing every line of its stdout to
+// onLine. posix_spawn does not copy this process, so the peak RSS is the
+// child's own.
+template <typename OnLine>
+Timing spawn(const std::vector<std::string> &args, OnLine &&onLine) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        throw std::runtime_error(
+            std::format("Cannot create a pipe: {}", std::strerror(errno)));
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+    std::vector<char *> argv;
+    for (const std::string &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(),
+                             environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    Timing timing;
+    if (error != 0) {
+        close(fds[0]);
+        return timing;
+    }
+    std::string pending;
+    std::array<char, 1 << 16> chunk;
+    for (;;) {
+        ssize_t count = read(fds[0], chunk.data(), chunk.size());
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        pending.append(chunk.data(), count);
+        size_t begin = 0;
+        for (size_t end; (end = pending.find('\n', begin)) != pending.npos;
+             begin = end + 1) {
+            onLine(std::string_view(pending).substr(begin, end - begin));
+        }
+        pending.erase(0, begin);
+    }
+    if (!pending.empty()) {
+        onLine(std::string_view(pending));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage {};
+    pid_t waited;
+    while ((waited = wait4(pid, &status, 0, &usage)) < 0 && errno == EINTR) {
+    }
+    timing.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    timing.peakKib = usage.ru_maxrss;
+    timing.ok = waited == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return timing;
+}
+
+struct Input {
+    std::string path;
+    // Bytes in executable sections.
+    uint64_t code;
+    bool synthetic;
+};
+
+// The executable bytes of a 64-bit x86-64 or AArch64 ELF file with a symbol
+// table, the files disasmer lists functions of.
+[[nodiscard]] std::optional<uint64_t>
+codeSize(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    Elf64_Ehdr header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+        header.e_ident[EI_CLASS] != ELFCLASS64 ||
+        (header.e_machine != EM_X86_64 && header.e_machine != EM_AARCH64) ||
+        header.e_shentsize < sizeof(Elf64_Shdr)) {
+        return std::nullopt;
+    }
+    std::string sections(size_t(header.e_shnum) * header.e_shentsize, '\0');
+    if (!file.seekg(header.e_shoff) ||
+        !file.read(sections.data(), sections.size())) {
+        return std::nullopt;
+    }
+    uint64_t code = 0;
+    bool symbols = false;
+    for (size_t i = 0; i < header.e_shnum; i++) {
+        Elf64_Shdr section;
+        std::memcpy(&section, sections.data() + i * header.e_shentsize,
+                    sizeof(section));
+        if (section.sh_type == SHT_SYMTAB &&
+            section.sh_size > sizeof(Elf64_Sym)) {
+            symbols = true;
+        }
+        if ((section.sh_flags & SHF_EXECINSTR) &&
+            section.sh_type != SHT_NOBITS) {
+            code += section.sh_size;
+        }
+    }
+    if (!symbols) {
+        return std::nullopt;
+    }
+    return code;
+}
+
+[[nodiscard]] std::vector<Input> collectCorpus(const Options &options,
+                                               size_t &candidates) {
+    std::vector<std::string> paths;
+    for (const std::string &root : options.paths) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(root, ec)) {
+            paths.push_back(root);
+            continue;
+        }
+        for (std::filesystem::recursive_directory_iterator it(
+                 root,
+                 std::filesystem::directory_options::skip_permission_denied,
+                 ec),
+             end;
+             !ec && it != end; it.increment(ec)) {
+            std::error_code entry;
+            if (it->is_regular_file(entry) && !it->is_symlink(entry)) {
+                paths.push_back(it->path().string());
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    candidates = paths.size();
+
+    std::vector<Input> eligible;
+    for (std::string &path : paths) {
+        if (auto code = codeSize(path)) {
+            eligible.push_back(Input{std::move(path), code.value(), false});
+        }
+    }
+    if (eligible.size() <= options.files) {
+        return eligible;
+    }
+    std::vector<Input> corpus;
+    for (size_t i = 0; i < options.files; i++) {
+        corpus.push_back(
+            std::move(eligible[i * eligible.size() / options.files]));
+    }
+    return corpus;
+}
+
+// The mnemonic of an instruction's text, past any prefix words.
+[[nodiscard]] std::string_view mnemonicOf(std::string_view text) {
+    for (;;) {
+        size_t begin = text.find_first_not_of(" \t");
+        if (begin == text.npos) {
+            return {};
+        }
+        text.remove_prefix(begin);
+        std::string_view word = text.substr(0, text.find_first_of(" \t"));
+        if (std::find(Prefixes.begin(), Prefixes.end(), word) ==
+            Prefixes.end()) {
+            return word;
+        }
+        text.remove_prefix(word.size());
+    }
+}
+
+// Compares the instructions of each function, by name, between the two
+// listings.
+class Divergence {
+  public:
+    // A line of `disasmer --all`. A function's instructions follow the
+    // names of its aliases and of its copies at other addresses; copies
+    // count as instructions of their own, as objdump decodes them again.
+    void addOwnLine(std::string_view line) {
+        if (line.starts_with('\t')) {
+            for (size_t body : group_) {
+                bodies_[body].emplace_back(mnemonicOf(line));
+            }
+            ownInstructions += group_.size();
+            inHeaders_ = false;
+            return;
+        }
+        if (line.empty()) {
+            inHeaders_ = false;
+            return;
+        }
+        if (!inHeaders_) {
+            group_.clear();
+            inHeaders_ = true;
+        }
+        size_t copy = line.find(": same as ");
+        std::string name(line.substr(0, line.find(':')));
+        if (copy == line.npos) {
+            if (group_.empty()) {
+                group_.push_back(addBody());
+            }
+            own_[name] = group_.front();
+            return;
+        }
+        // `name: same as first (at 0xaddress)`, one body per address.
+        size_t at = line.rfind("(at 0x");
+        uint64_t address = 0;
+        if (at != line.npos) {
+            std::from_chars(line.data() + at + 6, line.data() + line.size(),
+                            address, 16);
+        }
+        auto [it, added] = copies_.try_emplace(address, 0);
+        if (added) {
+            it->second = addBody();
+            group_.push_back(it->second);
+        }
+        own_[name] = it->second;
+    }
+
+    // A line of `objdump -d`, compared with the own listing a function at
+    // a time.
+    void addObjdumpLine(std::string_view line) {
+        size_t colon = line.find(":\t");
+        if (!line.empty() && line.front() != ' ' && line.ends_with(">:")) {
+            finishFunction();
+            size_t open = line.find('<');
+            name_ = line.substr(open + 1, line.size() - open - 3);
+            inFunction_ = open != line.npos;
+        } else if (colon != line.npos && line.starts_with(' ') &&
+                   line.find_first_not_of(" 0123456789abcdef") == colon) {
+            theirs_.emplace_back(mnemonicOf(line.substr(colon + 2)));
+            objdumpInstructions++;
+        }
+    }
+
+    // Starts the listings of another file.
+    void start(std::string_view path) { path_ = path; }
+
+    // Ends the current file.
+    void finish() {
+        finishFunction();
+        onlyOwn += bodies_.size() - matched_.size();
+        own_.clear();
+        bodies_.clear();
+        copies_.clear();
+        group_.clear();
+        matched_.clear();
+        inHeaders_ = false;
+    }
+
+    struct Example {
+        size_t count = 0;
+        std::string where;
+    };
+
+    uint64_t ownInstructions = 0;
+    uint64_t objdumpInstructions = 0;
+    size_t functions = 0;
+    size_t identical = 0;
+    size_t onlyOwn = 0;
+    size_t onlyObjdump = 0;
+    uint64_t compared = 0;
+    uint64_t mismatched = 0;
+    // By the first differing pair of mnemonics of each function.
+    std::map<std::pair<std::string, std::string>, Example> firstDifferences;
+
+  private:
+    void finishFunction() {
+        if (!inFunction_) {
+            return;
+        }
+        inFunction_ = false;
+        auto found = own_.find(name_);
+        if (found == own_.end() || !matched_.insert(found->second).second) {
+            onlyObjdump++;
+            theirs_.clear();
+            return;
+        }
+        functions++;
+        // Padding after the last instruction is not part of either.
+        auto trim = [](std::vector<std::string> &mnemonics) {
+            while (!mnemonics.empty() &&
+                   (mnemonics.back() == "nop" || mnemonics.back() == "int3")) {
+                mnemonics.pop_back();
+            }
+        };
+        std::vector<std::string> &own = bodies_[found->second];
+        trim(own);
+        trim(theirs_);
+        size_t common = std::min(own.size(), theirs_.size());
+        size_t first = common;
+        uint64_t differing = std::max(own.size(), theirs_.size()) - common;
+        for (size_t i = 0; i < common; i++) {
+            if (own[i] != theirs_[i]) {
+                first = std::min(first, i);
+                differing++;
+            }
+        }
+        compared += theirs_.size();
+        mismatched += differing;
+        if (differing == 0) {
+            identical++;
+        } else {
+            auto at = [&](const std::vector<std::string> &mnemonics) {
+                return first < mnemonics.size() ? mnemonics[first] : "(end)";
+            };
+            Example &example = firstDifferences[{at(own), at(theirs_)}];
+            if (example.count++ == 0) {
+                example.where = std::format("{} <{}>", path_, name_);
+            }
+        }
+        own.clear();
+        theirs_.clear();
+    }
+
+    size_t addBody() {
+        bodies_.emplace_back();
+        return bodies_.size() - 1;
+    }
+
+    // Mnemonics by distinct address, and the body of every name.
+    std::vector<std::vector<std::string>> bodies_;
+    std::unordered_map<std::string, size_t> own_;
+    // Bodies of the copies of the current file, by address.
+    std::unordered_map<uint64_t, size_t> copies_;
+    // Bodies the instructions being read belong to.
+    std::vector<size_t> group_;
+    bool inHeaders_ = false;
+    std::unordered_set<size_t> matched_;
+    std::vector<std::string> theirs_;
+    std::string name_;
+    std::string path_;
+    bool inFunction_ = false;
+};
+
+struct Result {
+    const Input *input;
+    uint64_t instructions = 0;
+    uint64_t objdumpInstructions = 0;
+    // One per job count.
+    std::vector<Timing> disasmer;
+    std::optional<Timing> objdump;
+    // --lift at the highest job count, for x86-64 inputs.
+    Timing lift;
+};
+
+// The median time and the highest peak RSS of `runs` runs.
+[[nodiscard]] Timing measure(const std::vector<std::string> &args,
+                             size_t runs) {
+    std::vector<Timing> timings;
+    for (size_t run = 0; run < runs; run++) {
+        timings.push_back(spawn(args, [](std::string_view) {}));
+        if (!timings.back().ok) {
+            return timings.back();
+        }
+    }
+    std::sort(timings.begin(), timings.end(),
+              [](const Timing &a, const Timing &b) {
+                  return a.seconds < b.seconds;
+              });
+    Timing median = timings[timings.size() / 2];
+    for (const Timing &timing : timings) {
+        median.peakKib = std::max(median.peakKib, timing.peakKib);
+    }
+    return median;
+}
+
+[[nodiscard]] std::vector<std::string> objdumpCommand(const Input &input) {
+    return {"objdump", "-d", "-M", "intel", "--no-show-raw-insn",
+            input.path};
+}
+
+} // namespace
+
+void writeSyntheticObject(const std::string &path, uint64_t instructions,
+                          uint64_t perFunction, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::string text;
+    std::string names(1, '\0');
+    std::vector<Elf64_Sym> symbols(1);
+    perFunction = std::max<uint64_t>(perFunction, 2);
+    for (uint64_t left = instructions; left > 0;) {
+        // Between half and one and a half times the average.
+        uint64_t count = perFunction / 2 + random() % (perFunction + 1);
+        count = std::clamp<uint64_t>(count, 2, left);
+        Elf64_Sym symbol{};
+        symbol.st_name = names.size();
+        symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+        symbol.st_shndx = 1;
+        symbol.st_value = text.size();
+        names += std::format("fn_{}", symbols.size());
+        names += '\0';
+        text += "\xf3\x0f\x1e\xfa"sv; // endbr64
+        for (uint64_t i = 2; i < count; i++) {
+            text += Patterns[random() % Patterns.size()];
+        }
+        text += '\xc3';
+        symbol.st_size = text.size() - symbol.st_value;
+        symbols.push_back(symbol);
+        left -= count;
+    }
+    constexpr std::string_view SectionNames =
+        "\0.text\0.symtab\0.strtab\0.shstrtab\0"sv;
+
+    std::string file(sizeof(Elf64_Ehdr), '\0');
+    std::array<Elf64_Shdr, 5> sections{};
+    auto place = [&](size_t index, uint32_t name, uint32_t type,
+                     std::string_view contents, size_t alignment) {
+        align(file, alignment);
+        Elf64_Shdr &section = sections[index];
+        section.sh_name = name;
+        section.sh_type = type;
+        section.sh_offset = file.size();
+        section.sh_size = contents.size();
+        section.sh_addralign = alignment;
+        file += contents;
+    };
+    place(1, 1, SHT_PROGBITS, text, 16);
+    sections[1].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    std::string table;
+    for (const Elf64_Sym &symbol : symbols) {
+        append(table, symbol);
+    }
+    place(2, 7, SHT_SYMTAB, table, 8);
+    sections[2].sh_link = 3;
+    sections[2].sh_info = 1;
+    sections[2].sh_entsize = sizeof(Elf64_Sym);
+    place(3, 15, SHT_STRTAB, names, 1);
+    place(4, 23, SHT_STRTAB, SectionNames, 1);
+
+    align(file, 8);
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = file.size();
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = sections.size();
+    header.e_shstrndx = 4;
+    std::memcpy(file.data(), &header, sizeof(header));
+    for (const Elf64_Shdr &section : sections) {
+        append(file, section);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(file.data(), file.size());
+    if (!out) {
+        throw std::runtime_error(std::format("Unable to write {}", path));
+    }
+}
+
+size_t run(const Options &options, std::ostream &report) {
+    size_t candidates = 0;
+    std::vector<Input> corpus = collectCorpus(options, candidates);
+    if (options.synthetic != 0) {
+        std::filesystem::create_directories(options.workDir);
+        // One huge function per eighth, and one symbol every 16
+        // instructions.
+        const std::pair<std::string_view, uint64_t> kinds[] = {
+            {"synthetic-large.o", options.synthetic / 8},
+            {"synthetic-symbols.o", 16}};
+        for (uint64_t seed = 0; const auto &[name, perFunction] : kinds) {
+            auto path = std::filesystem::path(options.workDir) / name;
+            writeSyntheticObject(path.string(), options.synthetic,
+                                 perFunction, ++seed);
+            corpus.push_back(Input{path.string(), codeSize(path).value_or(0),
+                                   true});
+        }
+    }
+    if (corpus.empty()) {
+        throw std::runtime_error("No ELF files with a symbol table found");
+    }
+
+    std::string self = std::filesystem::read_symlink("/proc/self/exe");
+    std::string objdumpVersion;
+    bool objdump = spawn({"objdump", "--version"},
+                         [&](std::string_view line) {
+                             if (objdumpVersion.empty()) {
+                                 objdumpVersion = line;
+                             }
+                         })
+                       .ok;
+    std::vector<size_t> jobCounts;
+    for (size_t jobs = 1; jobs < options.jobs; jobs *= 2) {
+        jobCounts.push_back(jobs);
+    }
+    jobCounts.push_back(options.jobs);
+
+    Divergence divergence;
+    std::vector<Result> results;
+    size_t failures = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const Input &input = corpus[i];
+        std::println(stderr, "[{}/{}] {}", i + 1, corpus.size(), input.path);
+        auto command = [&](size_t jobs) {
+            return std::vector<std::string>{self, "--all", "-j",
+                                            std::to_string(jobs), input.path};
+        };
+        Result result{.input = &input,
+                      .instructions = 0,
+                      .objdumpInstructions = 0,
+                      .disasmer = {},
+                      .objdump = std::nullopt,
+                      .lift = {}};
+
+        // An untimed pass for the instruction counts and the comparison.
+        uint64_t own = divergence.ownInstructions;
+        uint64_t theirs = divergence.objdumpInstructions;
+        divergence.start(input.path);
+        if (!spawn(command(options.jobs), [&](std::string_view line) {
+                 divergence.addOwnLine(line);
+             }).ok) {
+            std::println(stderr, "{}: disasmer failed", input.path);
+            divergence.finish();
+            failures++;
+            continue;
+        }
+        if (objdump && spawn(objdumpCommand(input), [&](std::string_view line) {
+                           divergence.addObjdumpLine(line);
+                       }).ok) {
+            result.objdump = measure(objdumpCommand(input), options.runs);
+        }
+        divergence.finish();
+        result.instructions = divergence.ownInstructions - own;
+        result.objdumpInstructions = divergence.objdumpInstructions - theirs;
+        for (size_t jobs : jobCounts) {
+            result.disasmer.push_back(measure(command(jobs), options.runs));
+        }
+        result.lift = measure({self, "--lift", "-j",
+                               std::to_string(options.jobs), input.path},
+                              options.runs);
+        results.push_back(std::move(result));
+    }
+
+    uint64_t code = 0;
+    size_t synthetic = 0;
+    for (const Input &input : corpus) {
+        code += input.code;
+        synthetic += input.synthetic;
+    }
+    std::string text = std::format(
+        "corpus: {} files ({} synthetic), {:.1f} MiB of code, drawn from {} "
+        "candidate files\n",
+        corpus.size(), synthetic, code / 1048576.0, candidates);
+    text += std::format("hardware threads: {}, runs per measurement: {} "
+                        "(median wall time, highest peak RSS)\n",
+                        std::thread::hardware_concurrency(), options.runs);
+    text += std::format("objdump: {}\n",
+                        objdump ? objdumpVersion : "not found");
+
+    text += std::format("\nper file (disasmer at -j {}):\n", options.jobs);
+    text += std::format("  {:>12} {:>12} {:>10} {:>10} {:>8}  {}\n",
+                        "instructions", "objdump", "disasmer s", "objdump s",
+                        "speedup", "file");
+    for (const Result &result : results) {
+        const Timing &own = result.disasmer.back();
+        if (result.objdump.has_value() && result.objdump->ok) {
+            text += std::format(
+                "  {:>12} {:>12} {:>10.3f} {:>10.3f} {:>7.1f}x  {}\n",
+                result.instructions, result.objdumpInstructions, own.seconds,
+                result.objdump->seconds,
+                result.objdump->seconds / std::max(own.seconds, 1e-9),
+                result.input->path);
+        } else {
+            text += std::format("  {:>12} {:>12} {:>10.3f} {:>10} {:>8}  {}\n",
+                                result.instructions, "-", own.seconds, "-",
+                                "-", result.input->path);
+        }
+    }
+
+    text += "\nscaling (all files):\n";
+    text += std::format("  {:<9} {:>5} {:>10} {:>12} {:>13}\n", "tool", "jobs",
+                        "wall s", "Minsn/s", "peak RSS MiB");
+    auto row = [&](std::string_view tool, std::string jobs, uint64_t count,
+                   double seconds, uint64_t peakKib) {
+        text += std::format("  {:<9} {:>5} {:>10.3f} {:>12.2f} {:>13.1f}\n",
+                            tool, jobs, seconds,
+                            count / std::max(seconds, 1e-9) / 1e6,
+                            peakKib / 1024.0);
+    };
+    for (size_t level = 0; level < jobCounts.size(); level++) {
+        uint64_t count = 0;
+        double seconds = 0;
+        uint64_t peakKib = 0;
+        for (const Result &result : results) {
+            const Timing &timing = result.disasmer[level];
+            count += result.instructions;
+            seconds += timing.seconds;
+            peakKib = std::max(peakKib, timing.peakKib);
+        }
+        row("disasmer", std::to_string(jobCounts[level]), count, seconds,
+            peakKib);
+    }
+    {
+        // Lifting also builds the graph and recovers jump tables; the
+        // instruction counts are those of the listing.
+        uint64_t count = 0;
+        double seconds = 0;
+        uint64_t peakKib = 0;
+        for (const Result &result : results) {
+            if (result.lift.ok) {
+                count += result.instructions;
+                seconds += result.lift.seconds;
+                peakKib = std::max(peakKib, result.lift.peakKib);
+            }
+        }
+        row("lift", std::to_string(options.jobs), count, seconds, peakKib);
+    }
+    if (objdump) {
+        uint64_t count = 0;
+        double seconds = 0;
+        uint64_t peakKib = 0;
+        for (const Result &result : results) {
+            if (result.objdump.has_value() && result.objdump->ok) {
+                count += result.objdumpInstructions;
+                seconds += result.objdump->seconds;
+                peakKib = std::max(peakKib, result.objdump->peakKib);
+            }
+        }
+        row("objdump", "1", count, seconds, peakKib);
+    }
+
+    if (objdump) {
+        text += std::format(
+            "\ndivergence from objdump: {} of {} functions identical, {} of "
+            "{} instructions differ; {} functions only in disasmer, {} only "
+            "in objdump\n",
+            divergence.identical, divergence.functions, divergence.mismatched,
+            divergence.compared, divergence.onlyOwn, divergence.onlyObjdump);
+        std::vector<std::pair<const std::pair<std::string, std::string> *,
+                              const Divergence::Example *>>
+            order;
+        for (const auto &[pair, example] : divergence.firstDifferences) {
+            order.emplace_back(&pair, &example);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [](const auto &a, const auto &b) {
+                             return a.second->count > b.second->count;
+                         });
+        order.resize(std::min<size_t>(order.size(), 20));
+        if (!order.empty()) {
+            text += "first differing mnemonics (disasmer / objdump):\n";
+        }
+        for (const auto &[pair, example] : order) {
+            text += std::format("  {:>8}  {:<12} {:<12} e.g. {}\n",
+                                example->count, pair->first, pair->second,
+                                example->where);
+        }
+    }
+    report << text;
+    return failures;
+}
+
+} // namespace bench
@@ -1,10 +1,20 @@
 #include <binary.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <elf.h>
-#include <fstream>
+#include <format>
+#include <io.hpp>
 #include <iostream>
+#include <parallel.hpp>
 #include <print>
+#ifdef DISASMER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef DISASMER_HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 namespace binary {
 
@@ -39,12 +49,11 @@ Binary::Type identifyFileType(std::vector<uint8_t> &data) {
     throw std::runtime_error("Unrecognized file type");
 }
 
-[[nodiscard]] std::unique_ptr<Binary> fromFile(std::string_view filepath) {
-    std::ifstream input(filepath.data(), std::ios::binary);
-    if (!input) {
-        throw std::runtime_error("Unable to read file");
-    }
-    std::vector<uint8_t> data(std::istreambuf_iterator<char>(input), {});
+[[nodiscard]] std::vector<uint8_t> readFile(std::string_view filepath) {
+    return io::readFile(filepath);
+}
+
+[[nodiscard]] std::unique_ptr<Binary> fromData(std::vector<uint8_t> data) {
     Binary::Type type = identifyFileType(data);
     switch (type) {
     case Binary::Type::Elf32:
@@ -57,6 +66,10 @@ Binary::Type identifyFileType(std::vector<uint8_t> &data) {
     assert(unreachable);
 }
 
+[[nodiscard]] std::unique_ptr<Binary> fromFile(std::string_view filepath) {
+    return fromData(readFile(filepath));
+}
+
 size_t Binary::readIntRef(uint8_t &ref, size_t position) const noexcept {
     ref = reader_(position, sizeof(uint8_t), data_);
     return position + sizeof(uint8_t);
@@ -91,16 +104,16 @@ size_t Binary::readIntRef(int64_t &ref, size_t position) const noexcept {
 }
 
 uint64_t readLsb(size_t position, size_t intSize,
-                 const std::vector<uint8_t> &data) {
+                 std::span<const uint8_t> data) {
     uint64_t ret = 0;
     for (size_t i = 0; i < intSize; i++) {
-        ret |= data[position + i] << (8 * i);
+        ret |= (uint64_t)data[position + i] << (8 * i);
     }
     return ret;
 }
 
 uint64_t readMsb(size_t position, size_t intSize,
-                 const std::vector<uint8_t> &data) {
+                 std::span<const uint8_t> data) {
     uint64_t ret = 0;
     for (size_t i = 0; i < intSize; i++) {
         ret <<= 8;
@@ -109,8 +122,8 @@ uint64_t readMsb(size_t position, size_t intSize,
     return ret;
 }
 
-std::function<uint64_t(size_t, size_t, const std::vector<uint8_t> &)>
-getElfReaderFunction(const std::vector<uint8_t> &data) {
+std::function<uint64_t(size_t, size_t, std::span<const uint8_t>)>
+getElfReaderFunction(std::span<const uint8_t> data) {
     if (data[EI_DATA] == ELFDATA2LSB) {
         return readLsb;
     }
@@ -124,7 +137,7 @@ Elf32::Elf32(std::vector<std::uint8_t> &&data)
     : Binary(Type::Elf32, std::forward<std::vector<uint8_t>>(data),
              getElfReaderFunction(data)) {
 
-    std::copy(header_.e_ident, header_.e_ident + EI_NIDENT, getData().begin());
+    std::copy_n(getData().begin(), EI_NIDENT, header_.e_ident);
     size_t position = EI_NIDENT;
     position = readIntRef(header_.e_type, position);
     position = readIntRef(header_.e_machine, position);
@@ -176,8 +189,16 @@ Elf32::Elf32(std::vector<std::uint8_t> &&data)
 Elf64::Elf64(std::vector<std::uint8_t> &&data)
     : Binary(Type::Elf64, std::forward<std::vector<uint8_t>>(data),
              getElfReaderFunction(data)) {
+    parse();
+}
 
-    std::copy(header_.e_ident, header_.e_ident + EI_NIDENT, getData().begin());
+Elf64::Elf64(std::span<const uint8_t> data)
+    : Binary(Type::Elf64, data, getElfReaderFunction(data)) {
+    parse();
+}
+
+void Elf64::parse() {
+    std::copy_n(getData().begin(), EI_NIDENT, header_.e_ident);
     size_t position = EI_NIDENT;
     position = readIntRef(header_.e_type, position);
     position = readIntRef(header_.e_machine, position);
@@ -207,61 +228,241 @@ Elf64::Elf64(std::vector<std::uint8_t> &&data)
         position = readIntRef(sectionHeaders_[i].sh_addralign, position);
         position = readIntRef(sectionHeaders_[i].sh_entsize, position);
     }
+    decompressed_ =
+        std::make_unique<DecompressedSection[]>(sectionHeaders_.size());
+    // Sections of relocatable objects all sit at address zero. Placing
+    // each at its file offset gives every byte a distinct address.
+    if (header_.e_type == ET_REL) {
+        for (Elf64_Shdr &section : sectionHeaders_) {
+            if (section.sh_flags & SHF_ALLOC) {
+                section.sh_addr = section.sh_offset;
+            }
+        }
+    }
 
+    // Symbols stay in the file: only the functions are kept, compactly.
     for (size_t i = 0; i < header_.e_shnum; i++) {
         if (sectionHeaders_[i].sh_type == SHT_DYNSYM) {
-            position = sectionHeaders_[i].sh_offset;
-            while (position <
-                   sectionHeaders_[i].sh_offset + sectionHeaders_[i].sh_size) {
-                Elf64_Sym symbol;
-                position = readIntRef(symbol.st_name, position);
-                position = readIntRef(symbol.st_info, position);
-                position = readIntRef(symbol.st_other, position);
-                position = readIntRef(symbol.st_shndx, position);
-                position = readIntRef(symbol.st_value, position);
-                position = readIntRef(symbol.st_size, position);
-                dynsymtab_.push_back(symbol);
-            }
+            dynsymIdx_ = i;
         } else if (sectionHeaders_[i].sh_type == SHT_SYMTAB) {
-            position = sectionHeaders_[i].sh_offset;
-            while (position <
-                   sectionHeaders_[i].sh_offset + sectionHeaders_[i].sh_size) {
-                Elf64_Sym symbol;
-                position = readIntRef(symbol.st_name, position);
-                position = readIntRef(symbol.st_info, position);
-                position = readIntRef(symbol.st_other, position);
-                position = readIntRef(symbol.st_shndx, position);
-                position = readIntRef(symbol.st_value, position);
-                position = readIntRef(symbol.st_size, position);
-                symtab_.push_back(symbol);
+            symtabIdx_ = i;
+        }
+    }
+    if (symtabIdx_.has_value()) {
+        std::vector<FunctionTable::Entry> entries;
+        size_t count = countSymbols(symtabIdx_.value());
+        for (size_t i = 0; i < count; i++) {
+            Elf64_Sym symbol = readSymbol(symtabIdx_.value(), i);
+            if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC ||
+                symbol.st_name == 0 || symbol.st_shndx == SHN_UNDEF) {
+                continue;
+            }
+            uint64_t address = symbol.st_value;
+            if (header_.e_type == ET_REL &&
+                symbol.st_shndx < sectionHeaders_.size()) {
+                address += sectionHeaders_[symbol.st_shndx].sh_addr;
+            }
+            entries.push_back(FunctionTable::Entry{
+                address, symbol.st_size, symbol.st_name});
+        }
+        size_t strtabIdx = sectionHeaders_[symtabIdx_.value()].sh_link;
+        std::span<const uint8_t> strings;
+        if (strtabIdx < sectionHeaders_.size()) {
+            const Elf64_Shdr &strtab = sectionHeaders_[strtabIdx];
+            if (strtab.sh_offset <= getData().size() &&
+                strtab.sh_size <= getData().size() - strtab.sh_offset) {
+                strings = getData().subspan(strtab.sh_offset, strtab.sh_size);
             }
         }
+        functions_ = FunctionTable(std::move(entries), strings);
     }
-    for (size_t i = 0; i < sectionHeaders_.size(); i++) {
-        if (getSectionName(i) == ".strtab") {
-            strtabIdx_ = i;
+    if (dynsymIdx_.has_value()) {
+        dynstrIdx_ = sectionHeaders_[dynsymIdx_.value()].sh_link;
+        readHashTables(dynsymIdx_.value());
+        readRelocations();
+        indexImports();
+    }
+}
+
+size_t Elf64::countSymbols(size_t section) const noexcept {
+    const Elf64_Shdr &header = sectionHeaders_[section];
+    if (header.sh_offset > getData().size()) {
+        return 0;
+    }
+    return std::min<uint64_t>(header.sh_size,
+                              getData().size() - header.sh_offset) /
+           sizeof(Elf64_Sym);
+}
+
+Elf64_Sym Elf64::readSymbol(size_t section, size_t idx) const noexcept {
+    Elf64_Sym symbol;
+    size_t position =
+        sectionHeaders_[section].sh_offset + idx * sizeof(Elf64_Sym);
+    position = readIntRef(symbol.st_name, position);
+    position = readIntRef(symbol.st_info, position);
+    position = readIntRef(symbol.st_other, position);
+    position = readIntRef(symbol.st_shndx, position);
+    position = readIntRef(symbol.st_value, position);
+    readIntRef(symbol.st_size, position);
+    return symbol;
+}
+
+void Elf64::readHashTables(size_t dynsymIdx) {
+    for (const Elf64_Shdr &section : sectionHeaders_) {
+        // The counts come from the file: tables not fitting in their
+        // section, or sections not fitting in the file, are skipped.
+        if (section.sh_link != dynsymIdx ||
+            section.sh_offset > getData().size() ||
+            section.sh_size > getData().size() - section.sh_offset) {
+            continue;
+        }
+        size_t position = section.sh_offset;
+        if (section.sh_type == SHT_GNU_HASH) {
+            GnuHashTable table;
+            uint32_t bucketCount;
+            uint32_t bloomSize;
+            if (section.sh_size < 4 * sizeof(uint32_t)) {
+                continue;
+            }
+            position = readIntRef(bucketCount, position);
+            position = readIntRef(table.symbolOffset, position);
+            position = readIntRef(bloomSize, position);
+            position = readIntRef(table.bloomShift, position);
+            // Lookups shift 32-bit hashes by bloomShift.
+            if (bucketCount == 0 || bloomSize == 0 ||
+                table.bloomShift >= 32 ||
+                table.symbolOffset > getDynamicSymbolCount()) {
+                continue;
+            }
+            uint64_t chainCount = getDynamicSymbolCount() - table.symbolOffset;
+            if (4 * sizeof(uint32_t) + bloomSize * sizeof(uint64_t) +
+                    (bucketCount + chainCount) * sizeof(uint32_t) >
+                section.sh_size) {
+                continue;
+            }
+            table.bloom.resize(bloomSize);
+            for (uint64_t &word : table.bloom) {
+                position = readIntRef(word, position);
+            }
+            table.buckets.resize(bucketCount);
+            for (uint32_t &bucket : table.buckets) {
+                position = readIntRef(bucket, position);
+            }
+            table.chains.resize(chainCount);
+            for (uint32_t &chain : table.chains) {
+                position = readIntRef(chain, position);
+            }
+            gnuHash_ = std::move(table);
+        } else if (section.sh_type == SHT_HASH) {
+            SysvHashTable table;
+            uint32_t bucketCount;
+            uint32_t chainCount;
+            if (section.sh_size < 2 * sizeof(uint32_t)) {
+                continue;
+            }
+            position = readIntRef(bucketCount, position);
+            position = readIntRef(chainCount, position);
+            if (bucketCount == 0 ||
+                (2 + (uint64_t)bucketCount + chainCount) * sizeof(uint32_t) >
+                    section.sh_size) {
+                continue;
+            }
+            table.buckets.resize(bucketCount);
+            for (uint32_t &bucket : table.buckets) {
+                position = readIntRef(bucket, position);
+            }
+            table.chains.resize(chainCount);
+            for (uint32_t &chain : table.chains) {
+                position = readIntRef(chain, position);
+            }
+            sysvHash_ = std::move(table);
         }
     }
-    for (size_t i = 0; i < symtab_.size(); i++) {
-        if (ELF64_ST_TYPE(symtab_[i].st_info) == STT_FUNC) {
-			Function fn;
-			if (symtab_[i].st_name == 0) {
-				continue;
-			}
-			if (symtab_[i].st_shndx == SHN_UNDEF) {
-				continue;
-			}
-			fn.name = getStringFromTable(strtabIdx_, symtab_[i].st_name);
-			fn.size = symtab_[i].st_size;
-			fn.offset = symtab_[i].st_value;
-			functions_.push_back(fn);
+}
+
+void Elf64::readRelocations() {
+    for (const Elf64_Shdr &section : sectionHeaders_) {
+        // Only the dynamic relocations are allocated; relocations of object
+        // files are relative to their section instead.
+        if (section.sh_type != SHT_RELA ||
+            (section.sh_flags & SHF_ALLOC) == 0 ||
+            section.sh_offset > getData().size() ||
+            section.sh_size > getData().size() - section.sh_offset) {
+            continue;
+        }
+        size_t position = section.sh_offset;
+        while (position + sizeof(Elf64_Rela) <=
+               section.sh_offset + section.sh_size) {
+            Elf64_Rela rela;
+            position = readIntRef(rela.r_offset, position);
+            position = readIntRef(rela.r_info, position);
+            position = readIntRef(rela.r_addend, position);
+            relocations_.push_back(Relocation{
+                .offset = rela.r_offset,
+                .type = (uint32_t)ELF64_R_TYPE(rela.r_info),
+                .symbol = (uint32_t)ELF64_R_SYM(rela.r_info),
+                .addend = rela.r_addend,
+            });
         }
     }
+    std::sort(relocations_.begin(), relocations_.end(),
+              [](const Relocation &a, const Relocation &b) {
+                  return a.offset < b.offset;
+              });
 }
 
-std::vector<uint8_t> &Binary::getData() noexcept { return data_; }
+// Names every GOT slot that holds an imported symbol, and every PLT stub
+// jumping through one (`jmp [rip + disp32]`, possibly after endbr64/bnd).
+void Elf64::indexImports() {
+    for (const Relocation &relocation : relocations_) {
+        if ((relocation.type == R_X86_64_JUMP_SLOT ||
+             relocation.type == R_X86_64_GLOB_DAT) &&
+            relocation.symbol != 0 &&
+            relocation.symbol < getDynamicSymbolCount()) {
+            importNames_.emplace(
+                relocation.offset,
+                std::string(getDynamicSymbolName(relocation.symbol)) + "@got");
+        }
+    }
+    if (header_.e_machine != EM_X86_64) {
+        return;
+    }
+    for (size_t i = 0; i < sectionHeaders_.size(); i++) {
+        std::string_view name = getSectionName(i);
+        if (name != ".plt" && name != ".plt.sec" && name != ".plt.got") {
+            continue;
+        }
+        const Elf64_Shdr &section = sectionHeaders_[i];
+        size_t entrySize = section.sh_entsize != 0 ? section.sh_entsize : 16;
+        auto code = getBytesAt(section.sh_addr, section.sh_size);
+        for (size_t entry = 0; entry + entrySize <= code.size();
+             entry += entrySize) {
+            for (size_t at = entry; at + 6 <= entry + entrySize; at++) {
+                if (code[at] != 0xff || code[at + 1] != 0x25) {
+                    continue;
+                }
+                int32_t displacement;
+                readIntRef(displacement, section.sh_offset + at + 2);
+                uint64_t slot = section.sh_addr + at + 6 + displacement;
+                const Relocation *relocation = findRelocation(slot);
+                if (relocation != nullptr && relocation->symbol != 0 &&
+                    relocation->symbol < getDynamicSymbolCount()) {
+                    importNames_.emplace(
+                        section.sh_addr + entry,
+                        std::string(getDynamicSymbolName(relocation->symbol)) +
+                            "@plt");
+                }
+                break;
+            }
+        }
+    }
+}
 
 Binary::Binary(Type type, std::vector<uint8_t> &&data, ReaderFn reader)
+    : type_(type), storage_(std::move(data)), data_(storage_),
+      reader_(reader) {}
+
+Binary::Binary(Type type, std::span<const uint8_t> data, ReaderFn reader)
     : type_(type), data_(data), reader_(reader) {}
 
 [[nodiscard]] Elf32_Ehdr Elf32::getHeader() const noexcept { return header_; }
@@ -276,20 +477,40 @@ Binary::Binary(Type type, std::vector<uint8_t> &&data, ReaderFn reader)
     return sectionHeaders_[idx];
 }
 
+// The NUL-terminated string at `offset` in string table `tableIdx`,
+// or an empty view when the table or the string is not inside the file.
+template <typename Shdr>
+[[nodiscard]] std::string_view stringAt(std::span<const uint8_t> data,
+                                        std::span<const Shdr> sections,
+                                        size_t tableIdx,
+                                        size_t offset) noexcept {
+    if (tableIdx >= sections.size()) {
+        return {};
+    }
+    const Shdr &table = sections[tableIdx];
+    if (table.sh_type != SHT_STRTAB || table.sh_offset > data.size() ||
+        table.sh_size > data.size() - table.sh_offset ||
+        offset >= table.sh_size) {
+        return {};
+    }
+    auto begin = reinterpret_cast<const char *>(data.data()) +
+                 table.sh_offset + offset;
+    auto end = static_cast<const char *>(
+        std::memchr(begin, '\0', table.sh_size - offset));
+    if (end == nullptr) {
+        return {};
+    }
+    return std::string_view(begin, end - begin);
+}
+
 [[nodiscard]] std::string_view
 Elf32::getStringFromTable(size_t tableIdx, size_t offset) const noexcept {
-    auto sectionHeader = sectionHeaders_[tableIdx];
-    assert(sectionHeader.sh_type == SHT_STRTAB);
-    return reinterpret_cast<const char *>(getData().data() +
-                                          sectionHeader.sh_offset + offset);
+    return stringAt<Elf32_Shdr>(getData(), sectionHeaders_, tableIdx, offset);
 }
 
 [[nodiscard]] std::string_view
 Elf64::getStringFromTable(size_t tableIdx, size_t offset) const noexcept {
-    auto sectionHeader = sectionHeaders_[tableIdx];
-    assert(sectionHeader.sh_type == SHT_STRTAB);
-    return reinterpret_cast<const char *>(getData().data() +
-                                          sectionHeader.sh_offset + offset);
+    return stringAt<Elf64_Shdr>(getData(), sectionHeaders_, tableIdx, offset);
 }
 
 [[nodiscard]] std::string_view
@@ -302,7 +523,104 @@ Elf64::getSectionName(size_t idx) const noexcept {
     return getStringFromTable(header_.e_shstrndx, sectionHeaders_[idx].sh_name);
 }
 
-[[nodiscard]] const std::vector<uint8_t> &Binary::getData() const noexcept {
+[[nodiscard]] std::optional<size_t>
+Elf64::findSection(std::string_view name) const noexcept {
+    for (size_t i = 0; i < sectionHeaders_.size(); i++) {
+        if (getSectionName(i) == name) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::span<const uint8_t>
+Elf64::getSectionData(size_t idx) const {
+    const Elf64_Shdr &section = sectionHeaders_[idx];
+    if (section.sh_type == SHT_NOBITS) {
+        return {};
+    }
+    if (section.sh_offset > getData().size() ||
+        section.sh_size > getData().size() - section.sh_offset) {
+        throw std::runtime_error(
+            std::format("Section {} is out of bounds", getSectionName(idx)));
+    }
+    auto raw = getData().subspan(section.sh_offset, section.sh_size);
+    if ((section.sh_flags & SHF_COMPRESSED) == 0) {
+        return raw;
+    }
+
+    DecompressedSection &cache = decompressed_[idx];
+    std::call_once(cache.once, [&] {
+        // Elf64_Chdr, in the byte order of the file.
+        uint32_t type;
+        uint64_t size;
+        if (raw.size() < sizeof(Elf64_Chdr)) {
+            throw std::runtime_error(std::format(
+                "Truncated compressed section {}", getSectionName(idx)));
+        }
+        readIntRef(type, section.sh_offset);
+        readIntRef(size, section.sh_offset + 8);
+        auto compressed = raw.subspan(sizeof(Elf64_Chdr));
+        // The size comes from the file: refuse what no stream of this
+        // length could expand to before allocating. Deflate peaks a little
+        // over 1032:1, zstd at 32768:1 (a 128 KiB RLE block in 4 bytes).
+        constexpr uint32_t CompressZstd = 2;
+        constexpr uint64_t MaxSize = (uint64_t)1 << 32;
+        uint64_t maxRatio = type == CompressZstd ? 32768 : 1032;
+        if (size > MaxSize || size > (compressed.size() + 1) * maxRatio) {
+            throw std::runtime_error(
+                std::format("Implausible size {} for compressed section {}",
+                            size, getSectionName(idx)));
+        }
+        // Left uninitialised: decompression overwrites all of it.
+        auto data = std::make_unique_for_overwrite<uint8_t[]>(size);
+        bool ok = false;
+        if (type == ELFCOMPRESS_ZLIB) {
+#ifdef DISASMER_HAVE_ZLIB
+            uLongf length = size;
+            ok = uncompress(data.get(), &length, compressed.data(),
+                            compressed.size()) == Z_OK &&
+                 length == size;
+#else
+            throw std::runtime_error("Built without zlib support");
+#endif
+        } else if (type == CompressZstd) {
+#ifdef DISASMER_HAVE_ZSTD
+            size_t length = ZSTD_decompress(data.get(), size,
+                                            compressed.data(),
+                                            compressed.size());
+            ok = !ZSTD_isError(length) && length == size;
+#else
+            throw std::runtime_error("Built without zstd support");
+#endif
+        } else {
+            throw std::runtime_error(
+                std::format("Unknown compression {} in section {}", type,
+                            getSectionName(idx)));
+        }
+        if (!ok) {
+            throw std::runtime_error(std::format(
+                "Corrupt compressed section {}", getSectionName(idx)));
+        }
+        cache.data = std::move(data);
+        cache.size = size;
+    });
+    return std::span<const uint8_t>(cache.data.get(), cache.size);
+}
+
+void Elf64::decompressSections(std::span<const size_t> sections,
+                               size_t jobs) const {
+    // Failures are left for getSectionData to report to whoever reads the
+    // section.
+    parallel::forEach(sections.size(), jobs, [&](size_t i, size_t) {
+        try {
+            (void)getSectionData(sections[i]);
+        } catch (const std::exception &) {
+        }
+    });
+}
+
+[[nodiscard]] std::span<const uint8_t> Binary::getData() const noexcept {
     return data_;
 }
 
@@ -311,14 +629,83 @@ Elf64::getSectionName(size_t idx) const noexcept {
 }
 
 [[nodiscard]] Elf64_Sym Elf64::getSymbol(size_t idx) const noexcept {
-    return symtab_[idx];
+    if (!symtabIdx_.has_value() || idx >= countSymbols(symtabIdx_.value())) {
+        return {};
+    }
+    return readSymbol(symtabIdx_.value(), idx);
 }
 
-[[nodiscard]] const std::vector<Function> &
-Elf64::getFunctions() const noexcept {
+[[nodiscard]] const FunctionTable &Elf64::getFunctions() const noexcept {
     return functions_;
 }
 
+FunctionTable::FunctionTable(std::vector<Entry> entries,
+                             std::span<const uint8_t> strings)
+    : strings_(strings) {
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) {
+                         return a.address < b.address;
+                     });
+    names_.reserve(entries.size());
+    deltas_.reserve(entries.size());
+    sizes_.reserve(entries.size());
+    bases_.reserve(entries.size() / BlockSize + 1);
+    auto narrow = [](uint64_t value, uint32_t idx, auto &wide) {
+        if (value < Wide) {
+            return (uint32_t)value;
+        }
+        wide.emplace_back(idx, value);
+        return Wide;
+    };
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry &entry = entries[i];
+        if (i % BlockSize == 0) {
+            bases_.push_back(entry.address);
+        }
+        names_.push_back(entry.name);
+        deltas_.push_back(
+            narrow(entry.address - bases_.back(), i, wideDeltas_));
+        sizes_.push_back(narrow(entry.size, i, wideSizes_));
+    }
+}
+
+namespace {
+
+[[nodiscard]] uint64_t
+findWide(const std::vector<std::pair<uint32_t, uint64_t>> &values,
+         size_t idx) noexcept {
+    auto it = std::lower_bound(
+        values.begin(), values.end(), idx,
+        [](const auto &value, size_t idx) { return value.first < idx; });
+    return it->second;
+}
+
+} // namespace
+
+std::string_view FunctionTable::getName(size_t idx) const noexcept {
+    size_t offset = names_[idx];
+    if (offset >= strings_.size()) {
+        return {};
+    }
+    auto begin = reinterpret_cast<const char *>(strings_.data()) + offset;
+    auto end = static_cast<const char *>(
+        std::memchr(begin, '\0', strings_.size() - offset));
+    return std::string_view(begin, end != nullptr
+                                       ? end - begin
+                                       : strings_.size() - offset);
+}
+
+uint64_t FunctionTable::getAddress(size_t idx) const noexcept {
+    uint32_t delta = deltas_[idx];
+    return bases_[idx / BlockSize] +
+           (delta != Wide ? delta : findWide(wideDeltas_, idx));
+}
+
+uint64_t FunctionTable::getSize(size_t idx) const noexcept {
+    uint32_t size = sizes_[idx];
+    return size != Wide ? size : findWide(wideSizes_, idx);
+}
+
 [[nodiscard]] const std::vector<Function> &
 Elf32::getFunctions() const noexcept {
     return functions_;
@@ -326,7 +713,186 @@ Elf32::getFunctions() const noexcept {
 
 [[nodiscard]] const std::span<const uint8_t> Elf64::getFunctionCode(size_t idx) const noexcept {
 	auto fn = functions_[idx];
-	return std::span(getData().begin() + fn.offset, getData().begin() + fn.offset + fn.size);
+	return getBytesAt(fn.offset, fn.size);
+}
+
+[[nodiscard]] std::optional<size_t>
+Elf64::findFunction(uint64_t address) const {
+    size_t low = 0;
+    size_t high = functions_.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (address < functions_.getAddress(middle)) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    // Walk back over aliases and nested symbols starting before `address`
+    // until one actually covers it.
+    for (size_t idx = low; idx != 0;) {
+        idx--;
+        uint64_t start = functions_.getAddress(idx);
+        if (address < start + std::max<uint64_t>(functions_.getSize(idx), 1)) {
+            return idx;
+        }
+        if (idx != 0 && functions_.getAddress(idx - 1) != start) {
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::optional<size_t>
+Elf64::getFileOffset(uint64_t address) const noexcept {
+    for (const Elf64_Shdr &section : sectionHeaders_) {
+        if ((section.sh_flags & SHF_ALLOC) == 0 ||
+            section.sh_type == SHT_NOBITS) {
+            continue;
+        }
+        if (section.sh_addr <= address &&
+            address < section.sh_addr + section.sh_size) {
+            return section.sh_offset + (address - section.sh_addr);
+        }
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::span<const uint8_t>
+Elf64::getBytesAt(uint64_t address, size_t size) const noexcept {
+    for (const Elf64_Shdr &section : sectionHeaders_) {
+        if ((section.sh_flags & SHF_ALLOC) == 0 ||
+            section.sh_type == SHT_NOBITS) {
+            continue;
+        }
+        if (section.sh_addr <= address &&
+            address - section.sh_addr + size <= section.sh_size &&
+            section.sh_offset + section.sh_size <= getData().size()) {
+            return std::span(getData()).subspan(
+                section.sh_offset + (address - section.sh_addr), size);
+        }
+    }
+    return {};
+}
+
+[[nodiscard]] size_t Elf64::getDynamicSymbolCount() const noexcept {
+    if (!dynsymIdx_.has_value()) {
+        return 0;
+    }
+    return countSymbols(dynsymIdx_.value());
+}
+
+[[nodiscard]] Elf64_Sym Elf64::getDynamicSymbol(size_t idx) const noexcept {
+    return readSymbol(dynsymIdx_.value(), idx);
+}
+
+[[nodiscard]] std::string_view
+Elf64::getDynamicSymbolName(size_t idx) const noexcept {
+    if (!dynstrIdx_.has_value()) {
+        return {};
+    }
+    return getStringFromTable(dynstrIdx_.value(),
+                              getDynamicSymbol(idx).st_name);
+}
+
+[[nodiscard]] uint32_t gnuHash(std::string_view name) noexcept {
+    uint32_t h = 5381;
+    for (unsigned char c : name) {
+        h = (h << 5) + h + c;
+    }
+    return h;
+}
+
+[[nodiscard]] uint32_t sysvHash(std::string_view name) noexcept {
+    uint32_t h = 0;
+    for (unsigned char c : name) {
+        h = (h << 4) + c;
+        uint32_t g = h & 0xf0000000;
+        if (g != 0) {
+            h ^= g >> 24;
+        }
+        h &= ~g;
+    }
+    return h;
+}
+
+[[nodiscard]] std::optional<size_t>
+Elf64::findDynamicSymbol(std::string_view name) const noexcept {
+    auto matches = [&](size_t idx) {
+        return idx < getDynamicSymbolCount() &&
+               getDynamicSymbol(idx).st_shndx != SHN_UNDEF &&
+               getDynamicSymbolName(idx) == name;
+    };
+    if (gnuHash_.has_value()) {
+        const GnuHashTable &table = gnuHash_.value();
+        uint32_t h = gnuHash(name);
+        uint64_t word = table.bloom[(h / 64) % table.bloom.size()];
+        uint64_t mask = (1ull << (h % 64)) |
+                        (1ull << ((h >> table.bloomShift) % 64));
+        if ((word & mask) != mask) {
+            return std::nullopt;
+        }
+        uint32_t idx = table.buckets[h % table.buckets.size()];
+        if (idx < table.symbolOffset) {
+            return std::nullopt;
+        }
+        for (; idx - table.symbolOffset < table.chains.size(); idx++) {
+            uint32_t chainHash = table.chains[idx - table.symbolOffset];
+            if ((chainHash | 1) == (h | 1) && matches(idx)) {
+                return idx;
+            }
+            if (chainHash & 1) {
+                break;
+            }
+        }
+        return std::nullopt;
+    }
+    if (sysvHash_.has_value()) {
+        const SysvHashTable &table = sysvHash_.value();
+        uint32_t idx = table.buckets[sysvHash(name) % table.buckets.size()];
+        // The chain length bounds the walk on malformed tables.
+        for (size_t steps = 0; idx != STN_UNDEF && idx < table.chains.size() &&
+                               steps < table.chains.size();
+             idx = table.chains[idx], steps++) {
+            if (matches(idx)) {
+                return idx;
+            }
+        }
+        return std::nullopt;
+    }
+    for (size_t idx = 1; idx < getDynamicSymbolCount(); idx++) {
+        if (matches(idx)) {
+            return idx;
+        }
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] const std::vector<Relocation> &
+Elf64::getRelocations() const noexcept {
+    return relocations_;
+}
+
+[[nodiscard]] const Relocation *
+Elf64::findRelocation(uint64_t address) const noexcept {
+    auto it = std::lower_bound(
+        relocations_.begin(), relocations_.end(), address,
+        [](const Relocation &relocation, uint64_t address) {
+            return relocation.offset < address;
+        });
+    if (it == relocations_.end() || it->offset != address) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+[[nodiscard]] std::string_view
+Elf64::getImportName(uint64_t address) const noexcept {
+    auto it = importNames_.find(address);
+    if (it == importNames_.end()) {
+        return {};
+    }
+    return it->second;
 }
 
 }; // namespace binary
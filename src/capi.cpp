@@ -0,0 +1,255 @@
+#include <disasmer.h>
+
+#include <binary.hpp>
+#include <cstring>
+#include <disassemble.hpp>
+#include <jumptable.hpp>
+#include <optional>
+#include <string>
+
+using disassemble::X86_64::Instruction;
+
+struct disasmer_binary {
+    std::unique_ptr<binary::Binary> binary;
+    const binary::Elf64 *elf64;
+    // Decoding a function is usually asked for twice, once for its size.
+    mutable jumptable::Cache jumpTables;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+int fail(const char *message) {
+    lastError = message;
+    return -1;
+}
+
+void toC(const Instruction &ins, disasmer_instruction &out) {
+    out.address = ins.address;
+    out.mnemonic = (uint16_t)ins.mnemonic;
+    out.length = ins.length;
+    out.opcode_map = ins.opcodeMap;
+    out.opcode = ins.opcode;
+    out.prefixes = ins.prefixes;
+    out.operand_count = ins.operandCount;
+    out.segment = (uint8_t)ins.segment;
+    for (size_t i = 0; i < ins.operands.size(); i++) {
+        const auto &operand = ins.operands[i];
+        out.operands[i] = disasmer_operand{
+            .kind = (uint8_t)operand.kind,
+            .size = operand.size,
+            .base = (uint8_t)operand.base,
+            .index = (uint8_t)operand.index,
+            .scale = operand.scale,
+            .value = operand.value,
+        };
+    }
+}
+
+// Nothing coming from the caller is trusted: registers and operand kinds
+// index tables when formatting, so out of range ones are rejected.
+std::optional<Instruction> fromC(const disasmer_instruction &in) {
+    using namespace disassemble::X86_64;
+    auto validRegister = [](uint8_t reg) {
+        return reg <= (uint8_t)Register::BH || reg == (uint8_t)Register::None;
+    };
+    Instruction ins;
+    ins.address = in.address;
+    ins.mnemonic = Mnemonic(in.mnemonic < (uint16_t)Mnemonic::Count
+                                ? in.mnemonic
+                                : 0);
+    ins.length = in.length;
+    ins.opcodeMap = in.opcode_map;
+    ins.opcode = in.opcode;
+    ins.prefixes = in.prefixes;
+    ins.operandCount = std::min<size_t>(in.operand_count, ins.operands.size());
+    if (in.segment > (uint8_t)Segment::GS) {
+        return std::nullopt;
+    }
+    ins.segment = Segment(in.segment);
+    for (size_t i = 0; i < ins.operands.size(); i++) {
+        const auto &operand = in.operands[i];
+        if (operand.kind > (uint8_t)OperandKind::Target ||
+            !validRegister(operand.base) || !validRegister(operand.index)) {
+            return std::nullopt;
+        }
+        ins.operands[i] = Operand{
+            .kind = OperandKind(operand.kind),
+            .size = operand.size,
+            .base = Register(operand.base),
+            .index = Register(operand.index),
+            .scale = operand.scale,
+            .value = operand.value,
+        };
+    }
+    return ins;
+}
+
+size_t copyOut(std::span<const Instruction> decoded,
+               disasmer_instruction *instructions, size_t capacity) {
+    for (size_t i = 0; i < decoded.size() && i < capacity; i++) {
+        toC(decoded[i], instructions[i]);
+    }
+    return decoded.size();
+}
+
+} // namespace
+
+extern "C" {
+
+int disasmer_api_version(void) { return DISASMER_API_VERSION; }
+
+const char *disasmer_last_error(void) { return lastError.c_str(); }
+
+int disasmer_open(const char *path, disasmer_binary **binary) {
+    if (path == nullptr || binary == nullptr) {
+        return fail("Invalid argument");
+    }
+    try {
+        auto bin = binary::fromFile(path);
+        auto elf64 = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf64 == nullptr) {
+            return fail("Unsupported file type");
+        }
+        *binary = new disasmer_binary{std::move(bin), elf64,
+                                      jumptable::Cache(*elf64)};
+        return 0;
+    } catch (const std::exception &e) {
+        lastError = e.what();
+        return -1;
+    }
+}
+
+void disasmer_close(disasmer_binary *binary) { delete binary; }
+
+size_t disasmer_function_count(const disasmer_binary *binary) {
+    return binary->elf64->getFunctions().size();
+}
+
+int disasmer_get_function(const disasmer_binary *binary, size_t index,
+                          disasmer_function *function) {
+    const auto &functions = binary->elf64->getFunctions();
+    if (index >= functions.size()) {
+        return fail("Function index out of range");
+    }
+    function->name = functions[index].name.data();
+    function->address = functions[index].offset;
+    function->size = functions[index].size;
+    return 0;
+}
+
+int disasmer_find_function(const disasmer_binary *binary, const char *name,
+                           size_t *index) {
+    const auto &functions = binary->elf64->getFunctions();
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (functions[i].name == name) {
+            *index = i;
+            return 0;
+        }
+    }
+    return fail("Function not found");
+}
+
+int disasmer_find_symbol(const disasmer_binary *binary, const char *name,
+                         disasmer_function *symbol) {
+    const auto &functions = binary->elf64->getFunctions();
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (functions[i].name == name) {
+            return disasmer_get_function(binary, i, symbol);
+        }
+    }
+    auto idx = binary->elf64->findDynamicSymbol(name);
+    if (!idx.has_value()) {
+        return fail("Symbol not found");
+    }
+    Elf64_Sym sym = binary->elf64->getDynamicSymbol(idx.value());
+    symbol->name = binary->elf64->getDynamicSymbolName(idx.value()).data();
+    symbol->address = sym.st_value;
+    symbol->size = sym.st_size;
+    return 0;
+}
+
+size_t disasmer_decode_function(const disasmer_binary *binary, size_t index,
+                                disasmer_instruction *instructions,
+                                size_t capacity) {
+    if (binary->elf64->getHeader().e_machine !=
+        disassemble::X86_64Isa::Machine) {
+        fail("Unsupported machine type");
+        return (size_t)-1;
+    }
+    const auto &functions = binary->elf64->getFunctions();
+    if (index >= functions.size()) {
+        fail("Function index out of range");
+        return (size_t)-1;
+    }
+    auto code = binary->elf64->getFunctionCode(index);
+    if (code.size() != functions[index].size) {
+        fail("Function is not backed by file contents");
+        return (size_t)-1;
+    }
+    try {
+        std::vector<Instruction> decoded;
+        (void)binary->jumpTables.decode(index, decoded);
+        return copyOut(decoded, instructions, capacity);
+    } catch (const std::exception &e) {
+        lastError = e.what();
+        return (size_t)-1;
+    }
+}
+
+size_t disasmer_decode(const uint8_t *code, size_t size, uint64_t address,
+                       disasmer_instruction *instructions, size_t capacity) {
+    try {
+        auto decoded = disassemble::X86_64::decode(
+            std::span(code, size), address, disassemble::ReadingMode::LSB);
+        return copyOut(decoded, instructions, capacity);
+    } catch (const std::exception &e) {
+        lastError = e.what();
+        return (size_t)-1;
+    }
+}
+
+const char *disasmer_mnemonic_name(uint16_t mnemonic) {
+    using disassemble::X86_64::Mnemonic;
+    if (mnemonic >= (uint16_t)Mnemonic::Count) {
+        return nullptr;
+    }
+    return disassemble::X86_64::mnemonicName(Mnemonic(mnemonic)).data();
+}
+
+const char *disasmer_register_name(uint8_t reg, uint8_t size) {
+    using disassemble::X86_64::Register;
+    if (reg > (uint8_t)Register::BH) {
+        return nullptr;
+    }
+    return disassemble::X86_64::registerName(Register(reg), size).data();
+}
+
+size_t disasmer_format_instruction(const disasmer_instruction *instruction,
+                                   char *buffer, size_t size) {
+    auto ins = fromC(*instruction);
+    if (!ins.has_value()) {
+        fail("Invalid instruction");
+        return (size_t)-1;
+    }
+    std::string text;
+    try {
+        disassemble::X86_64::formatInstruction(text, ins.value());
+    } catch (const std::exception &e) {
+        lastError = e.what();
+        return (size_t)-1;
+    }
+    // Drop the listing's indentation and line break.
+    std::string_view line(text);
+    line.remove_prefix(1);
+    line.remove_suffix(1);
+    if (size > 0) {
+        size_t count = std::min(line.size(), size - 1);
+        std::memcpy(buffer, line.data(), count);
+        buffer[count] = '\0';
+    }
+    return line.size();
+}
+
+} // extern "C"
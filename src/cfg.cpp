@@ -0,0 +1,188 @@
+#include <cfg.hpp>
+
+#include <algorithm>
+
+namespace cfg {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+
+namespace {
+
+bool endsBlock(Mnemonic mnemonic) noexcept {
+    return mnemonic == Mnemonic::Jmp || mnemonic == Mnemonic::Ret ||
+           mnemonic == Mnemonic::Hlt || mnemonic == Mnemonic::Ud2 ||
+           disassemble::X86_64::isConditionalJump(mnemonic);
+}
+
+bool fallsThrough(Mnemonic mnemonic) noexcept {
+    return mnemonic != Mnemonic::Jmp && mnemonic != Mnemonic::Ret &&
+           mnemonic != Mnemonic::Hlt && mnemonic != Mnemonic::Ud2;
+}
+
+// Index of the instruction starting at `address`, if any.
+std::optional<uint32_t> instructionAt(std::span<const Instruction> instructions,
+                                      uint64_t address) noexcept {
+    auto it = std::lower_bound(
+        instructions.begin(), instructions.end(), address,
+        [](const Instruction &ins, uint64_t value) {
+            return ins.address < value;
+        });
+    if (it == instructions.end() || it->address != address) {
+        return std::nullopt;
+    }
+    return it - instructions.begin();
+}
+
+} // namespace
+
+Graph Graph::build(std::span<const Instruction> instructions,
+                   std::span<const jumptable::Table> tables) {
+    Graph graph;
+    graph.assign(instructions, tables);
+    return graph;
+}
+
+void Graph::assign(std::span<const Instruction> instructions,
+                   std::span<const jumptable::Table> tables) {
+    blocks_.clear();
+    successors_.clear();
+    successorOffsets_.assign(1, 0);
+    predecessors_.clear();
+    predecessorOffsets_.assign(1, 0);
+    if (instructions.empty()) {
+        return;
+    }
+    address_ = instructions.front().address;
+
+    std::vector<uint32_t> &leaders = leaders_;
+    leaders.assign(1, 0);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction &ins = instructions[i];
+        if (!endsBlock(ins.mnemonic)) {
+            continue;
+        }
+        if (i + 1 < instructions.size()) {
+            leaders.push_back(i + 1);
+        }
+        if (auto target = ins.branchTarget()) {
+            if (auto idx = instructionAt(instructions, target.value())) {
+                leaders.push_back(idx.value());
+            }
+        }
+    }
+    for (const jumptable::Table &table : tables) {
+        for (uint64_t target : table.targets) {
+            if (auto idx = instructionAt(instructions, target)) {
+                leaders.push_back(idx.value());
+            }
+        }
+    }
+    std::sort(leaders.begin(), leaders.end());
+    leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+
+    blocks_.reserve(leaders.size());
+    for (size_t b = 0; b < leaders.size(); b++) {
+        uint32_t first = leaders[b];
+        uint32_t end =
+            b + 1 < leaders.size() ? leaders[b + 1] : instructions.size();
+        const Instruction &last = instructions[end - 1];
+        uint64_t start = instructions[first].address;
+        blocks_.push_back(Block{
+            .firstInstruction = first,
+            .instructionCount = end - first,
+            .offset = (uint32_t)(start - address_),
+            .size = (uint32_t)(last.address + last.length - start),
+        });
+    }
+
+    successorOffsets_.reserve(blocks_.size() + 1);
+    predecessorOffsets_.assign(blocks_.size() + 1, 0);
+    for (size_t b = 0; b < blocks_.size(); b++) {
+        const Block &block = blocks_[b];
+        const Instruction &last =
+            instructions[block.firstInstruction + block.instructionCount - 1];
+        size_t begin = successors_.size();
+        if (endsBlock(last.mnemonic)) {
+            if (auto target = last.branchTarget()) {
+                if (auto idx = instructionAt(instructions, target.value())) {
+                    successors_.push_back(blockOf(idx.value()));
+                }
+            }
+        }
+        for (const jumptable::Table &table : tables) {
+            if (table.jump != last.address) {
+                continue;
+            }
+            for (uint64_t target : table.targets) {
+                if (auto idx = instructionAt(instructions, target)) {
+                    successors_.push_back(blockOf(idx.value()));
+                }
+            }
+            std::sort(successors_.begin() + begin, successors_.end());
+            successors_.erase(
+                std::unique(successors_.begin() + begin, successors_.end()),
+                successors_.end());
+        }
+        if (fallsThrough(last.mnemonic) && b + 1 < blocks_.size() &&
+            (successors_.size() == begin || successors_.back() != b + 1)) {
+            successors_.push_back(b + 1);
+        }
+        successorOffsets_.push_back(successors_.size());
+        for (size_t i = begin; i < successors_.size(); i++) {
+            predecessorOffsets_[successors_[i] + 1]++;
+        }
+    }
+
+    for (size_t b = 0; b < blocks_.size(); b++) {
+        predecessorOffsets_[b + 1] += predecessorOffsets_[b];
+    }
+    predecessors_.resize(successors_.size());
+    // Filled back to front so every row ends up in ascending order.
+    std::vector<uint32_t> &next = next_;
+    next.assign(predecessorOffsets_.begin() + 1, predecessorOffsets_.end());
+    for (size_t b = blocks_.size(); b-- > 0;) {
+        for (uint32_t successor : successors(b)) {
+            predecessors_[--next[successor]] = b;
+        }
+    }
+}
+
+const std::vector<Block> &Graph::getBlocks() const noexcept { return blocks_; }
+
+std::span<const uint32_t> Graph::successors(size_t block) const noexcept {
+    return std::span(successors_).subspan(
+        successorOffsets_[block],
+        successorOffsets_[block + 1] - successorOffsets_[block]);
+}
+
+std::span<const uint32_t> Graph::predecessors(size_t block) const noexcept {
+    return std::span(predecessors_).subspan(
+        predecessorOffsets_[block],
+        predecessorOffsets_[block + 1] - predecessorOffsets_[block]);
+}
+
+size_t Graph::blockOf(size_t instruction) const noexcept {
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), instruction,
+                               [](size_t value, const Block &block) {
+                                   return value < block.firstInstruction;
+                               });
+    return it - blocks_.begin() - 1;
+}
+
+std::optional<size_t> Graph::blockAt(uint64_t address) const noexcept {
+    if (address < address_) {
+        return std::nullopt;
+    }
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(),
+                               address - address_,
+                               [](const Block &block, uint64_t value) {
+                                   return block.offset < value;
+                               });
+    if (it == blocks_.end() || it->offset != address - address_) {
+        return std::nullopt;
+    }
+    return it - blocks_.begin();
+}
+
+} // namespace cfg
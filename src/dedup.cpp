@@ -0,0 +1,209 @@
+#include <dedup.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <tuple>
+#include <parallel.hpp>
+
+namespace dedup {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::OperandKind;
+
+namespace {
+
+constexpr uint64_t Prime1 = 0x9e3779b185ebca87;
+constexpr uint64_t Prime2 = 0xc2b2ae3d27d4eb4f;
+constexpr uint64_t Prime3 = 0x165667b19e3779f9;
+
+[[nodiscard]] uint64_t load(const uint8_t *data) noexcept {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+[[nodiscard]] uint64_t round(uint64_t lane, uint64_t word) noexcept {
+    return std::rotl(lane + word * Prime2, 31) * Prime1;
+}
+
+[[nodiscard]] uint64_t avalanche(uint64_t hash) noexcept {
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    return hash ^ (hash >> 32);
+}
+
+// Four independent lanes over 32 byte blocks, which compilers keep in
+// vector registers.
+[[nodiscard]] uint64_t hash(std::span<const uint8_t> data) noexcept {
+    const uint8_t *p = data.data();
+    size_t size = data.size();
+    uint64_t lanes[4] = {Prime1 + Prime2, Prime2, 0, -Prime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] = round(lanes[lane], load(p + i + 8 * lane));
+        }
+    }
+    uint64_t result = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) +
+                      std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+    for (; i + 8 <= size; i += 8) {
+        result = std::rotl(result ^ round(0, load(p + i)), 27) * Prime1;
+    }
+    for (; i < size; i++) {
+        result = std::rotl(result ^ (p[i] * Prime3), 11) * Prime1;
+    }
+    return avalanche(result + size);
+}
+
+// Size of the branch displacement ending `ins`.
+[[nodiscard]] size_t displacementSize(const Instruction &ins) noexcept {
+    bool short_ = ins.opcodeMap == 0 &&
+                  ((ins.opcode >= 0x70 && ins.opcode <= 0x7f) ||
+                   ins.opcode == 0xeb);
+    return short_ ? 1 : 4;
+}
+
+// Bytes of immediate following a RIP-relative displacement.
+[[nodiscard]] size_t immediateBytes(const Instruction &ins) noexcept {
+    if (ins.opcodeMap == 0 && (ins.opcode == 0xd0 || ins.opcode == 0xd1)) {
+        // The implicit shift count of one has no encoding.
+        return 0;
+    }
+    size_t bytes = 0;
+    for (const auto &operand : ins.getOperands()) {
+        if (operand.kind == OperandKind::Immediate) {
+            bytes += operand.size;
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+Fingerprint Fingerprinter::operator()(std::span<const uint8_t> code,
+                                      uint64_t address) {
+    masked_.assign(code.begin(), code.end());
+    disassemble::X86_64::decode(code, address, disassemble::ReadingMode::LSB,
+                                instructions_);
+
+    uint64_t targets = 0;
+    auto mask = [&](const Instruction &ins, size_t end, size_t size,
+                    uint64_t target) {
+        size_t offset = ins.address - address;
+        if (end > ins.length || size > end ||
+            offset + end > masked_.size()) {
+            return;
+        }
+        std::fill_n(masked_.begin() + offset + end - size, size, 0);
+        if (target >= address && target < address + code.size()) {
+            target = (target - address) | 1ull << 63;
+        }
+        targets = std::rotl(targets ^ round(0, target), 27) * Prime1;
+    };
+    for (const Instruction &ins : instructions_) {
+        if (auto target = ins.branchTarget()) {
+            size_t size = displacementSize(ins);
+            mask(ins, ins.length, size, target.value());
+        } else if (auto target = ins.ripTarget()) {
+            mask(ins, ins.length - immediateBytes(ins), 4, target.value());
+        }
+    }
+    return Fingerprint{
+        .bytes = hash(masked_), .targets = targets, .size = code.size()};
+}
+
+Groups Groups::build(const binary::Elf64 &elf, size_t jobs) {
+    const auto &functions = elf.getFunctions();
+    std::vector<Fingerprint> fingerprints(functions.size());
+    std::vector<Fingerprinter> fingerprinters(jobs);
+    bool compare =
+        elf.getHeader().e_machine == disassemble::X86_64Isa::Machine;
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t worker) {
+        if (!compare) {
+            // Keyed by address, so that only symbols sharing one group.
+            fingerprints[fn] = Fingerprint{
+                .bytes = functions[fn].offset,
+                .targets = 0,
+                .size = functions[fn].size,
+            };
+            return;
+        }
+        fingerprints[fn] = fingerprinters[worker](elf.getFunctionCode(fn),
+                                                  functions[fn].offset);
+    });
+
+    std::vector<uint32_t> order(functions.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    // Functions without code each stay on their own.
+    auto groupKey = [&](uint32_t fn) {
+        const Fingerprint &fp = fingerprints[fn];
+        return std::tuple(fp.size == 0 ? fn + 1 : 0, fp);
+    };
+    parallel::sort(order, jobs, [&](uint32_t a, uint32_t b) {
+        return std::tuple(groupKey(a), functions[a].offset, a) <
+               std::tuple(groupKey(b), functions[b].offset, b);
+    });
+
+    struct Run {
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Run> runs;
+    for (size_t i = 0; i < order.size();) {
+        size_t end = i + 1;
+        while (end < order.size() &&
+               groupKey(order[end]) == groupKey(order[i])) {
+            end++;
+        }
+        runs.push_back(Run{(uint32_t)i, (uint32_t)end});
+        i = end;
+    }
+    // Groups follow the address order of their first member.
+    std::sort(runs.begin(), runs.end(), [&](const Run &a, const Run &b) {
+        uint32_t first = order[a.begin], second = order[b.begin];
+        return std::pair(functions[first].offset, first) <
+               std::pair(functions[second].offset, second);
+    });
+
+    Groups groups;
+    groups.offsets_.reserve(runs.size() + 1);
+    groups.offsets_.push_back(0);
+    groups.members_.reserve(order.size());
+    groups.copies_.reserve(runs.size());
+    groups.groupOf_.resize(functions.size());
+    for (const Run &run : runs) {
+        uint32_t copies = 0;
+        for (size_t i = run.begin; i < run.end; i++) {
+            uint32_t fn = order[i];
+            if (i == run.begin ||
+                functions[fn].offset != functions[order[i - 1]].offset) {
+                copies++;
+            }
+            groups.groupOf_[fn] = groups.copies_.size();
+            groups.members_.push_back(fn);
+        }
+        groups.copies_.push_back(copies);
+        groups.offsets_.push_back(groups.members_.size());
+    }
+    return groups;
+}
+
+size_t Groups::size() const noexcept { return copies_.size(); }
+
+std::span<const uint32_t> Groups::members(size_t group) const noexcept {
+    return std::span(members_).subspan(offsets_[group],
+                                       offsets_[group + 1] - offsets_[group]);
+}
+
+size_t Groups::groupOf(size_t function) const noexcept {
+    return groupOf_[function];
+}
+
+size_t Groups::copies(size_t group) const noexcept { return copies_[group]; }
+
+} // namespace dedup
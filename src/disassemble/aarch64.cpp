@@ -0,0 +1,1333 @@
+#include <array>
+#include <bit>
+#include <disassemble.hpp>
+#include <format>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace disassemble {
+
+namespace AArch64 {
+
+namespace {
+
+// How the fields of an encoding become operands. Each entry of the decoding
+// tables names one, and decodeForm extracts the operands and picks the
+// preferred alias accordingly.
+enum class Form : uint8_t {
+    Undefined,
+    PcRelative,
+    AddSubImmediate,
+    LogicalImmediate,
+    MoveWide,
+    Bitfield,
+    Extract,
+    Branch,
+    ConditionalBranch,
+    CompareBranch,
+    TestBranch,
+    Exception,
+    Hint,
+    Barrier,
+    InstructionBarrier,
+    SystemRegisterRead,
+    SystemRegisterWrite,
+    BranchRegister,
+    Return,
+    LoadLiteral,
+    LoadStorePair,
+    LoadStoreUnsigned,
+    LoadStoreImmediate,
+    LoadStoreRegister,
+    Exclusive,
+    LogicalShifted,
+    AddSubShifted,
+    AddSubExtended,
+    Carry,
+    ConditionalCompare,
+    ConditionalSelect,
+    DataProcessing1,
+    DataProcessing2,
+    DataProcessing3,
+};
+
+// An instruction matches when `word & mask == value`. Loads and stores
+// leave the mnemonic to their form, which picks it from the size and opc
+// fields.
+struct Encoding {
+    uint32_t mask;
+    uint32_t value;
+    Mnemonic mnemonic;
+    Form form;
+};
+
+constexpr std::array<Encoding, 1> Reserved = {{
+    {0xffff0000, 0x00000000, Mnemonic::Udf, Form::Undefined},
+}};
+
+constexpr std::array<Encoding, 17> DataImmediate = {{
+    {0x9f000000, 0x10000000, Mnemonic::Adr, Form::PcRelative},
+    {0x9f000000, 0x90000000, Mnemonic::Adrp, Form::PcRelative},
+    {0x7f800000, 0x11000000, Mnemonic::Add, Form::AddSubImmediate},
+    {0x7f800000, 0x31000000, Mnemonic::Adds, Form::AddSubImmediate},
+    {0x7f800000, 0x51000000, Mnemonic::Sub, Form::AddSubImmediate},
+    {0x7f800000, 0x71000000, Mnemonic::Subs, Form::AddSubImmediate},
+    {0x7f800000, 0x12000000, Mnemonic::And, Form::LogicalImmediate},
+    {0x7f800000, 0x32000000, Mnemonic::Orr, Form::LogicalImmediate},
+    {0x7f800000, 0x52000000, Mnemonic::Eor, Form::LogicalImmediate},
+    {0x7f800000, 0x72000000, Mnemonic::Ands, Form::LogicalImmediate},
+    {0x7f800000, 0x12800000, Mnemonic::Movn, Form::MoveWide},
+    {0x7f800000, 0x52800000, Mnemonic::Movz, Form::MoveWide},
+    {0x7f800000, 0x72800000, Mnemonic::Movk, Form::MoveWide},
+    {0x7f800000, 0x13000000, Mnemonic::Sbfm, Form::Bitfield},
+    {0x7f800000, 0x33000000, Mnemonic::Bfm, Form::Bitfield},
+    {0x7f800000, 0x53000000, Mnemonic::Ubfm, Form::Bitfield},
+    {0x7fa00000, 0x13800000, Mnemonic::Extr, Form::Extract},
+}};
+
+constexpr std::array<Encoding, 23> Branches = {{
+    {0xfc000000, 0x14000000, Mnemonic::B, Form::Branch},
+    {0xfc000000, 0x94000000, Mnemonic::Bl, Form::Branch},
+    {0xff000010, 0x54000000, Mnemonic::Beq, Form::ConditionalBranch},
+    {0x7f000000, 0x34000000, Mnemonic::Cbz, Form::CompareBranch},
+    {0x7f000000, 0x35000000, Mnemonic::Cbnz, Form::CompareBranch},
+    {0x7f000000, 0x36000000, Mnemonic::Tbz, Form::TestBranch},
+    {0x7f000000, 0x37000000, Mnemonic::Tbnz, Form::TestBranch},
+    {0xffe0001f, 0xd4000001, Mnemonic::Svc, Form::Exception},
+    {0xffe0001f, 0xd4000002, Mnemonic::Hvc, Form::Exception},
+    {0xffe0001f, 0xd4000003, Mnemonic::Smc, Form::Exception},
+    {0xffe0001f, 0xd4200000, Mnemonic::Brk, Form::Exception},
+    {0xffe0001f, 0xd4400000, Mnemonic::Hlt, Form::Exception},
+    {0xfffff01f, 0xd503201f, Mnemonic::Hint, Form::Hint},
+    {0xfffff0ff, 0xd503309f, Mnemonic::Dsb, Form::Barrier},
+    {0xfffff0ff, 0xd50330bf, Mnemonic::Dmb, Form::Barrier},
+    {0xfffff0ff, 0xd50330df, Mnemonic::Isb, Form::InstructionBarrier},
+    {0xfff00000, 0xd5300000, Mnemonic::Mrs, Form::SystemRegisterRead},
+    {0xfff00000, 0xd5100000, Mnemonic::Msr, Form::SystemRegisterWrite},
+    {0xfffffc1f, 0xd61f0000, Mnemonic::Br, Form::BranchRegister},
+    {0xfffffc1f, 0xd63f0000, Mnemonic::Blr, Form::BranchRegister},
+    {0xfffffc1f, 0xd65f0000, Mnemonic::Ret, Form::Return},
+    {0xffffffff, 0xd65f0bff, Mnemonic::Retaa, Form::Return},
+    {0xffffffff, 0xd65f0fff, Mnemonic::Retab, Form::Return},
+}};
+
+constexpr std::array<Encoding, 6> LoadsAndStores = {{
+    {0x3f000000, 0x08000000, Mnemonic::Unknown, Form::Exclusive},
+    {0x3b000000, 0x18000000, Mnemonic::Unknown, Form::LoadLiteral},
+    {0x3a000000, 0x28000000, Mnemonic::Unknown, Form::LoadStorePair},
+    {0x3b000000, 0x39000000, Mnemonic::Unknown, Form::LoadStoreUnsigned},
+    {0x3b200000, 0x38000000, Mnemonic::Unknown, Form::LoadStoreImmediate},
+    {0x3b200c00, 0x38200800, Mnemonic::Unknown, Form::LoadStoreRegister},
+}};
+
+constexpr std::array<Encoding, 9> DataRegister = {{
+    {0x1f000000, 0x0a000000, Mnemonic::Unknown, Form::LogicalShifted},
+    {0x1f200000, 0x0b000000, Mnemonic::Unknown, Form::AddSubShifted},
+    {0x1fe00000, 0x0b200000, Mnemonic::Unknown, Form::AddSubExtended},
+    {0x1fe0fc00, 0x1a000000, Mnemonic::Unknown, Form::Carry},
+    {0x3fe00410, 0x3a400000, Mnemonic::Unknown, Form::ConditionalCompare},
+    {0x3fe00800, 0x1a800000, Mnemonic::Unknown, Form::ConditionalSelect},
+    {0x7fff0000, 0x5ac00000, Mnemonic::Unknown, Form::DataProcessing1},
+    {0x7fe00000, 0x1ac00000, Mnemonic::Unknown, Form::DataProcessing2},
+    {0x7f000000, 0x1b000000, Mnemonic::Unknown, Form::DataProcessing3},
+}};
+
+// Indexed by op0, bits 28:25. SVE and SIMD/floating point data processing
+// have no entries yet.
+constexpr std::array<std::span<const Encoding>, 16> Groups = {
+    Reserved,       {},           {},       {},
+    LoadsAndStores, DataRegister, LoadsAndStores, {},
+    DataImmediate,  DataImmediate, Branches, Branches,
+    LoadsAndStores, DataRegister, LoadsAndStores, {},
+};
+
+[[nodiscard]] constexpr uint32_t bits(uint32_t word, unsigned low,
+                                      unsigned count) noexcept {
+    return (word >> low) & ((1u << count) - 1);
+}
+
+[[nodiscard]] constexpr int64_t signedBits(uint32_t word, unsigned low,
+                                           unsigned count) noexcept {
+    unsigned shift = 64 - count;
+    return (int64_t)((uint64_t)bits(word, low, count) << shift) >> shift;
+}
+
+// General purpose register `number`, 31 being SP when `stackPointer` is set
+// and the zero register otherwise.
+[[nodiscard]] Operand reg(uint32_t number, size_t size,
+                          bool stackPointer = false) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Register;
+    operand.size = size;
+    operand.base = number != 31  ? (Register)number
+                   : stackPointer ? Register::SP
+                                  : Register::ZR;
+    return operand;
+}
+
+[[nodiscard]] Operand vectorReg(uint32_t number, size_t size) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Register;
+    operand.size = size;
+    operand.base = (Register)((uint32_t)Register::V0 + number);
+    return operand;
+}
+
+[[nodiscard]] Operand shifted(Operand operand, Extend extend,
+                              uint32_t amount) noexcept {
+    operand.extend = extend;
+    operand.amount = amount;
+    return operand;
+}
+
+[[nodiscard]] Operand immediate(uint64_t value, uint32_t shift = 0) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Immediate;
+    operand.value = (int64_t)value;
+    if (shift != 0) {
+        operand.extend = Extend::Lsl;
+        operand.amount = shift;
+    }
+    return operand;
+}
+
+[[nodiscard]] Operand number(int64_t value) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Number;
+    operand.value = value;
+    return operand;
+}
+
+[[nodiscard]] Operand memory(uint32_t base, size_t size, int64_t offset = 0,
+                             Indexing indexing = Indexing::Offset) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Memory;
+    operand.size = size;
+    operand.base = base == 31 ? Register::SP : (Register)base;
+    operand.indexing = indexing;
+    operand.value = offset;
+    return operand;
+}
+
+[[nodiscard]] Operand target(uint64_t address) noexcept {
+    Operand operand;
+    operand.kind = OperandKind::Target;
+    operand.value = (int64_t)address;
+    return operand;
+}
+
+[[nodiscard]] Operand special(OperandKind kind, uint32_t value) noexcept {
+    Operand operand;
+    operand.kind = kind;
+    operand.value = value;
+    return operand;
+}
+
+void push(Instruction &ins, const Operand &operand) noexcept {
+    ins.operands[ins.operandCount++] = operand;
+}
+
+// DecodeBitMasks from the manual: the immediate of the logical
+// instructions, a rotated run of ones replicated across the register.
+[[nodiscard]] std::optional<uint64_t>
+decodeBitMask(bool wide, uint32_t n, uint32_t immr, uint32_t imms) noexcept {
+    uint32_t combined = (n << 6) | (~imms & 0x3f);
+    if (combined == 0 || (!wide && n != 0)) {
+        return std::nullopt;
+    }
+    uint32_t length = 31 - std::countl_zero(combined);
+    if (length < 1) {
+        return std::nullopt;
+    }
+    uint32_t size = 1u << length;
+    uint32_t levels = size - 1;
+    uint32_t ones = imms & levels;
+    uint32_t rotation = immr & levels;
+    if (ones == levels) {
+        return std::nullopt;
+    }
+    uint64_t element = (1ull << (ones + 1)) - 1;
+    if (rotation != 0) {
+        uint64_t mask = size == 64 ? ~0ull : (1ull << size) - 1;
+        element = ((element >> rotation) | (element << (size - rotation))) &
+                  mask;
+    }
+    for (uint32_t width = size; width < 64; width *= 2) {
+        element |= element << width;
+    }
+    return wide ? element : element & 0xffffffff;
+}
+
+// Whether MOVZ or MOVN can make `value`, in which case MOV stands for them
+// rather than for ORR.
+[[nodiscard]] bool isMoveWide(uint64_t value, bool wide) noexcept {
+    uint64_t mask = wide ? ~0ull : 0xffffffffull;
+    for (uint64_t candidate : {value & mask, ~value & mask}) {
+        for (unsigned shift = 0; shift < (wide ? 64u : 32u); shift += 16) {
+            if ((candidate & ~(0xffffull << shift)) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+struct Access {
+    Mnemonic mnemonic;
+    // Of the transfer register.
+    uint8_t registerSize;
+    // Of the memory access, which scales unsigned offsets.
+    uint8_t accessSize;
+    bool vector;
+};
+
+// The single register loads and stores by size, V and opc.
+[[nodiscard]] std::optional<Access> decodeAccess(uint32_t word,
+                                                 bool unscaled) noexcept {
+    using enum Mnemonic;
+    static constexpr std::array<std::array<Mnemonic, 4>, 4> scaledNames = {{
+        {Strb, Strh, Str, Str},
+        {Ldrb, Ldrh, Ldr, Ldr},
+        {Ldrsb, Ldrsh, Ldrsw, Prfm},
+        {Ldrsb, Ldrsh, Unknown, Unknown},
+    }};
+    static constexpr std::array<std::array<Mnemonic, 4>, 4> unscaledNames = {{
+        {Sturb, Sturh, Stur, Stur},
+        {Ldurb, Ldurh, Ldur, Ldur},
+        {Ldursb, Ldursh, Ldursw, Prfum},
+        {Ldursb, Ldursh, Unknown, Unknown},
+    }};
+    uint32_t size = bits(word, 30, 2);
+    uint32_t opc = bits(word, 22, 2);
+    if (bits(word, 26, 1) != 0) {
+        if ((opc & 2) != 0 && size != 0) {
+            return std::nullopt;
+        }
+        uint8_t accessSize = (opc & 2) != 0 ? 16 : 1u << size;
+        bool load = (opc & 1) != 0;
+        Mnemonic mnemonic = unscaled ? (load ? Ldur : Stur)
+                                     : (load ? Ldr : Str);
+        return Access{mnemonic, accessSize, accessSize, true};
+    }
+    Mnemonic mnemonic = (unscaled ? unscaledNames : scaledNames)[opc][size];
+    if (mnemonic == Unknown) {
+        return std::nullopt;
+    }
+    uint8_t registerSize = opc == 2 || (opc < 2 && size == 3) ? 8 : 4;
+    return Access{mnemonic, registerSize, (uint8_t)(1u << size), false};
+}
+
+[[nodiscard]] Operand transferRegister(uint32_t rt,
+                                       const Access &access) noexcept {
+    // Prefetches have an operation where loads have a register.
+    if (access.mnemonic == Mnemonic::Prfm ||
+        access.mnemonic == Mnemonic::Prfum) {
+        return special(OperandKind::Prefetch, rt);
+    }
+    return access.vector ? vectorReg(rt, access.registerSize)
+                         : reg(rt, access.registerSize);
+}
+
+bool decodeBitfield(Instruction &ins, uint32_t word, bool wide,
+                    size_t size) noexcept {
+    uint32_t immr = bits(word, 16, 6);
+    uint32_t imms = bits(word, 10, 6);
+    uint32_t width = wide ? 64 : 32;
+    if (bits(word, 22, 1) != wide || immr >= width || imms >= width) {
+        return false;
+    }
+    Operand rd = reg(bits(word, 0, 5), size);
+    Operand rn = reg(bits(word, 5, 5), size);
+    auto field = [&](Mnemonic mnemonic, int64_t first, int64_t second) {
+        ins.mnemonic = mnemonic;
+        push(ins, rd);
+        push(ins, rn);
+        push(ins, number(first));
+        push(ins, number(second));
+    };
+    auto extend = [&](Mnemonic mnemonic) {
+        ins.mnemonic = mnemonic;
+        push(ins, rd);
+        push(ins, reg(bits(word, 5, 5), 4));
+    };
+    switch (ins.mnemonic) {
+    case Mnemonic::Sbfm:
+        if (imms == width - 1) {
+            ins.mnemonic = Mnemonic::Asr;
+            push(ins, rd);
+            push(ins, rn);
+            push(ins, number(immr));
+        } else if (immr == 0 && imms == 7) {
+            extend(Mnemonic::Sxtb);
+        } else if (immr == 0 && imms == 15) {
+            extend(Mnemonic::Sxth);
+        } else if (immr == 0 && imms == 31) {
+            extend(Mnemonic::Sxtw);
+        } else if (imms < immr) {
+            field(Mnemonic::Sbfiz, width - immr, imms + 1);
+        } else {
+            field(Mnemonic::Sbfx, immr, imms - immr + 1);
+        }
+        return true;
+    case Mnemonic::Ubfm:
+        if (imms != width - 1 && imms + 1 == immr) {
+            ins.mnemonic = Mnemonic::Lsl;
+            push(ins, rd);
+            push(ins, rn);
+            push(ins, number(width - 1 - imms));
+        } else if (imms == width - 1) {
+            ins.mnemonic = Mnemonic::Lsr;
+            push(ins, rd);
+            push(ins, rn);
+            push(ins, number(immr));
+        } else if (!wide && immr == 0 && imms == 7) {
+            extend(Mnemonic::Uxtb);
+        } else if (!wide && immr == 0 && imms == 15) {
+            extend(Mnemonic::Uxth);
+        } else if (imms < immr) {
+            field(Mnemonic::Ubfiz, width - immr, imms + 1);
+        } else {
+            field(Mnemonic::Ubfx, immr, imms - immr + 1);
+        }
+        return true;
+    default:
+        if (imms < immr && bits(word, 5, 5) == 31) {
+            ins.mnemonic = Mnemonic::Bfc;
+            push(ins, rd);
+            push(ins, number(width - immr));
+            push(ins, number(imms + 1));
+        } else if (imms < immr) {
+            field(Mnemonic::Bfi, width - immr, imms + 1);
+        } else {
+            field(Mnemonic::Bfxil, immr, imms - immr + 1);
+        }
+        return true;
+    }
+}
+
+bool decodeMoveWide(Instruction &ins, uint32_t word, bool wide,
+                    size_t size) noexcept {
+    uint32_t hw = bits(word, 21, 2);
+    uint64_t imm16 = bits(word, 5, 16);
+    if (!wide && hw >= 2) {
+        return false;
+    }
+    uint32_t shift = hw * 16;
+    push(ins, reg(bits(word, 0, 5), size));
+    // MOV is preferred unless it cannot tell the encoding apart.
+    bool alias = !(imm16 == 0 && hw != 0);
+    if (ins.mnemonic == Mnemonic::Movz && alias) {
+        ins.mnemonic = Mnemonic::Mov;
+        push(ins, immediate(imm16 << shift));
+    } else if (ins.mnemonic == Mnemonic::Movn && alias &&
+               (wide || imm16 != 0xffff)) {
+        uint64_t value = ~(imm16 << shift);
+        ins.mnemonic = Mnemonic::Mov;
+        push(ins, immediate(wide ? value : value & 0xffffffff));
+    } else {
+        push(ins, immediate(imm16, shift));
+    }
+    return true;
+}
+
+bool decodeLoadStore(Instruction &ins, uint32_t word, Form form) noexcept {
+    uint32_t rt = bits(word, 0, 5);
+    uint32_t rn = bits(word, 5, 5);
+    switch (form) {
+    case Form::LoadStoreUnsigned: {
+        auto access = decodeAccess(word, false);
+        if (!access.has_value()) {
+            return false;
+        }
+        ins.mnemonic = access->mnemonic;
+        push(ins, transferRegister(rt, access.value()));
+        push(ins, memory(rn, access->accessSize,
+                         bits(word, 10, 12) * access->accessSize));
+        return true;
+    }
+    case Form::LoadStoreImmediate: {
+        static constexpr std::array<Indexing, 4> indexings = {
+            Indexing::Offset, Indexing::PostIndex, Indexing::Offset,
+            Indexing::PreIndex};
+        uint32_t type = bits(word, 10, 2);
+        auto access = decodeAccess(word, type == 0);
+        // Type 2 are the unprivileged LDTR and STTR.
+        if (!access.has_value() || type == 2 ||
+            (type != 0 && access->mnemonic == Mnemonic::Prfm)) {
+            return false;
+        }
+        ins.mnemonic = access->mnemonic;
+        push(ins, transferRegister(rt, access.value()));
+        push(ins, memory(rn, access->accessSize, signedBits(word, 12, 9),
+                         indexings[type]));
+        return true;
+    }
+    case Form::LoadStoreRegister: {
+        uint32_t option = bits(word, 13, 3);
+        auto access = decodeAccess(word, false);
+        if (!access.has_value() || (option & 2) == 0) {
+            return false;
+        }
+        bool scaled = bits(word, 12, 1) != 0;
+        Operand address = memory(rn, access->accessSize);
+        address.index = reg(bits(word, 16, 5), 8).base;
+        if (option == 3) {
+            address.extend = scaled ? Extend::Lsl : Extend::None;
+        } else {
+            address.extend = (Extend)((uint32_t)Extend::Uxtb + option);
+        }
+        address.amount = scaled ? std::countr_zero(access->accessSize) : 0;
+        ins.mnemonic = access->mnemonic;
+        push(ins, transferRegister(rt, access.value()));
+        push(ins, address);
+        return true;
+    }
+    case Form::LoadLiteral: {
+        static constexpr std::array<Mnemonic, 4> names = {
+            Mnemonic::Ldr, Mnemonic::Ldr, Mnemonic::Ldrsw, Mnemonic::Prfm};
+        uint32_t opc = bits(word, 30, 2);
+        bool vector = bits(word, 26, 1) != 0;
+        if (vector && opc == 3) {
+            return false;
+        }
+        ins.mnemonic = vector ? Mnemonic::Ldr : names[opc];
+        if (vector) {
+            push(ins, vectorReg(rt, 4u << opc));
+        } else if (opc == 3) {
+            push(ins, special(OperandKind::Prefetch, rt));
+        } else {
+            push(ins, reg(rt, opc == 0 ? 4 : 8));
+        }
+        push(ins, target(ins.address + signedBits(word, 5, 19) * 4));
+        return true;
+    }
+    case Form::LoadStorePair: {
+        uint32_t opc = bits(word, 30, 2);
+        uint32_t indexing = bits(word, 23, 2);
+        bool vector = bits(word, 26, 1) != 0;
+        bool load = bits(word, 22, 1) != 0;
+        size_t size = vector ? 4u << opc : (opc == 0 ? 4 : 8);
+        size_t scale = size;
+        if (opc == 3 || (!vector && opc == 1 && (!load || indexing == 0))) {
+            return false;
+        }
+        if (!vector && opc == 1) {
+            ins.mnemonic = Mnemonic::Ldpsw;
+            scale = 4;
+        } else if (indexing == 0) {
+            ins.mnemonic = load ? Mnemonic::Ldnp : Mnemonic::Stnp;
+        } else {
+            ins.mnemonic = load ? Mnemonic::Ldp : Mnemonic::Stp;
+        }
+        static constexpr std::array<Indexing, 4> indexings = {
+            Indexing::Offset, Indexing::PostIndex, Indexing::Offset,
+            Indexing::PreIndex};
+        uint32_t rt2 = bits(word, 10, 5);
+        push(ins, vector ? vectorReg(rt, size) : reg(rt, size));
+        push(ins, vector ? vectorReg(rt2, size) : reg(rt2, size));
+        push(ins, memory(rn, scale * 2, signedBits(word, 15, 7) * scale,
+                         indexings[indexing]));
+        return true;
+    }
+    case Form::Exclusive: {
+        using enum Mnemonic;
+        // By size (B, H, then W and X alike) and ordering.
+        static constexpr std::array<std::array<Mnemonic, 6>, 3> names = {{
+            {Ldxrb, Ldaxrb, Stxrb, Stlxrb, Ldarb, Stlrb},
+            {Ldxrh, Ldaxrh, Stxrh, Stlxrh, Ldarh, Stlrh},
+            {Ldxr, Ldaxr, Stxr, Stlxr, Ldar, Stlr},
+        }};
+        uint32_t size = bits(word, 30, 2);
+        bool ordered = bits(word, 23, 1) != 0;
+        bool load = bits(word, 22, 1) != 0;
+        bool acquireRelease = bits(word, 15, 1) != 0;
+        // Pairs, the LSE compare and swap and the LORegion LDLAR and STLLR
+        // are not modelled.
+        if (bits(word, 21, 1) != 0 || (ordered && !acquireRelease)) {
+            return false;
+        }
+        size_t kind = ordered ? 4 + !load : 2 * !load + acquireRelease;
+        ins.mnemonic = names[std::min<uint32_t>(size, 2)][kind];
+        if (!ordered && !load) {
+            push(ins, reg(bits(word, 16, 5), 4));
+        }
+        push(ins, reg(rt, size == 3 ? 8 : 4));
+        push(ins, memory(rn, 1u << size));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool decodeDataRegister(Instruction &ins, uint32_t word, Form form,
+                        bool wide, size_t size) noexcept {
+    using enum Mnemonic;
+    uint32_t rd = bits(word, 0, 5);
+    uint32_t rn = bits(word, 5, 5);
+    uint32_t rm = bits(word, 16, 5);
+    uint32_t operation = bits(word, 29, 2);
+    switch (form) {
+    case Form::LogicalShifted: {
+        static constexpr std::array<std::array<Mnemonic, 2>, 4> names = {{
+            {And, Bic}, {Orr, Orn}, {Eor, Eon}, {Ands, Bics}}};
+        uint32_t amount = bits(word, 10, 6);
+        if (!wide && amount >= 32) {
+            return false;
+        }
+        auto shift = (Extend)((uint32_t)Extend::Lsl + bits(word, 22, 2));
+        Operand source = reg(rm, size);
+        if (amount != 0 || shift != Extend::Lsl) {
+            source = shifted(source, shift, amount);
+        }
+        ins.mnemonic = names[operation][bits(word, 21, 1)];
+        if (ins.mnemonic == Orr && rn == 31 && amount == 0 &&
+            shift == Extend::Lsl) {
+            ins.mnemonic = Mov;
+        } else if (ins.mnemonic == Orn && rn == 31) {
+            ins.mnemonic = Mvn;
+        } else if (ins.mnemonic == Ands && rd == 31) {
+            ins.mnemonic = Tst;
+            push(ins, reg(rn, size));
+            push(ins, source);
+            return true;
+        } else {
+            push(ins, reg(rd, size));
+            push(ins, reg(rn, size));
+            push(ins, source);
+            return true;
+        }
+        push(ins, reg(rd, size));
+        push(ins, source);
+        return true;
+    }
+    case Form::AddSubShifted: {
+        static constexpr std::array<Mnemonic, 4> names = {Add, Adds, Sub,
+                                                          Subs};
+        uint32_t amount = bits(word, 10, 6);
+        uint32_t shift = bits(word, 22, 2);
+        if (shift == 3 || (!wide && amount >= 32)) {
+            return false;
+        }
+        Operand source = reg(rm, size);
+        if (amount != 0 || shift != 0) {
+            source = shifted(source, (Extend)((uint32_t)Extend::Lsl + shift),
+                             amount);
+        }
+        ins.mnemonic = names[operation];
+        if ((ins.mnemonic == Subs || ins.mnemonic == Adds) && rd == 31) {
+            ins.mnemonic = ins.mnemonic == Subs ? Cmp : Cmn;
+            push(ins, reg(rn, size));
+        } else if ((ins.mnemonic == Sub || ins.mnemonic == Subs) &&
+                   rn == 31) {
+            ins.mnemonic = ins.mnemonic == Sub ? Neg : Negs;
+            push(ins, reg(rd, size));
+        } else {
+            push(ins, reg(rd, size));
+            push(ins, reg(rn, size));
+        }
+        push(ins, source);
+        return true;
+    }
+    case Form::AddSubExtended: {
+        static constexpr std::array<Mnemonic, 4> names = {Add, Adds, Sub,
+                                                          Subs};
+        uint32_t amount = bits(word, 10, 3);
+        uint32_t option = bits(word, 13, 3);
+        bool setsFlags = (operation & 1) != 0;
+        if (amount > 4) {
+            return false;
+        }
+        auto extend = (Extend)((uint32_t)Extend::Uxtb + option);
+        // With SP involved, the extension matching the register width is
+        // written as LSL, or not at all.
+        if ((rn == 31 || (rd == 31 && !setsFlags)) &&
+            option == (wide ? 3u : 2u)) {
+            extend = amount != 0 ? Extend::Lsl : Extend::None;
+        }
+        Operand source = shifted(reg(rm, wide && (option & 3) == 3 ? 8 : 4),
+                                 extend, amount);
+        ins.mnemonic = names[operation];
+        if (setsFlags && rd == 31) {
+            ins.mnemonic = ins.mnemonic == Subs ? Cmp : Cmn;
+        } else {
+            push(ins, reg(rd, size, !setsFlags));
+        }
+        push(ins, reg(rn, size, true));
+        push(ins, source);
+        return true;
+    }
+    case Form::Carry: {
+        static constexpr std::array<Mnemonic, 4> names = {Adc, Adcs, Sbc,
+                                                          Sbcs};
+        ins.mnemonic = names[operation];
+        push(ins, reg(rd, size));
+        push(ins, reg(rn, size));
+        push(ins, reg(rm, size));
+        return true;
+    }
+    case Form::ConditionalCompare:
+        ins.mnemonic = bits(word, 30, 1) != 0 ? Ccmp : Ccmn;
+        push(ins, reg(rn, size));
+        push(ins, bits(word, 11, 1) != 0 ? immediate(rm) : reg(rm, size));
+        push(ins, number(bits(word, 0, 4)));
+        push(ins, special(OperandKind::Condition, bits(word, 12, 4)));
+        return true;
+    case Form::ConditionalSelect: {
+        static constexpr std::array<std::array<Mnemonic, 2>, 2> names = {{
+            {Csel, Csinc}, {Csinv, Csneg}}};
+        uint32_t condition = bits(word, 12, 4);
+        bool negate = bits(word, 30, 1) != 0;
+        ins.mnemonic = names[negate][bits(word, 10, 1)];
+        // The aliases invert the condition, which AL and NV cannot be.
+        if (ins.mnemonic != Csel && condition < 14 && rn == rm) {
+            auto inverted = special(OperandKind::Condition, condition ^ 1);
+            push(ins, reg(rd, size));
+            if (rn == 31 && ins.mnemonic != Csneg) {
+                ins.mnemonic = ins.mnemonic == Csinc ? Cset : Csetm;
+            } else {
+                ins.mnemonic = ins.mnemonic == Csinc   ? Cinc
+                               : ins.mnemonic == Csinv ? Cinv
+                                                       : Cneg;
+                push(ins, reg(rn, size));
+            }
+            push(ins, inverted);
+            return true;
+        }
+        push(ins, reg(rd, size));
+        push(ins, reg(rn, size));
+        push(ins, reg(rm, size));
+        push(ins, special(OperandKind::Condition, condition));
+        return true;
+    }
+    case Form::DataProcessing1: {
+        uint32_t opcode = bits(word, 10, 6);
+        switch (opcode) {
+        case 0:
+            ins.mnemonic = Rbit;
+            break;
+        case 1:
+            ins.mnemonic = Rev16;
+            break;
+        case 2:
+            ins.mnemonic = wide ? Rev32 : Rev;
+            break;
+        case 3:
+            if (!wide) {
+                return false;
+            }
+            ins.mnemonic = Rev;
+            break;
+        case 4:
+            ins.mnemonic = Clz;
+            break;
+        case 5:
+            ins.mnemonic = Cls;
+            break;
+        default:
+            return false;
+        }
+        push(ins, reg(rd, size));
+        push(ins, reg(rn, size));
+        return true;
+    }
+    case Form::DataProcessing2:
+        switch (bits(word, 10, 6)) {
+        case 2:
+            ins.mnemonic = Udiv;
+            break;
+        case 3:
+            ins.mnemonic = Sdiv;
+            break;
+        case 8:
+            ins.mnemonic = Lsl;
+            break;
+        case 9:
+            ins.mnemonic = Lsr;
+            break;
+        case 10:
+            ins.mnemonic = Asr;
+            break;
+        case 11:
+            ins.mnemonic = Ror;
+            break;
+        default:
+            return false;
+        }
+        push(ins, reg(rd, size));
+        push(ins, reg(rn, size));
+        push(ins, reg(rm, size));
+        return true;
+    case Form::DataProcessing3: {
+        uint32_t kind = bits(word, 21, 3);
+        bool subtract = bits(word, 15, 1) != 0;
+        uint32_t ra = bits(word, 10, 5);
+        if (kind == 0) {
+            ins.mnemonic = ra == 31 ? (subtract ? Mneg : Mul)
+                                    : (subtract ? Msub : Madd);
+            push(ins, reg(rd, size));
+            push(ins, reg(rn, size));
+            push(ins, reg(rm, size));
+            if (ra != 31) {
+                push(ins, reg(ra, size));
+            }
+            return true;
+        }
+        if (!wide) {
+            return false;
+        }
+        if ((kind == 2 || kind == 6) && !subtract) {
+            ins.mnemonic = kind == 2 ? Smulh : Umulh;
+            push(ins, reg(rd, 8));
+            push(ins, reg(rn, 8));
+            push(ins, reg(rm, 8));
+            return true;
+        }
+        if (kind != 1 && kind != 5) {
+            return false;
+        }
+        bool isSigned = kind == 1;
+        if (ra == 31) {
+            ins.mnemonic = subtract ? (isSigned ? Smnegl : Umnegl)
+                                    : (isSigned ? Smull : Umull);
+        } else if (subtract) {
+            ins.mnemonic = isSigned ? Smsubl : Umsubl;
+        } else {
+            ins.mnemonic = isSigned ? Smaddl : Umaddl;
+        }
+        push(ins, reg(rd, 8));
+        push(ins, reg(rn, 4));
+        push(ins, reg(rm, 4));
+        if (ra != 31) {
+            push(ins, reg(ra, 8));
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Fills in the operands of `ins` as laid out by `form`, replacing the
+// mnemonic with its preferred alias where there is one. Returns false for
+// unallocated encodings.
+bool decodeForm(Instruction &ins, uint32_t word, Form form) noexcept {
+    bool wide = bits(word, 31, 1) != 0;
+    size_t size = wide ? 8 : 4;
+    uint32_t rd = bits(word, 0, 5);
+    uint32_t rn = bits(word, 5, 5);
+    switch (form) {
+    case Form::Undefined:
+        push(ins, immediate(bits(word, 0, 16)));
+        return true;
+    case Form::PcRelative: {
+        int64_t offset = (signedBits(word, 5, 19) << 2) | bits(word, 29, 2);
+        uint64_t address = ins.address + offset;
+        if (ins.mnemonic == Mnemonic::Adrp) {
+            address = (ins.address & ~0xfffull) + (offset << 12);
+        }
+        push(ins, reg(rd, 8));
+        push(ins, target(address));
+        return true;
+    }
+    case Form::AddSubImmediate: {
+        bool setsFlags = ins.mnemonic == Mnemonic::Adds ||
+                         ins.mnemonic == Mnemonic::Subs;
+        uint32_t shift = bits(word, 22, 1) * 12;
+        uint32_t imm12 = bits(word, 10, 12);
+        if (ins.mnemonic == Mnemonic::Add && shift == 0 && imm12 == 0 &&
+            (rd == 31 || rn == 31)) {
+            ins.mnemonic = Mnemonic::Mov;
+            push(ins, reg(rd, size, true));
+            push(ins, reg(rn, size, true));
+            return true;
+        }
+        if (setsFlags && rd == 31) {
+            ins.mnemonic = ins.mnemonic == Mnemonic::Subs ? Mnemonic::Cmp
+                                                          : Mnemonic::Cmn;
+        } else {
+            push(ins, reg(rd, size, !setsFlags));
+        }
+        push(ins, reg(rn, size, true));
+        push(ins, immediate(imm12, shift));
+        return true;
+    }
+    case Form::LogicalImmediate: {
+        auto value = decodeBitMask(wide, bits(word, 22, 1),
+                                   bits(word, 16, 6), bits(word, 10, 6));
+        if (!value.has_value()) {
+            return false;
+        }
+        if (ins.mnemonic == Mnemonic::Ands && rd == 31) {
+            ins.mnemonic = Mnemonic::Tst;
+        } else if (ins.mnemonic == Mnemonic::Orr && rn == 31 &&
+                   !isMoveWide(value.value(), wide)) {
+            ins.mnemonic = Mnemonic::Mov;
+            push(ins, reg(rd, size, true));
+            push(ins, immediate(value.value()));
+            return true;
+        } else {
+            push(ins, reg(rd, size, ins.mnemonic != Mnemonic::Ands));
+        }
+        push(ins, reg(rn, size));
+        push(ins, immediate(value.value()));
+        return true;
+    }
+    case Form::MoveWide:
+        return decodeMoveWide(ins, word, wide, size);
+    case Form::Bitfield:
+        return decodeBitfield(ins, word, wide, size);
+    case Form::Extract: {
+        uint32_t rm = bits(word, 16, 5);
+        uint32_t lsb = bits(word, 10, 6);
+        if (bits(word, 22, 1) != wide || (!wide && lsb >= 32)) {
+            return false;
+        }
+        push(ins, reg(rd, size));
+        push(ins, reg(rn, size));
+        if (rn == rm) {
+            ins.mnemonic = Mnemonic::Ror;
+        } else {
+            push(ins, reg(rm, size));
+        }
+        push(ins, number(lsb));
+        return true;
+    }
+    case Form::Branch:
+        push(ins, target(ins.address + signedBits(word, 0, 26) * 4));
+        return true;
+    case Form::ConditionalBranch:
+        ins.mnemonic = (Mnemonic)((uint32_t)Mnemonic::Beq + bits(word, 0, 4));
+        push(ins, target(ins.address + signedBits(word, 5, 19) * 4));
+        return true;
+    case Form::CompareBranch:
+        push(ins, reg(rd, size));
+        push(ins, target(ins.address + signedBits(word, 5, 19) * 4));
+        return true;
+    case Form::TestBranch:
+        push(ins, reg(rd, size));
+        push(ins, number((bits(word, 31, 1) << 5) | bits(word, 19, 5)));
+        push(ins, target(ins.address + signedBits(word, 5, 14) * 4));
+        return true;
+    case Form::Exception:
+        push(ins, immediate(bits(word, 5, 16)));
+        return true;
+    case Form::Hint: {
+        uint32_t hint = bits(word, 5, 7);
+        switch (hint) {
+        case 0:
+            ins.mnemonic = Mnemonic::Nop;
+            return true;
+        case 1:
+            ins.mnemonic = Mnemonic::Yield;
+            return true;
+        case 2:
+            ins.mnemonic = Mnemonic::Wfe;
+            return true;
+        case 3:
+            ins.mnemonic = Mnemonic::Wfi;
+            return true;
+        case 4:
+            ins.mnemonic = Mnemonic::Sev;
+            return true;
+        case 24:
+            ins.mnemonic = Mnemonic::Paciaz;
+            return true;
+        case 25:
+            ins.mnemonic = Mnemonic::Paciasp;
+            return true;
+        case 27:
+            ins.mnemonic = Mnemonic::Pacibsp;
+            return true;
+        case 28:
+            ins.mnemonic = Mnemonic::Autiaz;
+            return true;
+        case 29:
+            ins.mnemonic = Mnemonic::Autiasp;
+            return true;
+        case 31:
+            ins.mnemonic = Mnemonic::Autibsp;
+            return true;
+        case 32:
+        case 34:
+        case 36:
+        case 38:
+            // The targets (c, j or jc) are printed from the encoding.
+            ins.mnemonic = Mnemonic::Bti;
+            return true;
+        default:
+            push(ins, number(hint));
+            return true;
+        }
+    }
+    case Form::Barrier:
+        push(ins, special(OperandKind::Barrier, bits(word, 8, 4)));
+        return true;
+    case Form::InstructionBarrier:
+        if (bits(word, 8, 4) != 15) {
+            push(ins, number(bits(word, 8, 4)));
+        }
+        return true;
+    case Form::SystemRegisterRead:
+        push(ins, reg(rd, 8));
+        push(ins, special(OperandKind::SystemRegister, bits(word, 5, 16)));
+        return true;
+    case Form::SystemRegisterWrite:
+        push(ins, special(OperandKind::SystemRegister, bits(word, 5, 16)));
+        push(ins, reg(rd, 8));
+        return true;
+    case Form::BranchRegister:
+        push(ins, reg(rn, 8));
+        return true;
+    case Form::Return:
+        if (ins.mnemonic == Mnemonic::Ret && rn != 30) {
+            push(ins, reg(rn, 8));
+        }
+        return true;
+    case Form::LoadLiteral:
+    case Form::LoadStorePair:
+    case Form::LoadStoreUnsigned:
+    case Form::LoadStoreImmediate:
+    case Form::LoadStoreRegister:
+    case Form::Exclusive:
+        return decodeLoadStore(ins, word, form);
+    default:
+        return decodeDataRegister(ins, word, form, wide, size);
+    }
+}
+
+[[nodiscard]] uint32_t readWord(std::span<const uint8_t> code,
+                                size_t offset) noexcept {
+    return (uint32_t)code[offset] | (uint32_t)code[offset + 1] << 8 |
+           (uint32_t)code[offset + 2] << 16 | (uint32_t)code[offset + 3] << 24;
+}
+
+void writeSystemRegister(std::string &out, uint32_t value) {
+    struct Named {
+        uint32_t encoding;
+        std::string_view name;
+    };
+    // op0:op1:CRn:CRm:op2 of the registers user space code reads.
+    constexpr auto encode = [](uint32_t op0, uint32_t op1, uint32_t crn,
+                               uint32_t crm, uint32_t op2) {
+        return op0 << 14 | op1 << 11 | crn << 7 | crm << 3 | op2;
+    };
+    static constexpr std::array<Named, 11> names = {{
+        {encode(3, 0, 0, 0, 0), "midr_el1"},
+        {encode(3, 3, 0, 0, 1), "ctr_el0"},
+        {encode(3, 3, 0, 0, 7), "dczid_el0"},
+        {encode(3, 3, 4, 2, 0), "nzcv"},
+        {encode(3, 3, 4, 2, 1), "daif"},
+        {encode(3, 3, 4, 4, 0), "fpcr"},
+        {encode(3, 3, 4, 4, 1), "fpsr"},
+        {encode(3, 3, 13, 0, 2), "tpidr_el0"},
+        {encode(3, 3, 13, 0, 3), "tpidrro_el0"},
+        {encode(3, 3, 14, 0, 0), "cntfrq_el0"},
+        {encode(3, 3, 14, 0, 2), "cntvct_el0"},
+    }};
+    for (const Named &named : names) {
+        if (named.encoding == value) {
+            out += named.name;
+            return;
+        }
+    }
+    std::format_to(std::back_inserter(out), "s{}_{}_c{}_c{}_{}",
+                   bits(value, 14, 2), bits(value, 11, 3), bits(value, 7, 4),
+                   bits(value, 3, 4), bits(value, 0, 3));
+}
+
+constexpr std::array<std::string_view, 16> ConditionNames = {
+    "eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+    "hi", "ls", "ge", "lt", "gt", "le", "al", "nv"};
+
+constexpr std::array<std::string_view, 13> ExtendNames = {
+    "",     "lsl",  "lsr",  "asr",  "ror",  "uxtb", "uxth",
+    "uxtw", "uxtx", "sxtb", "sxth", "sxtw", "sxtx"};
+
+// ", lsl #3" after a shifted register, ", uxtw" or ", sxtw #2" after an
+// extended one.
+void writeExtend(std::string &out, Extend extend, uint8_t amount) {
+    if (extend == Extend::None) {
+        return;
+    }
+    out += ", ";
+    out += ExtendNames[(size_t)extend];
+    if (extend <= Extend::Ror || amount != 0) {
+        std::format_to(std::back_inserter(out), " #{}", amount);
+    }
+}
+
+void writeMemory(std::string &out, const Operand &operand) {
+    out += '[';
+    out += registerName(operand.base, 8);
+    if (operand.index != Register::None) {
+        bool word = operand.extend == Extend::Uxtw ||
+                    operand.extend == Extend::Sxtw;
+        out += ", ";
+        out += registerName(operand.index, word ? 4 : 8);
+        writeExtend(out, operand.extend, operand.amount);
+    }
+    if (operand.indexing == Indexing::PreIndex ||
+        (operand.indexing == Indexing::Offset && operand.value != 0)) {
+        std::format_to(std::back_inserter(out), ", #{}", operand.value);
+    }
+    out += ']';
+    if (operand.indexing == Indexing::PreIndex) {
+        out += '!';
+    } else if (operand.indexing == Indexing::PostIndex) {
+        std::format_to(std::back_inserter(out), ", #{}", operand.value);
+    }
+}
+
+} // namespace
+
+std::optional<uint64_t> Instruction::branchTarget() const noexcept {
+    if (!isControlFlow(mnemonic)) {
+        return std::nullopt;
+    }
+    for (const Operand &operand : getOperands()) {
+        if (operand.kind == OperandKind::Target) {
+            return (uint64_t)operand.value;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view mnemonicName(Mnemonic mnemonic) noexcept {
+    static constexpr std::array<std::string_view, (size_t)Mnemonic::Count>
+        names = {
+            "(unknown)", "adr",     "adrp",    "add",     "adds",
+            "sub",       "subs",    "cmp",     "cmn",     "neg",
+            "negs",      "adc",     "adcs",    "sbc",     "sbcs",
+            "and",       "ands",    "orr",     "eor",     "bic",
+            "bics",      "orn",     "eon",     "tst",     "mvn",
+            "mov",       "movz",    "movn",    "movk",    "sbfm",
+            "bfm",       "ubfm",    "asr",     "lsl",     "lsr",
+            "ror",       "sxtb",    "sxth",    "sxtw",    "uxtb",
+            "uxth",      "sbfx",    "ubfx",    "sbfiz",   "ubfiz",
+            "bfi",       "bfc",     "bfxil",   "extr",    "csel",    "csinc",
+            "csinv",     "csneg",   "cset",    "csetm",   "cinc",
+            "cinv",      "cneg",    "ccmp",    "ccmn",    "madd",
+            "msub",      "mul",     "mneg",    "smaddl",  "smsubl",
+            "smnegl",    "smull",   "umaddl",  "umsubl",  "umnegl",
+            "umull",     "smulh",
+            "umulh",     "udiv",    "sdiv",    "rbit",    "rev16",
+            "rev32",     "rev",     "clz",     "cls",     "b",
+            "bl",        "br",      "blr",     "ret",     "retaa",
+            "retab",     "cbz",     "cbnz",    "tbz",     "tbnz",
+            "svc",       "hvc",     "smc",     "brk",     "hlt",
+            "udf",       "nop",     "yield",   "wfe",     "wfi",
+            "sev",       "hint",    "paciaz",  "paciasp", "pacibsp",
+            "autiaz",    "autiasp", "autibsp", "bti",     "dsb",
+            "dmb",       "isb",     "mrs",     "msr",     "ldr",
+            "ldrb",      "ldrh",    "ldrsb",   "ldrsh",   "ldrsw",
+            "str",       "strb",    "strh",    "ldur",    "ldurb",
+            "ldurh",     "ldursb",  "ldursh",  "ldursw",  "stur",
+            "sturb",     "sturh",   "prfm",    "prfum",   "ldp",
+            "ldpsw",     "stp",     "ldnp",    "stnp",    "ldxr",
+            "ldaxr",     "stxr",    "stlxr",   "ldar",    "stlr",
+            "ldxrb",     "ldaxrb",  "stxrb",   "stlxrb",  "ldarb",
+            "stlrb",     "ldxrh",   "ldaxrh",  "stxrh",   "stlxrh",
+            "ldarh",     "stlrh",
+            "b.eq",      "b.ne",    "b.hs",    "b.lo",    "b.mi",
+            "b.pl",      "b.vs",    "b.vc",    "b.hi",    "b.ls",
+            "b.ge",      "b.lt",    "b.gt",    "b.le",    "b.al",
+            "b.nv",
+        };
+    return names[(size_t)mnemonic];
+}
+
+std::string_view registerName(Register reg, size_t size) noexcept {
+    // One row per width: W, X, then B, H, S, D and Q.
+    static const auto names = [] {
+        std::array<std::array<std::string, 33>, 7> rows;
+        for (size_t n = 0; n < 31; n++) {
+            rows[0][n] = std::format("w{}", n);
+            rows[1][n] = std::format("x{}", n);
+        }
+        rows[0][31] = "wsp";
+        rows[1][31] = "sp";
+        rows[0][32] = "wzr";
+        rows[1][32] = "xzr";
+        constexpr std::string_view prefixes = "bhsdq";
+        for (size_t row = 0; row < prefixes.size(); row++) {
+            for (size_t n = 0; n < 32; n++) {
+                rows[2 + row][n] = std::format("{}{}", prefixes[row], n);
+            }
+        }
+        return rows;
+    }();
+    auto number = (size_t)reg;
+    if (reg >= Register::V0 && reg != Register::None) {
+        number -= (size_t)Register::V0;
+        if (number >= 32 || size == 0 || size > 16 ||
+            !std::has_single_bit(size)) {
+            return {};
+        }
+        return names[2 + std::countr_zero(size)][number];
+    }
+    if (number > (size_t)Register::ZR) {
+        return {};
+    }
+    return names[size == 8 ? 1 : 0][number];
+}
+
+bool isControlFlow(Mnemonic mnemonic) noexcept {
+    switch (mnemonic) {
+    case Mnemonic::B:
+    case Mnemonic::Bl:
+    case Mnemonic::Br:
+    case Mnemonic::Blr:
+    case Mnemonic::Ret:
+    case Mnemonic::Retaa:
+    case Mnemonic::Retab:
+    case Mnemonic::Cbz:
+    case Mnemonic::Cbnz:
+    case Mnemonic::Tbz:
+    case Mnemonic::Tbnz:
+        return true;
+    default:
+        return mnemonic >= Mnemonic::Beq && mnemonic <= Mnemonic::Bnv;
+    }
+}
+
+Instruction decodeInstruction(uint32_t word, uint64_t address) noexcept {
+    Instruction ins;
+    ins.address = address;
+    ins.encoding = word;
+    for (const Encoding &encoding : Groups[bits(word, 25, 4)]) {
+        if ((word & encoding.mask) == encoding.value) {
+            ins.mnemonic = encoding.mnemonic;
+            if (!decodeForm(ins, word, encoding.form)) {
+                ins.mnemonic = Mnemonic::Unknown;
+                ins.operandCount = 0;
+            }
+            break;
+        }
+    }
+    return ins;
+}
+
+Instruction decodeInstruction(std::span<const uint8_t> code, size_t offset,
+                              uint64_t address) {
+    if (offset >= code.size()) {
+        throw std::out_of_range(std::format(
+            "Offset {} is past the {} bytes of code", offset, code.size()));
+    }
+    if (code.size() - offset < InstructionLength) {
+        Instruction ins;
+        ins.address = address + offset;
+        for (size_t i = offset; i < code.size(); i++) {
+            ins.encoding |= (uint32_t)code[i] << (8 * (i - offset));
+        }
+        return ins;
+    }
+    return decodeInstruction(readWord(code, offset), address + offset);
+}
+
+void decode(std::span<const uint8_t> code, uint64_t address,
+            std::vector<Instruction> &out) {
+    out.clear();
+    out.reserve(code.size() / InstructionLength);
+    for (size_t offset = 0; offset + InstructionLength <= code.size();
+         offset += InstructionLength) {
+        out.push_back(
+            decodeInstruction(readWord(code, offset), address + offset));
+    }
+}
+
+void formatInstruction(std::string &out, const Instruction &ins,
+                       const SymbolResolver &resolver) {
+    out += '\t';
+    if (ins.mnemonic == Mnemonic::Unknown) {
+        std::format_to(std::back_inserter(out), "Unimplemented: {:08x}\n",
+                       ins.encoding);
+        return;
+    }
+    out += mnemonicName(ins.mnemonic);
+    if (ins.mnemonic == Mnemonic::Bti) {
+        static constexpr std::array<std::string_view, 4> targets = {
+            "", " c", " j", " jc"};
+        out += targets[bits(ins.encoding, 6, 2)];
+    }
+    for (size_t i = 0; i < ins.operandCount; i++) {
+        const Operand &operand = ins.operands[i];
+        out += i == 0 ? " " : ", ";
+        switch (operand.kind) {
+        case OperandKind::Register:
+            out += registerName(operand.base, operand.size);
+            writeExtend(out, operand.extend, operand.amount);
+            break;
+        case OperandKind::Immediate:
+            std::format_to(std::back_inserter(out), "#0x{:x}",
+                           (uint64_t)operand.value);
+            writeExtend(out, operand.extend, operand.amount);
+            break;
+        case OperandKind::Number:
+            std::format_to(std::back_inserter(out), "#{}", operand.value);
+            break;
+        case OperandKind::Memory:
+            writeMemory(out, operand);
+            break;
+        case OperandKind::Target:
+            std::format_to(std::back_inserter(out), "0x{:x}",
+                           (uint64_t)operand.value);
+            break;
+        case OperandKind::Condition:
+            out += ConditionNames[operand.value & 15];
+            break;
+        case OperandKind::SystemRegister:
+            writeSystemRegister(out, operand.value);
+            break;
+        case OperandKind::Barrier: {
+            static constexpr std::array<std::string_view, 16> options = {
+                "",    "oshld", "oshst", "osh", "",    "nshld",
+                "nshst", "nsh", "",      "ishld", "ishst", "ish",
+                "",    "ld",    "st",    "sy"};
+            if (options[operand.value & 15].empty()) {
+                std::format_to(std::back_inserter(out), "#{}",
+                               operand.value);
+            } else {
+                out += options[operand.value & 15];
+            }
+            break;
+        }
+        case OperandKind::Prefetch: {
+            // Type, target cache level and policy, as in pldl1keep.
+            static constexpr std::array<std::string_view, 4> types = {
+                "pld", "pli", "pst", ""};
+            uint32_t operation = operand.value & 31;
+            if (types[operation >> 3].empty() ||
+                ((operation >> 1) & 3) == 3) {
+                std::format_to(std::back_inserter(out), "#{}", operation);
+            } else {
+                std::format_to(std::back_inserter(out), "{}l{}{}",
+                               types[operation >> 3],
+                               ((operation >> 1) & 3) + 1,
+                               (operation & 1) != 0 ? "strm" : "keep");
+            }
+            break;
+        }
+        case OperandKind::None:
+            break;
+        }
+    }
+    if (resolver) {
+        if (auto target = ins.branchTarget()) {
+            std::string_view name = resolver(target.value());
+            if (!name.empty()) {
+                out += " <";
+                out += name;
+                out += '>';
+            }
+        }
+    }
+    out += '\n';
+}
+
+} // namespace AArch64
+
+} // namespace disassemble
@@ -1,12 +1,12 @@
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <disassemble.hpp>
 #include <format>
-#include <functional>
-#include <iostream>
-#include <map>
-#include <set>
-#include <sstream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -14,142 +14,414 @@ namespace disassemble {
 
 namespace X86_64 {
 
-namespace old {
-
-enum class Register {
-    RAX = 0b000,
-    RCX = 0b001,
-    RDX = 0b010,
-    RBX = 0b011,
-    RSP = 0b100,
-    RBP = 0b101,
-    RSI = 0b110,
-    RDI = 0b111,
+enum class OperandModel : uint8_t {
+    None,
+    // ModRM.reg
+    RegSize,
+    Reg8,
+    // ModRM.rm
+    RmSize,
+    Rm8,
+    Rm16,
+    Rm32,
+    Rm64,
+    // Register encoded in the low three bits of the opcode
+    OpRegSize,
+    OpReg8,
+    OpReg64,
+    // Implicit operands
+    Acc8,
+    AccSize,
+    One,
+    Cl,
+    // Immediates, sign extended to the operand size
+    ImmSize,
+    Imm8,
+    Imm16,
+    ImmFull,
+    // Branch displacements
+    Rel8,
+    Rel32,
 };
 
-[[nodiscard]] inline bool isNegative(uint64_t value, size_t size) noexcept {
-    return (value >> (8 * size - 1)) != 0;
-}
+enum class RegSpec : uint8_t {
+    None,
+    R,
+    R0,
+    R1,
+    R2,
+    R3,
+    R4,
+    R5,
+    R6,
+    R7,
+};
 
-struct Constant {
-    uint64_t value;
-    size_t size;
+class InstructionModel {
+  public:
+    InstructionModel(std::initializer_list<uint8_t> opcode, RegSpec regSpec,
+                     Mnemonic mnemonic,
+                     OperandModel operand1 = OperandModel::None,
+                     OperandModel operand2 = OperandModel::None,
+                     OperandModel operand3 = OperandModel::None) {
+        opcode_ = opcode;
+        mnemonic_ = mnemonic;
+        regSpec_ = regSpec;
+        operands_ = {operand1, operand2, operand3};
+        operandCount_ = std::count_if(
+            operands_.begin(), operands_.end(),
+            [](OperandModel model) { return model != OperandModel::None; });
+    }
+
+    [[nodiscard]] const std::vector<uint8_t> &getFullOpcode() const noexcept {
+        return opcode_;
+    }
+
+    [[nodiscard]] bool requiresModRMByte() const noexcept {
+        return regSpec_ != RegSpec::None;
+    }
+
+    [[nodiscard]] RegSpec getRegSpec() const noexcept { return regSpec_; }
+
+    [[nodiscard]] Mnemonic getMnemonic() const noexcept { return mnemonic_; }
+
+    [[nodiscard]] std::span<const OperandModel> getOperands() const noexcept {
+        return std::span(operands_).first(operandCount_);
+    }
+
+  private:
+    std::vector<uint8_t> opcode_;
+    Mnemonic mnemonic_;
+    RegSpec regSpec_;
+    std::array<OperandModel, 3> operands_;
+    size_t operandCount_;
 };
 
-[[nodiscard]] inline bool isNegative(Constant constant) noexcept {
-    return isNegative(constant.value, constant.size);
-}
+constexpr uint16_t NoModel = 0xffff;
 
-void writeRegister(std::ostream &out, Register reg, size_t regSize,
-                   bool extended = false) {
-    if (extended) {
-        out << 'r' << 8 + (int)reg;
-        return;
+// Models for one opcode of one opcode map. Opcodes extended by ModRM.reg
+// (`/digit` in the manuals) have one model per digit.
+struct OpcodeSlot {
+    uint16_t model = NoModel;
+    std::array<uint16_t, 8> byDigit;
+    // Worked out once the table is complete, so decoding reads them instead
+    // of scanning byDigit.
+    bool digitModels = false;
+    bool modRM = false;
+
+    OpcodeSlot() { byDigit.fill(NoModel); }
+};
+
+[[nodiscard]] bool hasModRM(uint8_t map, uint8_t opcode) noexcept;
+
+class InstructionSet {
+  public:
+    static InstructionSet &instance() {
+        static InstructionSet instance;
+        return instance;
     }
-    if (regSize == 1) {
-        // Special case
-        switch (reg) {
-        case Register::RAX:
-            out << "al";
-            break;
-        case Register::RCX:
-            out << "cl";
-            break;
-        case Register::RDX:
-            out << "dl";
-            break;
-        case Register::RBX:
-            out << "bl";
-            break;
-        case Register::RSP:
-            out << "sp";
-            break;
-        case Register::RBP:
-            out << "bp";
-            break;
-        case Register::RSI:
-            out << "si";
-            break;
-        case Register::RDI:
-            out << "di";
-            break;
+
+    [[nodiscard]] const OpcodeSlot &lookup(uint8_t map,
+                                           uint8_t opcode) const noexcept {
+        return tables_[map][opcode];
+    }
+
+    const InstructionModel &operator[](size_t id) const {
+        return instructions_[id];
+    }
+
+  private:
+    InstructionSet() {
+        using enum OperandModel;
+        using M = Mnemonic;
+
+        // add/or/adc/sbb/and/sub/xor/cmp share their encodings.
+        constexpr std::array alu = {M::Add, M::Or,  M::Adc, M::Sbb,
+                                    M::And, M::Sub, M::Xor, M::Cmp};
+        for (uint8_t op = 0; op < 8; op++) {
+            uint8_t base = op * 8;
+            add({base}, RegSpec::R, alu[op], Rm8, Reg8);
+            add({uint8_t(base + 1)}, RegSpec::R, alu[op], RmSize, RegSize);
+            add({uint8_t(base + 2)}, RegSpec::R, alu[op], Reg8, Rm8);
+            add({uint8_t(base + 3)}, RegSpec::R, alu[op], RegSize, RmSize);
+            add({uint8_t(base + 4)}, RegSpec::None, alu[op], Acc8, Imm8);
+            add({uint8_t(base + 5)}, RegSpec::None, alu[op], AccSize, ImmSize);
+            add({0x80}, digit(op), alu[op], Rm8, Imm8);
+            add({0x81}, digit(op), alu[op], RmSize, ImmSize);
+            add({0x83}, digit(op), alu[op], RmSize, Imm8);
+        }
+
+        constexpr std::array shifts = {M::Rol, M::Ror, M::Rcl, M::Rcr,
+                                       M::Shl, M::Shr, M::Shl, M::Sar};
+        for (uint8_t op = 0; op < 8; op++) {
+            add({0xc0}, digit(op), shifts[op], Rm8, Imm8);
+            add({0xc1}, digit(op), shifts[op], RmSize, Imm8);
+            add({0xd0}, digit(op), shifts[op], Rm8, One);
+            add({0xd1}, digit(op), shifts[op], RmSize, One);
+            add({0xd2}, digit(op), shifts[op], Rm8, Cl);
+            add({0xd3}, digit(op), shifts[op], RmSize, Cl);
+        }
+
+        for (uint8_t cc = 0; cc < 16; cc++) {
+            add({uint8_t(0x70 + cc)}, RegSpec::None, condition(M::Jo, cc),
+                Rel8);
+            add({0x0f, uint8_t(0x80 + cc)}, RegSpec::None,
+                condition(M::Jo, cc), Rel32);
+            add({0x0f, uint8_t(0x90 + cc)}, RegSpec::R,
+                condition(M::Seto, cc), Rm8);
+            add({0x0f, uint8_t(0x40 + cc)}, RegSpec::R,
+                condition(M::Cmovo, cc), RegSize, RmSize);
+        }
+
+        for (uint8_t reg = 0; reg < 8; reg++) {
+            add({uint8_t(0x50 + reg)}, RegSpec::None, M::Push, OpReg64);
+            add({uint8_t(0x58 + reg)}, RegSpec::None, M::Pop, OpReg64);
+            add({uint8_t(0xb0 + reg)}, RegSpec::None, M::Mov, OpReg8, Imm8);
+            add({uint8_t(0xb8 + reg)}, RegSpec::None, M::Mov, OpRegSize,
+                ImmFull);
+            if (reg != 0) {
+                add({uint8_t(0x90 + reg)}, RegSpec::None, M::Xchg, OpRegSize,
+                    AccSize);
+            }
+        }
+
+        add({0x63}, RegSpec::R, M::Movsxd, RegSize, Rm32);
+        add({0x68}, RegSpec::None, M::Push, ImmSize);
+        add({0x69}, RegSpec::R, M::Imul, RegSize, RmSize, ImmSize);
+        add({0x6a}, RegSpec::None, M::Push, Imm8);
+        add({0x6b}, RegSpec::R, M::Imul, RegSize, RmSize, Imm8);
+        add({0x84}, RegSpec::R, M::Test, Rm8, Reg8);
+        add({0x85}, RegSpec::R, M::Test, RmSize, RegSize);
+        add({0x86}, RegSpec::R, M::Xchg, Rm8, Reg8);
+        add({0x87}, RegSpec::R, M::Xchg, RmSize, RegSize);
+        add({0x88}, RegSpec::R, M::Mov, Rm8, Reg8);
+        add({0x89}, RegSpec::R, M::Mov, RmSize, RegSize);
+        add({0x8a}, RegSpec::R, M::Mov, Reg8, Rm8);
+        add({0x8b}, RegSpec::R, M::Mov, RegSize, RmSize);
+        add({0x8d}, RegSpec::R, M::Lea, RegSize, RmSize);
+        add({0x8f}, RegSpec::R0, M::Pop, Rm64);
+        add({0x90}, RegSpec::None, M::Nop);
+        add({0x98}, RegSpec::None, M::Cwde);
+        add({0x99}, RegSpec::None, M::Cdq);
+        add({0xa8}, RegSpec::None, M::Test, Acc8, Imm8);
+        add({0xa9}, RegSpec::None, M::Test, AccSize, ImmSize);
+        add({0xc2}, RegSpec::None, M::Ret, Imm16);
+        add({0xc3}, RegSpec::None, M::Ret);
+        add({0xc6}, RegSpec::R0, M::Mov, Rm8, Imm8);
+        add({0xc7}, RegSpec::R0, M::Mov, RmSize, ImmSize);
+        add({0xc9}, RegSpec::None, M::Leave);
+        add({0xcc}, RegSpec::None, M::Int3);
+        add({0xe8}, RegSpec::None, M::Call, Rel32);
+        add({0xe9}, RegSpec::None, M::Jmp, Rel32);
+        add({0xeb}, RegSpec::None, M::Jmp, Rel8);
+        add({0xf4}, RegSpec::None, M::Hlt);
+        add({0xf6}, RegSpec::R0, M::Test, Rm8, Imm8);
+        add({0xf6}, RegSpec::R2, M::Not, Rm8);
+        add({0xf6}, RegSpec::R3, M::Neg, Rm8);
+        add({0xf6}, RegSpec::R4, M::Mul, Rm8);
+        add({0xf6}, RegSpec::R5, M::Imul, Rm8);
+        add({0xf6}, RegSpec::R6, M::Div, Rm8);
+        add({0xf6}, RegSpec::R7, M::Idiv, Rm8);
+        add({0xf7}, RegSpec::R0, M::Test, RmSize, ImmSize);
+        add({0xf7}, RegSpec::R2, M::Not, RmSize);
+        add({0xf7}, RegSpec::R3, M::Neg, RmSize);
+        add({0xf7}, RegSpec::R4, M::Mul, RmSize);
+        add({0xf7}, RegSpec::R5, M::Imul, RmSize);
+        add({0xf7}, RegSpec::R6, M::Div, RmSize);
+        add({0xf7}, RegSpec::R7, M::Idiv, RmSize);
+        add({0xfe}, RegSpec::R0, M::Inc, Rm8);
+        add({0xfe}, RegSpec::R1, M::Dec, Rm8);
+        add({0xff}, RegSpec::R0, M::Inc, RmSize);
+        add({0xff}, RegSpec::R1, M::Dec, RmSize);
+        add({0xff}, RegSpec::R2, M::Call, Rm64);
+        add({0xff}, RegSpec::R4, M::Jmp, Rm64);
+        add({0xff}, RegSpec::R6, M::Push, Rm64);
+
+        add({0x0f, 0x05}, RegSpec::None, M::Syscall);
+        add({0x0f, 0x0b}, RegSpec::None, M::Ud2);
+        add({0x0f, 0x1e}, RegSpec::R, M::Nop, RmSize);
+        add({0x0f, 0x1f}, RegSpec::R0, M::Nop, RmSize);
+        add({0x0f, 0xaf}, RegSpec::R, M::Imul, RegSize, RmSize);
+        add({0x0f, 0xb6}, RegSpec::R, M::Movzx, RegSize, Rm8);
+        add({0x0f, 0xb7}, RegSpec::R, M::Movzx, RegSize, Rm16);
+        add({0x0f, 0xbe}, RegSpec::R, M::Movsx, RegSize, Rm8);
+        add({0x0f, 0xbf}, RegSpec::R, M::Movsx, RegSize, Rm16);
+
+        for (size_t id = 0; id < instructions_.size(); id++) {
+            const InstructionModel &model = instructions_[id];
+            const auto &opcode = model.getFullOpcode();
+            uint8_t map = 0;
+            if (opcode.size() == 2) {
+                map = 1;
+            } else if (opcode.size() == 3) {
+                map = opcode[1] == 0x38 ? 2 : 3;
+            }
+            OpcodeSlot &slot = tables_[map][opcode.back()];
+            RegSpec spec = model.getRegSpec();
+            if (spec == RegSpec::None || spec == RegSpec::R) {
+                slot.model = id;
+            } else {
+                slot.byDigit[(size_t)spec - (size_t)RegSpec::R0] = id;
+                slot.digitModels = true;
+            }
+        }
+        for (size_t map = 0; map < tables_.size(); map++) {
+            for (size_t opcode = 0; opcode < 256; opcode++) {
+                OpcodeSlot &slot = tables_[map][opcode];
+                slot.modRM =
+                    slot.digitModels ||
+                    (slot.model != NoModel
+                         ? instructions_[slot.model].requiresModRMByte()
+                         : hasModRM(map, opcode));
+            }
         }
-        return;
     }
-    if (regSize == 2) {
-        // Do nothing
-    } else if (regSize == 4) {
-        out << 'e';
-    } else if (regSize == 8) {
-        out << 'r';
-    } else {
-        throw std::runtime_error("Invalid register size");
+
+    void add(std::initializer_list<uint8_t> opcode, RegSpec regSpec,
+             Mnemonic mnemonic, OperandModel operand1 = OperandModel::None,
+             OperandModel operand2 = OperandModel::None,
+             OperandModel operand3 = OperandModel::None) {
+        instructions_.emplace_back(opcode, regSpec, mnemonic, operand1,
+                                   operand2, operand3);
     }
-    switch (reg) {
-    case Register::RAX:
-        out << "ax";
-        break;
-    case Register::RCX:
-        out << "cx";
-        break;
-    case Register::RDX:
-        out << "dx";
-        break;
-    case Register::RBX:
-        out << "bx";
-        break;
-    case Register::RSP:
-        out << "sp";
-        break;
-    case Register::RBP:
-        out << "bp";
-        break;
-    case Register::RSI:
-        out << "si";
-        break;
-    case Register::RDI:
-        out << "di";
-        break;
+
+    [[nodiscard]] static RegSpec digit(uint8_t value) noexcept {
+        return RegSpec((size_t)RegSpec::R0 + value);
+    }
+
+    [[nodiscard]] static Mnemonic condition(Mnemonic first,
+                                            uint8_t cc) noexcept {
+        return Mnemonic((uint16_t)first + cc);
+    }
+
+    std::vector<InstructionModel> instructions_;
+    std::array<std::array<OpcodeSlot, 256>, 4> tables_;
+};
+
+// Layout of opcodes without a model, so that unimplemented instructions
+// still consume the right number of bytes.
+[[nodiscard]] bool hasModRM(uint8_t map, uint8_t opcode) noexcept {
+    switch (map) {
+    case 0:
+        if (opcode < 0x40) {
+            return (opcode & 0x7) < 4;
+        }
+        return opcode == 0x62 || opcode == 0x63 || opcode == 0x69 ||
+               opcode == 0x6b || (opcode >= 0x80 && opcode <= 0x8f) ||
+               opcode == 0xc0 || opcode == 0xc1 || opcode == 0xc6 ||
+               opcode == 0xc7 || (opcode >= 0xd0 && opcode <= 0xd3) ||
+               (opcode >= 0xd8 && opcode <= 0xdf) || opcode == 0xf6 ||
+               opcode == 0xf7 || opcode == 0xfe || opcode == 0xff;
+    case 1:
+        return !((opcode >= 0x05 && opcode <= 0x09) || opcode == 0x0b ||
+                 opcode == 0x0e || (opcode >= 0x30 && opcode <= 0x37) ||
+                 opcode == 0x77 || (opcode >= 0x80 && opcode <= 0x8f) ||
+                 (opcode >= 0xa0 && opcode <= 0xa2) ||
+                 (opcode >= 0xa8 && opcode <= 0xaa) ||
+                 (opcode >= 0xc8 && opcode <= 0xcf));
+    default:
+        return true;
     }
 }
 
-struct Prefix {
-    enum class SegmentOverride {
-        CS,
-        SS,
-        DS,
-        ES,
-        FS,
-        GS,
-        None,
-    };
-    SegmentOverride segOverride;
-    Prefix() { segOverride = SegmentOverride::None; }
-    void setSegmentOverride(uint8_t value) {
-        if (value == 0x2e) {
-            segOverride = SegmentOverride::CS;
-        } else if (value == 0x36) {
-            segOverride = SegmentOverride::SS;
-        } else if (value == 0x3e) {
-            segOverride = SegmentOverride::DS;
-        } else if (value == 0x26) {
-            segOverride = SegmentOverride::ES;
-        } else if (value == 0x64) {
-            segOverride = SegmentOverride::FS;
-        } else if (value == 0x65) {
-            segOverride = SegmentOverride::GS;
-        } else {
-            segOverride = SegmentOverride::None;
+[[nodiscard]] size_t immediateSize(uint8_t map, uint8_t opcode,
+                                   uint8_t modRMReg, size_t operandSize,
+                                   bool addressSizePrefix) noexcept {
+    size_t z = operandSize == 2 ? 2 : 4;
+    switch (map) {
+    case 0:
+        if (opcode < 0x40) {
+            return (opcode & 0x7) == 4 ? 1 : (opcode & 0x7) == 5 ? z : 0;
+        }
+        if ((opcode >= 0x70 && opcode <= 0x7f) ||
+            (opcode >= 0xb0 && opcode <= 0xb7) ||
+            (opcode >= 0xe0 && opcode <= 0xe7)) {
+            return 1;
+        }
+        if (opcode >= 0xb8 && opcode <= 0xbf) {
+            return operandSize == 8 ? 8 : z;
         }
+        if (opcode >= 0xa0 && opcode <= 0xa3) {
+            return addressSizePrefix ? 4 : 8;
+        }
+        switch (opcode) {
+        case 0x6a:
+        case 0x6b:
+        case 0x80:
+        case 0x83:
+        case 0xa8:
+        case 0xc0:
+        case 0xc1:
+        case 0xc6:
+        case 0xcd:
+        case 0xeb:
+            return 1;
+        case 0xc2:
+        case 0xca:
+            return 2;
+        case 0xc8:
+            return 3;
+        case 0x68:
+        case 0x69:
+        case 0x81:
+        case 0xa9:
+        case 0xc7:
+            return z;
+        case 0xe8:
+        case 0xe9:
+            return 4;
+        case 0xf6:
+            return modRMReg < 2 ? 1 : 0;
+        case 0xf7:
+            return modRMReg < 2 ? z : 0;
+        }
+        return 0;
+    case 1:
+        if (opcode >= 0x80 && opcode <= 0x8f) {
+            return 4;
+        }
+        return ((opcode >= 0x70 && opcode <= 0x73) || opcode == 0xa4 ||
+                opcode == 0xac || opcode == 0xba || opcode == 0xc2 ||
+                (opcode >= 0xc4 && opcode <= 0xc6))
+                   ? 1
+                   : 0;
+    case 3:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Whether a VEX/EVEX encoded opcode is followed by an imm8.
+[[nodiscard]] bool vexHasImmediate(uint8_t map, uint8_t opcode) noexcept {
+    if (map == 3) {
+        return true;
     }
+    return map == 1 && ((opcode >= 0x70 && opcode <= 0x73) || opcode == 0xc2 ||
+                        (opcode >= 0xc4 && opcode <= 0xc6));
+}
+
+struct Constant {
+    uint64_t value;
+    size_t size;
 };
 
+[[nodiscard]] int64_t signExtend(Constant constant) noexcept {
+    if (constant.size >= 8) {
+        return (int64_t)constant.value;
+    }
+    size_t shift = 64 - 8 * constant.size;
+    return (int64_t)(constant.value << shift) >> shift;
+}
+
 struct RexPrefix {
-    bool present;
-    unsigned int w : 1;
-    unsigned int r : 1;
-    unsigned int x : 1;
-    unsigned int b : 1;
+    bool present = false;
+    unsigned int w : 1 = 0;
+    unsigned int r : 1 = 0;
+    unsigned int x : 1 = 0;
+    unsigned int b : 1 = 0;
+
+    RexPrefix() = default;
 
     RexPrefix(uint8_t byte) {
         w = (byte >> 3) & 1;
@@ -158,577 +430,393 @@ struct RexPrefix {
         b = byte & 1;
         present = true;
     }
-
-    RexPrefix() { present = false; }
 };
 
 struct ModRM {
-    bool present;
     unsigned int mod : 2;
     unsigned int reg : 3;
     unsigned int rm : 3;
 
-    ModRM() { present = false; }
-
     ModRM(uint8_t byte) {
         mod = byte >> 6;
         reg = (byte >> 3) & 0b111;
         rm = byte & 0b111;
-        present = true;
     }
 };
 
 struct SIB {
-    bool present;
     unsigned int scale : 2;
     unsigned int index : 3;
     unsigned int base : 3;
-    SIB() { present = false; }
+
     SIB(uint8_t value) {
         scale = value >> 6;
         index = (value >> 3) & 0b111;
         base = value & 0b111;
-        present = true;
     }
 };
 
-struct Instruction {
-    Prefix prefix;
-    RexPrefix rexPrefix;
-    uint16_t opcode;
-    ModRM modRM;
-    SIB sib;
-    Constant addressOffset;
-    Constant immediate;
-};
+class InstructionDecoder {
+  public:
+    InstructionDecoder(const std::span<const uint8_t> data,
+                       ReadingMode readingMode, uint64_t address)
+        : data_(data), readingMode_(readingMode), address_(address),
+          offset_(0) {}
 
-enum class OperandType {
-    I,
-    MI,
-    RM,
-    MR,
-    O,
-};
+    [[nodiscard]] bool done() const noexcept { return offset_ >= data_.size(); }
 
-OperandType getOperandType(const Instruction &ins) {
-    switch (ins.opcode) {
-    case 0x31:
-        return OperandType::MR;
-    case 0x50:
-    case 0x51:
-    case 0x52:
-    case 0x53:
-    case 0x54:
-    case 0x55:
-    case 0x56:
-    case 0x57:
-    case 0x58:
-    case 0x59:
-    case 0x5a:
-    case 0x5b:
-    case 0x5c:
-    case 0x5d:
-    case 0x5e:
-    case 0x5f:
-        return OperandType::O;
-    case 0x81:
-        if (ins.modRM.reg == 5) {
-            return OperandType::MI;
-        } else if (ins.modRM.reg == 0) {
-            return OperandType::MI;
-        } else if (ins.modRM.reg == 7) {
-            return OperandType::MI;
-        }
-        break;
-    case 0x83:
-        if (ins.modRM.reg == 7) {
-            return OperandType::MI;
-        }
-        break;
-    case 0x89:
-        return OperandType::MR;
-    case 0x8b:
-        return OperandType::RM;
-    }
-    throw std::runtime_error("Unimplemented case");
-}
+    void seek(size_t offset) noexcept { offset_ = offset; }
 
-Constant readConstant(const std::span<const uint8_t> code, size_t &offset,
-                      ReadingMode mode, size_t size) {
-    uint64_t value = 0;
-    switch (mode) {
-    case ReadingMode::LSB:
-        for (size_t i = 0; i < size; i++) {
-            value |= ((uint64_t)code[offset]) << (8 * i);
-            offset++;
+    // Bytes are read without bounds checks while at least MaxDecodeBytes
+    // remain. The last few instructions are decoded from a zero-padded copy
+    // instead, and one running past the end is cut short as unknown.
+    [[nodiscard]] Instruction next() {
+        if (data_.size() - offset_ >= MaxDecodeBytes) {
+            return read();
         }
-        break;
-    case ReadingMode::MSB:
-        for (size_t i = 0; i < size; i++) {
-            value <<= 8;
-            value |= ((uint64_t)code[offset]);
-            offset++;
-        }
-        break;
+        return readTail();
     }
-    return Constant{.value = value, .size = size};
-}
 
-bool requiresOperandByte(uint8_t opcode) {
-    static const std::set<uint8_t> list = {
-        0x29, 0x31, 0x32, 0x33, 0x38, 0x81, 0x83, 0x89, 0x8b,
-    };
-    return list.count(opcode);
-}
+  private:
+    // The most a single read() looks at: a full run of prefixes followed by
+    // the longest opcode, ModRM, SIB, displacement and immediate (27 bytes),
+    // and a constant read as a whole word.
+    static constexpr size_t MaxDecodeBytes = 40;
 
-void writeConstantHex(std::ostream &out, Constant constant,
-                      bool writeSign = true) {
-    if (isNegative(constant)) {
-        int64_t val = constant.value | ~((1ull << (8 * constant.size)) - 1);
-        if (writeSign) {
-            out << std::format("-0x{:x}", -val);
-        } else {
-            out << std::format("0x{:x}", -val);
+    [[gnu::noinline]] Instruction readTail() {
+        size_t left = data_.size() - offset_;
+        std::array<uint8_t, 2 * MaxDecodeBytes> padded{};
+        std::copy_n(data_.begin() + offset_, left, padded.begin());
+        InstructionDecoder tail(padded, readingMode_, address_ + offset_);
+        Instruction ins = tail.read();
+        if (ins.length > left) {
+            Instruction truncated;
+            truncated.address = ins.address;
+            truncated.length = left;
+            truncated.opcodeMap = ins.opcodeMap;
+            truncated.opcode = ins.opcode;
+            truncated.prefixes = ins.prefixes;
+            ins = truncated;
         }
-    } else {
-        out << std::format("0x{:x}", constant.value);
+        offset_ += ins.length;
+        return ins;
     }
-}
 
-void writeOperandRM(std::ostream &out, const Instruction &ins,
-                    size_t operandSize) {
-    if (ins.prefix.segOverride != Prefix::SegmentOverride::None) {
-        // Segment override present
-        // TODO: Implement segment overrides
-        out << "TODO(segment override)";
-        return;
-    }
-    if (ins.modRM.mod == 0) {
-        out << '[';
-        if (ins.modRM.rm == 5) {
-            out << "rip ";
-            if (isNegative(ins.addressOffset)) {
-                out << "- ";
+    [[nodiscard]] Instruction read() {
+        Instruction ins;
+        size_t start = offset_;
+        ins.address = address_ + start;
+
+        RexPrefix rex;
+        // Instructions are at most MaxInstructionLength bytes, which bounds
+        // the prefixes and so how far a read can go.
+        while (offset_ - start < MaxInstructionLength - 1) {
+            uint8_t byte = currentByte();
+            if (isPrefixByte(byte)) {
+                applyPrefix(ins, byte);
+                // A REX prefix only counts right before the opcode.
+                rex = RexPrefix();
+                ins.prefixes &= ~Prefix::Rex;
+            } else if (isRexPrefixByte(byte)) {
+                rex = byte;
+                ins.prefixes |= Prefix::Rex;
             } else {
-                out << "+ ";
+                break;
             }
-            writeConstantHex(out, ins.addressOffset, false);
-        } else if (ins.modRM.rm == 4) {
-            out << "sib";
-        } else {
-            writeRegister(out, (Register)ins.modRM.rm, operandSize,
-                          ins.rexPrefix.present && ins.rexPrefix.b == 1);
+            advance();
         }
-        out << ']';
-        return;
-    } else if (ins.modRM.mod == 1 || ins.modRM.mod == 2) {
-        out << '[';
-        if (ins.modRM.rm == 4) {
-            out << "sib ";
-        } else {
-            writeRegister(out, (Register)ins.modRM.rm, operandSize,
-                          ins.rexPrefix.present && ins.rexPrefix.b == 1);
-            out << " ";
+
+        size_t operandSize = 4;
+        if (ins.prefixes & Prefix::OperandSize) {
+            operandSize = 2;
         }
-        if (ins.modRM.mod == 1) {
-            if (isNegative(ins.addressOffset)) {
-                out << "- ";
-            } else {
-                out << "+ ";
-            }
-            writeConstantHex(out, ins.addressOffset, false);
-        } else {
-            if (isNegative(ins.addressOffset)) {
-                out << "- ";
-            } else {
-                out << "+ ";
-            }
-            writeConstantHex(out, ins.addressOffset, false);
+        if (rex.w) {
+            operandSize = 8;
         }
-        out << ']';
-        return;
-    } else if (ins.modRM.mod == 3) {
-        writeRegister(out, (Register)ins.modRM.rm, operandSize,
-                      ins.rexPrefix.present && ins.rexPrefix.b == 1);
-        return;
-    }
-    const bool unreachable = false;
-    assert(unreachable);
-}
 
-void readIns(std::ostream &out, const std::span<const uint8_t> code,
-             size_t &offset, ReadingMode readingMode) {
-    size_t sizeMode = 4;
-    Instruction ins;
-    uint8_t byte = code[offset];
-    if (byte == 0x64 || byte == 0x65 || byte == 0x26 || byte == 0x3E ||
-        byte == 0x36 || byte == 0x2E) {
-        ins.prefix.setSegmentOverride(byte);
-        offset++;
-        byte = code[offset];
-    }
-    if (byte == 0x66) {
-        sizeMode = 2;
-        offset++;
-        byte = code[offset];
-    }
-    if ((byte & 0xf0) == 0x40) {
-        // REX prefix
-        ins.rexPrefix = byte;
-        if (ins.rexPrefix.w) {
-            sizeMode = 8;
-        }
-        offset++;
-        byte = code[offset];
-    }
-    // At this point, 'byte' should hold the opcode
-    ins.opcode = byte;
-    offset++;
-    if (requiresOperandByte(ins.opcode)) {
-        ins.modRM = code[offset];
-        offset++;
-    }
-    OperandType opType;
-    try {
-        opType = getOperandType(ins);
-    } catch (...) {
-        out << "\tUnimplemented: " << std::format("{:02x}", ins.opcode)
-            << std::endl;
-        return;
-    }
-    switch (opType) {
-    case OperandType::RM:
-    case OperandType::MR:
-    case OperandType::MI:
-        if (!ins.modRM.present) {
-            ins.modRM = code[offset];
-            offset++;
-        }
-        if (ins.modRM.rm == 4 && ins.modRM.mod != 3) {
-            ins.sib = code[offset];
-            offset++;
-            if (ins.sib.base == 5) {
-                if (ins.modRM.mod == 1) {
-                    ins.addressOffset =
-                        readConstant(code, offset, readingMode, 1);
-                } else {
-                    ins.addressOffset =
-                        readConstant(code, offset, readingMode, 4);
-                }
-                break;
-            }
-        }
-        if (ins.modRM.mod == 0) {
-            if (ins.modRM.rm == 5) {
-                ins.addressOffset = readConstant(code, offset, readingMode, 4);
-            }
-        } else if (ins.modRM.mod == 1) {
-            ins.addressOffset = readConstant(code, offset, readingMode, 1);
-        } else if (ins.modRM.mod == 2) {
-            ins.addressOffset = readConstant(code, offset, readingMode, 4);
+        uint8_t byte = getByte();
+        if (byte == 0xc4 || byte == 0xc5 || byte == 0x62) {
+            skipVex(ins, byte);
+            ins.length = offset_ - start;
+            return ins;
         }
-        break;
-    case OperandType::I:
-        break;
-    case OperandType::O:
-        break;
-    }
-    switch (ins.opcode) {
-    case 0x31:
-        out << "\txor ";
-        writeOperandRM(out, ins, sizeMode);
-        out << ", ";
-        writeRegister(out, (Register)ins.modRM.reg, sizeMode,
-                      ins.rexPrefix.present && ins.rexPrefix.b == 1);
-        out << std::endl;
-        return;
-    case 0x50:
-    case 0x51:
-    case 0x52:
-    case 0x53:
-    case 0x54:
-    case 0x55:
-    case 0x56:
-    case 0x57:
-        // push
-        sizeMode = 8;
-        out << "\tpush ";
-        writeRegister(out, (Register)(ins.opcode & 0xf), sizeMode,
-                      ins.rexPrefix.present && ins.rexPrefix.b == 1);
-        out << std::endl;
-        return;
-    case 0x81:
-        if (!ins.rexPrefix.present || !ins.rexPrefix.w) {
-            ins.immediate = readConstant(code, offset, readingMode, sizeMode);
-            if (ins.modRM.reg == 0) {
-                // Add
-                out << "\tadd ";
-                writeOperandRM(out, ins, sizeMode);
-                out << ", ";
-                writeConstantHex(out, ins.immediate);
-                out << std::endl;
-            } else if (ins.modRM.reg == 5) {
-                out << "\tsub ";
-                writeOperandRM(out, ins, sizeMode);
-                out << ", ";
-                writeConstantHex(out, ins.immediate);
-                out << std::endl;
+        if (byte == 0x0f) {
+            byte = getByte();
+            ins.opcodeMap = 1;
+            if (byte == 0x38 || byte == 0x3a) {
+                ins.opcodeMap = byte == 0x38 ? 2 : 3;
+                byte = getByte();
             }
-            return;
         }
-        if (ins.modRM.reg == 0) {
-            // ADD
-            ins.immediate = readConstant(code, offset, readingMode, 4);
-            out << "\tadd ";
-            writeOperandRM(out, ins, 8);
-            out << ", ";
-            writeConstantHex(out, ins.immediate);
-            out << std::endl;
-        } else if (ins.modRM.reg == 5) {
-            // SUB
-            ins.immediate = readConstant(code, offset, readingMode, 4);
-            out << "\tsub ";
-            writeOperandRM(out, ins, 8);
-            out << ", ";
-            writeConstantHex(out, ins.immediate);
-            out << std::endl;
-        }
-        return;
-    case 0x83:
-        if (ins.modRM.reg == 7) {
-            out << "\tcmp ";
-            writeOperandRM(out, ins, sizeMode);
-            out << ", ";
-            writeConstantHex(out, ins.immediate);
-            out << std::endl;
-            return;
-        }
-        break;
-    case 0x89:
-        out << "\tmov ";
-        writeOperandRM(out, ins, sizeMode);
-        out << ", ";
-        writeRegister(out, (Register)ins.modRM.reg, sizeMode);
-        out << std::endl;
-        return;
-    case 0x8b:
-        out << "\tmov ";
-        writeRegister(out, (Register)ins.modRM.reg, sizeMode);
-        out << ", ";
-        writeOperandRM(out, ins, sizeMode);
-        out << std::endl;
-        return;
-    }
-    out << "\tUnimplemented: " << std::format("{:02x}", ins.opcode)
-        << std::endl;
-}
+        ins.opcode = byte;
 
-}; // namespace old
-
-enum class Register {
-    RAX = 0b000,
-    RCX = 0b001,
-    RDX = 0b010,
-    RBX = 0b011,
-    RSP = 0b100,
-    RBP = 0b101,
-    RSI = 0b110,
-    RDI = 0b111,
-};
+        const InstructionSet &set = InstructionSet::instance();
+        const OpcodeSlot &slot = set.lookup(ins.opcodeMap, ins.opcode);
 
-enum class OperandModel {
-    None,
-    RegSize,
-    Reg32,
-    Reg64,
-    RmSize,
-    Rm32,
-    Rm64,
-    ImmSize,
-    Imm8,
-    Imm32,
-};
+        std::optional<ModRM> modRM;
+        Operand rm;
+        if (slot.modRM) {
+            modRM = getByte();
+            rm = readRm(*modRM, rex);
+        }
 
-enum class RegSpec {
-    None,
-    R,
-    R0 = 0,
-    R1 = 1,
-    R2 = 2,
-    R3 = 3,
-    R4 = 4,
-    R5 = 5,
-    R6 = 6,
-    R7 = 7,
-};
+        uint16_t modelId = slot.model;
+        if (slot.digitModels) {
+            modelId = slot.byDigit[modRM->reg];
+        }
+        if (modelId == NoModel) {
+            size_t size = immediateSize(
+                ins.opcodeMap, ins.opcode, modRM ? modRM->reg : 0, operandSize,
+                ins.prefixes & Prefix::AddressSize);
+            offset_ += size;
+            ins.length = offset_ - start;
+            return ins;
+        }
 
-class InstructionModel {
-  public:
-    InstructionModel(std::initializer_list<uint8_t> opcode, RegSpec regSpec,
-                     std::string_view mnemonic, OperandModel operand1,
-                     OperandModel operand2) {
-        opcode_ = opcode;
-        mnemonic_ = mnemonic;
-        if ((opcode_[0] & 0xf0) == 0x40) {
-            if ((opcode_[0] & 0x8) != 0) {
-                rexPrefixConfig_ = RexPrefixConfig::RexW;
-            } else {
-                rexPrefixConfig_ = RexPrefixConfig::Rex;
+        const InstructionModel &model = set[modelId];
+        ins.mnemonic = model.getMnemonic();
+        for (OperandModel operandModel : model.getOperands()) {
+            ins.operands[ins.operandCount++] =
+                readOperand(operandModel, ins, modRM, rm, rex, operandSize);
+        }
+        ins.length = offset_ - start;
+        for (Operand &operand : ins.operands) {
+            if (operand.kind == OperandKind::Target) {
+                operand.value += ins.address + ins.length;
             }
-        } else {
-            rexPrefixConfig_ = RexPrefixConfig::None;
         }
-        op1_ = operand1;
-        op2_ = operand2;
-        regSpec_ = regSpec;
+        adjustMnemonic(ins, modRM, operandSize);
+        return ins;
     }
-	
-	[[nodiscard]] const std::vector<uint8_t> &getFullOpcode() {
-		return opcode_;
-	}
 
-    [[nodiscard]] bool requiresModRMByte() const noexcept {
-        return regSpec_ != RegSpec::None;
+    void applyPrefix(Instruction &ins, uint8_t byte) noexcept {
+        switch (byte) {
+        case 0xf0:
+            ins.prefixes |= Prefix::Lock;
+            break;
+        case 0xf2:
+            ins.prefixes |= Prefix::Repne;
+            break;
+        case 0xf3:
+            ins.prefixes |= Prefix::Rep;
+            break;
+        case 0x66:
+            ins.prefixes |= Prefix::OperandSize;
+            break;
+        case 0x67:
+            ins.prefixes |= Prefix::AddressSize;
+            break;
+        case 0x2e:
+            ins.segment = Segment::CS;
+            break;
+        case 0x36:
+            ins.segment = Segment::SS;
+            break;
+        case 0x3e:
+            ins.segment = Segment::DS;
+            break;
+        case 0x26:
+            ins.segment = Segment::ES;
+            break;
+        case 0x64:
+            ins.segment = Segment::FS;
+            break;
+        case 0x65:
+            ins.segment = Segment::GS;
+            break;
+        }
     }
 
-  private:
-    enum class RexPrefixConfig {
-        None,
-        Rex,
-        RexW,
-    };
-    std::vector<uint8_t> opcode_;
-    RexPrefixConfig rexPrefixConfig_;
-    std::string_view mnemonic_;
-    RegSpec regSpec_;
-    OperandModel op1_;
-    OperandModel op2_;
-};
-
-class Trie {
-  public:
-    Trie() { nodes_.emplace_back(); }
-
-    void insert(const std::vector<uint8_t> &prefix, size_t instructionIdx) {
-        size_t position = 0;
-        for (uint8_t byte : prefix) {
-            if (!nodes_[position].children.count(byte)) {
-                nodes_[position].children.insert({byte, nodes_.size()});
-                nodes_.emplace_back();
-            }
-            position = nodes_[position].children.at(byte);
+    // VEX and EVEX instructions are not modelled yet; only their length is
+    // worked out.
+    void skipVex(Instruction &ins, uint8_t escape) {
+        uint8_t map = 1;
+        if (escape == 0xc5) {
+            ins.prefixes |= Prefix::Vex;
+            advance();
+        } else if (escape == 0xc4) {
+            ins.prefixes |= Prefix::Vex;
+            map = getByte() & 0x1f;
+            advance();
+        } else {
+            ins.prefixes |= Prefix::Evex;
+            map = getByte() & 0x7;
+            advance();
+            advance();
+        }
+        ins.opcodeMap = map;
+        ins.opcode = getByte();
+        if (escape != 0x62 && map == 1 && ins.opcode == 0x77) {
+            // vzeroupper / vzeroall
+            return;
+        }
+        ModRM modRM = getByte();
+        (void)readRm(modRM, RexPrefix());
+        if (vexHasImmediate(map, ins.opcode)) {
+            advance();
         }
-        nodes_[position].instructionId = instructionIdx;
     }
 
-    std::vector<size_t> findByPrefix(const std::span<const uint8_t> &prefix) const {
-        size_t position = 0;
-        for (uint8_t byte : prefix) {
-            if (!nodes_[position].children.count(byte)) {
-                return {};
-            }
-            position = nodes_[position].children.at(byte);
+    // Reads the SIB byte and displacement following `modRM`, returning the
+    // r/m operand without its size.
+    [[nodiscard]] Operand readRm(ModRM modRM, RexPrefix rex) {
+        Operand operand;
+        if (modRM.mod == 3) {
+            operand.kind = OperandKind::Register;
+            operand.base = Register(modRM.rm + 8 * rex.b);
+            return operand;
         }
-        std::vector<size_t> matches;
-        std::function<void(size_t)> dfs = [this, &matches,
-                                           &dfs](size_t position) {
-            if (nodes_[position].instructionId.has_value()) {
-                matches.push_back(nodes_[position].instructionId.value());
+        operand.kind = OperandKind::Memory;
+        size_t displacementSize = modRM.mod == 1 ? 1 : modRM.mod == 2 ? 4 : 0;
+        if (modRM.rm == 4) {
+            SIB sib = getByte();
+            uint8_t index = sib.index + 8 * rex.x;
+            if (index != 4) {
+                operand.index = Register(index);
+                operand.scale = 1 << sib.scale;
             }
-            for (auto [byte, child] : nodes_[position].children) {
-                dfs(child);
+            if (sib.base == 5 && modRM.mod == 0) {
+                displacementSize = 4;
+            } else {
+                operand.base = Register(sib.base + 8 * rex.b);
             }
-        };
-        return matches;
-    }
-
-  private:
-    struct Node {
-        std::optional<size_t> instructionId;
-        std::map<uint8_t, size_t> children;
-    };
-    std::vector<Node> nodes_;
-};
-
-class InstructionSet {
-  public:
-    static InstructionSet &instance() {
-        static InstructionSet instance;
-        return instance;
+        } else if (modRM.rm == 5 && modRM.mod == 0) {
+            operand.base = Register::RIP;
+            displacementSize = 4;
+        } else {
+            operand.base = Register(modRM.rm + 8 * rex.b);
+        }
+        if (displacementSize != 0) {
+            operand.value = signExtend(readConstant(displacementSize));
+        }
+        return operand;
     }
 
-	std::vector<size_t> findByPrefix(const std::span<const uint8_t> prefix) {
-		return trie.findByPrefix(prefix);
-	}
-
-	const InstructionModel &operator[](size_t id) {
-		return instructions[id];
-	}
-
-  private:
-    InstructionSet() {
-		for (const InstructionModel &_: instructions) {
-		}
-	}
-    const std::vector<InstructionModel> instructions = {
-        InstructionModel({0x81}, RegSpec::R0, "add", OperandModel::RmSize,
-                         OperandModel::ImmSize),
-        InstructionModel({0x48, 0x81}, RegSpec::R0, "add", OperandModel::Rm64,
-                         OperandModel::Imm32),
-    };
-	Trie trie;
-};
-
-struct Constant {
-    uint64_t value;
-    size_t size;
-};
-
-class InstructionDecoder {
-  public:
-    InstructionDecoder(const std::span<const uint8_t> data,
-                       ReadingMode readingMode)
-        : data_(data), readingMode_(readingMode), offset_(0) {}
-
-    [[nodiscard]] bool done() const noexcept { return offset_ >= data_.size(); }
-
-  private:
-	std::pair<size_t, std::vector<uint8_t>> readNextInstructionBytes() {
-        std::vector<uint8_t> ins;
-		bool requiresSIB = false;
-        while (isPrefixByte(currentByte())) {
-            ins.push_back(getByte());
+    [[nodiscard]] Operand readOperand(OperandModel model,
+                                      const Instruction &ins,
+                                      const std::optional<ModRM> &modRM,
+                                      const Operand &rm, RexPrefix rex,
+                                      size_t operandSize) {
+        using enum OperandModel;
+        Operand operand;
+        switch (model) {
+        case RegSize:
+        case Reg8:
+            operand.kind = OperandKind::Register;
+            operand.size = model == Reg8 ? 1 : operandSize;
+            operand.base = byteRegister(modRM->reg + 8 * rex.r, operand.size,
+                                        rex.present);
+            return operand;
+        case RmSize:
+        case Rm8:
+        case Rm16:
+        case Rm32:
+        case Rm64:
+            operand = rm;
+            operand.size = model == Rm8    ? 1
+                           : model == Rm16 ? 2
+                           : model == Rm32 ? 4
+                           : model == Rm64 ? (operandSize == 2 ? 2 : 8)
+                                           : operandSize;
+            if (operand.kind == OperandKind::Register) {
+                operand.base =
+                    byteRegister((uint8_t)operand.base, operand.size,
+                                 rex.present);
+            }
+            return operand;
+        case OpRegSize:
+        case OpReg8:
+        case OpReg64:
+            operand.kind = OperandKind::Register;
+            operand.size = model == OpReg8    ? 1
+                           : model == OpReg64 ? (operandSize == 2 ? 2 : 8)
+                                              : operandSize;
+            operand.base = byteRegister((ins.opcode & 0x7) + 8 * rex.b,
+                                        operand.size, rex.present);
+            return operand;
+        case Acc8:
+        case AccSize:
+            operand.kind = OperandKind::Register;
+            operand.size = model == Acc8 ? 1 : operandSize;
+            operand.base = Register::RAX;
+            return operand;
+        case One:
+            operand.kind = OperandKind::Immediate;
+            operand.size = 1;
+            operand.value = 1;
+            return operand;
+        case Cl:
+            operand.kind = OperandKind::Register;
+            operand.size = 1;
+            operand.base = Register::RCX;
+            return operand;
+        case ImmSize:
+        case Imm8:
+        case Imm16:
+        case ImmFull: {
+            size_t size = model == Imm8    ? 1
+                          : model == Imm16 ? 2
+                          : model == ImmFull || operandSize == 2
+                              ? operandSize
+                              : 4;
+            operand.kind = OperandKind::Immediate;
+            operand.size = size;
+            operand.value = signExtend(readConstant(size));
+            return operand;
         }
-        if (isRexPrefixByte(currentByte())) {
-            ins.push_back(getByte());
+        case Rel8:
+        case Rel32:
+            operand.kind = OperandKind::Target;
+            operand.size = 8;
+            operand.value = signExtend(readConstant(model == Rel8 ? 1 : 4));
+            return operand;
+        case None:
+            break;
         }
+        const bool unreachable = false;
+        assert(unreachable);
+        return operand;
+    }
 
-        ins.push_back(getByte());
-
-        std::vector<size_t> possibleInstructions = InstructionSet::instance().findByPrefix(ins);
-
-        bool requiresModRM = std::any_of(
-            possibleInstructions.begin(), possibleInstructions.end(),
-            [](size_t id) { return InstructionSet::instance()[id].requiresModRMByte(); });
-
-        if (requiresModRM) {
-            ins.push_back(getByte());
-			possibleInstructions = InstructionSet::instance().findByPrefix(ins);
+    // Without a REX prefix, byte registers 4-7 are AH, CH, DH and BH.
+    [[nodiscard]] static Register byteRegister(uint8_t reg, size_t size,
+                                               bool rexPresent) noexcept {
+        if (size == 1 && !rexPresent && reg >= 4 && reg < 8) {
+            return Register((uint8_t)Register::AH + reg - 4);
         }
+        return Register(reg);
+    }
 
-		if (requiresSIB) {
-			ins.push_back(getByte());
-		}
-        return {possibleInstructions.front(), ins};
+    void adjustMnemonic(Instruction &ins, const std::optional<ModRM> &modRM,
+                        size_t operandSize) noexcept {
+        if (ins.mnemonic == Mnemonic::Cwde || ins.mnemonic == Mnemonic::Cdq) {
+            if (operandSize == 2) {
+                ins.mnemonic = Mnemonic((uint16_t)ins.mnemonic - 1);
+            } else if (operandSize == 8) {
+                ins.mnemonic = Mnemonic((uint16_t)ins.mnemonic + 1);
+            }
+        } else if (ins.opcodeMap == 0 && ins.opcode == 0x90 &&
+                   (ins.prefixes & Prefix::Rep)) {
+            ins.mnemonic = Mnemonic::Pause;
+        } else if (ins.opcodeMap == 1 && ins.opcode == 0x1e && modRM) {
+            if ((ins.prefixes & Prefix::Rep) && modRM->mod == 3 &&
+                modRM->reg == 7 && modRM->rm == 2) {
+                ins.mnemonic = Mnemonic::Endbr64;
+                ins.operandCount = 0;
+            }
+        }
     }
 
     [[nodiscard]] Constant readConstant(size_t size) noexcept {
         uint64_t value = 0;
         switch (readingMode_) {
         case ReadingMode::LSB:
-            for (size_t i = 0; i < size; i++) {
-                value |= ((uint64_t)getByte()) << (8 * i);
+            // MaxDecodeBytes leaves room for a whole word past the end.
+            std::memcpy(&value, data_.data() + offset_, sizeof(value));
+            if (size < sizeof(value)) {
+                value &= (uint64_t(1) << (8 * size)) - 1;
             }
+            offset_ += size;
             break;
         case ReadingMode::MSB:
             for (size_t i = 0; i < size; i++) {
@@ -757,34 +845,261 @@ class InstructionDecoder {
     }
 
     [[nodiscard]] bool isPrefixByte(uint8_t byte) const noexcept {
-        auto prefixBytes = {
-            0x64,
-            0x65,
-        };
-        for (uint8_t b : prefixBytes) {
-            if (byte == b) {
-                return true;
+        static constexpr std::array<bool, 256> prefixBytes = [] {
+            std::array<bool, 256> table{};
+            for (uint8_t b : {0xf0, 0xf2, 0xf3, 0x2e, 0x36, 0x3e, 0x26, 0x64,
+                              0x65, 0x66, 0x67}) {
+                table[b] = true;
             }
-        }
-        return false;
+            return table;
+        }();
+        return prefixBytes[byte];
     }
 
-  private:
     const std::span<const uint8_t> data_;
     ReadingMode readingMode_;
+    uint64_t address_;
     size_t offset_;
 };
 
+std::optional<uint64_t> Instruction::branchTarget() const noexcept {
+    for (const Operand &operand : getOperands()) {
+        if (operand.kind == OperandKind::Target) {
+            return operand.value;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> Instruction::ripTarget() const noexcept {
+    for (const Operand &operand : getOperands()) {
+        if (operand.kind == OperandKind::Memory &&
+            operand.base == Register::RIP) {
+            return address + length + operand.value;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view mnemonicName(Mnemonic mnemonic) noexcept {
+    static constexpr std::array<std::string_view, (size_t)Mnemonic::Count>
+        names = {
+            "(unknown)", "add",    "or",     "adc",    "sbb",    "and",
+            "sub",       "xor",    "cmp",    "test",   "not",    "neg",
+            "mul",       "imul",   "div",    "idiv",   "inc",    "dec",
+            "rol",       "ror",    "rcl",    "rcr",    "shl",    "shr",
+            "sar",       "mov",    "movsxd", "movzx",  "movsx",  "lea",
+            "xchg",      "push",   "pop",    "cbw",    "cwde",   "cdqe",
+            "cwd",       "cdq",    "cqo",    "call",   "jmp",    "ret",
+            "leave",     "nop",    "pause",  "int3",   "hlt",    "ud2",
+            "syscall",   "endbr64", "jo",    "jno",    "jb",     "jae",
+            "je",        "jne",    "jbe",    "ja",     "js",     "jns",
+            "jp",        "jnp",    "jl",     "jge",    "jle",    "jg",
+            "seto",      "setno",  "setb",   "setae",  "sete",   "setne",
+            "setbe",     "seta",   "sets",   "setns",  "setp",   "setnp",
+            "setl",      "setge",  "setle",  "setg",   "cmovo",  "cmovno",
+            "cmovb",     "cmovae", "cmove",  "cmovne", "cmovbe", "cmova",
+            "cmovs",     "cmovns", "cmovp",  "cmovnp", "cmovl",  "cmovge",
+            "cmovle",    "cmovg",
+        };
+    return names[(size_t)mnemonic];
+}
+
+std::string_view registerName(Register reg, size_t size) noexcept {
+    static constexpr std::array<std::array<std::string_view, 4>, 16> names = {{
+        {"al", "ax", "eax", "rax"},
+        {"cl", "cx", "ecx", "rcx"},
+        {"dl", "dx", "edx", "rdx"},
+        {"bl", "bx", "ebx", "rbx"},
+        {"spl", "sp", "esp", "rsp"},
+        {"bpl", "bp", "ebp", "rbp"},
+        {"sil", "si", "esi", "rsi"},
+        {"dil", "di", "edi", "rdi"},
+        {"r8b", "r8w", "r8d", "r8"},
+        {"r9b", "r9w", "r9d", "r9"},
+        {"r10b", "r10w", "r10d", "r10"},
+        {"r11b", "r11w", "r11d", "r11"},
+        {"r12b", "r12w", "r12d", "r12"},
+        {"r13b", "r13w", "r13d", "r13"},
+        {"r14b", "r14w", "r14d", "r14"},
+        {"r15b", "r15w", "r15d", "r15"},
+    }};
+    switch (reg) {
+    case Register::RIP:
+        return "rip";
+    case Register::AH:
+        return "ah";
+    case Register::CH:
+        return "ch";
+    case Register::DH:
+        return "dh";
+    case Register::BH:
+        return "bh";
+    case Register::None:
+        return "";
+    default:
+        break;
+    }
+    size_t column = size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3;
+    return names[(size_t)reg][column];
+}
+
+bool isConditionalJump(Mnemonic mnemonic) noexcept {
+    return mnemonic >= Mnemonic::Jo && mnemonic <= Mnemonic::Jg;
+}
+
+bool isControlFlow(Mnemonic mnemonic) noexcept {
+    return mnemonic == Mnemonic::Call || mnemonic == Mnemonic::Jmp ||
+           mnemonic == Mnemonic::Ret || isConditionalJump(mnemonic);
+}
+
+Instruction decodeInstruction(std::span<const uint8_t> code, size_t offset,
+                              uint64_t address, ReadingMode readingMode) {
+    if (offset >= code.size()) {
+        throw std::out_of_range(std::format(
+            "Offset {} is past the {} bytes of code", offset, code.size()));
+    }
+    InstructionDecoder decoder(code, readingMode, address);
+    decoder.seek(offset);
+    return decoder.next();
+}
+
+std::vector<Instruction> decode(std::span<const uint8_t> code,
+                                uint64_t address, ReadingMode readingMode) {
+    std::vector<Instruction> result;
+    decode(code, address, readingMode, result);
+    return result;
+}
+
+void decode(std::span<const uint8_t> code, uint64_t address,
+            ReadingMode readingMode, std::vector<Instruction> &out) {
+    out.clear();
+    // Compiled x86-64 code averages around four bytes per instruction.
+    out.reserve(code.size() / 4 + 1);
+    InstructionDecoder decoder(code, readingMode, address);
+    while (!decoder.done()) {
+        out.push_back(decoder.next());
+    }
+}
+
+void writeConstantHex(std::string &out, int64_t value, bool writeSign = true) {
+    if (value < 0) {
+        std::format_to(std::back_inserter(out), "{}0x{:x}",
+                       writeSign ? "-" : "", -(uint64_t)value);
+    } else {
+        std::format_to(std::back_inserter(out), "0x{:x}", value);
+    }
+}
+
+void writeOperandRM(std::string &out, const Instruction &ins,
+                    const Operand &operand) {
+    static constexpr std::array<std::string_view, 7> segments = {
+        "", "cs:", "ss:", "ds:", "es:", "fs:", "gs:"};
+    out += segments[(size_t)ins.segment];
+    out += '[';
+    size_t addressSize = (ins.prefixes & Prefix::AddressSize) ? 4 : 8;
+    bool first = true;
+    if (operand.base != Register::None) {
+        out += registerName(operand.base, addressSize);
+        first = false;
+    }
+    if (operand.index != Register::None) {
+        if (!first) {
+            out += " + ";
+        }
+        out += registerName(operand.index, addressSize);
+        if (operand.scale != 1) {
+            out += '*';
+            out += (char)('0' + operand.scale);
+        }
+        first = false;
+    }
+    if (first) {
+        writeConstantHex(out, operand.value);
+    } else if (operand.value != 0 || operand.base == Register::RIP) {
+        out += operand.value < 0 ? " - " : " + ";
+        writeConstantHex(out, operand.value, false);
+    }
+    out += ']';
+}
+
+void formatInstruction(std::string &out, const Instruction &ins,
+                       const SymbolResolver &resolver) {
+    out += '\t';
+    if (ins.mnemonic == Mnemonic::Unknown) {
+        out += "Unimplemented: ";
+        if (ins.prefixes & (Prefix::Vex | Prefix::Evex)) {
+            out += (ins.prefixes & Prefix::Vex) ? "vex " : "evex ";
+        }
+        static constexpr std::array<std::string_view, 4> escapes = {
+            "", "0f ", "0f 38 ", "0f 3a "};
+        if (ins.opcodeMap < escapes.size()) {
+            out += escapes[ins.opcodeMap];
+        } else {
+            std::format_to(std::back_inserter(out), "map{} ", ins.opcodeMap);
+        }
+        std::format_to(std::back_inserter(out), "{:02x}\n", ins.opcode);
+        return;
+    }
+    if (ins.prefixes & Prefix::Lock) {
+        out += "lock ";
+    }
+    out += mnemonicName(ins.mnemonic);
+    for (size_t i = 0; i < ins.operandCount; i++) {
+        const Operand &operand = ins.operands[i];
+        out += i == 0 ? " " : ", ";
+        switch (operand.kind) {
+        case OperandKind::Register:
+            out += registerName(operand.base, operand.size);
+            break;
+        case OperandKind::Memory:
+            writeOperandRM(out, ins, operand);
+            break;
+        case OperandKind::Immediate:
+            writeConstantHex(out, operand.value);
+            break;
+        case OperandKind::Target:
+            std::format_to(std::back_inserter(out), "0x{:x}",
+                           (uint64_t)operand.value);
+            break;
+        case OperandKind::None:
+            break;
+        }
+    }
+    if (resolver && isControlFlow(ins.mnemonic)) {
+        std::optional<uint64_t> target = ins.branchTarget();
+        if (!target.has_value()) {
+            target = ins.ripTarget();
+        }
+        if (target.has_value()) {
+            std::string_view name = resolver(target.value());
+            if (!name.empty()) {
+                out += " <";
+                out += name;
+                out += '>';
+            }
+        }
+    }
+    out += '\n';
+}
+
 }; // namespace X86_64
 
 std::string disassembleX86_64(const std::span<const uint8_t> code,
-                              ReadingMode readingMode) {
-    std::stringstream result;
-    size_t offset = 0;
-    while (offset < code.size()) {
-        X86_64::old::readIns(result, code, offset, readingMode);
+                              ReadingMode readingMode, uint64_t address,
+                              const X86_64::SymbolResolver &resolver) {
+    std::string result;
+    X86_64::InstructionDecoder decoder(code, readingMode, address);
+    while (!decoder.done()) {
+        X86_64::formatInstruction(result, decoder.next(), resolver);
     }
-    return result.str();
+    return result;
+}
+
+void disassembleX86_64(std::ostream &out, const std::span<const uint8_t> code,
+                       ReadingMode readingMode, uint64_t address,
+                       const X86_64::SymbolResolver &resolver) {
+    out << disassembleX86_64(code, readingMode, address, resolver);
 }
 
 }; // namespace disassemble
@@ -0,0 +1,627 @@
+#include <dwarf.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace dwarf {
+
+namespace {
+
+constexpr uint64_t AttributeStmtList = 0x10;
+constexpr uint64_t FormImplicitConst = 0x21;
+constexpr uint64_t ContentPath = 1;
+constexpr uint64_t ContentDirectoryIndex = 2;
+
+// Little endian reads that throw past the end of the data.
+class Reader {
+  public:
+    Reader(std::span<const uint8_t> data, size_t position)
+        : data_(data), position_(position) {}
+
+    [[nodiscard]] size_t position() const noexcept { return position_; }
+    void seek(size_t position) noexcept { position_ = position; }
+    [[nodiscard]] bool atEnd() const noexcept {
+        return position_ >= data_.size();
+    }
+
+    uint64_t fixed(size_t bytes) {
+        need(bytes);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            value |= (uint64_t)data_[position_ + i] << (8 * i);
+        }
+        position_ += bytes;
+        return value;
+    }
+
+    uint64_t uleb() {
+        uint64_t value = 0;
+        for (size_t shift = 0;; shift += 7) {
+            uint8_t byte = fixed(1);
+            if (shift < 64) {
+                value |= (uint64_t)(byte & 0x7f) << shift;
+            }
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+    }
+
+    int64_t sleb() {
+        uint64_t value = 0;
+        size_t shift = 0;
+        uint8_t byte;
+        do {
+            byte = fixed(1);
+            if (shift < 64) {
+                value |= (uint64_t)(byte & 0x7f) << shift;
+            }
+            shift += 7;
+        } while (byte & 0x80);
+        if (shift < 64 && (byte & 0x40)) {
+            value |= ~0ull << shift;
+        }
+        return value;
+    }
+
+    std::string_view string() {
+        auto text = std::string_view(
+            reinterpret_cast<const char *>(data_.data()), data_.size());
+        size_t end = text.find('\0', position_);
+        if (position_ > text.size() || end == std::string_view::npos) {
+            throw std::runtime_error("Truncated DWARF data");
+        }
+        std::string_view result = text.substr(position_, end - position_);
+        position_ = end + 1;
+        return result;
+    }
+
+    void skip(size_t bytes) {
+        need(bytes);
+        position_ += bytes;
+    }
+
+    // An initial length: sets `is64` for the 64-bit DWARF format.
+    uint64_t length(bool &is64) {
+        uint64_t length = fixed(4);
+        is64 = length == 0xffffffff;
+        return is64 ? fixed(8) : length;
+    }
+
+  private:
+    void need(size_t bytes) const {
+        if (position_ > data_.size() || bytes > data_.size() - position_) {
+            throw std::runtime_error("Truncated DWARF data");
+        }
+    }
+
+    std::span<const uint8_t> data_;
+    size_t position_;
+};
+
+struct Encoding {
+    uint16_t version;
+    uint8_t addressSize;
+    uint8_t offsetSize;
+};
+
+// Skips an attribute value of form `form`.
+void skipForm(Reader &reader, uint64_t form, const Encoding &encoding) {
+    switch (form) {
+    case 0x01: // addr
+        reader.skip(encoding.addressSize);
+        break;
+    case 0x0b: // data1
+    case 0x0c: // flag
+    case 0x11: // ref1
+    case 0x25: // strx1
+    case 0x29: // addrx1
+        reader.skip(1);
+        break;
+    case 0x05: // data2
+    case 0x12: // ref2
+    case 0x26: // strx2
+    case 0x2a: // addrx2
+        reader.skip(2);
+        break;
+    case 0x27: // strx3
+    case 0x2b: // addrx3
+        reader.skip(3);
+        break;
+    case 0x06: // data4
+    case 0x13: // ref4
+    case 0x1c: // ref_sup4
+    case 0x28: // strx4
+    case 0x2c: // addrx4
+        reader.skip(4);
+        break;
+    case 0x07: // data8
+    case 0x14: // ref8
+    case 0x20: // ref_sig8
+    case 0x24: // ref_sup8
+        reader.skip(8);
+        break;
+    case 0x1e: // data16
+        reader.skip(16);
+        break;
+    case 0x0e:   // strp
+    case 0x10:   // ref_addr
+    case 0x17:   // sec_offset
+    case 0x1d:   // strp_sup
+    case 0x1f:   // line_strp
+    case 0x1f20: // GNU_ref_alt
+    case 0x1f21: // GNU_strp_alt
+        reader.skip(encoding.offsetSize);
+        break;
+    case 0x08: // string
+        (void)reader.string();
+        break;
+    case 0x0d: // sdata
+        (void)reader.sleb();
+        break;
+    case 0x0f:   // udata
+    case 0x15:   // ref_udata
+    case 0x1a:   // strx
+    case 0x1b:   // addrx
+    case 0x22:   // loclistx
+    case 0x23:   // rnglistx
+    case 0x1f01: // GNU_addr_index
+    case 0x1f02: // GNU_str_index
+        (void)reader.uleb();
+        break;
+    case 0x09: // block
+    case 0x18: // exprloc
+        reader.skip(reader.uleb());
+        break;
+    case 0x0a: // block1
+        reader.skip(reader.fixed(1));
+        break;
+    case 0x03: // block2
+        reader.skip(reader.fixed(2));
+        break;
+    case 0x04: // block4
+        reader.skip(reader.fixed(4));
+        break;
+    case 0x19: // flag_present
+    case FormImplicitConst:
+        break;
+    case 0x16: // indirect
+        skipForm(reader, reader.uleb(), encoding);
+        break;
+    default:
+        throw std::runtime_error("Unknown DWARF form");
+    }
+}
+
+[[nodiscard]] std::string joinPath(std::string_view directory,
+                                   std::string_view name) {
+    if (directory.empty() || name.starts_with('/')) {
+        return std::string(name);
+    }
+    std::string path(directory);
+    path += '/';
+    path += name;
+    return path;
+}
+
+} // namespace
+
+LineIndex::LineIndex(const binary::Elf64 &elf)
+    : elf_(elf), info_(elf.findSection(".debug_info")),
+      abbrev_(elf.findSection(".debug_abbrev")),
+      line_(elf.findSection(".debug_line")),
+      str_(elf.findSection(".debug_str")),
+      lineStr_(elf.findSection(".debug_line_str")) {}
+
+void LineIndex::readRanges() {
+    auto aranges = elf_.findSection(".debug_aranges");
+    if (!aranges.has_value() || !info_.has_value() || !line_.has_value()) {
+        return;
+    }
+    std::span<const uint8_t> data = elf_.getSectionData(aranges.value());
+    std::unordered_map<uint64_t, std::optional<uint64_t>> lineOffsets;
+    Reader reader(data, 0);
+    try {
+        while (!reader.atEnd()) {
+            size_t start = reader.position();
+            bool is64;
+            uint64_t length = reader.length(is64);
+            size_t end = reader.position() + length;
+            reader.skip(2); // version
+            uint64_t info = reader.fixed(is64 ? 8 : 4);
+            uint8_t addressSize = reader.fixed(1);
+            reader.skip(1); // segment selector size
+            if (addressSize == 0) {
+                break;
+            }
+            // Tuples are aligned to twice the address size.
+            size_t tuple = 2 * addressSize;
+            reader.skip((tuple - (reader.position() - start) % tuple) % tuple);
+
+            auto [it, inserted] = lineOffsets.try_emplace(info);
+            if (inserted) {
+                it->second = lineOffset(info);
+            }
+            while (reader.position() + tuple <= end) {
+                uint64_t address = reader.fixed(addressSize);
+                uint64_t size = reader.fixed(addressSize);
+                if (address == 0 && size == 0) {
+                    break;
+                }
+                if (it->second.has_value() && size != 0) {
+                    ranges_.push_back(
+                        Range{address, address + size, it->second.value()});
+                }
+            }
+            reader.seek(end);
+        }
+    } catch (const std::exception &) {
+        // Keep the ranges read before the damage.
+    }
+    std::sort(ranges_.begin(), ranges_.end(),
+              [](const Range &a, const Range &b) { return a.start < b.start; });
+}
+
+std::optional<uint64_t> LineIndex::lineOffset(uint64_t info) const {
+    if (!abbrev_.has_value()) {
+        return std::nullopt;
+    }
+    try {
+        // The compile unit header, then the abbreviation of its DIE.
+        Reader reader(elf_.getSectionData(info_.value()), info);
+        bool is64;
+        (void)reader.length(is64);
+        Encoding encoding;
+        encoding.offsetSize = is64 ? 8 : 4;
+        encoding.version = reader.fixed(2);
+        uint64_t abbrevOffset;
+        if (encoding.version >= 5) {
+            uint8_t unitType = reader.fixed(1);
+            encoding.addressSize = reader.fixed(1);
+            abbrevOffset = reader.fixed(encoding.offsetSize);
+            // Skeleton and split units carry a DWO id.
+            if (unitType == 4 || unitType == 5) {
+                reader.skip(8);
+            }
+        } else {
+            abbrevOffset = reader.fixed(encoding.offsetSize);
+            encoding.addressSize = reader.fixed(1);
+        }
+        uint64_t code = reader.uleb();
+
+        Reader abbrev(elf_.getSectionData(abbrev_.value()), abbrevOffset);
+        while (true) {
+            uint64_t entry = abbrev.uleb();
+            if (entry == 0) {
+                return std::nullopt;
+            }
+            (void)abbrev.uleb(); // tag
+            abbrev.skip(1);      // children
+            while (true) {
+                uint64_t attribute = abbrev.uleb();
+                uint64_t form = abbrev.uleb();
+                if (attribute == 0 && form == 0) {
+                    break;
+                }
+                if (form == FormImplicitConst) {
+                    (void)abbrev.sleb();
+                }
+                if (entry != code) {
+                    continue;
+                }
+                if (attribute == AttributeStmtList) {
+                    switch (form) {
+                    case 0x06: // data4
+                        return reader.fixed(4);
+                    case 0x07: // data8
+                        return reader.fixed(8);
+                    case 0x17: // sec_offset
+                        return reader.fixed(encoding.offsetSize);
+                    default:
+                        return std::nullopt;
+                    }
+                }
+                skipForm(reader, form, encoding);
+            }
+            if (entry == code) {
+                return std::nullopt;
+            }
+        }
+    } catch (const std::exception &) {
+        return std::nullopt;
+    }
+}
+
+LineIndex::Unit &LineIndex::unitAt(uint64_t lineOffset) {
+    auto &unit = units_[lineOffset];
+    if (unit == nullptr) {
+        unit = std::make_unique<Unit>();
+    }
+    return *unit;
+}
+
+void LineIndex::decode(uint64_t lineOffset, Unit &unit) const {
+    std::vector<Row> rows;
+    try {
+        Reader reader(elf_.getSectionData(line_.value()), lineOffset);
+        bool is64;
+        uint64_t length = reader.length(is64);
+        size_t end = reader.position() + length;
+        Encoding encoding;
+        encoding.offsetSize = is64 ? 8 : 4;
+        encoding.version = reader.fixed(2);
+        encoding.addressSize = 8;
+        if (encoding.version >= 5) {
+            encoding.addressSize = reader.fixed(1);
+            reader.skip(1); // segment selector size
+        }
+        uint64_t headerLength = reader.fixed(encoding.offsetSize);
+        size_t program = reader.position() + headerLength;
+        uint8_t minimumLength = reader.fixed(1);
+        if (encoding.version >= 4) {
+            reader.skip(1); // maximum operations per instruction
+        }
+        reader.skip(1); // default is_stmt
+        int8_t lineBase = reader.fixed(1);
+        uint8_t lineRange = reader.fixed(1);
+        uint8_t opcodeBase = reader.fixed(1);
+        std::vector<uint8_t> operandCounts(opcodeBase);
+        for (size_t i = 1; i < opcodeBase; i++) {
+            operandCounts[i] = reader.fixed(1);
+        }
+        if (lineRange == 0) {
+            return;
+        }
+
+        auto stringForm = [&](uint64_t form) -> std::string_view {
+            if (form == 0x08) {
+                return reader.string();
+            }
+            std::optional<size_t> section;
+            if (form == 0x1f) {
+                section = lineStr_;
+            } else if (form == 0x0e) {
+                section = str_;
+            }
+            if (!section.has_value()) {
+                skipForm(reader, form, encoding);
+                return {};
+            }
+            Reader strings(elf_.getSectionData(section.value()),
+                           reader.fixed(encoding.offsetSize));
+            return strings.string();
+        };
+
+        std::vector<std::string> directories;
+        if (encoding.version >= 5) {
+            // Entries described by (content type, form) pairs.
+            auto readEntries = [&](auto &&entry) {
+                std::vector<std::pair<uint64_t, uint64_t>> formats(
+                    reader.fixed(1));
+                for (auto &[type, form] : formats) {
+                    type = reader.uleb();
+                    form = reader.uleb();
+                }
+                uint64_t count = reader.uleb();
+                for (uint64_t i = 0; i < count; i++) {
+                    std::string_view path;
+                    uint64_t directory = 0;
+                    for (auto [type, form] : formats) {
+                        if (type == ContentPath) {
+                            path = stringForm(form);
+                        } else if (type == ContentDirectoryIndex &&
+                                   (form == 0x0b || form == 0x05 ||
+                                    form == 0x0f)) {
+                            directory = form == 0x0f
+                                            ? reader.uleb()
+                                            : reader.fixed(form == 0x0b ? 1
+                                                                        : 2);
+                        } else {
+                            skipForm(reader, form, encoding);
+                        }
+                    }
+                    entry(path, directory);
+                }
+            };
+            readEntries([&](std::string_view path, uint64_t) {
+                directories.emplace_back(path);
+            });
+            readEntries([&](std::string_view path, uint64_t directory) {
+                unit.files.push_back(joinPath(
+                    directory < directories.size() ? directories[directory]
+                                                   : std::string_view(),
+                    path));
+            });
+        } else {
+            // Index 0 is the compilation directory, unnamed here.
+            directories.emplace_back();
+            for (auto path = reader.string(); !path.empty();
+                 path = reader.string()) {
+                directories.emplace_back(path);
+            }
+            unit.files.emplace_back();
+            for (auto path = reader.string(); !path.empty();
+                 path = reader.string()) {
+                uint64_t directory = reader.uleb();
+                (void)reader.uleb(); // modification time
+                (void)reader.uleb(); // length
+                unit.files.push_back(joinPath(
+                    directory < directories.size() ? directories[directory]
+                                                   : std::string_view(),
+                    path));
+            }
+        }
+
+        reader.seek(program);
+        uint64_t address = 0;
+        uint32_t file = 1;
+        int64_t line = 1;
+        size_t sequence = rows.size();
+        auto emit = [&] {
+            rows.push_back(Row{address, file, (uint32_t)std::max<int64_t>(
+                                                  line, 1)});
+        };
+        while (reader.position() < end) {
+            uint8_t opcode = reader.fixed(1);
+            if (opcode >= opcodeBase) {
+                uint8_t adjusted = opcode - opcodeBase;
+                address += adjusted / lineRange * minimumLength;
+                line += lineBase + adjusted % lineRange;
+                emit();
+                continue;
+            }
+            switch (opcode) {
+            case 0: {
+                uint64_t size = reader.uleb();
+                size_t next = reader.position() + size;
+                if (size == 0) {
+                    break;
+                }
+                uint8_t extended = reader.fixed(1);
+                if (extended == 1) { // end_sequence
+                    // Rows at the end address cover nothing.
+                    while (rows.size() > sequence &&
+                           rows.back().address == address) {
+                        rows.pop_back();
+                    }
+                    rows.push_back(Row{address, 0, 0});
+                    sequence = rows.size();
+                    address = 0;
+                    file = 1;
+                    line = 1;
+                } else if (extended == 2) { // set_address
+                    address = reader.fixed(size - 1);
+                }
+                reader.seek(next);
+                break;
+            }
+            case 1: // copy
+                emit();
+                break;
+            case 2: // advance_pc
+                address += reader.uleb() * minimumLength;
+                break;
+            case 3: // advance_line
+                line += reader.sleb();
+                break;
+            case 4: // set_file
+                file = reader.uleb();
+                break;
+            case 8: // const_add_pc
+                address += (255 - opcodeBase) / lineRange * minimumLength;
+                break;
+            case 9: // fixed_advance_pc
+                address += reader.fixed(2);
+                break;
+            default:
+                for (size_t i = 0; i < operandCounts[opcode]; i++) {
+                    (void)reader.uleb();
+                }
+                break;
+            }
+        }
+    } catch (const std::exception &) {
+        // Keep the rows decoded before the damage.
+    }
+
+    // Sequences may come in any order. At equal addresses the end of one
+    // sequence goes before the start of the next, and the last row wins.
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Row &a, const Row &b) {
+                         return a.address < b.address ||
+                                (a.address == b.address && a.line == 0 &&
+                                 b.line != 0);
+                     });
+    for (const Row &row : rows) {
+        if (!unit.rows.empty() && unit.rows.back().address == row.address) {
+            unit.rows.back() = row;
+        } else if (unit.rows.empty() || unit.rows.back().file != row.file ||
+                   unit.rows.back().line != row.line) {
+            unit.rows.push_back(row);
+        }
+    }
+    unit.rows.shrink_to_fit();
+}
+
+std::optional<Location> LineIndex::findIn(const Unit &unit,
+                                          uint64_t address) const {
+    auto it = std::upper_bound(unit.rows.begin(), unit.rows.end(), address,
+                               [](uint64_t address, const Row &row) {
+                                   return address < row.address;
+                               });
+    if (it == unit.rows.begin() || (it - 1)->line == 0) {
+        return std::nullopt;
+    }
+    const Row &row = *(it - 1);
+    std::string_view file = "?";
+    if (row.file < unit.files.size()) {
+        file = unit.files[row.file];
+    }
+    return Location{file, row.line};
+}
+
+std::optional<Location> LineIndex::find(uint64_t address) {
+    if (!line_.has_value()) {
+        return std::nullopt;
+    }
+    std::unique_lock lock(mutex_);
+    if (!rangesRead_) {
+        readRanges();
+        rangesRead_ = true;
+    }
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), address,
+                               [](uint64_t address, const Range &range) {
+                                   return address < range.start;
+                               });
+    if ((it == ranges_.begin() || address >= (it - 1)->end) &&
+        !allDecoded_) {
+        // Nothing says which unit covers the address: decode all of them
+        // and cover their rows with ranges.
+        allDecoded_ = true;
+        Reader reader(elf_.getSectionData(line_.value()), 0);
+        try {
+            while (!reader.atEnd()) {
+                uint64_t offset = reader.position();
+                bool is64;
+                uint64_t length = reader.length(is64);
+                reader.seek(reader.position() + length);
+                Unit &unit = unitAt(offset);
+                std::call_once(unit.once,
+                               [&] { decode(offset, unit); });
+                size_t start = 0;
+                for (size_t i = 0; i < unit.rows.size(); i++) {
+                    if (unit.rows[i].line == 0) {
+                        ranges_.push_back(Range{unit.rows[start].address,
+                                                unit.rows[i].address,
+                                                offset});
+                        start = i + 1;
+                    }
+                }
+            }
+        } catch (const std::exception &) {
+        }
+        std::sort(ranges_.begin(), ranges_.end(),
+                  [](const Range &a, const Range &b) {
+                      return a.start < b.start;
+                  });
+        it = std::upper_bound(ranges_.begin(), ranges_.end(), address,
+                              [](uint64_t address, const Range &range) {
+                                  return address < range.start;
+                              });
+    }
+    if (it == ranges_.begin() || address >= (it - 1)->end) {
+        return std::nullopt;
+    }
+    uint64_t offset = (it - 1)->line;
+    Unit &unit = unitAt(offset);
+    lock.unlock();
+    std::call_once(unit.once, [&] { decode(offset, unit); });
+    return findIn(unit, address);
+}
+
+size_t LineIndex::getDecodedUnitCount() const {
+    std::lock_guard lock(mutex_);
+    return units_.size();
+}
+
+} // namespace dwarf
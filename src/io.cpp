@@ -0,0 +1,449 @@
+#include <io.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <format>
+#include <parallel.hpp>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#ifdef DISASMER_HAVE_IO_URING
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace io {
+
+namespace {
+
+constexpr size_t ChunkSize = size_t(1) << 20;
+// Chunk reads in flight at once.
+constexpr unsigned Depth = 32;
+
+struct File;
+
+struct Request {
+    File *file;
+    int fd;
+    size_t offset;
+    size_t length;
+    iovec vector;
+};
+
+struct File {
+    size_t index;
+    int fd = -1;
+    std::vector<uint8_t> data;
+    std::vector<Request> chunks;
+    size_t remaining = 0;
+    std::string error;
+
+    ~File() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+struct Completion {
+    Request *request;
+    // Bytes read, or a negated errno.
+    int result;
+};
+
+// Where chunk reads go. Requests must stay alive until they complete.
+class Backend {
+  public:
+    virtual ~Backend() = default;
+    virtual void submit(Request *request) = 0;
+    // Waits for at least one read to complete and appends those that have.
+    virtual void wait(std::vector<Completion> &completions) = 0;
+};
+
+#ifdef DISASMER_HAVE_IO_URING
+// An io_uring set up through the raw system calls.
+class Ring final : public Backend {
+  public:
+    [[nodiscard]] static std::unique_ptr<Ring> create(unsigned entries) {
+        io_uring_params params{};
+        int fd = syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) {
+            return nullptr;
+        }
+        std::unique_ptr<Ring> ring(new Ring(fd));
+        ring->sqSize_ =
+            params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cqSize_ =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring->sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            ring->sqSize_ = ring->cqSize_ =
+                std::max(ring->sqSize_, ring->cqSize_);
+        }
+        auto map = [&](size_t size, off_t offset) {
+            void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd, offset);
+            return address == MAP_FAILED ? nullptr
+                                         : static_cast<uint8_t *>(address);
+        };
+        ring->sq_ = map(ring->sqSize_, IORING_OFF_SQ_RING);
+        ring->cq_ = single ? ring->sq_ : map(ring->cqSize_, IORING_OFF_CQ_RING);
+        ring->sqes_ = reinterpret_cast<io_uring_sqe *>(
+            map(ring->sqesSize_, IORING_OFF_SQES));
+        if (ring->sq_ == nullptr || ring->cq_ == nullptr ||
+            ring->sqes_ == nullptr) {
+            return nullptr;
+        }
+        auto at = [](uint8_t *base, uint32_t offset) {
+            return reinterpret_cast<unsigned *>(base + offset);
+        };
+        ring->sqTail_ = at(ring->sq_, params.sq_off.tail);
+        ring->sqMask_ = *at(ring->sq_, params.sq_off.ring_mask);
+        ring->sqArray_ = at(ring->sq_, params.sq_off.array);
+        ring->cqHead_ = at(ring->cq_, params.cq_off.head);
+        ring->cqTail_ = at(ring->cq_, params.cq_off.tail);
+        ring->cqMask_ = *at(ring->cq_, params.cq_off.ring_mask);
+        ring->cqes_ =
+            reinterpret_cast<io_uring_cqe *>(ring->cq_ + params.cq_off.cqes);
+        return ring;
+    }
+
+    ~Ring() override {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqesSize_);
+        }
+        if (cq_ != nullptr && cq_ != sq_) {
+            munmap(cq_, cqSize_);
+        }
+        if (sq_ != nullptr) {
+            munmap(sq_, sqSize_);
+        }
+        close(fd_);
+    }
+
+    void submit(Request *request) override {
+        // This thread is the only producer, the kernel only reads the tail.
+        unsigned tail = *sqTail_;
+        unsigned index = tail & sqMask_;
+        io_uring_sqe &sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = request->fd;
+        sqe.off = request->offset;
+        sqe.addr = reinterpret_cast<uint64_t>(&request->vector);
+        sqe.len = 1;
+        sqe.user_data = reinterpret_cast<uint64_t>(request);
+        sqArray_[index] = index;
+        std::atomic_ref(*sqTail_).store(tail + 1, std::memory_order_release);
+        unsubmitted_++;
+    }
+
+    void wait(std::vector<Completion> &completions) override {
+        int submitted = syscall(__NR_io_uring_enter, fd_, unsubmitted_, 1,
+                                IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted >= 0) {
+            unsubmitted_ -= submitted;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw std::runtime_error(
+                std::format("io_uring_enter: {}", std::strerror(errno)));
+        }
+        unsigned head = *cqHead_;
+        unsigned tail =
+            std::atomic_ref(*cqTail_).load(std::memory_order_acquire);
+        for (; head != tail; head++) {
+            const io_uring_cqe &cqe = cqes_[head & cqMask_];
+            completions.push_back(
+                Completion{reinterpret_cast<Request *>(cqe.user_data),
+                           cqe.res});
+        }
+        std::atomic_ref(*cqHead_).store(head, std::memory_order_release);
+    }
+
+  private:
+    explicit Ring(int fd) : fd_(fd) {}
+
+    int fd_;
+    uint8_t *sq_ = nullptr;
+    uint8_t *cq_ = nullptr;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqSize_ = 0;
+    size_t cqSize_ = 0;
+    size_t sqesSize_ = 0;
+    unsigned *sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned *sqArray_ = nullptr;
+    unsigned *cqHead_ = nullptr;
+    unsigned *cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned unsubmitted_ = 0;
+};
+#endif
+
+// Threads calling pread, for kernels or sandboxes without io_uring.
+class Pool final : public Backend {
+  public:
+    explicit Pool(size_t threads) {
+        for (size_t i = 0; i < threads; i++) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~Pool() override {
+        requests_.close();
+        threads_.clear();
+    }
+
+    void submit(Request *request) override { requests_.push(request); }
+
+    void wait(std::vector<Completion> &completions) override {
+        if (auto completion = completions_.pop()) {
+            completions.push_back(completion.value());
+        }
+        while (auto completion = completions_.tryPop()) {
+            completions.push_back(completion.value());
+        }
+    }
+
+  private:
+    void run() {
+        while (auto request = requests_.pop()) {
+            Request *r = request.value();
+            ssize_t count = pread(r->fd, r->vector.iov_base, r->vector.iov_len,
+                                  r->offset);
+            completions_.push(Completion{r, count < 0 ? -errno : (int)count});
+        }
+    }
+
+    // No more than Depth reads are ever in flight, so neither blocks.
+    Queue<Request *> requests_{Depth};
+    Queue<Completion> completions_{Depth};
+    std::vector<std::jthread> threads_;
+};
+
+} // namespace
+
+struct Reader::State {
+    std::vector<std::string> paths;
+    size_t ahead;
+    size_t budget;
+    std::unique_ptr<Backend> backend;
+    bool ioUring = false;
+
+    std::mutex mutex;
+    // Signalled when a file is ready, returned or when stopping.
+    std::condition_variable changed;
+    std::deque<Loaded> ready;
+    // Files opened and not yet returned by next(), and their sizes.
+    size_t held = 0;
+    size_t heldBytes = 0;
+    size_t returned = 0;
+    size_t next = 0;
+    bool stopping = false;
+    std::thread thread;
+
+    [[nodiscard]] bool canOpen() const noexcept {
+        return next < paths.size() && held < ahead &&
+               (held == 0 || heldBytes < budget);
+    }
+
+    void finish(std::unique_ptr<File> file) {
+        std::lock_guard lock(mutex);
+        if (!file->error.empty()) {
+            heldBytes -= file->data.size();
+            file->data = {};
+        }
+        ready.push_back(Loaded{file->index, std::move(file->data),
+                               std::move(file->error)});
+        changed.notify_all();
+    }
+
+    void load() {
+        std::vector<std::unique_ptr<File>> files;
+        std::deque<Request *> queued;
+        std::vector<Completion> completions;
+        unsigned inFlight = 0;
+        auto release = [&](File *file) {
+            auto it = std::find_if(files.begin(), files.end(),
+                                   [&](const auto &f) {
+                                       return f.get() == file;
+                                   });
+            std::unique_ptr<File> owned = std::move(*it);
+            files.erase(it);
+            finish(std::move(owned));
+        };
+        try {
+            for (;;) {
+                while (inFlight < Depth && !queued.empty()) {
+                    backend->submit(queued.front());
+                    queued.pop_front();
+                    inFlight++;
+                }
+                std::optional<size_t> opening;
+                {
+                    std::unique_lock lock(mutex);
+                    changed.wait(lock, [&] {
+                        return stopping || inFlight > 0 || canOpen() ||
+                               next == paths.size();
+                    });
+                    if (stopping) {
+                        break;
+                    }
+                    if (canOpen()) {
+                        opening = next++;
+                        held++;
+                    } else if (inFlight == 0) {
+                        break;
+                    }
+                }
+                if (opening.has_value()) {
+                    files.push_back(open(opening.value()));
+                    File *file = files.back().get();
+                    for (Request &chunk : file->chunks) {
+                        queued.push_back(&chunk);
+                    }
+                    if (file->remaining == 0) {
+                        release(file);
+                    }
+                    continue;
+                }
+
+                completions.clear();
+                backend->wait(completions);
+                for (auto [request, result] : completions) {
+                    inFlight--;
+                    File *file = request->file;
+                    if (result == -EINTR || result == -EAGAIN) {
+                        queued.push_front(request);
+                        continue;
+                    }
+                    if (result <= 0) {
+                        file->error = "Unable to read file";
+                    } else if ((size_t)result < request->length) {
+                        // Short reads continue where they stopped.
+                        request->offset += result;
+                        request->length -= result;
+                        request->vector.iov_base =
+                            static_cast<uint8_t *>(request->vector.iov_base) +
+                            result;
+                        request->vector.iov_len = request->length;
+                        queued.push_front(request);
+                        continue;
+                    }
+                    if (--file->remaining == 0) {
+                        release(file);
+                    }
+                }
+            }
+        } catch (const std::exception &e) {
+            // Reads may still be in flight: their buffers are left alone.
+            std::lock_guard lock(mutex);
+            for (; next < paths.size(); next++) {
+                ready.push_back(Loaded{next, {}, e.what()});
+                held++;
+            }
+            for (const auto &file : files) {
+                ready.push_back(Loaded{file->index, {}, e.what()});
+            }
+            changed.notify_all();
+            for (auto &file : files) {
+                file.release();
+            }
+            return;
+        }
+        // Stopping: the buffers of the reads in flight must outlive them.
+        while (inFlight > 0) {
+            completions.clear();
+            backend->wait(completions);
+            inFlight -= completions.size();
+        }
+    }
+
+    [[nodiscard]] std::unique_ptr<File> open(size_t index) {
+        auto file = std::make_unique<File>();
+        file->index = index;
+        file->fd = ::open(paths[index].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat status;
+        if (file->fd < 0 || fstat(file->fd, &status) != 0) {
+            file->error = "Unable to read file";
+            return file;
+        }
+        file->data.resize(status.st_size);
+        {
+            std::lock_guard lock(mutex);
+            heldBytes += file->data.size();
+        }
+        for (size_t offset = 0; offset < file->data.size();
+             offset += ChunkSize) {
+            size_t length = std::min(ChunkSize, file->data.size() - offset);
+            file->chunks.push_back(
+                Request{file.get(), file->fd, offset, length,
+                        iovec{file->data.data() + offset, length}});
+        }
+        file->remaining = file->chunks.size();
+        return file;
+    }
+};
+
+Reader::Reader(std::vector<std::string> paths, size_t ahead, size_t budget)
+    : state_(std::make_unique<State>()) {
+    state_->paths = std::move(paths);
+    state_->ahead = std::max<size_t>(ahead, 1);
+    state_->budget = budget;
+#ifdef DISASMER_HAVE_IO_URING
+    state_->backend = Ring::create(Depth);
+    state_->ioUring = state_->backend != nullptr;
+#endif
+    if (state_->backend == nullptr) {
+        state_->backend = std::make_unique<Pool>(
+            std::clamp<size_t>(parallel::defaultJobCount(), 2, 8));
+    }
+    state_->thread = std::thread([state = state_.get()] { state->load(); });
+}
+
+Reader::~Reader() {
+    {
+        std::lock_guard lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->changed.notify_all();
+    state_->thread.join();
+}
+
+std::optional<Loaded> Reader::next() {
+    std::unique_lock lock(state_->mutex);
+    state_->changed.wait(lock, [&] {
+        return !state_->ready.empty() ||
+               state_->returned == state_->paths.size();
+    });
+    if (state_->ready.empty()) {
+        return std::nullopt;
+    }
+    Loaded loaded = std::move(state_->ready.front());
+    state_->ready.pop_front();
+    state_->returned++;
+    state_->held--;
+    state_->heldBytes -= loaded.data.size();
+    state_->changed.notify_all();
+    return loaded;
+}
+
+bool Reader::usesIoUring() const noexcept { return state_->ioUring; }
+
+std::vector<uint8_t> readFile(std::string_view filepath) {
+    Reader reader({std::string(filepath)}, 1);
+    Loaded loaded = reader.next().value();
+    if (!loaded.error.empty()) {
+        throw std::runtime_error(loaded.error);
+    }
+    return std::move(loaded.data);
+}
+
+} // namespace io
@@ -0,0 +1,985 @@
+#include <ir.hpp>
+
+#include <format>
+#include <parallel.hpp>
+
+namespace ir {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+using disassemble::X86_64::Operand;
+using disassemble::X86_64::OperandKind;
+using disassemble::X86_64::Register;
+
+namespace {
+
+[[nodiscard]] uint64_t mask(size_t size) noexcept {
+    return size >= 8 ? ~0ull : (1ull << (8 * size)) - 1;
+}
+
+[[nodiscard]] int64_t signExtend(uint64_t value, size_t size) noexcept {
+    if (size >= 8) {
+        return (int64_t)value;
+    }
+    size_t shift = 64 - 8 * size;
+    return (int64_t)(value << shift) >> shift;
+}
+
+// How many of a, b and c hold values.
+[[nodiscard]] size_t valueOperands(Opcode opcode) noexcept {
+    switch (opcode) {
+    case Opcode::Flags:
+    case Opcode::Select:
+        return 3;
+    case Opcode::Store:
+    case Opcode::Branch:
+    case Opcode::Add:
+    case Opcode::Sub:
+    case Opcode::Mul:
+    case Opcode::And:
+    case Opcode::Or:
+    case Opcode::Xor:
+    case Opcode::Shl:
+    case Opcode::Shr:
+    case Opcode::Sar:
+    case Opcode::Rol:
+    case Opcode::Ror:
+        return 2;
+    case Opcode::Put:
+    case Opcode::Load:
+    case Opcode::Not:
+    case Opcode::Trunc:
+    case Opcode::Zext:
+    case Opcode::Sext:
+    case Opcode::Jump:
+    case Opcode::Call:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Ops without side effects, removed when nothing uses them.
+[[nodiscard]] bool isPure(Opcode opcode) noexcept {
+    switch (opcode) {
+    case Opcode::Put:
+    case Opcode::Store:
+    case Opcode::Flags:
+    case Opcode::Jump:
+    case Opcode::Branch:
+    case Opcode::Call:
+    case Opcode::Return:
+    case Opcode::Intrinsic:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Flags tested by each condition code.
+constexpr std::array<uint8_t, 16> conditionFlags = {
+    Flag::OF,           Flag::OF,           Flag::CF,
+    Flag::CF,           Flag::ZF,           Flag::ZF,
+    Flag::CF | Flag::ZF, Flag::CF | Flag::ZF, Flag::SF,
+    Flag::SF,           Flag::PF,           Flag::PF,
+    Flag::SF | Flag::OF, Flag::SF | Flag::OF, Flag::ZF | Flag::SF | Flag::OF,
+    Flag::ZF | Flag::SF | Flag::OF,
+};
+
+[[nodiscard]] uint8_t conditionCode(Mnemonic mnemonic, Mnemonic first) {
+    return (uint16_t)mnemonic - (uint16_t)first;
+}
+
+[[nodiscard]] bool isIn(Mnemonic mnemonic, Mnemonic first) noexcept {
+    return mnemonic >= first &&
+           (uint16_t)mnemonic < (uint16_t)first + 16;
+}
+
+} // namespace
+
+const std::vector<Op> &Function::getOps() const noexcept { return ops_; }
+
+size_t Function::getInstructionCount() const noexcept {
+    return instructionOffsets_.empty() ? 0 : instructionOffsets_.size() - 1;
+}
+
+size_t Function::firstOp(size_t instruction) const noexcept {
+    return instructionOffsets_[instruction];
+}
+
+std::span<const Op> Function::ops(size_t instruction) const noexcept {
+    return std::span(ops_).subspan(instructionOffsets_[instruction],
+                                   instructionOffsets_[instruction + 1] -
+                                       instructionOffsets_[instruction]);
+}
+
+void Lifter::lift(std::span<const Instruction> instructions,
+                  const cfg::Graph &graph, Function &out) {
+    out_ = &out;
+    out.ops_.clear();
+    out.instructionOffsets_.clear();
+    out.ops_.reserve(instructions.size() * 4);
+    out.instructionOffsets_.reserve(instructions.size() + 1);
+
+    for (const cfg::Block &block : graph.getBlocks()) {
+        // Nothing is known on entry to a block.
+        forget();
+        for (size_t i = block.firstInstruction;
+             i < block.firstInstruction + block.instructionCount; i++) {
+            out.instructionOffsets_.push_back(out.ops_.size());
+            ins_ = &instructions[i];
+            liftInstruction(instructions[i], i);
+        }
+    }
+    out.instructionOffsets_.push_back(out.ops_.size());
+
+    removeDeadFlags(graph, instructions);
+    removeUnused();
+    out_ = nullptr;
+    ins_ = nullptr;
+}
+
+void Lifter::forget() {
+    registers_.fill(NoValue);
+    lastFlags_ = NoValue;
+}
+
+uint32_t Lifter::emit(Op op) {
+    out_->ops_.push_back(op);
+    return out_->ops_.size() - 1;
+}
+
+uint32_t Lifter::constant(uint64_t value, size_t size) {
+    value &= mask(size);
+    return emit(Op{.opcode = Opcode::Const,
+                   .size = (uint8_t)size,
+                   .a = (uint32_t)value,
+                   .b = (uint32_t)(value >> 32)});
+}
+
+uint32_t Lifter::binary(Opcode opcode, size_t size, uint32_t left,
+                        uint32_t right) {
+    const Op &l = out_->ops_[left];
+    const Op &r = out_->ops_[right];
+    bool leftConstant = l.opcode == Opcode::Const;
+    bool rightConstant = r.opcode == Opcode::Const;
+    if (leftConstant && rightConstant) {
+        uint64_t x = l.constant();
+        uint64_t y = r.constant();
+        uint64_t count = y & (size == 8 ? 0x3f : 0x1f);
+        uint64_t value = 0;
+        switch (opcode) {
+        case Opcode::Add:
+            value = x + y;
+            break;
+        case Opcode::Sub:
+            value = x - y;
+            break;
+        case Opcode::Mul:
+            value = x * y;
+            break;
+        case Opcode::And:
+            value = x & y;
+            break;
+        case Opcode::Or:
+            value = x | y;
+            break;
+        case Opcode::Xor:
+            value = x ^ y;
+            break;
+        case Opcode::Shl:
+            value = x << count;
+            break;
+        case Opcode::Shr:
+            value = (x & mask(size)) >> count;
+            break;
+        case Opcode::Sar:
+            value = signExtend(x, size) >> count;
+            break;
+        default:
+            return emit(Op{.opcode = opcode,
+                           .size = (uint8_t)size,
+                           .a = left,
+                           .b = right});
+        }
+        return constant(value, size);
+    }
+    if (rightConstant && r.constant() == 0 &&
+        (opcode == Opcode::Add || opcode == Opcode::Sub ||
+         opcode == Opcode::Or || opcode == Opcode::Xor ||
+         opcode == Opcode::Shl || opcode == Opcode::Shr ||
+         opcode == Opcode::Sar) &&
+        l.size == size) {
+        return left;
+    }
+    if (left == right && (opcode == Opcode::Xor || opcode == Opcode::Sub)) {
+        return constant(0, size);
+    }
+    return emit(
+        Op{.opcode = opcode, .size = (uint8_t)size, .a = left, .b = right});
+}
+
+uint32_t Lifter::unary(Opcode opcode, size_t size, uint32_t value) {
+    const Op &op = out_->ops_[value];
+    if (op.size == size && opcode != Opcode::Not) {
+        return value;
+    }
+    if (op.opcode == Opcode::Const) {
+        uint64_t x = op.constant();
+        switch (opcode) {
+        case Opcode::Not:
+            return constant(~x, size);
+        case Opcode::Sext:
+            return constant(signExtend(x, op.size), size);
+        default:
+            return constant(x, size);
+        }
+    }
+    return emit(Op{.opcode = opcode, .size = (uint8_t)size, .a = value});
+}
+
+uint32_t Lifter::get(Register reg, size_t size) {
+    if (reg < Register::RIP && registers_[(size_t)reg] != NoValue) {
+        return unary(Opcode::Trunc, size, registers_[(size_t)reg]);
+    }
+    return emit(
+        Op{.opcode = Opcode::Get, .size = (uint8_t)size, .aux = (uint16_t)reg});
+}
+
+void Lifter::put(Register reg, size_t size, uint32_t value) {
+    emit(Op{.opcode = Opcode::Put,
+            .size = (uint8_t)size,
+            .aux = (uint16_t)reg,
+            .a = value});
+    if (reg >= Register::AH && reg <= Register::BH) {
+        registers_[(size_t)reg - (size_t)Register::AH] = NoValue;
+        return;
+    }
+    if (reg >= Register::RIP) {
+        return;
+    }
+    uint32_t &known = registers_[(size_t)reg];
+    const Op &op = out_->ops_[value];
+    if (op.opcode != Opcode::Const) {
+        known = NoValue;
+    } else if (size >= 4) {
+        known = unary(Opcode::Zext, 8, value);
+    } else if (known != NoValue) {
+        uint64_t merged = (out_->ops_[known].constant() & ~mask(size)) |
+                          op.constant();
+        known = constant(merged, 8);
+    }
+}
+
+uint32_t Lifter::address(const Operand &operand) {
+    if (operand.base == Register::RIP) {
+        return constant(ins_->address + ins_->length + operand.value, 8);
+    }
+    uint32_t result = NoValue;
+    if (operand.base != Register::None) {
+        result = get(operand.base, 8);
+    }
+    if (operand.index != Register::None) {
+        uint32_t index = get(operand.index, 8);
+        if (operand.scale > 1) {
+            index = binary(Opcode::Mul, 8, index, constant(operand.scale, 8));
+        }
+        result = result == NoValue ? index
+                                   : binary(Opcode::Add, 8, result, index);
+    }
+    if (result == NoValue) {
+        return constant(operand.value, 8);
+    }
+    if (operand.value != 0) {
+        result =
+            binary(Opcode::Add, 8, result, constant(operand.value, 8));
+    }
+    return result;
+}
+
+uint32_t Lifter::read(const Operand &operand, size_t size) {
+    switch (operand.kind) {
+    case OperandKind::Register:
+        return get(operand.base, size);
+    case OperandKind::Memory:
+        return emit(Op{.opcode = Opcode::Load,
+                       .size = (uint8_t)size,
+                       .aux = (uint16_t)ins_->segment,
+                       .a = address(operand)});
+    case OperandKind::Immediate:
+    case OperandKind::Target:
+        return constant(operand.value, size);
+    case OperandKind::None:
+        break;
+    }
+    return constant(0, size);
+}
+
+void Lifter::write(const Operand &operand, uint32_t value) {
+    if (operand.kind == OperandKind::Register) {
+        put(operand.base, operand.size, value);
+    } else if (operand.kind == OperandKind::Memory) {
+        emit(Op{.opcode = Opcode::Store,
+                .size = operand.size,
+                .aux = (uint16_t)ins_->segment,
+                .a = address(operand),
+                .b = value});
+    }
+}
+
+void Lifter::flags(Opcode opcode, uint8_t mask, uint32_t left, uint32_t right,
+                   uint32_t result) {
+    uint32_t index = emit(Op{.opcode = Opcode::Flags,
+                             .size = out_->ops_[result].size,
+                             .aux = (uint16_t)(mask | (uint16_t)opcode << 8),
+                             .a = left,
+                             .b = right,
+                             .c = result});
+    if (!(mask & Flag::Partial)) {
+        lastFlags_ = index;
+    }
+}
+
+uint32_t Lifter::condition(uint8_t cc) {
+    uint32_t source = lastFlags_;
+    if (source != NoValue &&
+        (out_->ops_[source].aux & conditionFlags[cc]) != conditionFlags[cc]) {
+        source = NoValue;
+    }
+    return emit(
+        Op{.opcode = Opcode::Cond, .size = 1, .aux = cc, .a = source});
+}
+
+void Lifter::liftInstruction(const Instruction &ins, size_t index) {
+    auto operands = ins.getOperands();
+    size_t size = operands.empty() ? 8 : operands[0].size;
+    Mnemonic mnemonic = ins.mnemonic;
+
+    switch (mnemonic) {
+    case Mnemonic::Mov:
+        write(operands[0], read(operands[1], size));
+        return;
+    case Mnemonic::Movzx:
+        write(operands[0], unary(Opcode::Zext, size,
+                                 read(operands[1], operands[1].size)));
+        return;
+    case Mnemonic::Movsx:
+    case Mnemonic::Movsxd:
+        write(operands[0], unary(Opcode::Sext, size,
+                                 read(operands[1], operands[1].size)));
+        return;
+    case Mnemonic::Lea:
+        write(operands[0],
+              unary(Opcode::Trunc, size, address(operands[1])));
+        return;
+    case Mnemonic::Add:
+    case Mnemonic::Sub:
+    case Mnemonic::And:
+    case Mnemonic::Or:
+    case Mnemonic::Xor:
+    case Mnemonic::Cmp:
+    case Mnemonic::Test: {
+        Opcode opcode = mnemonic == Mnemonic::Add   ? Opcode::Add
+                        : mnemonic == Mnemonic::Sub ? Opcode::Sub
+                        : mnemonic == Mnemonic::Cmp ? Opcode::Sub
+                        : mnemonic == Mnemonic::Or  ? Opcode::Or
+                        : mnemonic == Mnemonic::Xor ? Opcode::Xor
+                                                    : Opcode::And;
+        uint32_t left = read(operands[0], size);
+        // `xor eax, eax` and `test rax, rax` use one value twice.
+        bool same = operands[1].kind == OperandKind::Register &&
+                    operands[0].kind == OperandKind::Register &&
+                    operands[0].base == operands[1].base;
+        uint32_t right = same ? left : read(operands[1], size);
+        uint32_t result = binary(opcode, size, left, right);
+        flags(opcode, Flag::All, left, right, result);
+        if (mnemonic != Mnemonic::Cmp && mnemonic != Mnemonic::Test) {
+            write(operands[0], result);
+        }
+        return;
+    }
+    case Mnemonic::Inc:
+    case Mnemonic::Dec: {
+        Opcode opcode = mnemonic == Mnemonic::Inc ? Opcode::Add : Opcode::Sub;
+        uint32_t left = read(operands[0], size);
+        uint32_t right = constant(1, size);
+        uint32_t result = binary(opcode, size, left, right);
+        flags(opcode, Flag::All & ~Flag::CF, left, right, result);
+        write(operands[0], result);
+        return;
+    }
+    case Mnemonic::Neg: {
+        uint32_t left = constant(0, size);
+        uint32_t right = read(operands[0], size);
+        uint32_t result = binary(Opcode::Sub, size, left, right);
+        flags(Opcode::Sub, Flag::All, left, right, result);
+        write(operands[0], result);
+        return;
+    }
+    case Mnemonic::Not:
+        write(operands[0], unary(Opcode::Not, size, read(operands[0], size)));
+        return;
+    case Mnemonic::Shl:
+    case Mnemonic::Shr:
+    case Mnemonic::Sar:
+    case Mnemonic::Rol:
+    case Mnemonic::Ror: {
+        Opcode opcode = mnemonic == Mnemonic::Shl   ? Opcode::Shl
+                        : mnemonic == Mnemonic::Shr ? Opcode::Shr
+                        : mnemonic == Mnemonic::Sar ? Opcode::Sar
+                        : mnemonic == Mnemonic::Rol ? Opcode::Rol
+                                                    : Opcode::Ror;
+        uint32_t count = binary(Opcode::And, 1, read(operands[1], 1),
+                                constant(size == 8 ? 0x3f : 0x1f, 1));
+        const Op &countOp = out_->ops_[count];
+        bool known = countOp.opcode == Opcode::Const;
+        if (known && countOp.constant() == 0) {
+            return;
+        }
+        uint32_t left = read(operands[0], size);
+        uint32_t right = unary(Opcode::Zext, size, count);
+        uint32_t result = binary(opcode, size, left, right);
+        uint8_t written = opcode == Opcode::Rol || opcode == Opcode::Ror
+                              ? Flag::CF | Flag::OF
+                              : Flag::All;
+        flags(opcode, written | (known ? 0 : Flag::Partial), left, right,
+              result);
+        write(operands[0], result);
+        return;
+    }
+    case Mnemonic::Imul:
+        if (operands.size() < 2) {
+            break;
+        }
+        {
+            uint32_t left = read(operands[operands.size() - 2], size);
+            uint32_t right = read(operands.back(), size);
+            uint32_t result = binary(Opcode::Mul, size, left, right);
+            flags(Opcode::Mul, Flag::All, left, right, result);
+            write(operands[0], result);
+        }
+        return;
+    case Mnemonic::Xchg: {
+        uint32_t first = read(operands[0], size);
+        uint32_t second = read(operands[1], size);
+        write(operands[0], second);
+        write(operands[1], first);
+        return;
+    }
+    case Mnemonic::Push: {
+        // Immediates are pushed sign extended to the stack slot size.
+        if (operands[0].kind == OperandKind::Immediate) {
+            size = 8;
+        }
+        uint32_t value = read(operands[0], size);
+        uint32_t sp = binary(Opcode::Sub, 8, get(Register::RSP, 8),
+                             constant(size, 8));
+        emit(Op{.opcode = Opcode::Store,
+                .size = (uint8_t)size,
+                .a = sp,
+                .b = value});
+        put(Register::RSP, 8, sp);
+        return;
+    }
+    case Mnemonic::Pop: {
+        uint32_t sp = get(Register::RSP, 8);
+        uint32_t value =
+            emit(Op{.opcode = Opcode::Load, .size = (uint8_t)size, .a = sp});
+        write(operands[0], value);
+        put(Register::RSP, 8, binary(Opcode::Add, 8, sp, constant(size, 8)));
+        return;
+    }
+    case Mnemonic::Leave: {
+        uint32_t frame = get(Register::RBP, 8);
+        put(Register::RSP, 8, binary(Opcode::Add, 8, frame, constant(8, 8)));
+        put(Register::RBP, 8,
+            emit(Op{.opcode = Opcode::Load, .size = 8, .a = frame}));
+        return;
+    }
+    case Mnemonic::Cbw:
+    case Mnemonic::Cwde:
+    case Mnemonic::Cdqe: {
+        size_t to = mnemonic == Mnemonic::Cbw    ? 2
+                    : mnemonic == Mnemonic::Cwde ? 4
+                                                 : 8;
+        put(Register::RAX, to,
+            unary(Opcode::Sext, to, get(Register::RAX, to / 2)));
+        return;
+    }
+    case Mnemonic::Cwd:
+    case Mnemonic::Cdq:
+    case Mnemonic::Cqo: {
+        size_t to = mnemonic == Mnemonic::Cwd   ? 2
+                    : mnemonic == Mnemonic::Cdq ? 4
+                                                : 8;
+        put(Register::RDX, to,
+            binary(Opcode::Sar, to, get(Register::RAX, to),
+                   constant(to * 8 - 1, to)));
+        return;
+    }
+    case Mnemonic::Call:
+        emit(Op{.opcode = Opcode::Call, .size = 8, .a = read(operands[0], 8)});
+        // Caller saved registers and the flags are clobbered.
+        forget();
+        return;
+    case Mnemonic::Jmp:
+        emit(Op{.opcode = Opcode::Jump, .size = 8, .a = read(operands[0], 8)});
+        return;
+    case Mnemonic::Ret:
+        emit(Op{.opcode = Opcode::Return});
+        return;
+    case Mnemonic::Nop:
+    case Mnemonic::Pause:
+    case Mnemonic::Endbr64:
+        return;
+    default:
+        break;
+    }
+
+    if (isIn(mnemonic, Mnemonic::Jo)) {
+        uint32_t cond = condition(conditionCode(mnemonic, Mnemonic::Jo));
+        emit(Op{.opcode = Opcode::Branch,
+                .size = 8,
+                .a = cond,
+                .b = read(operands[0], 8)});
+        return;
+    }
+    if (isIn(mnemonic, Mnemonic::Seto)) {
+        write(operands[0], condition(conditionCode(mnemonic, Mnemonic::Seto)));
+        return;
+    }
+    if (isIn(mnemonic, Mnemonic::Cmovo)) {
+        uint32_t cond = condition(conditionCode(mnemonic, Mnemonic::Cmovo));
+        uint32_t value = emit(Op{.opcode = Opcode::Select,
+                                 .size = (uint8_t)size,
+                                 .a = cond,
+                                 .b = read(operands[1], size),
+                                 .c = read(operands[0], size)});
+        write(operands[0], value);
+        return;
+    }
+
+    emit(Op{.opcode = Opcode::Intrinsic,
+            .aux = (uint16_t)mnemonic,
+            .a = (uint32_t)index});
+    forget();
+}
+
+// Flags written and overwritten (or clobbered by a call) within a block
+// before anything tests them are dropped. Flags still live at the end of a
+// block with successors are kept.
+void Lifter::removeDeadFlags(const cfg::Graph &graph,
+                             std::span<const Instruction> instructions) {
+    std::vector<Op> &ops = out_->ops_;
+    const auto &offsets = out_->instructionOffsets_;
+    const auto &blocks = graph.getBlocks();
+    // Instructions were lifted block by block, so ops of block b follow
+    // those of block b - 1.
+    size_t instruction = 0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+        size_t first = offsets[instruction];
+        instruction += blocks[b].instructionCount;
+        size_t end = offsets[instruction];
+        uint8_t live = graph.successors(b).empty() &&
+                               instructions[instruction - 1].mnemonic ==
+                                   Mnemonic::Ret
+                           ? 0
+                           : Flag::All;
+        for (size_t i = end; i-- > first;) {
+            Op &op = ops[i];
+            switch (op.opcode) {
+            case Opcode::Cond:
+                live |= conditionFlags[op.aux];
+                break;
+            case Opcode::Intrinsic:
+                live = Flag::All;
+                break;
+            case Opcode::Call:
+            case Opcode::Return:
+                live = 0;
+                break;
+            case Opcode::Flags: {
+                uint8_t written = op.aux & Flag::All;
+                if (!(written & live)) {
+                    op.opcode = Opcode::Nop;
+                } else if (!(op.aux & Flag::Partial)) {
+                    live &= ~written;
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+}
+
+// Drops pure ops nothing uses and compacts the op array.
+void Lifter::removeUnused() {
+    std::vector<Op> &ops = out_->ops_;
+    uses_.assign(ops.size(), 0);
+    for (const Op &op : ops) {
+        if (op.opcode == Opcode::Nop) {
+            continue;
+        }
+        const std::array<uint32_t, 3> values = {op.a, op.b, op.c};
+        for (size_t v = 0; v < valueOperands(op.opcode); v++) {
+            uses_[values[v]]++;
+        }
+    }
+    for (size_t i = ops.size(); i-- > 0;) {
+        Op &op = ops[i];
+        if (op.opcode == Opcode::Nop ||
+            (isPure(op.opcode) && uses_[i] == 0)) {
+            if (op.opcode != Opcode::Nop) {
+                const std::array<uint32_t, 3> values = {op.a, op.b, op.c};
+                for (size_t v = 0; v < valueOperands(op.opcode); v++) {
+                    uses_[values[v]]--;
+                }
+            }
+            op.opcode = Opcode::Nop;
+        }
+    }
+
+    // uses_ becomes the old -> new index map.
+    std::vector<uint32_t> &remap = uses_;
+    auto &offsets = out_->instructionOffsets_;
+    size_t kept = 0;
+    size_t instruction = 0;
+    for (size_t i = 0; i < ops.size(); i++) {
+        while (instruction < offsets.size() && offsets[instruction] == i) {
+            offsets[instruction++] = kept;
+        }
+        if (ops[i].opcode == Opcode::Nop) {
+            remap[i] = NoValue;
+            continue;
+        }
+        remap[i] = kept;
+        Op op = ops[i];
+        uint32_t *values[] = {&op.a, &op.b, &op.c};
+        for (size_t v = 0; v < valueOperands(op.opcode); v++) {
+            *values[v] = remap[*values[v]];
+        }
+        if (op.opcode == Opcode::Cond && op.a != NoValue) {
+            op.a = remap[op.a];
+        }
+        ops[kept++] = op;
+    }
+    while (instruction < offsets.size()) {
+        offsets[instruction++] = kept;
+    }
+    ops.resize(kept);
+}
+
+namespace {
+
+class Printer {
+  public:
+    Printer(std::string &out, const Function &function,
+            const disassemble::X86_64::SymbolResolver &resolver)
+        : out_(out), ops_(function.getOps()), resolver_(resolver) {}
+
+    void statement(uint32_t index) {
+        const Op &op = ops_[index];
+        switch (op.opcode) {
+        case Opcode::Put: {
+            auto name = registerName(op);
+            out_ += '\t';
+            out_ += name;
+            const Op &value = ops_[op.a];
+            const Op *left =
+                valueOperands(value.opcode) == 2 ? &ops_[value.a] : nullptr;
+            if (left != nullptr && left->opcode == Opcode::Get &&
+                left->aux == op.aux && left->size == op.size &&
+                value.size == op.size) {
+                out_ += std::format(" {}= ", symbol(value.opcode));
+                expression(value.b, false);
+            } else {
+                out_ += " = ";
+                expression(op.a, true);
+            }
+            break;
+        }
+        case Opcode::Store:
+            out_ += '\t';
+            memory(op);
+            out_ += " = ";
+            expression(op.b, true);
+            break;
+        case Opcode::Flags:
+            out_ += std::format("\tflags {} ", (op.aux & Flag::Partial)
+                                                   ? "<-?"
+                                                   : "<-");
+            out_ += opcodeName(Opcode(op.aux >> 8));
+            out_ += '(';
+            expression(op.a, true);
+            out_ += ", ";
+            expression(op.b, true);
+            out_ += ')';
+            break;
+        case Opcode::Jump:
+            out_ += "\tgoto ";
+            target(op.a);
+            break;
+        case Opcode::Branch:
+            out_ += "\tif ";
+            expression(op.a, false);
+            out_ += " goto ";
+            target(op.b);
+            break;
+        case Opcode::Call:
+            out_ += "\tcall ";
+            target(op.a);
+            break;
+        case Opcode::Return:
+            out_ += "\treturn";
+            break;
+        case Opcode::Intrinsic:
+            out_ += "\tasm ";
+            out_ += disassemble::X86_64::mnemonicName(Mnemonic(op.aux));
+            break;
+        default:
+            return;
+        }
+        out_ += '\n';
+    }
+
+  private:
+    [[nodiscard]] static std::string_view registerName(const Op &op) {
+        return disassemble::X86_64::registerName(Register(op.aux), op.size);
+    }
+
+    [[nodiscard]] static std::string_view symbol(Opcode opcode) {
+        switch (opcode) {
+        case Opcode::Add:
+            return "+";
+        case Opcode::Sub:
+            return "-";
+        case Opcode::Mul:
+            return "*";
+        case Opcode::And:
+            return "&";
+        case Opcode::Or:
+            return "|";
+        case Opcode::Xor:
+            return "^";
+        case Opcode::Shl:
+            return "<<";
+        case Opcode::Shr:
+            return ">>";
+        case Opcode::Sar:
+            return ">>s";
+        case Opcode::Rol:
+            return "rol";
+        case Opcode::Ror:
+            return "ror";
+        default:
+            return "?";
+        }
+    }
+
+    [[nodiscard]] static std::string_view opcodeName(Opcode opcode) {
+        switch (opcode) {
+        case Opcode::Add:
+            return "add";
+        case Opcode::Sub:
+            return "sub";
+        case Opcode::Mul:
+            return "mul";
+        case Opcode::And:
+            return "and";
+        case Opcode::Or:
+            return "or";
+        case Opcode::Xor:
+            return "xor";
+        case Opcode::Shl:
+            return "shl";
+        case Opcode::Shr:
+            return "shr";
+        case Opcode::Sar:
+            return "sar";
+        case Opcode::Rol:
+            return "rol";
+        case Opcode::Ror:
+            return "ror";
+        default:
+            return "?";
+        }
+    }
+
+    void hex(uint64_t value) { out_ += std::format("0x{:x}", value); }
+
+    void target(uint32_t index) {
+        const Op &op = ops_[index];
+        if (op.opcode == Opcode::Const) {
+            hex(op.constant());
+            name(op.constant());
+        } else {
+            expression(index, true);
+        }
+    }
+
+    void name(uint64_t address) {
+        if (!resolver_) {
+            return;
+        }
+        std::string_view symbol = resolver_(address);
+        if (!symbol.empty()) {
+            out_ += " <";
+            out_ += symbol;
+            out_ += '>';
+        }
+    }
+
+    void memory(const Op &op) {
+        out_ += std::format("u{}[", op.size * 8);
+        auto segment = disassemble::X86_64::Segment(op.aux);
+        if (segment == disassemble::X86_64::Segment::FS) {
+            out_ += "fs:";
+        } else if (segment == disassemble::X86_64::Segment::GS) {
+            out_ += "gs:";
+        }
+        expression(op.a, true);
+        const Op &address = ops_[op.a];
+        if (address.opcode == Opcode::Const) {
+            name(address.constant());
+        }
+        out_ += ']';
+    }
+
+    void condition(const Op &op) {
+        static constexpr std::array<std::string_view, 16> compare = {
+            "", "", "<u", ">=u", "==", "!=", "<=u", ">u",
+            "", "", "",   "",    "<s", ">=s", "<=s", ">s",
+        };
+        std::string_view cc =
+            disassemble::X86_64::mnemonicName(
+                Mnemonic((uint16_t)Mnemonic::Jo + op.aux))
+                .substr(1);
+        if (op.a == NoValue) {
+            out_ += cc;
+            return;
+        }
+        const Op &source = ops_[op.a];
+        Opcode kind = Opcode(source.aux >> 8);
+        if (kind == Opcode::Sub && !compare[op.aux].empty()) {
+            out_ += '(';
+            expression(source.a, false);
+            out_ += std::format(" {} ", compare[op.aux]);
+            expression(source.b, false);
+            out_ += ')';
+        } else if (kind == Opcode::And && (op.aux == 4 || op.aux == 5)) {
+            out_ += '(';
+            if (source.a == source.b) {
+                expression(source.a, false);
+            } else {
+                expression(source.c, false);
+            }
+            out_ += op.aux == 4 ? " == 0)" : " != 0)";
+        } else {
+            out_ += cc;
+        }
+    }
+
+    void expression(uint32_t index, bool top) {
+        const Op &op = ops_[index];
+        switch (op.opcode) {
+        case Opcode::Const:
+            hex(op.constant());
+            return;
+        case Opcode::Get:
+            out_ += registerName(op);
+            return;
+        case Opcode::Load:
+            memory(op);
+            return;
+        case Opcode::Not:
+            out_ += '~';
+            expression(op.a, false);
+            return;
+        case Opcode::Trunc:
+        case Opcode::Zext:
+        case Opcode::Sext:
+            out_ += op.opcode == Opcode::Trunc  ? "trunc"
+                    : op.opcode == Opcode::Zext ? "zext"
+                                                : "sext";
+            out_ += std::format("{}(", op.size * 8);
+            expression(op.a, true);
+            out_ += ')';
+            return;
+        case Opcode::Cond:
+            condition(op);
+            return;
+        case Opcode::Select:
+            out_ += top ? "" : "(";
+            expression(op.a, false);
+            out_ += " ? ";
+            expression(op.b, false);
+            out_ += " : ";
+            expression(op.c, false);
+            out_ += top ? "" : ")";
+            return;
+        default:
+            break;
+        }
+        if (valueOperands(op.opcode) != 2) {
+            out_ += '?';
+            return;
+        }
+        out_ += top ? "" : "(";
+        expression(op.a, false);
+        const Op &right = ops_[op.b];
+        // Negative displacements read better as subtractions.
+        if (op.opcode == Opcode::Add && right.opcode == Opcode::Const &&
+            signExtend(right.constant(), right.size) < 0) {
+            out_ += " - ";
+            hex(-(uint64_t)signExtend(right.constant(), right.size));
+        } else {
+            out_ += std::format(" {} ", symbol(op.opcode));
+            expression(op.b, false);
+        }
+        out_ += top ? "" : ")";
+    }
+
+    std::string &out_;
+    const std::vector<Op> &ops_;
+    const disassemble::X86_64::SymbolResolver &resolver_;
+};
+
+} // namespace
+
+void formatInstruction(std::string &out, const Function &function,
+                       size_t instruction,
+                       const disassemble::X86_64::SymbolResolver &resolver) {
+    Printer printer(out, function, resolver);
+    size_t first = function.firstOp(instruction);
+    size_t count = function.ops(instruction).size();
+    for (size_t i = first; i < first + count; i++) {
+        printer.statement(i);
+    }
+}
+
+void liftAll(const binary::Elf64 &elf, size_t jobs,
+             const std::function<void(size_t, const cfg::Graph &,
+                                      const Function &)> &callback) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    struct Worker {
+        std::vector<Instruction> instructions;
+        std::vector<jumptable::Table> tables;
+        cfg::Graph graph;
+        Lifter lifter;
+        Function function;
+    };
+    std::vector<Worker> workers(jobs);
+    parallel::forEach(elf.getFunctions().size(), jobs,
+                      [&](size_t fn, size_t id) {
+        Worker &worker = workers[id];
+        jumptable::decode(elf, fn, worker.instructions, worker.tables);
+        worker.graph.assign(worker.instructions, worker.tables);
+        worker.lifter.lift(worker.instructions, worker.graph,
+                           worker.function);
+        callback(fn, worker.graph, worker.function);
+    });
+}
+
+} // namespace ir
@@ -0,0 +1,383 @@
+#include <jumptable.hpp>
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace jumptable {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+using disassemble::X86_64::Operand;
+using disassemble::X86_64::OperandKind;
+using disassemble::X86_64::Register;
+using disassemble::X86_64::Segment;
+
+namespace {
+
+// How far before a jump its table load and bounds check are looked for.
+constexpr size_t Window = 24;
+// Past this, a bounds check is not believed and an unbounded table stops.
+constexpr uint64_t MaxEntries = 1024;
+
+bool isGeneral(const Operand &operand, Register reg) noexcept {
+    return operand.kind == OperandKind::Register && operand.base == reg &&
+           operand.size <= 8;
+}
+
+bool writesFirstOperand(Mnemonic mnemonic) noexcept {
+    return mnemonic != Mnemonic::Cmp && mnemonic != Mnemonic::Test &&
+           mnemonic != Mnemonic::Push;
+}
+
+// The last instruction before `from` writing `reg`, looking no further back
+// than the straight line of code leading to `from`.
+std::optional<size_t> lastWrite(std::span<const Instruction> instructions,
+                                size_t from, Register reg) noexcept {
+    for (size_t i = from; i-- > 0 && from - i <= Window;) {
+        const Instruction &ins = instructions[i];
+        if (ins.mnemonic == Mnemonic::Jmp || ins.mnemonic == Mnemonic::Ret ||
+            ins.mnemonic == Mnemonic::Call) {
+            return std::nullopt;
+        }
+        if (ins.operandCount != 0 && isGeneral(ins.operands[0], reg) &&
+            writesFirstOperand(ins.mnemonic)) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+// The address held by `reg` at `from`, when it was set by a RIP-relative
+// lea or a move of an immediate.
+std::optional<uint64_t> addressIn(std::span<const Instruction> instructions,
+                                  size_t from, Register reg) noexcept {
+    auto at = lastWrite(instructions, from, reg);
+    if (!at.has_value()) {
+        return std::nullopt;
+    }
+    const Instruction &ins = instructions[at.value()];
+    if (ins.mnemonic == Mnemonic::Lea) {
+        return ins.ripTarget();
+    }
+    if (ins.mnemonic == Mnemonic::Mov &&
+        ins.operands[1].kind == OperandKind::Immediate) {
+        return (uint64_t)ins.operands[1].value;
+    }
+    return std::nullopt;
+}
+
+// Where `memory`, an indexed operand of instruction `at`, points when the
+// index is zero.
+std::optional<uint64_t> tableAddress(std::span<const Instruction> instructions,
+                                     size_t at, const Operand &memory) {
+    const Instruction &ins = instructions[at];
+    if (memory.index == Register::None || ins.segment == Segment::FS ||
+        ins.segment == Segment::GS) {
+        return std::nullopt;
+    }
+    if (memory.base == Register::None) {
+        return (uint64_t)memory.value;
+    }
+    auto base = addressIn(instructions, at, memory.base);
+    if (!base.has_value()) {
+        return std::nullopt;
+    }
+    return base.value() + memory.value;
+}
+
+// The instruction reading an entry of the table and the operand it reads.
+struct Load {
+    size_t at;
+    Operand memory;
+    uint64_t address;
+    uint8_t entrySize;
+    bool relative;
+};
+
+bool isEntry(const Operand &memory, uint8_t size) noexcept {
+    return memory.kind == OperandKind::Memory && memory.size == size &&
+           memory.scale == size;
+}
+
+std::optional<Load> findLoad(std::span<const Instruction> instructions,
+                             size_t jump) {
+    const Operand &operand = instructions[jump].operands[0];
+    if (operand.kind == OperandKind::Memory) {
+        if (!isEntry(operand, 8)) {
+            return std::nullopt;
+        }
+        auto address = tableAddress(instructions, jump, operand);
+        if (!address.has_value()) {
+            return std::nullopt;
+        }
+        return Load{jump, operand, address.value(), 8, false};
+    }
+    if (operand.kind != OperandKind::Register) {
+        return std::nullopt;
+    }
+    auto at = lastWrite(instructions, jump, operand.base);
+    if (!at.has_value()) {
+        return std::nullopt;
+    }
+    const Instruction &def = instructions[at.value()];
+    if (def.mnemonic == Mnemonic::Mov && isEntry(def.operands[1], 8)) {
+        auto address = tableAddress(instructions, at.value(), def.operands[1]);
+        if (!address.has_value()) {
+            return std::nullopt;
+        }
+        return Load{at.value(), def.operands[1], address.value(), 8, false};
+    }
+    if (def.mnemonic != Mnemonic::Add ||
+        def.operands[1].kind != OperandKind::Register) {
+        return std::nullopt;
+    }
+    // One side of the add holds the table address, the other an entry read
+    // relative to it; compilers emit both orders.
+    std::array<Register, 2> sides = {def.operands[0].base,
+                                     def.operands[1].base};
+    for (size_t side = 0; side < 2; side++) {
+        auto base = addressIn(instructions, at.value(), sides[side]);
+        auto read = lastWrite(instructions, at.value(), sides[1 - side]);
+        if (!base.has_value() || !read.has_value()) {
+            continue;
+        }
+        const Instruction &entry = instructions[read.value()];
+        if (entry.mnemonic != Mnemonic::Movsxd ||
+            !isEntry(entry.operands[1], 4)) {
+            continue;
+        }
+        auto address =
+            tableAddress(instructions, read.value(), entry.operands[1]);
+        if (address == base) {
+            return Load{read.value(), entry.operands[1], base.value(), 4,
+                        true};
+        }
+    }
+    return std::nullopt;
+}
+
+bool isMove(Mnemonic mnemonic) noexcept {
+    return mnemonic == Mnemonic::Mov || mnemonic == Mnemonic::Movzx ||
+           mnemonic == Mnemonic::Movsxd || mnemonic == Mnemonic::Lea;
+}
+
+bool isCopyOf(const Instruction &ins, const Operand &source) noexcept {
+    const Operand &operand = ins.operands[1];
+    return ins.mnemonic != Mnemonic::Lea && isMove(ins.mnemonic) &&
+           operand.kind == source.kind && operand.base == source.base &&
+           operand.index == source.index && operand.scale == source.scale &&
+           operand.value == source.value;
+}
+
+// The entry count allowed by the `and index, imm` mask and the
+// `cmp index, imm` / `ja` (or jae, jb, jbe) guarding `load`, whichever is
+// tighter. The index is either the compared register or a copy of what was
+// compared.
+std::optional<uint64_t> entryCount(std::span<const Instruction> instructions,
+                                   const Load &load) noexcept {
+    auto write = lastWrite(instructions, load.at, load.memory.index);
+    std::optional<uint64_t> masked;
+    if (write.has_value()) {
+        const Instruction &mask = instructions[write.value()];
+        if (mask.mnemonic == Mnemonic::And &&
+            mask.operands[1].kind == OperandKind::Immediate &&
+            (uint64_t)mask.operands[1].value < MaxEntries) {
+            masked = mask.operands[1].value + 1;
+        }
+    }
+    for (size_t i = load.at; i-- > 1 && load.at - i <= Window;) {
+        const Instruction &ins = instructions[i];
+        if (ins.mnemonic == Mnemonic::Jmp || ins.mnemonic == Mnemonic::Ret) {
+            return masked;
+        }
+        uint64_t inclusive;
+        if (ins.mnemonic == Mnemonic::Ja || ins.mnemonic == Mnemonic::Jbe) {
+            inclusive = 1;
+        } else if (ins.mnemonic == Mnemonic::Jae ||
+                   ins.mnemonic == Mnemonic::Jb) {
+            inclusive = 0;
+        } else {
+            continue;
+        }
+        // Compilers schedule moves, which leave the flags alone, in between.
+        size_t at = i - 1;
+        while (at > 0 && isMove(instructions[at].mnemonic)) {
+            at--;
+        }
+        const Instruction &cmp = instructions[at];
+        const Operand &checked = cmp.operands[0];
+        if (cmp.mnemonic != Mnemonic::Cmp ||
+            cmp.operands[1].kind != OperandKind::Immediate ||
+            (checked.kind != OperandKind::Register &&
+             checked.kind != OperandKind::Memory)) {
+            return masked;
+        }
+        bool copied = write.has_value() &&
+                      isCopyOf(instructions[write.value()], checked);
+        bool compared = isGeneral(checked, load.memory.index) &&
+                        !(write.has_value() && write.value() > at);
+        if (!copied && !compared) {
+            return masked;
+        }
+        // The comparison is unsigned at the width of the operand.
+        uint64_t limit = cmp.operands[1].value;
+        if (checked.size < 8) {
+            limit &= (uint64_t(1) << checked.size * 8) - 1;
+        }
+        if (limit >= MaxEntries) {
+            return masked;
+        }
+        return std::min(limit + inclusive, masked.value_or(MaxEntries));
+    }
+    return masked;
+}
+
+// Up to `count` entries from `address`, fewer when the table runs past the
+// end of its section.
+std::span<const uint8_t> tableBytes(const binary::Elf64 &elf,
+                                    uint64_t address, size_t entrySize,
+                                    uint64_t count) noexcept {
+    for (; count > 0; count /= 2) {
+        auto bytes = elf.getBytesAt(address, count * entrySize);
+        if (!bytes.empty()) {
+            return bytes;
+        }
+    }
+    return {};
+}
+
+uint64_t readEntry(std::span<const uint8_t> bytes, size_t at,
+                   size_t entrySize) noexcept {
+    uint64_t value = 0;
+    for (size_t i = entrySize; i-- > 0;) {
+        value = value << 8 | bytes[at + i];
+    }
+    return value;
+}
+
+} // namespace
+
+std::vector<Table> recover(const binary::Elf64 &elf, size_t function,
+                           std::span<const Instruction> instructions) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const binary::Function &fn = elf.getFunctions()[function];
+    std::vector<Table> tables;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction &ins = instructions[i];
+        if (ins.mnemonic != Mnemonic::Jmp || ins.operandCount != 1 ||
+            ins.operands[0].kind == OperandKind::Target) {
+            continue;
+        }
+        auto load = findLoad(instructions, i);
+        if (!load.has_value()) {
+            continue;
+        }
+        auto count = entryCount(instructions, load.value());
+        Table table = {
+            .jump = ins.address,
+            .address = load->address,
+            .entrySize = load->entrySize,
+            .relative = load->relative,
+            .bounded = count.has_value(),
+            .targets = {},
+        };
+        auto bytes = tableBytes(elf, table.address, table.entrySize,
+                                count.value_or(MaxEntries));
+        for (size_t at = 0; at + table.entrySize <= bytes.size();
+             at += table.entrySize) {
+            uint64_t target = readEntry(bytes, at, table.entrySize);
+            if (table.relative) {
+                target = table.address + (int64_t)(int32_t)target;
+            }
+            if (target >= fn.offset && target < fn.offset + fn.size) {
+                table.targets.push_back(target);
+            } else if (!table.bounded) {
+                break;
+            }
+        }
+        if (!table.targets.empty()) {
+            tables.push_back(std::move(table));
+        }
+    }
+    return tables;
+}
+
+void decode(const binary::Elf64 &elf, size_t function,
+            std::span<const Table> tables, std::vector<Instruction> &out) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const binary::Function &fn = elf.getFunctions()[function];
+    auto code = elf.getFunctionCode(function);
+    if (tables.empty()) {
+        disassemble::X86_64::decode(code, fn.offset,
+                                    disassemble::ReadingMode::LSB, out);
+        return;
+    }
+    std::vector<uint64_t> restarts;
+    for (const Table &table : tables) {
+        restarts.insert(restarts.end(), table.targets.begin(),
+                        table.targets.end());
+    }
+    std::sort(restarts.begin(), restarts.end());
+    restarts.erase(std::unique(restarts.begin(), restarts.end()),
+                   restarts.end());
+
+    out.clear();
+    out.reserve(code.size() / 4 + 1);
+    auto restart = restarts.begin();
+    size_t offset = 0;
+    while (offset < code.size()) {
+        while (restart != restarts.end() && *restart - fn.offset <= offset) {
+            ++restart;
+        }
+        size_t end =
+            restart != restarts.end() ? *restart - fn.offset : code.size();
+        out.push_back(disassemble::X86_64::decodeInstruction(
+            code.first(end), offset, fn.offset,
+            disassemble::ReadingMode::LSB));
+        offset += out.back().length;
+    }
+}
+
+void decode(const binary::Elf64 &elf, size_t function,
+            std::vector<Instruction> &out, std::vector<Table> &tables) {
+    const binary::Function &fn = elf.getFunctions()[function];
+    disassemble::X86_64::decode(elf.getFunctionCode(function), fn.offset,
+                                disassemble::ReadingMode::LSB, out);
+    tables = recover(elf, function, out);
+    auto startsInstruction = [&](uint64_t address) {
+        auto it = std::lower_bound(
+            out.begin(), out.end(), address,
+            [](const Instruction &ins, uint64_t value) {
+                return ins.address < value;
+            });
+        return it != out.end() && it->address == address;
+    };
+    for (const Table &table : tables) {
+        if (!std::all_of(table.targets.begin(), table.targets.end(),
+                         startsInstruction)) {
+            decode(elf, function, tables, out);
+            return;
+        }
+    }
+}
+
+Cache::Cache(const binary::Elf64 &elf)
+    : elf_(elf),
+      entries_(std::make_unique<Entry[]>(elf.getFunctions().size())) {}
+
+std::span<const Table> Cache::decode(size_t function,
+                                     std::vector<Instruction> &out) {
+    Entry &entry = entries_[function];
+    bool recovered = false;
+    std::call_once(entry.once, [&] {
+        jumptable::decode(elf_, function, out, entry.tables);
+        recovered = true;
+    });
+    if (!recovered) {
+        jumptable::decode(elf_, function, entry.tables, out);
+    }
+    return entry.tables;
+}
+
+} // namespace jumptable
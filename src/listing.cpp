@@ -0,0 +1,734 @@
+#include <listing.hpp>
+
+#include <algorithm>
+#include <cfg.hpp>
+#include <disassemble.hpp>
+#include <format>
+#include <fstream>
+#include <ir.hpp>
+#include <iterator>
+#include <jumptable.hpp>
+#include <liveness.hpp>
+#include <optional>
+#include <parallel.hpp>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace listing {
+
+namespace {
+
+template <disassemble::Isa Isa>
+void appendFunction(std::string &text, const binary::Elf64 &elf,
+                    size_t function,
+                    std::vector<typename Isa::Instruction> &buffer) {
+    const binary::Function &fn = elf.getFunctions()[function];
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+    text += fn.name;
+    text += ":\n";
+    Isa::decode(elf.getFunctionCode(function), fn.offset, buffer);
+    for (const auto &ins : buffer) {
+        Isa::format(text, ins, resolver);
+    }
+    text += '\n';
+}
+
+} // namespace
+
+void writeMainListing(std::ostream &out, const binary::Binary &bin) {
+    std::string text;
+    DecodeBuffers buffers;
+    appendMainListing(text, bin, buffers);
+    out << text;
+}
+
+void appendMainListing(std::string &text, const binary::Binary &bin,
+                       DecodeBuffers &buffers) {
+    if (auto elf32 = dynamic_cast<const binary::Elf32 *>(&bin)) {
+        [[maybe_unused]] auto header = elf32->getHeader();
+    } else if (auto elf64 = dynamic_cast<const binary::Elf64 *>(&bin)) {
+        const auto &functions = elf64->getFunctions();
+        std::optional<size_t> mainIdx;
+        for (size_t i = 0; i < functions.size(); i++) {
+            if (functions[i].name == "main") {
+                mainIdx = i;
+            }
+        }
+        if (mainIdx.has_value()) {
+            disassemble::withIsa(
+                elf64->getHeader().e_machine, [&]<typename Isa>(Isa) {
+                    appendFunction<Isa>(
+                        text, *elf64, mainIdx.value(),
+                        std::get<std::vector<typename Isa::Instruction>>(
+                            buffers));
+                });
+        } else {
+            text += "main function not found\n";
+        }
+    } else {
+        throw std::runtime_error("Unsupported file type");
+    }
+}
+
+void writeFunction(std::ostream &out, const binary::Elf64 &elf,
+                   size_t function) {
+    disassemble::withIsa(elf.getHeader().e_machine, [&]<typename Isa>(Isa) {
+        std::string text;
+        std::vector<typename Isa::Instruction> buffer;
+        appendFunction<Isa>(text, elf, function, buffer);
+        out << text;
+    });
+}
+
+void writeArchive(std::ostream &out, const archive::Archive &archive,
+                  size_t jobs) {
+    const auto &members = archive.getMembers();
+    std::vector<std::string> texts(members.size());
+    // Members need not all be for the same machine.
+    std::vector<DecodeBuffers> buffers(jobs);
+    parallel::forEach(members.size(), jobs, [&](size_t idx, size_t worker) {
+        std::string &text = texts[idx];
+        text = std::format("==> {} <==\n", members[idx].name);
+        try {
+            auto elf = archive.openMember(idx);
+            disassemble::withIsa(
+                elf->getHeader().e_machine, [&]<typename Isa>(Isa) {
+                    auto &buffer = std::get<
+                        std::vector<typename Isa::Instruction>>(
+                        buffers[worker]);
+                    for (size_t fn = 0; fn < elf->getFunctions().size();
+                         fn++) {
+                        appendFunction<Isa>(text, *elf, fn, buffer);
+                    }
+                });
+        } catch (const std::exception &e) {
+            text += std::format("{}\n\n", e.what());
+        }
+    });
+    for (const std::string &text : texts) {
+        out << text;
+    }
+}
+
+void writeSections(std::ostream &out, const binary::Elf64 &elf,
+                   size_t jobs) {
+    size_t count = elf.getHeader().e_shnum;
+    std::vector<size_t> compressed;
+    for (size_t i = 0; i < count; i++) {
+        if (elf.getSectionHeader(i).sh_flags & SHF_COMPRESSED) {
+            compressed.push_back(i);
+        }
+    }
+    elf.decompressSections(compressed, jobs);
+
+    std::string text;
+    for (size_t i = 0; i < count; i++) {
+        Elf64_Shdr section = elf.getSectionHeader(i);
+        text = std::format("{:>3} {:<24} {:>16x} {:>10}", i,
+                           elf.getSectionName(i), section.sh_addr,
+                           section.sh_size);
+        if (section.sh_flags & SHF_COMPRESSED) {
+            try {
+                text += std::format(" compressed, {} bytes",
+                                    elf.getSectionData(i).size());
+            } catch (const std::exception &e) {
+                text += std::format(" compressed, {}", e.what());
+            }
+        }
+        text += '\n';
+        out << text;
+    }
+}
+
+void writeFunctionSource(std::ostream &out, const binary::Elf64 &elf,
+                         size_t function, dwarf::LineIndex &lines) {
+    const binary::Function &fn = elf.getFunctions()[function];
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+    // Lines of the source files read so far, empty when unreadable.
+    std::unordered_map<std::string_view, std::vector<std::string>> sources;
+    auto sourceLine = [&](std::string_view file,
+                          uint32_t line) -> std::string_view {
+        auto [it, inserted] = sources.try_emplace(file);
+        if (inserted) {
+            std::ifstream input{std::string(file)};
+            for (std::string text; std::getline(input, text);) {
+                it->second.push_back(std::move(text));
+            }
+        }
+        if (line == 0 || line > it->second.size()) {
+            return {};
+        }
+        return it->second[line - 1];
+    };
+
+    std::string text = std::format("{}:\n", fn.name);
+    disassemble::withIsa(elf.getHeader().e_machine, [&]<typename Isa>(Isa) {
+        std::vector<typename Isa::Instruction> instructions;
+        Isa::decode(elf.getFunctionCode(function), fn.offset, instructions);
+        std::optional<dwarf::Location> last;
+        for (const auto &ins : instructions) {
+            auto location = lines.find(ins.address);
+            if (location.has_value() &&
+                (!last.has_value() || last->line != location->line ||
+                 last->file != location->file)) {
+                text +=
+                    std::format("; {}:{}", location->file, location->line);
+                std::string_view source =
+                    sourceLine(location->file, location->line);
+                if (!source.empty()) {
+                    text += std::format("  {}", source);
+                }
+                text += '\n';
+            }
+            last = location;
+            Isa::format(text, ins, resolver);
+        }
+    });
+    text += '\n';
+    out << text;
+}
+
+void writeFunctionGraph(std::ostream &out, const binary::Elf64 &elf,
+                        size_t function) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const binary::Function &fn = elf.getFunctions()[function];
+    std::vector<disassemble::X86_64::Instruction> instructions;
+    std::vector<jumptable::Table> tables;
+    jumptable::decode(elf, function, instructions, tables);
+    auto graph = cfg::Graph::build(instructions, tables);
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+
+    out << fn.name << ":\n";
+    std::string text;
+    const auto &blocks = graph.getBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const cfg::Block &block = blocks[b];
+        text = std::format("block {} (+0x{:x})", b, block.offset);
+        if (!graph.predecessors(b).empty()) {
+            text += " <-";
+            for (uint32_t predecessor : graph.predecessors(b)) {
+                text += std::format(" {}", predecessor);
+            }
+        }
+        text += '\n';
+        for (const auto &ins : std::span(instructions)
+                                   .subspan(block.firstInstruction,
+                                            block.instructionCount)) {
+            disassemble::X86_64::formatInstruction(text, ins, resolver);
+        }
+        const auto &last =
+            instructions[block.firstInstruction + block.instructionCount - 1];
+        for (const jumptable::Table &table : tables) {
+            if (table.jump == last.address) {
+                text += std::format("\t; table at 0x{:x}, {} entries{}\n",
+                                    table.address, table.targets.size(),
+                                    table.bounded ? "" : ", unbounded");
+            }
+        }
+        if (!graph.successors(b).empty()) {
+            text += "\t->";
+            for (uint32_t successor : graph.successors(b)) {
+                text += std::format(" {}", successor);
+            }
+            text += '\n';
+        }
+        out << text;
+    }
+    out << '\n';
+}
+
+namespace {
+
+void appendLifted(std::string &text, const binary::Elf64 &elf,
+                  size_t function, const cfg::Graph &graph,
+                  const ir::Function &lifted) {
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+    text += elf.getFunctions()[function].name;
+    text += ":\n";
+    const auto &blocks = graph.getBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const cfg::Block &block = blocks[b];
+        std::format_to(std::back_inserter(text), "block {} (+0x{:x}):\n", b,
+                       block.offset);
+        for (size_t i = block.firstInstruction;
+             i < block.firstInstruction + block.instructionCount; i++) {
+            ir::formatInstruction(text, lifted, i, resolver);
+        }
+    }
+    text += '\n';
+}
+
+} // namespace
+
+void writeFunctionIR(std::ostream &out, const binary::Elf64 &elf,
+                     size_t function) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    std::vector<disassemble::X86_64::Instruction> instructions;
+    std::vector<jumptable::Table> tables;
+    jumptable::decode(elf, function, instructions, tables);
+    auto graph = cfg::Graph::build(instructions, tables);
+    ir::Function lifted;
+    ir::Lifter().lift(instructions, graph, lifted);
+    std::string text;
+    appendLifted(text, elf, function, graph, lifted);
+    out << text;
+}
+
+void writeLiftedFunctions(std::ostream &out, const binary::Elf64 &elf,
+                          size_t jobs) {
+    std::vector<std::string> texts(elf.getFunctions().size());
+    ir::liftAll(elf, jobs,
+                [&](size_t function, const cfg::Graph &graph,
+                    const ir::Function &lifted) {
+                    appendLifted(texts[function], elf, function, graph,
+                                 lifted);
+                });
+    for (const std::string &text : texts) {
+        out << text;
+    }
+}
+
+void writeFunctionLiveness(std::ostream &out, const binary::Elf64 &elf,
+                           size_t function) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const binary::Function &fn = elf.getFunctions()[function];
+    std::vector<disassemble::X86_64::Instruction> instructions;
+    std::vector<jumptable::Table> tables;
+    jumptable::decode(elf, function, instructions, tables);
+    auto graph = cfg::Graph::build(instructions, tables);
+    liveness::Analysis analysis;
+    analysis.run(instructions, graph);
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+
+    out << fn.name << ":\n";
+    std::string text;
+    if (analysis.uselessSaves() != 0) {
+        text = "\t; saved but never written: ";
+        liveness::formatRegisterSet(text, analysis.uselessSaves());
+        out << text << '\n';
+    }
+    const auto &blocks = graph.getBlocks();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const cfg::Block &block = blocks[b];
+        text = std::format("block {} (+0x{:x}) live in: ", b, block.offset);
+        liveness::formatRegisterSet(text, analysis.liveIn(b));
+        text += '\n';
+        for (size_t i = block.firstInstruction;
+             i < block.firstInstruction + block.instructionCount; i++) {
+            disassemble::X86_64::formatInstruction(text, instructions[i],
+                                                   resolver);
+            text.pop_back();
+            text += "\t; live: ";
+            liveness::formatRegisterSet(text, analysis.liveAfter(i));
+            if (auto dead = analysis.deadDefinitions(i)) {
+                text += "; dead: ";
+                liveness::formatRegisterSet(text, dead);
+            }
+            text += '\n';
+        }
+        out << text;
+    }
+    out << '\n';
+}
+
+void writeIdenticalFunctions(std::ostream &out, const binary::Elf64 &elf,
+                             const dedup::Groups &groups) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    auto wasted = [&](size_t group) {
+        size_t size = functions[groups.members(group)[0]].size;
+        return size * (groups.copies(group) - 1);
+    };
+    std::vector<uint32_t> duplicated;
+    for (size_t group = 0; group < groups.size(); group++) {
+        if (groups.copies(group) > 1) {
+            duplicated.push_back(group);
+        }
+    }
+    std::stable_sort(duplicated.begin(), duplicated.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         return wasted(a) > wasted(b);
+                     });
+
+    size_t total = 0;
+    std::string text;
+    for (uint32_t group : duplicated) {
+        auto members = groups.members(group);
+        text = std::format("{} copies of {} bytes ({} duplicated):\n",
+                           groups.copies(group), functions[members[0]].size,
+                           wasted(group));
+        for (uint32_t fn : members) {
+            text += std::format("\t0x{:x}\t{}\n", functions[fn].offset,
+                                functions[fn].name);
+        }
+        out << text;
+        total += wasted(group);
+    }
+    out << std::format("{} groups, {} bytes duplicated\n", duplicated.size(),
+                       total);
+}
+
+void writeAllFunctions(std::ostream &out, const binary::Elf64 &elf,
+                       const dedup::Groups &groups, size_t jobs) {
+    disassemble::withIsa(elf.getHeader().e_machine, [&]<typename Isa>(Isa) {
+        const auto &functions = elf.getFunctions();
+        auto resolver = [&elf](uint64_t address) {
+            return elf.getImportName(address);
+        };
+        std::vector<std::string> texts(groups.size());
+        std::vector<std::vector<typename Isa::Instruction>> buffers(jobs);
+        parallel::forEach(groups.size(), jobs, [&](size_t group,
+                                                   size_t worker) {
+            auto members = groups.members(group);
+            const binary::Function &first = functions[members[0]];
+            std::string &text = texts[group];
+            text = std::format("{}:\n", first.name);
+            for (uint32_t fn : members.subspan(1)) {
+                if (functions[fn].offset == first.offset) {
+                    text += std::format("{}:\n", functions[fn].name);
+                } else {
+                    text += std::format("{}: same as {} (at 0x{:x})\n",
+                                        functions[fn].name, first.name,
+                                        functions[fn].offset);
+                }
+            }
+            auto &instructions = buffers[worker];
+            Isa::decode(elf.getFunctionCode(members[0]), first.offset,
+                        instructions);
+            for (const auto &ins : instructions) {
+                Isa::format(text, ins, resolver);
+            }
+            text += '\n';
+        });
+        for (const std::string &text : texts) {
+            out << text;
+        }
+    });
+}
+
+void writeProfile(std::ostream &out, const binary::Elf64 &elf,
+                  const profile::Profile &profile, size_t limit,
+                  size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    auto hot = std::span(profile.getFunctions());
+    hot = hot.first(std::min(limit, hot.size()));
+    auto percent = [](uint64_t count, uint64_t total) {
+        return total == 0 ? 0.0 : 100.0 * count / total;
+    };
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+
+    struct Worker {
+        std::vector<disassemble::X86_64::Instruction> instructions;
+        std::vector<uint64_t> counts;
+    };
+    std::vector<Worker> workers(jobs);
+    std::vector<std::string> texts(hot.size());
+    parallel::forEach(hot.size(), jobs, [&](size_t i, size_t id) {
+        Worker &worker = workers[id];
+        const binary::Function &fn = functions[hot[i].function];
+        std::string &text = texts[i];
+        text = std::format("{}: {} samples ({:.2f}%)\n", fn.name,
+                           hot[i].count,
+                           percent(hot[i].count, profile.getTotal()));
+        disassemble::X86_64::decode(elf.getFunctionCode(hot[i].function),
+                                    fn.offset, disassemble::ReadingMode::LSB,
+                                    worker.instructions);
+        auto samples = profile.samplesIn(fn);
+        profile::countInstructions(worker.instructions, samples,
+                                   worker.counts);
+        uint64_t total = 0;
+        for (uint64_t count : worker.counts) {
+            total += count;
+        }
+        for (size_t j = 0; j < worker.instructions.size(); j++) {
+            const auto &ins = worker.instructions[j];
+            if (worker.counts[j] != 0) {
+                text += std::format("{:7.2f}%  {:x}:",
+                                    percent(worker.counts[j], total),
+                                    ins.address);
+            } else {
+                text += std::format("          {:x}:", ins.address);
+            }
+            disassemble::X86_64::formatInstruction(text, ins, resolver);
+        }
+        text += '\n';
+    });
+
+    out << std::format("{} samples, {} ({:.2f}%) outside known functions\n\n",
+                       profile.getTotal(), profile.getUnattributed(),
+                       percent(profile.getUnattributed(),
+                               profile.getTotal()));
+    for (const std::string &text : texts) {
+        out << text;
+    }
+}
+
+void writeProcessMappings(std::ostream &out, const process::Snapshot &snapshot,
+                          const process::Symbols &symbols) {
+    std::string text;
+    for (const process::Mapping &mapping : snapshot.getMappings()) {
+        text = std::format("{:x}-{:x}\t{}\n", mapping.start, mapping.end,
+                           mapping.path.empty() ? "[anonymous]"
+                                                : mapping.path);
+        out << text;
+    }
+    out << std::format("{} files with symbols, {} JIT symbols\n",
+                       symbols.getModuleCount(),
+                       symbols.getJitSymbolCount());
+}
+
+void writeProcessMemory(std::ostream &out, const process::Snapshot &snapshot,
+                        const process::Symbols &symbols, uint64_t address,
+                        size_t size) {
+    auto code = snapshot.getBytes(address, size);
+    if (code.empty()) {
+        throw std::runtime_error(
+            std::format("0x{:x} is not in a captured mapping", address));
+    }
+    auto resolver = [&symbols](uint64_t target) -> std::string_view {
+        auto symbol = symbols.find(target);
+        if (!symbol.has_value() || symbol->address != target) {
+            return symbols.findImport(target);
+        }
+        return symbol->name;
+    };
+    auto symbol = symbols.find(address);
+    if (symbol.has_value() && symbol->address == address) {
+        out << symbol->name << ":\n";
+    } else {
+        out << std::format("0x{:x}:\n", address);
+    }
+    std::string text;
+    disassemble::withIsa(disassemble::HostMachine, [&]<typename Isa>(Isa) {
+        std::vector<typename Isa::Instruction> instructions;
+        Isa::decode(code, address, instructions);
+        for (const auto &ins : instructions) {
+            Isa::format(text, ins, resolver);
+        }
+    });
+    text += '\n';
+    out << text;
+}
+
+void writePatches(std::ostream &out, const binary::Elf64 &elf,
+                  std::span<const patch::Write> writes) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    auto resolver = [&elf](uint64_t address) {
+        return elf.getImportName(address);
+    };
+    std::string text;
+    std::vector<disassemble::X86_64::Instruction> buffer;
+    auto append = [&](char sign, std::span<const uint8_t> bytes,
+                      uint64_t address) {
+        disassemble::X86_64::decode(bytes, address,
+                                    disassemble::ReadingMode::LSB, buffer);
+        for (const auto &ins : buffer) {
+            text += sign;
+            disassemble::X86_64::formatInstruction(text, ins, resolver);
+        }
+    };
+    for (const patch::Write &write : writes) {
+        text += std::format("{} (file offset 0x{:x}):\n",
+                            describeAddress(elf, write.address),
+                            write.offset);
+        append('-', write.original, write.address);
+        append('+', write.bytes, write.address);
+    }
+    out << text;
+}
+
+void writeRange(std::ostream &out, const query::Image &image,
+                std::string_view label, uint64_t start, uint64_t end) {
+    auto code = image.getBytes(start, end - start);
+    if (code.empty() && end > start) {
+        throw std::runtime_error(std::format(
+            "0x{:x}-0x{:x} has no file contents", start, end));
+    }
+    // Written in pieces so that long ranges show up as they are decoded.
+    constexpr size_t FlushSize = 64 * 1024;
+    std::string text = std::format("{}:\n", label);
+    disassemble::withIsa(image.getMachine(), [&]<typename Isa>(Isa) {
+        for (size_t offset = 0; offset < code.size();) {
+            auto ins = Isa::decodeInstruction(code, offset, start);
+            Isa::format(text, ins, {});
+            offset += std::max<size_t>(Isa::length(ins), 1);
+            if (text.size() >= FlushSize) {
+                out << text;
+                out.flush();
+                text.clear();
+            }
+        }
+    });
+    text += '\n';
+    out << text;
+}
+
+void writeMatches(std::ostream &out, const binary::Elf64 &elf,
+                  std::span<const search::Match> matches, bool instructions) {
+    if (instructions) {
+        disassemble::requireX86_64(elf.getHeader().e_machine);
+    }
+    std::string text;
+    for (const search::Match &match : matches) {
+        text = std::format("0x{:x}\t{}\t", match.address,
+                           describeAddress(elf, match.address));
+        auto bytes = elf.getBytesAt(match.address, match.size);
+        if (instructions) {
+            auto decoded = disassemble::X86_64::decode(
+                bytes, match.address, disassemble::ReadingMode::LSB);
+            for (size_t i = 0; i < decoded.size(); i++) {
+                size_t start = text.size();
+                disassemble::X86_64::formatInstruction(text, decoded[i]);
+                // Drop the tab and newline framing each instruction.
+                text.erase(start, 1);
+                text.pop_back();
+                if (i + 1 < decoded.size()) {
+                    text += "; ";
+                }
+            }
+        } else {
+            for (size_t i = 0; i < bytes.size(); i++) {
+                if (i != 0) {
+                    text += ' ';
+                }
+                text += std::format("{:02x}", bytes[i]);
+            }
+        }
+        text += '\n';
+        out << text;
+    }
+}
+
+void writeInstructionMix(std::ostream &out, const binary::Elf64 &elf,
+                         const mix::Mix &mix, size_t limit) {
+    const mix::Counts &totals = mix.getTotals();
+    auto percent = [&](uint64_t count) {
+        return totals.instructions == 0
+                   ? 0.0
+                   : 100.0 * count / totals.instructions;
+    };
+    // Writes the nonzero `counts` most frequent first, named by `name(i)`.
+    auto writeCounts = [&](std::string &text, std::span<const uint64_t> counts,
+                           auto &&name) {
+        std::vector<uint32_t> order;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (counts[i] != 0) {
+                order.push_back(i);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return counts[a] > counts[b];
+                         });
+        for (uint32_t i : order) {
+            text += std::format("\t{:<12} {:>12} {:6.2f}%\n", name(i),
+                                counts[i], percent(counts[i]));
+        }
+    };
+
+    std::string text = std::format(
+        "{} instructions, {} bytes in {} functions\n", totals.instructions,
+        totals.bytes, elf.getFunctions().size());
+    text += std::format("{} SIMD ({:.2f}%), {} stack accesses ({:.2f}%), "
+                        "{} memory operands, {} RIP-relative\n",
+                        totals.simd, percent(totals.simd), totals.stack,
+                        percent(totals.stack), totals.memoryOperands,
+                        totals.ripRelative);
+    text += "\nmnemonics:\n";
+    writeCounts(text, totals.mnemonics, [](size_t i) {
+        return disassemble::X86_64::mnemonicName(
+            (disassemble::X86_64::Mnemonic)i);
+    });
+    text += "\nprefixes:\n";
+    static constexpr std::array<std::string_view, 8> prefixes = {
+        "lock", "rep", "repne", "66", "67", "rex", "vex", "evex"};
+    writeCounts(text, totals.prefixes,
+                [](size_t i) { return prefixes[i]; });
+    static constexpr std::array<std::string_view, 7> segments = {
+        "", "cs", "ss", "ds", "es", "fs", "gs"};
+    writeCounts(text, std::span(totals.segments).subspan(1),
+                [](size_t i) { return segments[i + 1]; });
+    text += "\noperand forms:\n";
+    writeCounts(text, totals.forms, mix::formName);
+
+    uint64_t unknown = totals.mnemonics[0];
+    text += std::format("\nunknown opcodes: {} ({:.2f}%)\n", unknown,
+                        percent(unknown));
+    static constexpr std::array<std::string_view, 4> maps = {"", "0f ",
+                                                             "0f 38 ",
+                                                             "0f 3a "};
+    std::vector<uint64_t> opcodes;
+    for (const auto &map : totals.unknown) {
+        opcodes.insert(opcodes.end(), map.begin(), map.end());
+    }
+    opcodes.push_back(totals.unknownVex);
+    writeCounts(text, opcodes, [&](size_t i) {
+        if (i == opcodes.size() - 1) {
+            return std::string("vex/evex");
+        }
+        return std::format("{}{:02x}", maps[i / 256], i % 256);
+    });
+    out << text;
+
+    const auto &functions = elf.getFunctions();
+    const auto &mixes = mix.getFunctions();
+    std::vector<uint32_t> order(functions.size());
+    for (size_t fn = 0; fn < order.size(); fn++) {
+        order[fn] = fn;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return mixes[a].instructions > mixes[b].instructions;
+    });
+    order.resize(std::min(limit, order.size()));
+    out << std::format("\n{:>10} {:>8} {:>6} {:>8} {:>8} {:>8}  {:<30} {}\n",
+                       "insns", "unknown", "lock", "simd", "stack", "memory",
+                       "top", "function");
+    for (uint32_t fn : order) {
+        const mix::FunctionMix &counts = mixes[fn];
+        std::string top;
+        for (size_t i = 0; i < counts.top.size() && counts.topCounts[i] != 0;
+             i++) {
+            top += std::format("{}{} {}", top.empty() ? "" : ", ",
+                               disassemble::X86_64::mnemonicName(counts.top[i]),
+                               counts.topCounts[i]);
+        }
+        text = std::format("{:>10} {:>8} {:>6} {:>8} {:>8} {:>8}  {:<30} {}\n",
+                           counts.instructions, counts.unknown, counts.locked,
+                           counts.simd, counts.stack, counts.memoryOperands,
+                           top, functions[fn].name);
+        out << text;
+    }
+}
+
+std::string describeAddress(const binary::Elf64 &elf, uint64_t address) {
+    auto fn = elf.findFunction(address);
+    if (!fn.has_value()) {
+        std::string_view name = elf.getImportName(address);
+        if (!name.empty()) {
+            return std::string(name);
+        }
+        return std::format("0x{:x}", address);
+    }
+    const binary::Function &function = elf.getFunctions()[fn.value()];
+    if (function.offset == address) {
+        return std::string(function.name);
+    }
+    return std::format("{}+0x{:x}", function.name, address - function.offset);
+}
+
+} // namespace listing
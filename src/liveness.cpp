@@ -0,0 +1,378 @@
+#include <liveness.hpp>
+
+#include <array>
+
+namespace liveness {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+using disassemble::X86_64::OperandKind;
+using disassemble::X86_64::Register;
+
+namespace {
+
+constexpr RegisterSet bit(Register reg) noexcept { return registerBit(reg); }
+
+// Flags tested by each condition code, in Jcc order.
+constexpr std::array<RegisterSet, 16> conditionFlags = {
+    Registers::OF,
+    Registers::OF,
+    Registers::CF,
+    Registers::CF,
+    Registers::ZF,
+    Registers::ZF,
+    Registers::CF | Registers::ZF,
+    Registers::CF | Registers::ZF,
+    Registers::SF,
+    Registers::SF,
+    Registers::PF,
+    Registers::PF,
+    Registers::SF | Registers::OF,
+    Registers::SF | Registers::OF,
+    Registers::ZF | Registers::SF | Registers::OF,
+    Registers::ZF | Registers::SF | Registers::OF,
+};
+
+constexpr RegisterSet CallerSaved =
+    Registers::General & ~Registers::CalleeSaved & ~bit(Register::RSP);
+
+[[nodiscard]] bool isIn(Mnemonic mnemonic, Mnemonic first) noexcept {
+    return mnemonic >= first && (uint16_t)mnemonic < (uint16_t)first + 16;
+}
+
+[[nodiscard]] RegisterSet addressUses(
+    const disassemble::X86_64::Operand &operand) noexcept {
+    if (operand.kind != OperandKind::Memory) {
+        return 0;
+    }
+    return bit(operand.base) | bit(operand.index);
+}
+
+// How an instruction treats its first operand.
+enum class Destination : uint8_t {
+    Read,
+    Write,
+    ReadWrite,
+};
+
+} // namespace
+
+Effects effects(const Instruction &ins) {
+    Effects result;
+    Mnemonic mnemonic = ins.mnemonic;
+    auto operands = ins.getOperands();
+    Destination destination = Destination::Read;
+
+    switch (mnemonic) {
+    case Mnemonic::Mov:
+    case Mnemonic::Movzx:
+    case Mnemonic::Movsx:
+    case Mnemonic::Movsxd:
+    case Mnemonic::Lea:
+        destination = Destination::Write;
+        break;
+    case Mnemonic::Add:
+    case Mnemonic::Or:
+    case Mnemonic::And:
+    case Mnemonic::Sub:
+    case Mnemonic::Xor:
+    case Mnemonic::Neg:
+        destination = Destination::ReadWrite;
+        result.defs |= Registers::Flags;
+        break;
+    case Mnemonic::Adc:
+    case Mnemonic::Sbb:
+        destination = Destination::ReadWrite;
+        result.uses |= Registers::CF;
+        result.defs |= Registers::Flags;
+        break;
+    case Mnemonic::Cmp:
+    case Mnemonic::Test:
+        result.defs |= Registers::Flags;
+        break;
+    case Mnemonic::Inc:
+    case Mnemonic::Dec:
+        destination = Destination::ReadWrite;
+        result.defs |= Registers::Flags & ~Registers::CF;
+        break;
+    case Mnemonic::Not:
+    case Mnemonic::Xchg:
+        destination = Destination::ReadWrite;
+        break;
+    case Mnemonic::Rol:
+    case Mnemonic::Ror:
+    case Mnemonic::Rcl:
+    case Mnemonic::Rcr:
+    case Mnemonic::Shl:
+    case Mnemonic::Shr:
+    case Mnemonic::Sar: {
+        destination = Destination::ReadWrite;
+        if (mnemonic == Mnemonic::Rcl || mnemonic == Mnemonic::Rcr) {
+            result.uses |= Registers::CF;
+        }
+        // A count of zero, possibly only known at runtime, leaves the flags
+        // alone.
+        const auto &count = operands[1];
+        if (count.kind == OperandKind::Immediate && (count.value & 0x3f)) {
+            result.defs |= mnemonic <= Mnemonic::Rcr
+                               ? Registers::CF | Registers::OF
+                               : Registers::Flags;
+        }
+        break;
+    }
+    case Mnemonic::Imul:
+        if (operands.size() == 3) {
+            destination = Destination::Write;
+        } else if (operands.size() == 2) {
+            destination = Destination::ReadWrite;
+        } else {
+            result.uses |= bit(Register::RAX);
+            result.defs |= bit(Register::RAX) | bit(Register::RDX);
+        }
+        result.defs |= Registers::Flags;
+        break;
+    case Mnemonic::Mul:
+        result.uses |= bit(Register::RAX);
+        result.defs |= bit(Register::RAX) | bit(Register::RDX) |
+                       Registers::Flags;
+        break;
+    case Mnemonic::Div:
+    case Mnemonic::Idiv:
+        result.uses |= bit(Register::RAX) | bit(Register::RDX);
+        result.defs |= bit(Register::RAX) | bit(Register::RDX) |
+                       Registers::Flags;
+        break;
+    case Mnemonic::Push:
+        result.uses |= bit(Register::RSP);
+        result.defs |= bit(Register::RSP);
+        break;
+    case Mnemonic::Pop:
+        destination = Destination::Write;
+        result.uses |= bit(Register::RSP);
+        result.defs |= bit(Register::RSP);
+        break;
+    case Mnemonic::Leave:
+        result.uses |= bit(Register::RBP);
+        result.defs |= bit(Register::RBP) | bit(Register::RSP);
+        break;
+    case Mnemonic::Cbw:
+    case Mnemonic::Cwde:
+    case Mnemonic::Cdqe:
+        result.uses |= bit(Register::RAX);
+        result.defs |= bit(Register::RAX);
+        break;
+    case Mnemonic::Cwd:
+    case Mnemonic::Cdq:
+    case Mnemonic::Cqo:
+        result.uses |= bit(Register::RAX);
+        result.defs |= bit(Register::RDX);
+        break;
+    case Mnemonic::Call:
+        // RAX carries the vector register count of variadic calls.
+        result.uses |= Registers::Arguments | bit(Register::RAX) |
+                       bit(Register::RSP);
+        result.defs |= CallerSaved | Registers::Flags;
+        break;
+    case Mnemonic::Ret:
+        result.uses |= bit(Register::RAX) | bit(Register::RDX) |
+                       bit(Register::RSP) | Registers::CalleeSaved;
+        break;
+    case Mnemonic::Syscall:
+        result.uses |= bit(Register::RAX) | bit(Register::RDI) |
+                       bit(Register::RSI) | bit(Register::RDX) |
+                       bit(Register::R10) | bit(Register::R8) |
+                       bit(Register::R9);
+        result.defs |=
+            bit(Register::RAX) | bit(Register::RCX) | bit(Register::R11);
+        break;
+    // Padding such as `nop [rax + rax]` names registers without reading
+    // them.
+    case Mnemonic::Nop:
+    case Mnemonic::Pause:
+    case Mnemonic::Endbr64:
+        return result;
+    case Mnemonic::Jmp:
+    case Mnemonic::Int3:
+    case Mnemonic::Hlt:
+    case Mnemonic::Ud2:
+        break;
+    case Mnemonic::Unknown:
+        result.uses |= Registers::General | Registers::Flags;
+        return result;
+    default:
+        if (isIn(mnemonic, Mnemonic::Jo)) {
+            result.uses |=
+                conditionFlags[(size_t)mnemonic - (size_t)Mnemonic::Jo];
+        } else if (isIn(mnemonic, Mnemonic::Seto)) {
+            destination = Destination::Write;
+            result.uses |=
+                conditionFlags[(size_t)mnemonic - (size_t)Mnemonic::Seto];
+        } else if (isIn(mnemonic, Mnemonic::Cmovo)) {
+            destination = Destination::ReadWrite;
+            result.uses |=
+                conditionFlags[(size_t)mnemonic - (size_t)Mnemonic::Cmovo];
+        }
+        break;
+    }
+
+    // `xor eax, eax` and friends only write their register. Byte and word
+    // forms keep the rest of it, so they still read it.
+    if ((mnemonic == Mnemonic::Xor || mnemonic == Mnemonic::Sub) &&
+        operands[0].kind == OperandKind::Register &&
+        operands[1].kind == OperandKind::Register &&
+        operands[0].base == operands[1].base && operands[0].size >= 4) {
+        result.defs |= bit(operands[0].base);
+        return result;
+    }
+
+    for (size_t i = 0; i < operands.size(); i++) {
+        const auto &operand = operands[i];
+        result.uses |= addressUses(operand);
+        if (operand.kind != OperandKind::Register) {
+            continue;
+        }
+        RegisterSet reg = bit(operand.base);
+        bool first = i == 0 || mnemonic == Mnemonic::Xchg;
+        if (!first || destination == Destination::Read) {
+            result.uses |= reg;
+            continue;
+        }
+        result.defs |= reg;
+        // Byte and word writes merge into the old value.
+        if (destination == Destination::ReadWrite || operand.size < 4 ||
+            operand.base >= Register::AH) {
+            result.uses |= reg;
+        }
+    }
+    return result;
+}
+
+void formatRegisterSet(std::string &out, RegisterSet set) {
+    bool first = true;
+    for (size_t reg = 0; reg < 16; reg++) {
+        if (!(set & (1ull << reg))) {
+            continue;
+        }
+        if (!first) {
+            out += ' ';
+        }
+        out += disassemble::X86_64::registerName(Register(reg), 8);
+        first = false;
+    }
+}
+
+void Analysis::run(std::span<const Instruction> instructions,
+                   const cfg::Graph &graph) {
+    const auto &blocks = graph.getBlocks();
+    effects_.resize(instructions.size());
+    isCall_.resize(instructions.size());
+    liveAfter_.resize(instructions.size());
+    blocks_.assign(blocks.size(), BlockSets{});
+
+    RegisterSet pushed = 0;
+    RegisterSet written = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction &ins = instructions[i];
+        effects_[i] = effects(ins);
+        isCall_[i] = ins.mnemonic == Mnemonic::Call;
+        bool savesOrRestores =
+            (ins.mnemonic == Mnemonic::Push || ins.mnemonic == Mnemonic::Pop) &&
+            ins.operands[0].kind == OperandKind::Register;
+        if (savesOrRestores && ins.mnemonic == Mnemonic::Push) {
+            pushed |= bit(ins.operands[0].base);
+        } else if (!savesOrRestores && !isCall_[i]) {
+            written |= effects_[i].defs;
+        }
+    }
+    uselessSaves_ = pushed & ~written & Registers::CalleeSaved &
+                    ~bit(Register::RSP);
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        BlockSets &sets = blocks_[b];
+        const cfg::Block &block = blocks[b];
+        for (size_t i = block.firstInstruction + block.instructionCount;
+             i-- > block.firstInstruction;) {
+            sets.uses = (sets.uses & ~effects_[i].defs) | effects_[i].uses;
+            sets.defs |= effects_[i].defs;
+        }
+        if (graph.successors(b).empty()) {
+            // Leaving the function other than through ret: a tail call
+            // passes arguments on, a trailing call does not return, anything
+            // else is unknown.
+            const Instruction &last =
+                instructions[block.firstInstruction + block.instructionCount -
+                             1];
+            if (last.mnemonic == Mnemonic::Jmp && last.branchTarget()) {
+                sets.out = Registers::Arguments | Registers::CalleeSaved |
+                           bit(Register::RAX) | bit(Register::RSP);
+            } else if (last.mnemonic != Mnemonic::Ret &&
+                       last.mnemonic != Mnemonic::Call &&
+                       last.mnemonic != Mnemonic::Hlt &&
+                       last.mnemonic != Mnemonic::Ud2) {
+                sets.out = Registers::General;
+            }
+        }
+        sets.in = sets.uses | (sets.out & ~sets.defs);
+    }
+
+    worklist_.clear();
+    queued_.assign(blocks.size(), 1);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        worklist_.push_back(b);
+    }
+    // Popped from the back, so blocks are first visited last to first.
+    while (!worklist_.empty()) {
+        uint32_t b = worklist_.back();
+        worklist_.pop_back();
+        queued_[b] = 0;
+        BlockSets &sets = blocks_[b];
+        for (uint32_t successor : graph.successors(b)) {
+            sets.out |= blocks_[successor].in;
+        }
+        RegisterSet in = sets.uses | (sets.out & ~sets.defs);
+        if (in == sets.in) {
+            continue;
+        }
+        sets.in = in;
+        for (uint32_t predecessor : graph.predecessors(b)) {
+            if (!queued_[predecessor]) {
+                queued_[predecessor] = 1;
+                worklist_.push_back(predecessor);
+            }
+        }
+    }
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const cfg::Block &block = blocks[b];
+        RegisterSet live = blocks_[b].out;
+        for (size_t i = block.firstInstruction + block.instructionCount;
+             i-- > block.firstInstruction;) {
+            liveAfter_[i] = live;
+            live = (live & ~effects_[i].defs) | effects_[i].uses;
+        }
+    }
+}
+
+RegisterSet Analysis::liveIn(size_t block) const noexcept {
+    return blocks_[block].in;
+}
+
+RegisterSet Analysis::liveOut(size_t block) const noexcept {
+    return blocks_[block].out;
+}
+
+RegisterSet Analysis::liveAfter(size_t instruction) const noexcept {
+    return liveAfter_[instruction];
+}
+
+RegisterSet Analysis::deadDefinitions(size_t instruction) const noexcept {
+    if (isCall_[instruction]) {
+        return 0;
+    }
+    return effects_[instruction].defs & ~liveAfter_[instruction] &
+           Registers::General;
+}
+
+RegisterSet Analysis::uselessSaves() const noexcept { return uselessSaves_; }
+
+} // namespace liveness
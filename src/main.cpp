@@ -1,8 +1,28 @@
+#include <archive.hpp>
+#include <array>
+#include <batch.hpp>
+#include <bench.hpp>
 #include <binary.hpp>
-#include <disassemble.hpp>
+#include <charconv>
+#include <dedup.hpp>
+#include <dwarf.hpp>
 #include <elf.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
 #include <iostream>
+#include <listing.hpp>
+#include <mix.hpp>
+#include <parallel.hpp>
+#include <patch.hpp>
 #include <print>
+#include <process.hpp>
+#include <profile.hpp>
+#include <query.hpp>
+#include <records.hpp>
+#include <search.hpp>
+#include <server.hpp>
+#include <xref.hpp>
 
 bool isNameMangled([[maybe_unused]] std::string_view name) {
     return name.starts_with("_Z");
@@ -23,35 +43,1000 @@ std::string demangleCpp([[maybe_unused]] std::string_view name) {
     return result;
 }
 
+void printUsage(std::string_view program) {
+    std::println("Usage: {} <filename>", program);
+    std::println("       {} --function <name|address> <filename>", program);
+    std::println("       {} --range START-END <filename>", program);
+    std::println("       {} --batch [-j JOBS] [-o DIR] [-l LIST] [files...]",
+                 program);
+    std::println("       {} --xrefs [-j JOBS] <filename> <name|address>",
+                 program);
+    std::println("       {} --find [-j JOBS] <filename> <instruction pattern>",
+                 program);
+    std::println("       {} --find-bytes [-j JOBS] <filename> <byte pattern>",
+                 program);
+    std::println("       {} --identical [-j JOBS] <filename>", program);
+    std::println("       {} --all [-j JOBS] <filename>", program);
+    std::println("       {} --profile [-j JOBS] [-b BIAS] [-n COUNT] "
+                 "<filename> <samples>",
+                 program);
+    std::println("       {} --process [--stop] [-n BYTES] PID "
+                 "[name|address]",
+                 program);
+    std::println("       {} --sections [-j JOBS] <filename>", program);
+    std::println("       {} --mix [-j JOBS] [-n COUNT] <filename>", program);
+    std::println("       {} --export json|records [-j JOBS] [-o OUTPUT] "
+                 "<filename>",
+                 program);
+    std::println("       {} --archive [-j JOBS] <archive> [function]",
+                 program);
+    std::println("       {} --source <filename> <name|address>", program);
+    std::println("       {} --patch [--dry-run] [--force] [-o OUTPUT] "
+                 "<filename> <name|address>=<bytes|nop>...",
+                 program);
+    std::println("       {} --cfg <filename> <name|address>", program);
+    std::println("       {} --lift [-j JOBS] <filename> [name|address]",
+                 program);
+    std::println("       {} --liveness <filename> <name|address>", program);
+    std::println("       {} --bench [-j JOBS] [-n FILES] [-r RUNS] "
+                 "[-s INSTRUCTIONS] [-d DIR]",
+                 program);
+    std::println("              [-o OUTPUT] [paths...]");
+    std::println("       {} --serve SOCKET [-c CACHED_FILES]", program);
+    std::println("       {} --client SOCKET <request...>", program);
+    std::println("");
+    std::println("Batch mode reads paths from LIST (one per line, '-' for "
+                 "stdin), from the");
+    std::println("arguments, or from stdin when neither is given.");
+    std::println("");
+    std::println("Instruction patterns look like \"mov reg, [rip+X]; call "
+                 "reg\", byte");
+    std::println("patterns like \"48 8b 05 ?? ?? ?? ??\".");
+    std::println("");
+    std::println("Profiles are `perf script` output or `address count` "
+                 "lines; BIAS is");
+    std::println("subtracted from every address, COUNT limits the functions "
+                 "shown.");
+    std::println("The instruction mix lists the COUNT largest functions, "
+                 "all by default.");
+    std::println("");
+    std::println("Patches replace the instructions at an address with hex "
+                 "bytes (\"eb 10\"),");
+    std::println("padded with NOPs; \"nop\" blanks one instruction. They are "
+                 "written to");
+    std::println("OUTPUT, a copy of the file, or to the file itself; "
+                 "--dry-run writes nothing.");
+    std::println("");
+    std::println("The benchmark times disasmer --all against objdump -d on "
+                 "FILES ELF files");
+    std::println("with symbols from the paths (/usr/bin and /usr/lib by "
+                 "default), plus two");
+    std::println("synthetic objects of INSTRUCTIONS instructions written to "
+                 "DIR. --lift over");
+    std::println("every function is timed too, at JOBS threads.");
+    std::println("");
+    std::println("Server requests: function <file> <name> | range <file> "
+                 "<start> <end> |");
+    std::println("                 functions <file>");
+}
+
+int runBatch(int argc, char *argv[]) {
+    batch::Options options{.paths = {},
+                           .jobs = parallel::defaultJobCount(),
+                           .outputDir = std::nullopt};
+    std::optional<std::string> listFile;
+    for (int i = 2; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if ((arg == "-j" || arg == "-o" || arg == "-l") && i + 1 == argc) {
+            std::println(stderr, "Missing value for {}", arg);
+            return 1;
+        }
+        if (arg == "-j") {
+            std::string_view value = argv[++i];
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), options.jobs);
+            if (ec != std::errc() || end != value.data() + value.size() ||
+                options.jobs == 0) {
+                std::println(stderr, "Invalid job count: {}", value);
+                return 1;
+            }
+        } else if (arg == "-o") {
+            options.outputDir = argv[++i];
+        } else if (arg == "-l") {
+            listFile = argv[++i];
+        } else {
+            options.paths.emplace_back(arg);
+        }
+    }
+    if (listFile == "-" || (!listFile.has_value() && options.paths.empty())) {
+        auto paths = batch::readPathList(std::cin);
+        options.paths.insert(options.paths.end(), paths.begin(), paths.end());
+    } else if (listFile.has_value()) {
+        std::ifstream input(listFile.value());
+        if (!input) {
+            std::println(stderr, "Unable to read {}", listFile.value());
+            return 1;
+        }
+        auto paths = batch::readPathList(input);
+        options.paths.insert(options.paths.end(), paths.begin(), paths.end());
+    }
+    return batch::run(options) == 0 ? 0 : 1;
+}
+
+std::optional<uint64_t> parseHex(std::string_view text) {
+    if (text.starts_with("0x")) {
+        text.remove_prefix(2);
+    }
+    uint64_t value;
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    if (text.empty() || ec != std::errc() ||
+        end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Accepts a function name or a hexadecimal address. Names missing from the
+// symbol table, as in stripped libraries, are looked up among the dynamic
+// symbols.
+std::optional<uint64_t> resolveTarget(const binary::Elf64 &elf,
+                                      std::string_view target) {
+    for (const auto &function : elf.getFunctions()) {
+        if (function.name == target) {
+            return function.offset;
+        }
+    }
+    if (auto symbol = elf.findDynamicSymbol(target)) {
+        return elf.getDynamicSymbol(symbol.value()).st_value;
+    }
+    return parseHex(target);
+}
+
+// Splits `-j JOBS` from the positional arguments following the command.
+bool parseJobs(int argc, char *argv[], size_t &jobs,
+               std::vector<std::string_view> &args) {
+    for (int i = 2; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), jobs);
+            if (ec != std::errc() || end != value.data() + value.size() ||
+                jobs == 0) {
+                std::println(stderr, "Invalid job count: {}", value);
+                return false;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    return true;
+}
+
+int runXrefs(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.size() != 2) {
+        std::println(stderr, "Expected a file and a target");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        auto address = resolveTarget(*elf, args[1]);
+        if (!address.has_value()) {
+            throw std::runtime_error(std::format("Unknown target {}", args[1]));
+        }
+        auto index = xref::Index::build(*elf, jobs);
+        constexpr std::array kinds = {"call", "jump", "data"};
+        std::println("{}:", listing::describeAddress(*elf, address.value()));
+        for (uint32_t ref : index.referencesTo(address.value())) {
+            const auto &reference = index.getReferences()[ref];
+            std::println("\t{} from {}", kinds[(size_t)reference.kind],
+                         listing::describeAddress(*elf, reference.from));
+        }
+        auto fn = elf->findFunction(address.value());
+        if (fn.has_value() && elf->getFunctions()[fn.value()].offset ==
+                                  address.value()) {
+            for (uint32_t caller : index.callers(fn.value())) {
+                std::println("\tcaller {}", elf->getFunctions()[caller].name);
+            }
+            for (uint32_t callee : index.callees(fn.value())) {
+                std::println("\tcallee {}", elf->getFunctions()[callee].name);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int runSearch(int argc, char *argv[], bool instructions) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.size() != 2) {
+        std::println(stderr, "Expected a file and a pattern");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        std::vector<search::Match> matches;
+        if (instructions) {
+            matches = search::findInstructions(
+                *elf, search::InstructionPattern::parse(args[1]), jobs);
+        } else {
+            matches = search::findBytes(
+                *elf, search::BytePattern::parse(args[1]), jobs);
+        }
+        listing::writeMatches(std::cout, *elf, matches, instructions);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Groups identical functions, then reports them or, with `all`, lists every
+// function.
+int runIdentical(int argc, char *argv[], bool all) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.size() != 1) {
+        std::println(stderr, "Expected a file");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        auto groups = dedup::Groups::build(*elf, jobs);
+        if (all) {
+            listing::writeAllFunctions(std::cout, *elf, groups, jobs);
+        } else {
+            listing::writeIdenticalFunctions(std::cout, *elf, groups);
+        }
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int runProfile(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    uint64_t bias = 0;
+    size_t limit = SIZE_MAX;
+    std::vector<std::string_view> paths;
+    for (size_t i = 0; i < args.size(); i++) {
+        if ((args[i] == "-b" || args[i] == "-n") && i + 1 < args.size()) {
+            std::string_view value = args[++i];
+            int base = 10;
+            if (value.starts_with("0x")) {
+                value.remove_prefix(2);
+                base = 16;
+            }
+            uint64_t number;
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), number, base);
+            if (ec != std::errc() || end != value.data() + value.size()) {
+                std::println(stderr, "Invalid number: {}", args[i]);
+                return 1;
+            }
+            (args[i - 1] == "-b" ? bias : limit) = number;
+        } else {
+            paths.push_back(args[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        std::println(stderr, "Expected a file and a sample file");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(paths[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        std::ifstream input(std::string(paths[1]), std::ios::binary);
+        if (!input) {
+            throw std::runtime_error(
+                std::format("Cannot open {}", paths[1]));
+        }
+        input.seekg(0, std::ios::end);
+        std::string text(static_cast<size_t>(input.tellg()), '\0');
+        input.seekg(0, std::ios::beg);
+        input.read(text.data(), text.size());
+        if (!input) {
+            throw std::runtime_error(
+                std::format("Unable to read {}", paths[1]));
+        }
+        auto profile = profile::Profile::build(
+            *elf, profile::parseSamples(text, jobs), bias);
+        listing::writeProfile(std::cout, *elf, profile, limit, jobs);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Reads a running process: its executable mappings, or the code of one
+// function or address in it.
+int runProcess(int argc, char *argv[]) {
+    process::Snapshot::Options options;
+    size_t bytes = 64;
+    std::vector<std::string_view> args;
+    for (int i = 2; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--stop") {
+            options.stop = true;
+        } else if (arg == "-n" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), bytes);
+            if (ec != std::errc() || end != value.data() + value.size()) {
+                std::println(stderr, "Invalid size: {}", value);
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    pid_t pid = 0;
+    if (args.empty() || args.size() > 2 ||
+        std::from_chars(args[0].data(), args[0].data() + args[0].size(), pid)
+                .ec != std::errc()) {
+        std::println(stderr, "Expected a process id and optionally a target");
+        return 1;
+    }
+    try {
+        if (args.size() == 1) {
+            auto snapshot = process::Snapshot::capture(pid, options);
+            auto symbols =
+                process::Symbols::load(pid, snapshot.getMappings());
+            listing::writeProcessMappings(std::cout, snapshot, symbols);
+            return 0;
+        }
+        // The target is resolved first so that only its bytes are read.
+        auto symbols =
+            process::Symbols::load(pid, process::readMappings(pid));
+        // Symbols give their own size; bare addresses get `-n` bytes.
+        auto symbol = symbols.find(args[1]);
+        uint64_t address;
+        size_t size = bytes;
+        if (symbol.has_value()) {
+            address = symbol->address;
+            size = symbol->size;
+        } else {
+            std::string_view text = args[1];
+            if (text.starts_with("0x")) {
+                text.remove_prefix(2);
+            }
+            auto [end, ec] = std::from_chars(
+                text.data(), text.data() + text.size(), address, 16);
+            if (ec != std::errc() || end != text.data() + text.size()) {
+                throw std::runtime_error(
+                    std::format("Unknown target {}", args[1]));
+            }
+        }
+        options.address = address;
+        options.size = size;
+        auto snapshot = process::Snapshot::capture(pid, options);
+        if (const auto *mapping = snapshot.findMapping(address)) {
+            size = std::min<size_t>(size, mapping->end - address);
+        }
+        listing::writeProcessMemory(std::cout, snapshot, symbols, address,
+                                    size);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int runSections(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.size() != 1) {
+        std::println(stderr, "Expected a file");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        listing::writeSections(std::cout, *elf, jobs);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Counts mnemonics, prefixes and operand forms over every function.
+int runMix(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    size_t limit = SIZE_MAX;
+    std::vector<std::string_view> paths;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-n" && i + 1 < args.size()) {
+            std::string_view value = args[++i];
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), limit);
+            if (ec != std::errc() || end != value.data() + value.size()) {
+                std::println(stderr, "Invalid count: {}", value);
+                return 1;
+            }
+        } else {
+            paths.push_back(args[i]);
+        }
+    }
+    if (paths.size() != 1) {
+        std::println(stderr, "Expected a file");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(paths[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        auto mix = mix::Mix::build(*elf, jobs);
+        listing::writeInstructionMix(std::cout, *elf, mix, limit);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Writes every function as JSON Lines or binary records, to OUTPUT or
+// stdout.
+int runExport(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    std::optional<std::string_view> output;
+    std::vector<std::string_view> positional;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-o" && i + 1 < args.size()) {
+            output = args[++i];
+        } else {
+            positional.push_back(args[i]);
+        }
+    }
+    if (positional.size() != 2 ||
+        (positional[0] != "json" && positional[0] != "records")) {
+        std::println(stderr, "Expected json or records and a file");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(positional[1]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        std::ofstream file;
+        if (output.has_value()) {
+            file.open(std::string(output.value()), std::ios::binary);
+            if (!file) {
+                throw std::runtime_error(
+                    std::format("Cannot open {}", output.value()));
+            }
+        }
+        std::ostream &out = output.has_value() ? file : std::cout;
+        if (positional[0] == "json") {
+            records::writeJsonLines(out, *elf, jobs);
+        } else {
+            records::writeRecords(out, *elf, jobs);
+        }
+        if (!out) {
+            throw std::runtime_error("Unable to write output");
+        }
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Times this tool against objdump on a corpus and reports the results to
+// OUTPUT or stdout.
+int runBench(int argc, char *argv[]) {
+    bench::Options options{
+        .paths = {},
+        .files = 20,
+        .jobs = parallel::defaultJobCount(),
+        .runs = 3,
+        .synthetic = 1000000,
+        .workDir = (std::filesystem::temp_directory_path() / "disasmer-bench")
+                       .string()};
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, options.jobs, args)) {
+        return 1;
+    }
+    std::optional<std::string_view> output;
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string_view arg = args[i];
+        if ((arg == "-n" || arg == "-r" || arg == "-s") &&
+            i + 1 < args.size()) {
+            std::string_view value = args[++i];
+            uint64_t number;
+            auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), number);
+            if (ec != std::errc() || end != value.data() + value.size() ||
+                (number == 0 && arg != "-s")) {
+                std::println(stderr, "Invalid count: {}", value);
+                return 1;
+            }
+            if (arg == "-n") {
+                options.files = number;
+            } else if (arg == "-r") {
+                options.runs = number;
+            } else {
+                options.synthetic = number;
+            }
+        } else if (arg == "-d" && i + 1 < args.size()) {
+            options.workDir = args[++i];
+        } else if (arg == "-o" && i + 1 < args.size()) {
+            output = args[++i];
+        } else {
+            options.paths.emplace_back(arg);
+        }
+    }
+    if (options.paths.empty()) {
+        options.paths = {"/usr/bin", "/usr/lib"};
+    }
+    try {
+        std::ofstream file;
+        if (output.has_value()) {
+            file.open(std::string(output.value()));
+            if (!file) {
+                throw std::runtime_error(
+                    std::format("Cannot open {}", output.value()));
+            }
+        }
+        std::ostream &out = output.has_value() ? file : std::cout;
+        size_t failures = bench::run(options, out);
+        if (!out) {
+            throw std::runtime_error("Unable to write output");
+        }
+        return failures == 0 ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+}
+
+// Shows one function or address range of a file without parsing all of it.
+int runQuery(int argc, char *argv[], bool range) {
+    if (argc != 4) {
+        std::println(stderr, "Expected {} and a file",
+                     range ? "a range" : "a function");
+        return 1;
+    }
+    std::string_view target = argv[2];
+    try {
+        auto image = query::Image::open(argv[3]);
+        uint64_t start;
+        uint64_t end;
+        std::string label;
+        if (range) {
+            size_t dash = target.find('-');
+            auto first = parseHex(target.substr(0, dash));
+            auto last = dash == std::string_view::npos
+                            ? std::nullopt
+                            : parseHex(target.substr(dash + 1));
+            if (!first.has_value() || !last.has_value() ||
+                last.value() < first.value()) {
+                throw std::runtime_error(
+                    std::format("Invalid range {}", target));
+            }
+            start = first.value();
+            end = last.value();
+            auto function = image.functionAt(start);
+            if (!function.has_value()) {
+                label = std::format("0x{:x}", start);
+            } else if (function->address == start) {
+                label = function->name;
+            } else {
+                label = std::format("{}+0x{:x}", function->name,
+                                    start - function->address);
+            }
+        } else {
+            auto function = image.findFunction(target);
+            if (!function.has_value()) {
+                if (auto address = parseHex(target)) {
+                    function = image.functionAt(address.value());
+                }
+            }
+            if (!function.has_value()) {
+                throw std::runtime_error(
+                    std::format("Unknown function {}", target));
+            }
+            start = function->address;
+            end = function->address + function->size;
+            label = function->name;
+        }
+        listing::writeRange(std::cout, image, label, start, end);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Lists a static library, or the one function given after it.
+int runArchive(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.empty() || args.size() > 2) {
+        std::println(stderr, "Expected an archive and optionally a function");
+        return 1;
+    }
+    try {
+        auto archive = archive::Archive::fromFile(args[0]);
+        if (args.size() == 1) {
+            listing::writeArchive(std::cout, archive, jobs);
+            return 0;
+        }
+        // Local functions and archives without a symbol table need a
+        // search member by member.
+        std::vector<size_t> candidates;
+        if (auto member = archive.findMember(args[1])) {
+            candidates.push_back(member.value());
+        } else {
+            for (size_t i = 0; i < archive.getMembers().size(); i++) {
+                candidates.push_back(i);
+            }
+        }
+        for (size_t member : candidates) {
+            std::unique_ptr<binary::Elf64> elf;
+            try {
+                elf = archive.openMember(member);
+            } catch (const std::exception &) {
+                continue;
+            }
+            const auto &functions = elf->getFunctions();
+            for (size_t fn = 0; fn < functions.size(); fn++) {
+                if (functions[fn].name == args[1]) {
+                    std::println("==> {} <==",
+                                 archive.getMembers()[member].name);
+                    listing::writeFunction(std::cout, *elf, fn);
+                    return 0;
+                }
+            }
+        }
+        throw std::runtime_error(std::format("Unknown function {}", args[1]));
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+}
+
+// Runs `write` on the function named (or containing the address) given
+// after the file name.
+int runFunctionListing(int argc, char *argv[],
+                       void (*write)(std::ostream &, const binary::Elf64 &,
+                                     size_t)) {
+    if (argc != 4) {
+        std::println(stderr, "Expected a file and a function");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(argv[2]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        auto address = resolveTarget(*elf, argv[3]);
+        auto fn = address.has_value() ? elf->findFunction(address.value())
+                                      : std::nullopt;
+        if (!fn.has_value()) {
+            throw std::runtime_error(
+                std::format("Unknown function {}", argv[3]));
+        }
+        write(std::cout, *elf, fn.value());
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Lifts the function given after the file name, or every function of the
+// file in parallel when there is none.
+int runLift(int argc, char *argv[]) {
+    size_t jobs = parallel::defaultJobCount();
+    std::vector<std::string_view> args;
+    if (!parseJobs(argc, argv, jobs, args)) {
+        return 1;
+    }
+    if (args.size() == 2 && argc == 4) {
+        return runFunctionListing(argc, argv, listing::writeFunctionIR);
+    }
+    if (args.size() != 1) {
+        std::println(stderr, "Expected a file and optionally a function");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        listing::writeLiftedFunctions(std::cout, *elf, jobs);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// `target=bytes`, bytes being hexadecimal with optional spaces or `nop`.
+std::optional<patch::Edit> parseEdit(const binary::Elf64 &elf,
+                                     std::string_view text) {
+    size_t separator = text.rfind('=');
+    if (separator == std::string_view::npos) {
+        return std::nullopt;
+    }
+    auto address = resolveTarget(elf, text.substr(0, separator));
+    if (!address.has_value()) {
+        return std::nullopt;
+    }
+    patch::Edit edit;
+    edit.address = address.value();
+    std::string_view bytes = text.substr(separator + 1);
+    if (bytes == "nop") {
+        return edit;
+    }
+    std::string digits;
+    for (char c : bytes) {
+        if (c != ' ') {
+            digits += c;
+        }
+    }
+    if (digits.empty() || digits.size() % 2 != 0) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        uint8_t byte;
+        auto [end, ec] = std::from_chars(digits.data() + i,
+                                         digits.data() + i + 2, byte, 16);
+        if (ec != std::errc() || end != digits.data() + i + 2) {
+            return std::nullopt;
+        }
+        edit.bytes.push_back(byte);
+    }
+    return edit;
+}
+
+int runPatch(int argc, char *argv[]) {
+    bool dryRun = false;
+    bool force = false;
+    std::optional<std::string_view> output;
+    std::vector<std::string_view> args;
+    for (int i = 2; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--dry-run") {
+            dryRun = true;
+        } else if (arg == "--force") {
+            force = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() < 2) {
+        std::println(stderr, "Expected a file and at least one patch");
+        return 1;
+    }
+    try {
+        auto bin = binary::fromFile(args[0]);
+        auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+        if (elf == nullptr) {
+            throw std::runtime_error("Unsupported file type");
+        }
+        std::vector<patch::Edit> edits;
+        for (size_t i = 1; i < args.size(); i++) {
+            auto edit = parseEdit(*elf, args[i]);
+            if (!edit.has_value()) {
+                throw std::runtime_error(
+                    std::format("Invalid patch {}", args[i]));
+            }
+            edits.push_back(std::move(edit.value()));
+        }
+        auto writes = patch::plan(*elf, edits, force);
+        std::string_view path = args[0];
+        if (output.has_value() && !dryRun) {
+            patch::copyFile(args[0], output.value());
+            path = output.value();
+        }
+        // Reading the result back shows what actually landed in the file.
+        auto patched = patch::PatchedFile::apply(
+            path, writes,
+            dryRun ? patch::Mapping::Private : patch::Mapping::Shared);
+        binary::Elf64 result(patched.getData());
+        listing::writePatches(std::cout, result, writes);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int runServer(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::println(stderr, "Missing socket path");
+        return 1;
+    }
+    server::Options options{.socketPath = argv[2], .cacheCapacity = 16};
+    for (int i = 3; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "-c" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto [end, ec] =
+                std::from_chars(value.data(), value.data() + value.size(),
+                                options.cacheCapacity);
+            if (ec != std::errc() || end != value.data() + value.size() ||
+                options.cacheCapacity == 0) {
+                std::println(stderr, "Invalid cache size: {}", value);
+                return 1;
+            }
+        } else {
+            std::println(stderr, "Unknown option {}", arg);
+            return 1;
+        }
+    }
+    try {
+        server::serve(options);
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+}
+
+int runClient(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::println(stderr, "Missing socket path or request");
+        return 1;
+    }
+    std::string request = argv[3];
+    for (int i = 4; i < argc; i++) {
+        request += ' ';
+        request += argv[i];
+    }
+    try {
+        std::print("{}", server::query(argv[2], request));
+    } catch (const std::exception &e) {
+        std::println(stderr, "{}", e.what());
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        std::println("Usage: {} <filename>", argv[0]);
+        printUsage(argv[0]);
         return 0;
     }
-    auto bin = binary::fromFile(argv[1]);
-    if (auto elf32 = dynamic_cast<binary::Elf32 *>(bin.get())) {
-        [[maybe_unused]] auto header = elf32->getHeader();
-    } else if (auto elf64 = dynamic_cast<binary::Elf64 *>(bin.get())) {
-        auto functions = elf64->getFunctions();
-        std::optional<size_t> mainIdx;
-        for (size_t i = 0; i < functions.size(); i++) {
-            auto function = functions[i];
-            if (function.name == "main") {
-                mainIdx = i;
-            }
-        }
-        if (mainIdx.has_value()) {
-            [[maybe_unused]] auto idx = mainIdx.value();
-            auto code = elf64->getFunctionCode(idx);
-            std::println(
-                "main:\n{}",
-                disassemble::disassembleX86_64(
-                    code, disassemble::ReadingMode::LSB));
-        } else {
-            std::println("main function not found");
-        }
-    } else {
-        std::cerr << "Unsupported file type" << std::endl;
+    std::string_view command = argv[1];
+    if (command == "--function") {
+        return runQuery(argc, argv, false);
+    }
+    if (command == "--range") {
+        return runQuery(argc, argv, true);
+    }
+    if (command == "--batch") {
+        return runBatch(argc, argv);
+    }
+    if (command == "--xrefs") {
+        return runXrefs(argc, argv);
+    }
+    if (command == "--find") {
+        return runSearch(argc, argv, true);
+    }
+    if (command == "--find-bytes") {
+        return runSearch(argc, argv, false);
+    }
+    if (command == "--identical") {
+        return runIdentical(argc, argv, false);
+    }
+    if (command == "--all") {
+        return runIdentical(argc, argv, true);
+    }
+    if (command == "--profile") {
+        return runProfile(argc, argv);
+    }
+    if (command == "--process") {
+        return runProcess(argc, argv);
+    }
+    if (command == "--sections") {
+        return runSections(argc, argv);
+    }
+    if (command == "--mix") {
+        return runMix(argc, argv);
+    }
+    if (command == "--export") {
+        return runExport(argc, argv);
+    }
+    if (command == "--archive") {
+        return runArchive(argc, argv);
+    }
+    if (command == "--source") {
+        return runFunctionListing(
+            argc, argv,
+            [](std::ostream &out, const binary::Elf64 &elf, size_t fn) {
+                dwarf::LineIndex lines(elf);
+                listing::writeFunctionSource(out, elf, fn, lines);
+            });
+    }
+    if (command == "--patch") {
+        return runPatch(argc, argv);
+    }
+    if (command == "--cfg") {
+        return runFunctionListing(argc, argv, listing::writeFunctionGraph);
+    }
+    if (command == "--liveness") {
+        return runFunctionListing(argc, argv, listing::writeFunctionLiveness);
+    }
+    if (command == "--lift") {
+        return runLift(argc, argv);
+    }
+    if (command == "--bench") {
+        return runBench(argc, argv);
+    }
+    if (command == "--serve") {
+        return runServer(argc, argv);
+    }
+    if (command == "--client") {
+        return runClient(argc, argv);
+    }
+    try {
+        auto bin = binary::fromFile(argv[1]);
+        listing::writeMainListing(std::cout, *bin);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
     return 0;
 }
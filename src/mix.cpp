@@ -0,0 +1,218 @@
+#include <mix.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <parallel.hpp>
+#include <string>
+#include <utility>
+
+namespace mix {
+
+namespace {
+
+using binary::Function;
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+using disassemble::X86_64::OperandKind;
+using disassemble::X86_64::Register;
+
+constexpr size_t MnemonicCount = (size_t)Mnemonic::Count;
+constexpr size_t LockBit =
+    std::countr_zero(disassemble::X86_64::Prefix::Lock);
+
+// The SSE parts of the 0F map: moves and arithmetic on xmm registers, MMX,
+// compares and shuffles.
+[[nodiscard]] constexpr bool isVectorOpcode(uint8_t opcode) noexcept {
+    return (opcode >= 0x10 && opcode <= 0x17) ||
+           (opcode >= 0x28 && opcode <= 0x2f) ||
+           (opcode >= 0x50 && opcode <= 0x7f) || opcode == 0xc2 ||
+           (opcode >= 0xc4 && opcode <= 0xc6) || opcode >= 0xd0;
+}
+
+[[nodiscard]] bool isSimd(const Instruction &ins) noexcept {
+    using namespace disassemble::X86_64::Prefix;
+    return (ins.prefixes & (Vex | Evex)) || ins.opcodeMap >= 2 ||
+           (ins.opcodeMap == 1 && isVectorOpcode(ins.opcode));
+}
+
+[[nodiscard]] bool isStackAccess(const Instruction &ins) noexcept {
+    switch (ins.mnemonic) {
+    case Mnemonic::Push:
+    case Mnemonic::Pop:
+    case Mnemonic::Call:
+    case Mnemonic::Ret:
+    case Mnemonic::Leave:
+        return true;
+    default:
+        break;
+    }
+    for (const auto &operand : ins.getOperands()) {
+        if (operand.kind == OperandKind::Memory &&
+            (operand.base == Register::RSP || operand.base == Register::RBP)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+[[nodiscard]] size_t formOf(const Instruction &ins) noexcept {
+    size_t form = 0;
+    for (size_t op = ins.operandCount; op-- > 0;) {
+        form = form * OperandKinds + (size_t)ins.operands[op].kind;
+    }
+    return form;
+}
+
+[[nodiscard]] size_t countMemoryOperands(const Instruction &ins) noexcept {
+    size_t count = 0;
+    for (const auto &operand : ins.getOperands()) {
+        count += operand.kind == OperandKind::Memory;
+    }
+    return count;
+}
+
+} // namespace
+
+void Counts::add(const Instruction &ins) noexcept {
+    instructions++;
+    bytes += ins.length;
+    simd += isSimd(ins);
+    stack += isStackAccess(ins);
+    memoryOperands += countMemoryOperands(ins);
+    ripRelative += ins.ripTarget().has_value();
+    mnemonics[(size_t)ins.mnemonic]++;
+    for (size_t bit = 0; bit < prefixes.size(); bit++) {
+        prefixes[bit] += (ins.prefixes >> bit) & 1;
+    }
+    segments[(size_t)ins.segment]++;
+    forms[formOf(ins)]++;
+    if (ins.mnemonic == Mnemonic::Unknown) {
+        using namespace disassemble::X86_64::Prefix;
+        if (ins.prefixes & (Vex | Evex)) {
+            unknownVex++;
+        } else {
+            unknown[ins.opcodeMap & 3][ins.opcode]++;
+        }
+    }
+}
+
+Counts &Counts::operator+=(const Counts &other) noexcept {
+    auto merge = [](auto &to, const auto &from) {
+        for (size_t i = 0; i < to.size(); i++) {
+            to[i] += from[i];
+        }
+    };
+    instructions += other.instructions;
+    bytes += other.bytes;
+    simd += other.simd;
+    stack += other.stack;
+    memoryOperands += other.memoryOperands;
+    ripRelative += other.ripRelative;
+    merge(mnemonics, other.mnemonics);
+    merge(prefixes, other.prefixes);
+    merge(segments, other.segments);
+    merge(forms, other.forms);
+    for (size_t map = 0; map < unknown.size(); map++) {
+        merge(unknown[map], other.unknown[map]);
+    }
+    unknownVex += other.unknownVex;
+    return *this;
+}
+
+std::string formName(size_t form) {
+    static constexpr std::array<char, OperandKinds> letters = {'-', 'r', 'm',
+                                                               'i', 't'};
+    if (form == 0) {
+        return "none";
+    }
+    std::string name;
+    for (; form != 0; form /= OperandKinds) {
+        if (!name.empty()) {
+            name += ", ";
+        }
+        name += letters[form % OperandKinds];
+    }
+    return name;
+}
+
+Mix Mix::build(const binary::Elf64 &elf, size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    // Aliases and nested symbols cover the same code more than once: the
+    // totals only count what no earlier function covered.
+    std::vector<uint64_t> countedFrom(functions.size());
+    uint64_t covered = 0;
+    for (size_t fn = 0; fn < functions.size(); fn++) {
+        Function function = functions[fn];
+        countedFrom[fn] = std::max<uint64_t>(function.offset, covered);
+        covered = std::max<uint64_t>(covered, function.offset + function.size);
+    }
+    struct Worker {
+        std::vector<Instruction> instructions;
+        Counts totals;
+        // Instructions already counted in another function's totals.
+        Counts repeats;
+        // Mnemonics of the current function, cleared after each.
+        std::array<uint32_t, MnemonicCount> mnemonics{};
+    };
+    std::vector<Worker> workers(jobs);
+    Mix mix;
+    mix.functions_.resize(functions.size());
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t id) {
+        Worker &worker = workers[id];
+        FunctionMix &result = mix.functions_[fn];
+        disassemble::X86_64::decode(elf.getFunctionCode(fn),
+                                    functions[fn].offset,
+                                    disassemble::ReadingMode::LSB,
+                                    worker.instructions);
+        // The function's own counts are what it added to the totals and
+        // repeats.
+        const Counts &totals = worker.totals;
+        const Counts &repeats = worker.repeats;
+        uint64_t simd = totals.simd + repeats.simd;
+        uint64_t stack = totals.stack + repeats.stack;
+        uint64_t memoryOperands =
+            totals.memoryOperands + repeats.memoryOperands;
+        uint64_t locked =
+            totals.prefixes[LockBit] + repeats.prefixes[LockBit];
+        for (const Instruction &ins : worker.instructions) {
+            (ins.address >= countedFrom[fn] ? worker.totals : worker.repeats)
+                .add(ins);
+            worker.mnemonics[(size_t)ins.mnemonic]++;
+        }
+        result.instructions = worker.instructions.size();
+        result.unknown = worker.mnemonics[(size_t)Mnemonic::Unknown];
+        result.simd = totals.simd + repeats.simd - simd;
+        result.stack = totals.stack + repeats.stack - stack;
+        result.memoryOperands =
+            totals.memoryOperands + repeats.memoryOperands - memoryOperands;
+        result.locked =
+            totals.prefixes[LockBit] + repeats.prefixes[LockBit] - locked;
+        for (size_t m = 0; m < MnemonicCount; m++) {
+            uint32_t count = std::exchange(worker.mnemonics[m], 0);
+            for (size_t slot = 0; slot < result.top.size(); slot++) {
+                if (count > result.topCounts[slot]) {
+                    std::shift_right(result.top.begin() + slot,
+                                     result.top.end(), 1);
+                    std::shift_right(result.topCounts.begin() + slot,
+                                     result.topCounts.end(), 1);
+                    result.top[slot] = (Mnemonic)m;
+                    result.topCounts[slot] = count;
+                    break;
+                }
+            }
+        }
+    });
+    for (const Worker &worker : workers) {
+        mix.totals_ += worker.totals;
+    }
+    return mix;
+}
+
+const Counts &Mix::getTotals() const noexcept { return totals_; }
+
+const std::vector<FunctionMix> &Mix::getFunctions() const noexcept {
+    return functions_;
+}
+
+} // namespace mix
@@ -0,0 +1,241 @@
+#include <patch.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <disassemble.hpp>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace patch {
+
+namespace {
+
+constexpr uint8_t Nop = 0x90;
+
+class FileDescriptor {
+  public:
+    explicit FileDescriptor(int fd) noexcept : fd_(fd) {}
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    [[nodiscard]] int get() const noexcept { return fd_; }
+
+  private:
+    int fd_;
+};
+
+[[nodiscard]] int openFile(std::string_view path, int flags,
+                           mode_t mode = 0) {
+    int fd = open(std::string(path).c_str(), flags | O_CLOEXEC, mode);
+    if (fd < 0) {
+        throw std::runtime_error(
+            std::format("Cannot open {}: {}", path, std::strerror(errno)));
+    }
+    return fd;
+}
+
+// The new bytes must decode to whole instructions, the last one ending
+// exactly where they do, and unless `force`, to instructions the decoder
+// knows.
+void checkEncoding(const Edit &edit, bool force) {
+    std::vector<uint8_t> padded(edit.bytes);
+    padded.resize(edit.bytes.size() +
+                  disassemble::X86_64::MaxInstructionLength);
+    size_t offset = 0;
+    while (offset < edit.bytes.size()) {
+        auto ins = disassemble::X86_64::decodeInstruction(
+            padded, offset, edit.address, disassemble::ReadingMode::LSB);
+        if (ins.mnemonic == disassemble::X86_64::Mnemonic::Unknown &&
+            !force) {
+            throw std::runtime_error(std::format(
+                "{:#x}: cannot decode the new instructions", edit.address));
+        }
+        offset += ins.length;
+    }
+    if (offset != edit.bytes.size()) {
+        throw std::runtime_error(std::format(
+            "{:#x}: the last new instruction is cut short", edit.address));
+    }
+}
+
+} // namespace
+
+std::vector<Write> plan(const binary::Elf64 &elf,
+                        std::span<const Edit> edits, bool force) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    std::vector<const Edit *> sorted;
+    for (const Edit &edit : edits) {
+        sorted.push_back(&edit);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Edit *a, const Edit *b) {
+                         return a->address < b->address;
+                     });
+
+    std::unordered_map<size_t, std::vector<disassemble::X86_64::Instruction>>
+        decoded;
+    std::vector<Write> writes;
+    for (const Edit *edit : sorted) {
+        auto fn = elf.findFunction(edit->address);
+        if (!fn.has_value()) {
+            throw std::runtime_error(std::format(
+                "{:#x}: not inside a function", edit->address));
+        }
+        const binary::Function &function = elf.getFunctions()[fn.value()];
+        auto &instructions = decoded[fn.value()];
+        if (instructions.empty()) {
+            disassemble::X86_64::decode(elf.getFunctionCode(fn.value()),
+                                        function.offset,
+                                        disassemble::ReadingMode::LSB,
+                                        instructions);
+        }
+        auto first = std::lower_bound(
+            instructions.begin(), instructions.end(), edit->address,
+            [](const disassemble::X86_64::Instruction &ins, uint64_t address) {
+                return ins.address < address;
+            });
+        if (first == instructions.end() || first->address != edit->address) {
+            throw std::runtime_error(std::format(
+                "{:#x}: not an instruction boundary in {}", edit->address,
+                function.name));
+        }
+        size_t size = edit->bytes.empty() ? first->length : edit->bytes.size();
+        uint64_t end = edit->address;
+        for (auto it = first; it != instructions.end() &&
+                              end < edit->address + size;
+             ++it) {
+            end = it->address + it->length;
+        }
+        if (end < edit->address + size) {
+            throw std::runtime_error(std::format(
+                "{:#x}: {} bytes do not fit before the end of {}",
+                edit->address, size, function.name));
+        }
+        checkEncoding(*edit, force);
+
+        auto original = elf.getBytesAt(edit->address, end - edit->address);
+        auto offset = elf.getFileOffset(edit->address);
+        if (original.empty() || !offset.has_value()) {
+            throw std::runtime_error(std::format(
+                "{:#x}: no file contents to patch", edit->address));
+        }
+        Write write;
+        write.address = edit->address;
+        write.offset = offset.value();
+        write.original.assign(original.begin(), original.end());
+        write.bytes = edit->bytes;
+        write.bytes.resize(original.size(), Nop);
+        if (!writes.empty() &&
+            writes.back().address + writes.back().bytes.size() >
+                write.address) {
+            throw std::runtime_error(std::format(
+                "{:#x}: overlaps the edit at {:#x}", write.address,
+                writes.back().address));
+        }
+        writes.push_back(std::move(write));
+    }
+    return writes;
+}
+
+PatchedFile::PatchedFile(uint8_t *data, size_t size) noexcept
+    : data_(data), size_(size) {}
+
+PatchedFile::PatchedFile(PatchedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+PatchedFile::~PatchedFile() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+PatchedFile PatchedFile::apply(std::string_view path,
+                               std::span<const Write> writes,
+                               Mapping mapping) {
+    bool shared = mapping == Mapping::Shared;
+    FileDescriptor fd(openFile(path, shared ? O_RDWR : O_RDONLY));
+    struct stat status;
+    if (fstat(fd.get(), &status) != 0 || status.st_size == 0) {
+        throw std::runtime_error(std::format("Cannot map {}", path));
+    }
+    size_t size = status.st_size;
+    // Pages are only read in, and for shared mappings written back, when
+    // touched.
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         shared ? MAP_SHARED : MAP_PRIVATE, fd.get(), 0);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error(
+            std::format("Cannot map {}: {}", path, std::strerror(errno)));
+    }
+    PatchedFile file(static_cast<uint8_t *>(address), size);
+
+    for (const Write &write : writes) {
+        if (write.offset > size ||
+            write.original.size() > size - write.offset ||
+            !std::equal(write.original.begin(), write.original.end(),
+                        file.data_ + write.offset)) {
+            throw std::runtime_error(std::format(
+                "{}: {:#x} changed since the file was read", path,
+                write.address));
+        }
+    }
+    for (const Write &write : writes) {
+        std::copy(write.bytes.begin(), write.bytes.end(),
+                  file.data_ + write.offset);
+    }
+    if (shared) {
+        size_t pageSize = sysconf(_SC_PAGESIZE);
+        for (const Write &write : writes) {
+            size_t start = write.offset / pageSize * pageSize;
+            size_t end = write.offset + write.bytes.size();
+            if (msync(file.data_ + start, end - start, MS_SYNC) != 0) {
+                throw std::runtime_error(std::format(
+                    "Cannot write {}: {}", path, std::strerror(errno)));
+            }
+        }
+    }
+    return file;
+}
+
+std::span<const uint8_t> PatchedFile::getData() const noexcept {
+    return std::span<const uint8_t>(data_, size_);
+}
+
+void copyFile(std::string_view from, std::string_view to) {
+    FileDescriptor source(openFile(from, O_RDONLY));
+    struct stat status;
+    if (fstat(source.get(), &status) != 0) {
+        throw std::runtime_error(
+            std::format("Cannot read {}: {}", from, std::strerror(errno)));
+    }
+    FileDescriptor target(
+        openFile(to, O_WRONLY | O_CREAT | O_TRUNC, status.st_mode & 07777));
+    size_t left = status.st_size;
+    while (left > 0) {
+        ssize_t copied = copy_file_range(source.get(), nullptr, target.get(),
+                                         nullptr, left, 0);
+        if (copied <= 0) {
+            throw std::runtime_error(std::format(
+                "Cannot copy {} to {}: {}", from, to,
+                copied == 0 ? "unexpected end of file"
+                            : std::strerror(errno)));
+        }
+        left -= copied;
+    }
+}
+
+} // namespace patch
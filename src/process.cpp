@@ -0,0 +1,367 @@
+#include <process.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <thread>
+
+namespace process {
+
+namespace {
+
+// Splits off the text up to the next space, skipping the spaces after it.
+std::string_view nextField(std::string_view &line) noexcept {
+    size_t end = std::min(line.find(' '), line.size());
+    std::string_view field = line.substr(0, end);
+    line.remove_prefix(end);
+    while (!line.empty() && line.front() == ' ') {
+        line.remove_prefix(1);
+    }
+    return field;
+}
+
+[[nodiscard]] bool parseHex(std::string_view text, uint64_t &value) noexcept {
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    return !text.empty() && ec == std::errc() &&
+           end == text.data() + text.size();
+}
+
+// Whether the kernel reports `pid` as stopped or traced.
+[[nodiscard]] bool isStopped(pid_t pid) {
+    std::ifstream input(std::format("/proc/{}/stat", pid));
+    std::string stat;
+    std::getline(input, stat);
+    // The state follows the parenthesized command name.
+    size_t close = stat.rfind(')');
+    return close != std::string::npos && close + 2 < stat.size() &&
+           (stat[close + 2] == 'T' || stat[close + 2] == 't');
+}
+
+// Waits until the kernel reports `pid` as stopped, for a bounded time.
+void waitUntilStopped(pid_t pid) {
+    for (size_t attempt = 0; attempt < 1000 && !isStopped(pid); attempt++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+// Sends SIGCONT when leaving the scope of a stop of our own.
+class Resume {
+  public:
+    explicit Resume(pid_t pid) : pid_(pid) {}
+    ~Resume() { kill(pid_, SIGCONT); }
+
+    Resume(const Resume &) = delete;
+    Resume &operator=(const Resume &) = delete;
+
+  private:
+    pid_t pid_;
+};
+
+} // namespace
+
+std::vector<Mapping> readMappings(pid_t pid) {
+    std::ifstream input(std::format("/proc/{}/maps", pid));
+    if (!input) {
+        throw std::runtime_error(
+            std::format("Unable to read the mappings of process {}", pid));
+    }
+    std::vector<Mapping> mappings;
+    std::string text;
+    while (std::getline(input, text)) {
+        // start-end perms offset dev inode [path]
+        std::string_view line = text;
+        std::string_view range = nextField(line);
+        std::string_view perms = nextField(line);
+        std::string_view offset = nextField(line);
+        nextField(line);
+        nextField(line);
+        size_t dash = range.find('-');
+        Mapping mapping;
+        if (dash == std::string_view::npos || perms.size() < 3 ||
+            !parseHex(range.substr(0, dash), mapping.start) ||
+            !parseHex(range.substr(dash + 1), mapping.end) ||
+            !parseHex(offset, mapping.offset)) {
+            throw std::runtime_error(
+                std::format("Malformed mapping: {}", text));
+        }
+        mapping.executable = perms[2] == 'x';
+        if (line.ends_with(" (deleted)")) {
+            line.remove_suffix(10);
+        }
+        mapping.path = line;
+        mappings.push_back(std::move(mapping));
+    }
+    return mappings;
+}
+
+Snapshot Snapshot::capture(pid_t pid, const Options &options) {
+    Snapshot snapshot;
+    size_t total = 0;
+    for (Mapping &mapping : readMappings(pid)) {
+        if (options.address.has_value()) {
+            uint64_t address = options.address.value();
+            if (!mapping.executable || address < mapping.start ||
+                address >= mapping.end) {
+                continue;
+            }
+            mapping.offset += address - mapping.start;
+            mapping.start = address;
+            mapping.end = address + std::min<uint64_t>(
+                                        options.size, mapping.end - address);
+        }
+        size_t size = mapping.end - mapping.start;
+        // The vsyscall page cannot be read from another process.
+        if (!mapping.executable || mapping.path == "[vsyscall]" ||
+            total + size > options.maxBytes) {
+            continue;
+        }
+        snapshot.positions_.push_back(total);
+        snapshot.mappings_.push_back(std::move(mapping));
+        total += size;
+    }
+    snapshot.positions_.push_back(total);
+    snapshot.memory_.resize(total);
+
+    std::vector<iovec> remote(snapshot.mappings_.size());
+    for (size_t i = 0; i < remote.size(); i++) {
+        const Mapping &mapping = snapshot.mappings_[i];
+        remote[i].iov_base = reinterpret_cast<void *>(mapping.start);
+        remote[i].iov_len = mapping.end - mapping.start;
+    }
+    std::vector<uint8_t> readable(remote.size(), 1);
+
+    std::optional<Resume> resume;
+    if (options.stop && !isStopped(pid)) {
+        if (kill(pid, SIGSTOP) != 0) {
+            throw std::runtime_error(std::format(
+                "Unable to stop process {}: {}", pid, std::strerror(errno)));
+        }
+        resume.emplace(pid);
+        waitUntilStopped(pid);
+    }
+    // One call covers up to IOV_MAX mappings, all landing contiguously in
+    // memory_. A mapping that cannot be read ends the transfer early; it
+    // is dropped and the next call resumes after it.
+    size_t next = 0;
+    while (next < remote.size()) {
+        size_t count = std::min<size_t>(remote.size() - next, IOV_MAX);
+        iovec local;
+        local.iov_base = snapshot.memory_.data() + snapshot.positions_[next];
+        local.iov_len =
+            snapshot.positions_[next + count] - snapshot.positions_[next];
+        ssize_t read =
+            process_vm_readv(pid, &local, 1, &remote[next], count, 0);
+        if (read < 0 && errno != EFAULT && errno != EIO) {
+            throw std::runtime_error(std::format(
+                "Unable to read process {}: {}", pid, std::strerror(errno)));
+        }
+        size_t left = std::max<ssize_t>(read, 0);
+        size_t end = next + count;
+        while (next < end && left >= remote[next].iov_len) {
+            left -= remote[next].iov_len;
+            next++;
+        }
+        if (next < end) {
+            readable[next++] = 0;
+        }
+    }
+    resume.reset();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < snapshot.mappings_.size(); i++) {
+        if (!readable[i]) {
+            continue;
+        }
+        if (kept != i) {
+            snapshot.positions_[kept] = snapshot.positions_[i];
+            snapshot.mappings_[kept] = std::move(snapshot.mappings_[i]);
+        }
+        kept++;
+    }
+    snapshot.mappings_.resize(kept);
+    snapshot.positions_.resize(kept);
+    return snapshot;
+}
+
+const std::vector<Mapping> &Snapshot::getMappings() const noexcept {
+    return mappings_;
+}
+
+const Mapping *Snapshot::findMapping(uint64_t address) const noexcept {
+    auto it = std::upper_bound(mappings_.begin(), mappings_.end(), address,
+                               [](uint64_t address, const Mapping &mapping) {
+                                   return address < mapping.start;
+                               });
+    if (it == mappings_.begin() || address >= (it - 1)->end) {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
+
+std::span<const uint8_t> Snapshot::getBytes(uint64_t address,
+                                            size_t size) const noexcept {
+    const Mapping *mapping = findMapping(address);
+    if (mapping == nullptr || size > mapping->end - address) {
+        return {};
+    }
+    size_t position = positions_[mapping - mappings_.data()];
+    return std::span(memory_).subspan(position + (address - mapping->start),
+                                      size);
+}
+
+Symbols Symbols::load(pid_t pid, std::span<const Mapping> mappings) {
+    Symbols symbols;
+    for (const Mapping &mapping : mappings) {
+        if (!mapping.executable || !mapping.path.starts_with('/')) {
+            continue;
+        }
+        auto known = std::find_if(
+            symbols.modules_.begin(), symbols.modules_.end(),
+            [&](const Module &module) {
+                return module.start <= mapping.start &&
+                       mapping.start < module.end;
+            });
+        if (known != symbols.modules_.end()) {
+            continue;
+        }
+        std::unique_ptr<binary::Binary> file;
+        try {
+            file = binary::fromFile(mapping.path);
+        } catch (const std::exception &) {
+            // Files gone or unreadable since they were mapped stay
+            // anonymous.
+            continue;
+        }
+        auto elf = dynamic_cast<const binary::Elf64 *>(file.get());
+        if (elf == nullptr) {
+            continue;
+        }
+        // The load bias follows from any allocated section inside the
+        // mapping: its runtime address against its file address.
+        std::optional<uint64_t> bias;
+        for (size_t i = 0; i < elf->getHeader().e_shnum; i++) {
+            Elf64_Shdr section = elf->getSectionHeader(i);
+            if ((section.sh_flags & SHF_ALLOC) != 0 &&
+                section.sh_type != SHT_NOBITS &&
+                section.sh_offset >= mapping.offset &&
+                section.sh_offset < mapping.offset + mapping.end -
+                                        mapping.start) {
+                bias = mapping.start + (section.sh_offset - mapping.offset) -
+                       section.sh_addr;
+                break;
+            }
+        }
+        if (!bias.has_value()) {
+            continue;
+        }
+        Module module;
+        module.elf = elf;
+        module.file = std::move(file);
+        module.bias = bias.value();
+        module.start = mapping.start;
+        module.end = mapping.end;
+        // The other executable mappings of the same file share the bias.
+        for (const Mapping &other : mappings) {
+            if (other.executable && other.path == mapping.path) {
+                module.start = std::min(module.start, other.start);
+                module.end = std::max(module.end, other.end);
+            }
+        }
+        symbols.modules_.push_back(std::move(module));
+    }
+
+    // `start size name` per line, hex without prefix.
+    std::ifstream input(std::format("/tmp/perf-{}.map", pid),
+                        std::ios::binary);
+    if (input) {
+        symbols.jitNames_.assign(std::istreambuf_iterator<char>(input), {});
+        std::string_view rest = symbols.jitNames_;
+        while (!rest.empty()) {
+            size_t end = std::min(rest.find('\n'), rest.size());
+            std::string_view line = rest.substr(0, end);
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+            Symbol symbol;
+            std::string_view start = nextField(line);
+            std::string_view size = nextField(line);
+            if (parseHex(start, symbol.address) &&
+                parseHex(size, symbol.size) && !line.empty()) {
+                symbol.name = line;
+                symbols.jitSymbols_.push_back(symbol);
+            }
+        }
+        std::sort(symbols.jitSymbols_.begin(), symbols.jitSymbols_.end(),
+                  [](const Symbol &a, const Symbol &b) {
+                      return a.address < b.address;
+                  });
+    }
+    return symbols;
+}
+
+std::optional<Symbol> Symbols::find(uint64_t address) const {
+    for (const Module &module : modules_) {
+        if (address < module.start || address >= module.end) {
+            continue;
+        }
+        auto fn = module.elf->findFunction(address - module.bias);
+        if (!fn.has_value()) {
+            return std::nullopt;
+        }
+        const binary::Function &function =
+            module.elf->getFunctions()[fn.value()];
+        return Symbol{function.offset + module.bias, function.size,
+                      function.name};
+    }
+    auto it = std::upper_bound(jitSymbols_.begin(), jitSymbols_.end(),
+                               address,
+                               [](uint64_t address, const Symbol &symbol) {
+                                   return address < symbol.address;
+                               });
+    if (it == jitSymbols_.begin() ||
+        address >= (it - 1)->address + std::max<uint64_t>((it - 1)->size, 1)) {
+        return std::nullopt;
+    }
+    return *(it - 1);
+}
+
+std::optional<Symbol> Symbols::find(std::string_view name) const {
+    for (const Module &module : modules_) {
+        for (const binary::Function &function : module.elf->getFunctions()) {
+            if (function.name == name) {
+                return Symbol{function.offset + module.bias, function.size,
+                              function.name};
+            }
+        }
+    }
+    for (const Symbol &symbol : jitSymbols_) {
+        if (symbol.name == name) {
+            return symbol;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view Symbols::findImport(uint64_t address) const {
+    for (const Module &module : modules_) {
+        if (address >= module.start && address < module.end) {
+            return module.elf->getImportName(address - module.bias);
+        }
+    }
+    return {};
+}
+
+size_t Symbols::getModuleCount() const noexcept { return modules_.size(); }
+
+size_t Symbols::getJitSymbolCount() const noexcept {
+    return jitSymbols_.size();
+}
+
+} // namespace process
@@ -0,0 +1,347 @@
+#include <profile.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <optional>
+#include <parallel.hpp>
+#include <stdexcept>
+
+namespace profile {
+
+namespace {
+
+[[nodiscard]] bool isBlank(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+class Tokens {
+  public:
+    explicit Tokens(std::string_view line) : line_(line) {}
+
+    // The next whitespace separated token, empty at the end of the line.
+    [[nodiscard]] std::string_view next() noexcept {
+        while (position_ < line_.size() && isBlank(line_[position_])) {
+            position_++;
+        }
+        size_t start = position_;
+        while (position_ < line_.size() && !isBlank(line_[position_])) {
+            position_++;
+        }
+        return line_.substr(start, position_ - start);
+    }
+
+  private:
+    std::string_view line_;
+    size_t position_ = 0;
+};
+
+[[nodiscard]] std::optional<uint64_t> parseNumber(std::string_view token,
+                                                  int base) noexcept {
+    if (base == 16 && (token.starts_with("0x") || token.starts_with("0X"))) {
+        token.remove_prefix(2);
+    }
+    uint64_t value;
+    auto [end, ec] = std::from_chars(token.data(),
+                                     token.data() + token.size(), value, base);
+    if (token.empty() || ec != std::errc() ||
+        end != token.data() + token.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// perf prints the time of a sample as `seconds.fraction:`.
+[[nodiscard]] bool isTimestamp(std::string_view token) noexcept {
+    if (token.size() < 2 || !token.ends_with(':')) {
+        return false;
+    }
+    token.remove_suffix(1);
+    size_t dot = token.find('.');
+    return dot != std::string_view::npos && dot != 0 &&
+           token.find_first_not_of("0123456789.") == std::string_view::npos;
+}
+
+// Whether `line` is a perf sample header, going by its timestamp.
+[[nodiscard]] bool hasTimestamp(std::string_view line) noexcept {
+    Tokens tokens(line);
+    for (auto token = tokens.next(); !token.empty(); token = tokens.next()) {
+        if (isTimestamp(token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Callchain frames (`ip sym (dso)`) have three or more tokens and no
+// timestamp; every other line starts a new sample.
+[[nodiscard]] bool startsSample(std::string_view line) noexcept {
+    Tokens tokens(line);
+    (void)tokens.next();
+    (void)tokens.next();
+    return tokens.next().empty() || hasTimestamp(line);
+}
+
+class Parser {
+  public:
+    // Returns false for lines in none of the known formats.
+    bool line(std::string_view line, std::vector<Sample> &out) {
+        Tokens tokens(line);
+        std::string_view first = tokens.next();
+        if (first.empty()) {
+            // Blank lines separate perf samples with callchains.
+            awaitingIp_ = false;
+            inCallchain_ = false;
+            return true;
+        }
+        if (first.starts_with('#')) {
+            return true;
+        }
+        if (awaitingIp_) {
+            // The leaf frame of a callchain.
+            awaitingIp_ = false;
+            inCallchain_ = true;
+            return add(first, 1, out);
+        }
+        std::string_view second = tokens.next();
+        std::string_view third = tokens.next();
+        if (third.empty() && parseNumber(first, 16).has_value()) {
+            inCallchain_ = false;
+            if (second.empty()) {
+                return add(first, 1, out);
+            }
+            if (auto count = parseNumber(second, 10)) {
+                return add(first, count.value(), out);
+            }
+        }
+
+        // perf script: comm, tid, [cpu], time, [period], event, ip, sym...
+        Tokens perf(line);
+        std::string_view token = perf.next();
+        while (!token.empty() && !isTimestamp(token)) {
+            token = perf.next();
+        }
+        if (token.empty()) {
+            if (inCallchain_ && !third.empty()) {
+                return true;
+            }
+            inCallchain_ = false;
+            // `perf script -F ip,sym` and the like.
+            return add(first, 1, out);
+        }
+        std::string_view afterTime = perf.next();
+        token = afterTime;
+        while (!token.empty() && !token.ends_with(':')) {
+            token = perf.next();
+        }
+        std::string_view ip = token.empty() ? afterTime : perf.next();
+        if (ip.empty()) {
+            awaitingIp_ = true;
+            return true;
+        }
+        inCallchain_ = true;
+        return add(ip, 1, out);
+    }
+
+  private:
+    static bool add(std::string_view address, uint64_t count,
+                    std::vector<Sample> &out) {
+        auto value = parseNumber(address, 16);
+        if (!value.has_value()) {
+            return false;
+        }
+        out.push_back(Sample{value.value(), count});
+        return true;
+    }
+
+    bool awaitingIp_ = false;
+    bool inCallchain_ = false;
+};
+
+// Merges the neighbouring samples of sorted `samples` sharing an address.
+void combine(std::vector<Sample> &samples) {
+    size_t kept = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (kept != 0 && samples[kept - 1].address == samples[i].address) {
+            samples[kept - 1].count += samples[i].count;
+        } else {
+            samples[kept++] = samples[i];
+        }
+    }
+    samples.resize(kept);
+}
+
+bool byAddress(const Sample &a, const Sample &b) noexcept {
+    return a.address < b.address;
+}
+
+} // namespace
+
+std::vector<Sample> parseSamples(std::string_view text, size_t jobs) {
+    // Chunks end before a line starting a sample, so no callchain
+    // straddles two of them.
+    constexpr size_t ChunkSize = 1 << 22;
+    std::vector<size_t> bounds = {0};
+    while (bounds.back() < text.size()) {
+        size_t end = bounds.back() + ChunkSize;
+        while (end < text.size()) {
+            end = text.find('\n', end);
+            if (end == std::string_view::npos) {
+                end = text.size();
+                break;
+            }
+            end++;
+            size_t lineEnd = std::min(text.find('\n', end), text.size());
+            if (startsSample(text.substr(end, lineEnd - end))) {
+                break;
+            }
+        }
+        bounds.push_back(std::min(end, text.size()));
+    }
+
+    size_t chunks = bounds.size() - 1;
+    std::vector<std::vector<Sample>> parsed(chunks);
+    std::vector<std::optional<std::string_view>> errors(chunks);
+    parallel::forEach(chunks, jobs, [&](size_t chunk, size_t) {
+        std::string_view rest =
+            text.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]);
+        Parser parser;
+        std::vector<Sample> &samples = parsed[chunk];
+        while (!rest.empty()) {
+            size_t end = std::min(rest.find('\n'), rest.size());
+            std::string_view line = rest.substr(0, end);
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+            if (!parser.line(line, samples)) {
+                errors[chunk] = line;
+                return;
+            }
+        }
+        // Hot code repeats the same addresses, so combining here shrinks
+        // what the final sort has to handle.
+        std::sort(samples.begin(), samples.end(), byAddress);
+        combine(samples);
+    });
+    for (const auto &error : errors) {
+        if (error.has_value()) {
+            throw std::runtime_error(
+                std::format("Unrecognized sample line: {}", error.value()));
+        }
+    }
+
+    size_t total = 0;
+    for (const auto &samples : parsed) {
+        total += samples.size();
+    }
+    std::vector<Sample> samples;
+    samples.reserve(total);
+    for (auto &chunk : parsed) {
+        samples.insert(samples.end(), chunk.begin(), chunk.end());
+        std::vector<Sample>().swap(chunk);
+    }
+    if (chunks > 1) {
+        parallel::sort(samples, jobs, byAddress);
+        combine(samples);
+    }
+    return samples;
+}
+
+Profile Profile::build(const binary::Elf64 &elf,
+                       std::vector<Sample> &&samples, uint64_t bias) {
+    Profile profile;
+    for (const Sample &sample : samples) {
+        profile.total_ += sample.count;
+    }
+    auto below = std::partition_point(
+        samples.begin(), samples.end(),
+        [bias](const Sample &sample) { return sample.address < bias; });
+    samples.erase(samples.begin(), below);
+    for (Sample &sample : samples) {
+        sample.address -= bias;
+    }
+
+    // Samples and functions are both in address order, so one merge walk
+    // attributes everything.
+    const auto &functions = elf.getFunctions();
+    std::vector<uint64_t> counts(functions.size());
+    size_t next = 0;
+    uint64_t attributed = 0;
+    for (const Sample &sample : samples) {
+        while (next < functions.size() &&
+               functions.getAddress(next) <= sample.address) {
+            next++;
+        }
+        // As in Elf64::findFunction, step back over aliases and nested
+        // symbols until one covers the address.
+        for (size_t i = next; i != 0;) {
+            const binary::Function &fn = functions[--i];
+            if (sample.address < fn.offset + std::max<size_t>(fn.size, 1)) {
+                counts[i] += sample.count;
+                attributed += sample.count;
+                break;
+            }
+            if (i != 0 && functions.getAddress(i - 1) != fn.offset) {
+                break;
+            }
+        }
+    }
+    profile.unattributed_ = profile.total_ - attributed;
+
+    for (size_t fn = 0; fn < counts.size(); fn++) {
+        if (counts[fn] != 0) {
+            profile.functions_.push_back(FunctionProfile{(uint32_t)fn,
+                                                         counts[fn]});
+        }
+    }
+    std::sort(profile.functions_.begin(), profile.functions_.end(),
+              [&](const FunctionProfile &a, const FunctionProfile &b) {
+                  if (a.count != b.count) {
+                      return a.count > b.count;
+                  }
+                  return functions[a.function].offset <
+                         functions[b.function].offset;
+              });
+    profile.samples_ = std::move(samples);
+    return profile;
+}
+
+uint64_t Profile::getTotal() const noexcept { return total_; }
+
+uint64_t Profile::getUnattributed() const noexcept { return unattributed_; }
+
+const std::vector<FunctionProfile> &Profile::getFunctions() const noexcept {
+    return functions_;
+}
+
+std::span<const Sample>
+Profile::samplesIn(const binary::Function &function) const noexcept {
+    auto first = std::lower_bound(
+        samples_.begin(), samples_.end(), function.offset,
+        [](const Sample &sample, uint64_t address) {
+            return sample.address < address;
+        });
+    auto last = std::lower_bound(
+        first, samples_.end(), function.offset + function.size,
+        [](const Sample &sample, uint64_t address) {
+            return sample.address < address;
+        });
+    return std::span(first, last);
+}
+
+void countInstructions(
+    std::span<const disassemble::X86_64::Instruction> instructions,
+    std::span<const Sample> samples, std::vector<uint64_t> &counts) {
+    counts.assign(instructions.size(), 0);
+    size_t next = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const auto &ins = instructions[i];
+        while (next < samples.size() && samples[next].address < ins.address) {
+            next++;
+        }
+        while (next < samples.size() &&
+               samples[next].address < ins.address + ins.length) {
+            counts[i] += samples[next++].count;
+        }
+    }
+}
+
+} // namespace profile
@@ -0,0 +1,240 @@
+#include <query.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace query {
+
+namespace {
+
+template <typename T>
+[[nodiscard]] T readStruct(const uint8_t *data) noexcept {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+[[nodiscard]] bool isFunction(const Elf64_Sym &symbol) noexcept {
+    return ELF64_ST_TYPE(symbol.st_info) == STT_FUNC &&
+           symbol.st_shndx != SHN_UNDEF && symbol.st_name != 0;
+}
+
+} // namespace
+
+Image::Image(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+Image::Image(Image &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      segments_(std::move(other.segments_)),
+      sections_(std::move(other.sections_)),
+      relocatable_(other.relocatable_), machine_(other.machine_) {}
+
+Image::~Image() {
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+}
+
+Image Image::open(std::string_view path) {
+    int fd = ::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(
+            std::format("Cannot open {}: {}", path, std::strerror(errno)));
+    }
+    struct stat status;
+    void *address = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+        address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error(std::format("Cannot map {}", path));
+    }
+    Image image(static_cast<const uint8_t *>(address), status.st_size);
+
+    if (image.size_ < sizeof(Elf64_Ehdr) ||
+        std::memcmp(image.data_, ELFMAG, SELFMAG) != 0 ||
+        image.data_[EI_CLASS] != ELFCLASS64) {
+        throw std::runtime_error(
+            std::format("{}: not a 64-bit ELF file", path));
+    }
+    auto header = readStruct<Elf64_Ehdr>(image.data_);
+    auto table = [&](uint64_t offset, size_t count, size_t entrySize,
+                     size_t expected) {
+        if (count != 0 && (entrySize < expected ||
+                           offset > image.size_ ||
+                           count > (image.size_ - offset) / entrySize)) {
+            throw std::runtime_error(
+                std::format("{}: malformed ELF header", path));
+        }
+    };
+    table(header.e_phoff, header.e_phnum, header.e_phentsize,
+          sizeof(Elf64_Phdr));
+    table(header.e_shoff, header.e_shnum, header.e_shentsize,
+          sizeof(Elf64_Shdr));
+    image.relocatable_ = header.e_type == ET_REL;
+    image.machine_ = header.e_machine;
+    for (size_t i = 0; i < header.e_phnum; i++) {
+        auto segment = readStruct<Elf64_Phdr>(
+            image.data_ + header.e_phoff + i * header.e_phentsize);
+        if (segment.p_type == PT_LOAD) {
+            image.segments_.push_back(segment);
+        }
+    }
+    for (size_t i = 0; i < header.e_shnum; i++) {
+        auto section = readStruct<Elf64_Shdr>(
+            image.data_ + header.e_shoff + i * header.e_shentsize);
+        // As in binary::Elf64, sections of relocatable objects are placed
+        // at their file offset.
+        if (image.relocatable_ && (section.sh_flags & SHF_ALLOC)) {
+            section.sh_addr = section.sh_offset;
+        }
+        image.sections_.push_back(section);
+    }
+    return image;
+}
+
+std::span<const uint8_t>
+Image::getSection(const Elf64_Shdr &section) const noexcept {
+    if (section.sh_type == SHT_NOBITS || section.sh_offset > size_ ||
+        section.sh_size > size_ - section.sh_offset) {
+        return {};
+    }
+    return std::span(data_ + section.sh_offset, section.sh_size);
+}
+
+std::optional<Image::SymbolTable> Image::getSymbolTable() const noexcept {
+    const Elf64_Shdr *found = nullptr;
+    for (const Elf64_Shdr &section : sections_) {
+        if (section.sh_type == SHT_SYMTAB ||
+            (section.sh_type == SHT_DYNSYM && found == nullptr)) {
+            found = &section;
+        }
+    }
+    if (found == nullptr || found->sh_link >= sections_.size()) {
+        return std::nullopt;
+    }
+    SymbolTable table;
+    table.symbols = getSection(*found);
+    table.names = getSection(sections_[found->sh_link]);
+    return table;
+}
+
+uint64_t Image::getAddress(const Elf64_Sym &symbol) const noexcept {
+    if (relocatable_ && symbol.st_shndx < sections_.size()) {
+        return symbol.st_value + sections_[symbol.st_shndx].sh_addr;
+    }
+    return symbol.st_value;
+}
+
+std::string_view Image::getName(const SymbolTable &table,
+                                uint32_t offset) const noexcept {
+    if (offset >= table.names.size()) {
+        return {};
+    }
+    std::string_view names(reinterpret_cast<const char *>(table.names.data()),
+                           table.names.size());
+    names.remove_prefix(offset);
+    return names.substr(0, names.find('\0'));
+}
+
+std::optional<Symbol> Image::findFunction(std::string_view name) const {
+    auto table = getSymbolTable();
+    if (!table.has_value() || name.empty()) {
+        return std::nullopt;
+    }
+    // Linkers share string tails, so a symbol may name the end of a longer
+    // string: every place the name ends with a NUL is a candidate.
+    std::string needle(name);
+    needle += '\0';
+    std::boyer_moore_horspool_searcher searcher(needle.begin(), needle.end());
+    auto names = reinterpret_cast<const char *>(table->names.data());
+    auto end = names + table->names.size();
+    std::vector<uint32_t> offsets;
+    for (auto it = std::search(names, end, searcher); it != end;
+         it = std::search(it + 1, end, searcher)) {
+        offsets.push_back(it - names);
+    }
+    if (offsets.empty()) {
+        return std::nullopt;
+    }
+
+    for (size_t position = 0;
+         position + sizeof(Elf64_Sym) <= table->symbols.size();
+         position += sizeof(Elf64_Sym)) {
+        auto symbol = readStruct<Elf64_Sym>(table->symbols.data() + position);
+        if (isFunction(symbol) &&
+            std::binary_search(offsets.begin(), offsets.end(),
+                               symbol.st_name)) {
+            return Symbol{getName(*table, symbol.st_name), getAddress(symbol),
+                          symbol.st_size};
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Symbol> Image::functionAt(uint64_t address) const {
+    auto table = getSymbolTable();
+    if (!table.has_value()) {
+        return std::nullopt;
+    }
+    for (size_t position = 0;
+         position + sizeof(Elf64_Sym) <= table->symbols.size();
+         position += sizeof(Elf64_Sym)) {
+        auto symbol = readStruct<Elf64_Sym>(table->symbols.data() + position);
+        uint64_t start = getAddress(symbol);
+        if (isFunction(symbol) && start <= address &&
+            address - start < symbol.st_size) {
+            return Symbol{getName(*table, symbol.st_name), start,
+                          symbol.st_size};
+        }
+    }
+    return std::nullopt;
+}
+
+std::span<const uint8_t> Image::getBytes(uint64_t address,
+                                         size_t size) const noexcept {
+    auto inside = [&](uint64_t start, uint64_t length, uint64_t offset) {
+        if (address < start || address - start > length ||
+            size > length - (address - start) || offset > size_ ||
+            length > size_ - offset) {
+            return std::span<const uint8_t>();
+        }
+        return std::span(data_ + offset + (address - start), size);
+    };
+    for (const Elf64_Phdr &segment : segments_) {
+        auto bytes =
+            inside(segment.p_vaddr, segment.p_filesz, segment.p_offset);
+        if (bytes.data() != nullptr) {
+            return bytes;
+        }
+    }
+    if (!segments_.empty()) {
+        return {};
+    }
+    for (const Elf64_Shdr &section : sections_) {
+        if ((section.sh_flags & SHF_ALLOC) && section.sh_type != SHT_NOBITS) {
+            auto bytes =
+                inside(section.sh_addr, section.sh_size, section.sh_offset);
+            if (bytes.data() != nullptr) {
+                return bytes;
+            }
+        }
+    }
+    return {};
+}
+
+uint16_t Image::getMachine() const noexcept { return machine_; }
+
+} // namespace query
@@ -0,0 +1,314 @@
+#include <records.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <disassemble.hpp>
+#include <format>
+#include <ostream>
+#include <parallel.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace records {
+
+static_assert(std::endian::native == std::endian::little,
+              "records are written in host byte order");
+
+namespace {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::OperandKind;
+
+// Functions encoded per round: enough to keep the workers busy, few enough
+// that the output of a round stays small.
+constexpr size_t FunctionsPerJob = 256;
+
+constexpr size_t align8(size_t value) noexcept { return (value + 7) & ~7ul; }
+
+template <typename T> void appendRaw(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Encodes every function of `elf` through `encode(text, fn, instructions)`
+// in parallel, writing the texts out in function order.
+template <typename Encode>
+void encodeFunctions(std::ostream &out, const binary::Elf64 &elf,
+                     size_t jobs, Encode &&encode) {
+    const auto &functions = elf.getFunctions();
+    std::vector<std::vector<Instruction>> buffers(jobs);
+    std::vector<std::string> texts(std::min(functions.size(),
+                                            jobs * FunctionsPerJob));
+    for (size_t first = 0; first < functions.size(); first += texts.size()) {
+        size_t count = std::min(texts.size(), functions.size() - first);
+        parallel::forEach(count, jobs, [&](size_t idx, size_t worker) {
+            size_t fn = first + idx;
+            std::string &text = texts[idx];
+            text.clear();
+            disassemble::X86_64::decode(
+                elf.getFunctionCode(fn), functions[fn].offset,
+                disassemble::ReadingMode::LSB, buffers[worker]);
+            encode(text, fn, buffers[worker]);
+        });
+        for (size_t idx = 0; idx < count; idx++) {
+            out.write(texts[idx].data(), texts[idx].size());
+        }
+    }
+}
+
+// std::format_to through a back inserter costs more than the decoding;
+// numbers go through to_chars instead.
+template <typename T> void appendNumber(std::string &out, T value) {
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
+}
+
+void appendJsonString(std::string &out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            std::format_to(std::back_inserter(out), "\\u{:04x}", (int)c);
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendJsonOperand(std::string &out, const Instruction &ins,
+                       const disassemble::X86_64::Operand &operand) {
+    using disassemble::X86_64::Register;
+    using disassemble::X86_64::registerName;
+    switch (operand.kind) {
+    case OperandKind::Register:
+        out += "{\"kind\":\"register\",\"size\":";
+        appendNumber(out, operand.size);
+        out += ",\"register\":\"";
+        out += registerName(operand.base, operand.size);
+        out += "\"}";
+        break;
+    case OperandKind::Memory: {
+        static constexpr std::array<std::string_view, 7> segments = {
+            "", "cs", "ss", "ds", "es", "fs", "gs"};
+        size_t addressSize =
+            (ins.prefixes & disassemble::X86_64::Prefix::AddressSize) ? 4 : 8;
+        out += "{\"kind\":\"memory\",\"size\":";
+        appendNumber(out, operand.size);
+        if (ins.segment != disassemble::X86_64::Segment::None) {
+            out += ",\"segment\":\"";
+            out += segments[(size_t)ins.segment];
+            out += '"';
+        }
+        if (operand.base != Register::None) {
+            out += ",\"base\":\"";
+            out += registerName(operand.base, addressSize);
+            out += '"';
+        }
+        if (operand.index != Register::None) {
+            out += ",\"index\":\"";
+            out += registerName(operand.index, addressSize);
+            out += "\",\"scale\":";
+            appendNumber(out, operand.scale);
+        }
+        out += ",\"displacement\":";
+        appendNumber(out, operand.value);
+        out += '}';
+        break;
+    }
+    case OperandKind::Immediate:
+        out += "{\"kind\":\"immediate\",\"size\":";
+        appendNumber(out, operand.size);
+        out += ",\"value\":";
+        appendNumber(out, operand.value);
+        out += '}';
+        break;
+    case OperandKind::Target:
+        out += "{\"kind\":\"target\",\"value\":";
+        appendNumber(out, (uint64_t)operand.value);
+        out += '}';
+        break;
+    case OperandKind::None:
+        out += "{\"kind\":\"none\"}";
+        break;
+    }
+}
+
+} // namespace
+
+void writeRecords(std::ostream &out, const binary::Elf64 &elf, size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    std::string names;
+    std::string table;
+    table.reserve(functions.size() * sizeof(FunctionEntry));
+    for (const binary::Function &function : functions) {
+        FunctionEntry entry;
+        entry.address = function.offset;
+        entry.size = function.size;
+        entry.nameOffset = names.size();
+        entry.nameLength = function.name.size();
+        appendRaw(table, entry);
+        names += function.name;
+    }
+    names.resize(align8(names.size()), '\0');
+
+    Header header;
+    header.magic = Magic;
+    header.version = Version;
+    header.recordSize = sizeof(InstructionRecord);
+    header.functionCount = functions.size();
+    header.functionsOffset = sizeof(Header);
+    header.namesOffset = header.functionsOffset + table.size();
+    header.recordsOffset = header.namesOffset + names.size();
+    std::string prologue;
+    appendRaw(prologue, header);
+    out.write(prologue.data(), prologue.size());
+    out.write(table.data(), table.size());
+    out.write(names.data(), names.size());
+
+    encodeFunctions(
+        out, elf, jobs,
+        [](std::string &text, size_t fn,
+           const std::vector<Instruction> &instructions) {
+            size_t start = text.size();
+            text.resize(start + instructions.size() *
+                                    sizeof(InstructionRecord));
+            for (size_t i = 0; i < instructions.size(); i++) {
+                const Instruction &ins = instructions[i];
+                InstructionRecord record{};
+                record.address = ins.address;
+                record.function = fn;
+                record.mnemonic = (uint16_t)ins.mnemonic;
+                record.length = ins.length;
+                record.opcodeMap = ins.opcodeMap;
+                record.opcode = ins.opcode;
+                record.prefixes = ins.prefixes;
+                record.segment = (uint8_t)ins.segment;
+                record.operandCount = ins.operandCount;
+                if (auto target = ins.branchTarget()) {
+                    record.target = target.value();
+                    record.targetKind = TargetKind::Branch;
+                } else if (auto target = ins.ripTarget()) {
+                    record.target = target.value();
+                    record.targetKind = TargetKind::RipRelative;
+                }
+                for (size_t op = 0; op < ins.operandCount; op++) {
+                    const auto &operand = ins.operands[op];
+                    OperandRecord &encoded = record.operands[op];
+                    encoded.value = operand.value;
+                    encoded.kind = (uint8_t)operand.kind;
+                    encoded.size = operand.size;
+                    encoded.base = (uint8_t)operand.base;
+                    encoded.index = (uint8_t)operand.index;
+                    encoded.scale = operand.scale;
+                }
+                std::memcpy(text.data() + start +
+                                i * sizeof(InstructionRecord),
+                            &record, sizeof(record));
+            }
+        });
+    out.flush();
+}
+
+void writeJsonLines(std::ostream &out, const binary::Elf64 &elf,
+                    size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    encodeFunctions(
+        out, elf, jobs,
+        [&functions](std::string &text, size_t fn,
+                     const std::vector<Instruction> &instructions) {
+            std::string prefix = "{\"function\":";
+            appendJsonString(prefix, functions[fn].name);
+            prefix += ",\"address\":";
+            for (const Instruction &ins : instructions) {
+                text += prefix;
+                appendNumber(text, ins.address);
+                text += ",\"length\":";
+                appendNumber(text, ins.length);
+                text += ",\"mnemonic\":\"";
+                text += disassemble::X86_64::mnemonicName(ins.mnemonic);
+                text += '"';
+                if (ins.mnemonic == disassemble::X86_64::Mnemonic::Unknown) {
+                    text += ",\"map\":";
+                    appendNumber(text, ins.opcodeMap);
+                    text += ",\"opcode\":";
+                    appendNumber(text, ins.opcode);
+                }
+                text += ",\"operands\":[";
+                for (size_t op = 0; op < ins.operandCount; op++) {
+                    if (op != 0) {
+                        text += ',';
+                    }
+                    appendJsonOperand(text, ins, ins.operands[op]);
+                }
+                text += ']';
+                if (auto target = ins.branchTarget()) {
+                    text += ",\"target\":";
+                    appendNumber(text, target.value());
+                } else if (auto target = ins.ripTarget()) {
+                    text += ",\"rip_target\":";
+                    appendNumber(text, target.value());
+                }
+                text += "}\n";
+            }
+        });
+    out.flush();
+}
+
+RecordFile RecordFile::open(std::span<const uint8_t> data) {
+    Header header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Truncated record file");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != Magic) {
+        throw std::runtime_error("Not a record file");
+    }
+    if (header.version != Version ||
+        header.recordSize != sizeof(InstructionRecord)) {
+        throw std::runtime_error(std::format(
+            "Unsupported record file version {}", header.version));
+    }
+    size_t tableSize = header.functionCount * sizeof(FunctionEntry);
+    if (reinterpret_cast<uintptr_t>(data.data()) % 8 != 0 ||
+        header.functionsOffset != sizeof(Header) ||
+        header.functionCount >
+            (data.size() - sizeof(Header)) / sizeof(FunctionEntry) ||
+        header.namesOffset != header.functionsOffset + tableSize ||
+        header.recordsOffset < header.namesOffset ||
+        header.recordsOffset > data.size() || header.recordsOffset % 8 != 0) {
+        throw std::runtime_error("Malformed record file");
+    }
+    RecordFile file;
+    file.functions = std::span(
+        reinterpret_cast<const FunctionEntry *>(data.data() +
+                                                header.functionsOffset),
+        header.functionCount);
+    file.names = std::span(
+        reinterpret_cast<const char *>(data.data() + header.namesOffset),
+        header.recordsOffset - header.namesOffset);
+    file.instructions = std::span(
+        reinterpret_cast<const InstructionRecord *>(data.data() +
+                                                    header.recordsOffset),
+        (data.size() - header.recordsOffset) / sizeof(InstructionRecord));
+    return file;
+}
+
+std::string_view
+RecordFile::functionName(const FunctionEntry &function) const noexcept {
+    if (function.nameOffset > names.size() ||
+        function.nameLength > names.size() - function.nameOffset) {
+        return {};
+    }
+    return std::string_view(names.data() + function.nameOffset,
+                            function.nameLength);
+}
+
+} // namespace records
@@ -0,0 +1,499 @@
+#include <search.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <parallel.hpp>
+#include <stdexcept>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace search {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+using disassemble::X86_64::OperandKind;
+using disassemble::X86_64::Register;
+
+namespace {
+
+// Candidate positions scanned per task.
+constexpr size_t ChunkSize = 1 << 20;
+
+[[nodiscard]] std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && std::isspace((unsigned char)text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace((unsigned char)text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+[[nodiscard]] std::vector<std::string_view> split(std::string_view text,
+                                                  char separator) {
+    std::vector<std::string_view> parts;
+    while (true) {
+        size_t end = text.find(separator);
+        parts.push_back(trim(text.substr(0, end)));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        text.remove_prefix(end + 1);
+    }
+}
+
+[[nodiscard]] std::optional<int64_t> parseNumber(std::string_view text) {
+    bool negative = text.starts_with('-');
+    if (negative || text.starts_with('+')) {
+        text.remove_prefix(1);
+    }
+    int base = 10;
+    if (text.starts_with("0x")) {
+        text.remove_prefix(2);
+        base = 16;
+    }
+    uint64_t value = 0;
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value, base);
+    if (text.empty() || ec != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return negative ? -(int64_t)value : (int64_t)value;
+}
+
+// `reg`, `reg1`, ... `reg9`.
+[[nodiscard]] std::optional<int8_t> parseVariable(std::string_view text) {
+    if (text == "reg") {
+        return 0;
+    }
+    if (text.size() == 4 && text.starts_with("reg") && text[3] >= '1' &&
+        text[3] <= '9') {
+        return text[3] - '0';
+    }
+    return std::nullopt;
+}
+
+struct NamedRegister {
+    Register reg;
+    uint8_t size;
+};
+
+[[nodiscard]] std::optional<NamedRegister>
+parseRegister(std::string_view text) {
+    if (text == "rip") {
+        return NamedRegister{Register::RIP, 8};
+    }
+    for (uint8_t reg = 0; reg <= (uint8_t)Register::BH; reg++) {
+        for (uint8_t size : {1, 2, 4, 8}) {
+            if (disassemble::X86_64::registerName(Register(reg), size) ==
+                text) {
+                return NamedRegister{Register(reg), size};
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::optional<Mnemonic> parseMnemonic(std::string_view text) {
+    for (uint16_t m = 1; m < (uint16_t)Mnemonic::Count; m++) {
+        if (disassemble::X86_64::mnemonicName(Mnemonic(m)) == text) {
+            return Mnemonic(m);
+        }
+    }
+    return std::nullopt;
+}
+
+// Registers compare by their full width: `eax` bound to a variable matches
+// `rax` later on.
+[[nodiscard]] uint8_t family(Register reg) noexcept {
+    if (reg >= Register::AH && reg <= Register::BH) {
+        return (uint8_t)reg - (uint8_t)Register::AH;
+    }
+    return (uint8_t)reg;
+}
+
+[[nodiscard]] InstructionPattern::Operand
+parseMemory(std::string_view text) {
+    using Operand = InstructionPattern::Operand;
+    Operand operand;
+    operand.kind = Operand::Kind::Memory;
+    std::string inner;
+    for (char c : text.substr(1, text.size() - 2)) {
+        if (!std::isspace((unsigned char)c)) {
+            inner += c;
+        }
+    }
+    if (inner == "*") {
+        operand.anyMemory = true;
+        return operand;
+    }
+    size_t sign = inner.find_first_of("+-");
+    std::string_view base = std::string_view(inner).substr(0, sign);
+    if (auto variable = parseVariable(base)) {
+        operand.variable = variable.value();
+    } else if (auto reg = parseRegister(base)) {
+        operand.reg = reg->reg;
+    } else {
+        throw std::runtime_error(std::format("Bad memory operand {}", text));
+    }
+    if (sign != std::string::npos) {
+        std::string_view displacement = std::string_view(inner).substr(sign);
+        if (displacement != "+X" && displacement != "+x") {
+            operand.value = parseNumber(displacement);
+            if (!operand.value.has_value()) {
+                throw std::runtime_error(
+                    std::format("Bad displacement in {}", text));
+            }
+        }
+    } else {
+        operand.value = 0;
+    }
+    return operand;
+}
+
+[[nodiscard]] InstructionPattern::Operand parseOperand(std::string_view text) {
+    using Operand = InstructionPattern::Operand;
+    if (text.starts_with('[') && text.ends_with(']')) {
+        return parseMemory(text);
+    }
+    Operand operand;
+    if (text == "*") {
+        return operand;
+    }
+    if (text == "mem") {
+        operand.kind = Operand::Kind::Memory;
+        operand.anyMemory = true;
+    } else if (text == "imm" || text == "X" || text == "x") {
+        operand.kind = Operand::Kind::Immediate;
+    } else if (auto variable = parseVariable(text)) {
+        operand.kind = Operand::Kind::Register;
+        operand.variable = variable.value();
+    } else if (auto reg = parseRegister(text)) {
+        operand.kind = Operand::Kind::Register;
+        operand.reg = reg->reg;
+        operand.size = reg->size;
+    } else if (auto value = parseNumber(text)) {
+        operand.kind = Operand::Kind::Immediate;
+        operand.value = value;
+    } else {
+        throw std::runtime_error(std::format("Bad operand {}", text));
+    }
+    return operand;
+}
+
+// Binds or checks register variable `variable`.
+[[nodiscard]] bool bind(std::array<uint8_t, 10> &bindings, int8_t variable,
+                        Register reg) noexcept {
+    constexpr uint8_t Unbound = 0xff;
+    if (variable < 0) {
+        return true;
+    }
+    uint8_t &bound = bindings[variable];
+    if (bound == Unbound) {
+        bound = family(reg);
+        return true;
+    }
+    return bound == family(reg);
+}
+
+[[nodiscard]] bool
+matchOperand(const InstructionPattern::Operand &pattern,
+             const disassemble::X86_64::Operand &operand,
+             std::array<uint8_t, 10> &bindings) noexcept {
+    using Kind = InstructionPattern::Operand::Kind;
+    switch (pattern.kind) {
+    case Kind::Any:
+        return true;
+    case Kind::Register:
+        if (operand.kind != OperandKind::Register) {
+            return false;
+        }
+        if (pattern.reg != Register::None) {
+            return operand.base == pattern.reg && operand.size == pattern.size;
+        }
+        return bind(bindings, pattern.variable, operand.base);
+    case Kind::Immediate:
+        if (operand.kind != OperandKind::Immediate &&
+            operand.kind != OperandKind::Target) {
+            return false;
+        }
+        return !pattern.value.has_value() || pattern.value == operand.value;
+    case Kind::Memory:
+        if (operand.kind != OperandKind::Memory) {
+            return false;
+        }
+        if (pattern.anyMemory) {
+            return true;
+        }
+        if (operand.index != Register::None ||
+            (pattern.value.has_value() && pattern.value != operand.value)) {
+            return false;
+        }
+        if (pattern.reg != Register::None) {
+            return operand.base == pattern.reg;
+        }
+        return operand.base != Register::None &&
+               operand.base != Register::RIP &&
+               bind(bindings, pattern.variable, operand.base);
+    }
+    return false;
+}
+
+// Calls `found` for every position in [begin, end) of `data` where the
+// pattern matches. Positions must leave room for the whole pattern.
+template <typename Found>
+void scan(std::span<const uint8_t> data, const uint8_t *bytes,
+          const uint8_t *mask, size_t length, size_t firstAnchor,
+          size_t lastAnchor, size_t begin, size_t end, Found found) {
+    const uint8_t *base = data.data();
+    auto verify = [&](size_t position) {
+        for (size_t i = 0; i < length; i++) {
+            if ((base[position + i] & mask[i]) != bytes[i]) {
+                return;
+            }
+        }
+        found(position);
+    };
+
+    size_t position = begin;
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8((char)bytes[firstAnchor]);
+    const __m128i last = _mm_set1_epi8((char)bytes[lastAnchor]);
+    for (; position + 16 <= end; position += 16) {
+        __m128i a = _mm_loadu_si128(
+            (const __m128i *)(base + position + firstAnchor));
+        __m128i b =
+            _mm_loadu_si128((const __m128i *)(base + position + lastAnchor));
+        unsigned bits = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (bits != 0) {
+            verify(position + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for (; position < end; position++) {
+        if (base[position + firstAnchor] == bytes[firstAnchor] &&
+            base[position + lastAnchor] == bytes[lastAnchor]) {
+            verify(position);
+        }
+    }
+}
+
+} // namespace
+
+BytePattern BytePattern::parse(std::string_view text) {
+    BytePattern pattern;
+    for (std::string_view token : split(trim(text), ' ')) {
+        if (token.empty()) {
+            continue;
+        }
+        if (token.size() != 2) {
+            throw std::runtime_error(std::format("Bad byte {}", token));
+        }
+        uint8_t byte = 0;
+        uint8_t mask = 0;
+        for (char c : token) {
+            byte <<= 4;
+            mask <<= 4;
+            if (c == '?') {
+                continue;
+            }
+            int digit = std::isdigit((unsigned char)c) ? c - '0'
+                        : std::isxdigit((unsigned char)c)
+                            ? std::tolower((unsigned char)c) - 'a' + 10
+                            : -1;
+            if (digit < 0) {
+                throw std::runtime_error(std::format("Bad byte {}", token));
+            }
+            byte |= digit;
+            mask |= 0xf;
+        }
+        pattern.bytes_.push_back(byte);
+        pattern.mask_.push_back(mask);
+    }
+    auto first = std::find(pattern.mask_.begin(), pattern.mask_.end(), 0xff);
+    if (first == pattern.mask_.end()) {
+        throw std::runtime_error("Pattern needs at least one fixed byte");
+    }
+    pattern.firstAnchor_ = first - pattern.mask_.begin();
+    pattern.lastAnchor_ =
+        pattern.mask_.rend() -
+        std::find(pattern.mask_.rbegin(), pattern.mask_.rend(), 0xff) - 1;
+    return pattern;
+}
+
+size_t BytePattern::size() const noexcept { return bytes_.size(); }
+
+bool BytePattern::matches(const uint8_t *data) const noexcept {
+    for (size_t i = 0; i < bytes_.size(); i++) {
+        if ((data[i] & mask_[i]) != bytes_[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Match> findBytes(const binary::Elf64 &elf,
+                             const BytePattern &pattern, size_t jobs) {
+    struct Chunk {
+        uint64_t address;
+        std::span<const uint8_t> data;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Chunk> chunks;
+    auto data = elf.getData();
+    for (size_t i = 0; i < elf.getHeader().e_shnum; i++) {
+        Elf64_Shdr section = elf.getSectionHeader(i);
+        if (!(section.sh_flags & SHF_EXECINSTR) ||
+            section.sh_type == SHT_NOBITS ||
+            section.sh_offset + section.sh_size > data.size() ||
+            section.sh_size < pattern.size()) {
+            continue;
+        }
+        auto bytes = std::span(data).subspan(section.sh_offset,
+                                             section.sh_size);
+        size_t positions = bytes.size() - pattern.size() + 1;
+        for (size_t begin = 0; begin < positions; begin += ChunkSize) {
+            chunks.push_back(Chunk{section.sh_addr, bytes, begin,
+                                   std::min(begin + ChunkSize, positions)});
+        }
+    }
+
+    std::vector<std::vector<Match>> found(chunks.size());
+    parallel::forEach(chunks.size(), jobs, [&](size_t i, size_t) {
+        const Chunk &chunk = chunks[i];
+        scan(chunk.data, pattern.bytes_.data(), pattern.mask_.data(),
+             pattern.size(), pattern.firstAnchor_, pattern.lastAnchor_,
+             chunk.begin, chunk.end, [&](size_t position) {
+                 found[i].push_back(
+                     Match{chunk.address + position, pattern.size()});
+             });
+    });
+
+    std::vector<Match> matches;
+    for (const auto &chunk : found) {
+        matches.insert(matches.end(), chunk.begin(), chunk.end());
+    }
+    std::sort(matches.begin(), matches.end(),
+              [](const Match &a, const Match &b) {
+                  return a.address < b.address;
+              });
+    return matches;
+}
+
+InstructionPattern InstructionPattern::parse(std::string_view text) {
+    InstructionPattern pattern;
+    for (std::string_view instruction : split(text, ';')) {
+        if (instruction.empty()) {
+            continue;
+        }
+        Step step;
+        size_t space = instruction.find_first_of(" \t");
+        std::string_view mnemonic = instruction.substr(0, space);
+        if (mnemonic != "*") {
+            step.mnemonic = parseMnemonic(mnemonic);
+            if (!step.mnemonic.has_value()) {
+                throw std::runtime_error(
+                    std::format("Unknown mnemonic {}", mnemonic));
+            }
+        }
+        std::string_view rest =
+            space == std::string_view::npos ? "" : trim(instruction.substr(space));
+        step.anyOperands = rest.empty();
+        if (!rest.empty()) {
+            for (std::string_view operand : split(rest, ',')) {
+                step.operands.push_back(parseOperand(operand));
+            }
+        }
+        pattern.steps_.push_back(std::move(step));
+    }
+    if (pattern.steps_.empty()) {
+        throw std::runtime_error("Empty pattern");
+    }
+    return pattern;
+}
+
+size_t InstructionPattern::size() const noexcept { return steps_.size(); }
+
+bool InstructionPattern::matchesAt(std::span<const Instruction> instructions,
+                                   size_t index) const noexcept {
+    if (index + steps_.size() > instructions.size()) {
+        return false;
+    }
+    std::array<uint8_t, 10> bindings;
+    bindings.fill(0xff);
+    for (size_t s = 0; s < steps_.size(); s++) {
+        const Step &step = steps_[s];
+        const Instruction &ins = instructions[index + s];
+        if (step.mnemonic.has_value() && step.mnemonic != ins.mnemonic) {
+            return false;
+        }
+        if (ins.mnemonic == Mnemonic::Unknown && !step.anyOperands) {
+            return false;
+        }
+        if (step.anyOperands) {
+            continue;
+        }
+        auto operands = ins.getOperands();
+        if (operands.size() != step.operands.size()) {
+            return false;
+        }
+        for (size_t o = 0; o < operands.size(); o++) {
+            if (!matchOperand(step.operands[o], operands[o], bindings)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<Match> findInstructions(const binary::Elf64 &elf,
+                                    const InstructionPattern &pattern,
+                                    size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    std::vector<std::vector<Match>> found(jobs);
+    std::vector<std::vector<Instruction>> buffers(jobs);
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t worker) {
+        auto &instructions = buffers[worker];
+        disassemble::X86_64::decode(elf.getFunctionCode(fn),
+                                    functions[fn].offset,
+                                    disassemble::ReadingMode::LSB,
+                                    instructions);
+        for (size_t i = 0; i + pattern.size() <= instructions.size(); i++) {
+            if (!pattern.matchesAt(instructions, i)) {
+                continue;
+            }
+            const Instruction &last = instructions[i + pattern.size() - 1];
+            found[worker].push_back(
+                Match{instructions[i].address,
+                      last.address + last.length - instructions[i].address});
+        }
+    });
+
+    std::vector<Match> matches;
+    for (const auto &worker : found) {
+        matches.insert(matches.end(), worker.begin(), worker.end());
+    }
+    std::sort(matches.begin(), matches.end(),
+              [](const Match &a, const Match &b) {
+                  return a.address < b.address;
+              });
+    // Aliased symbols cover the same code more than once.
+    matches.erase(std::unique(matches.begin(), matches.end(),
+                              [](const Match &a, const Match &b) {
+                                  return a.address == b.address;
+                              }),
+                  matches.end());
+    return matches;
+}
+
+} // namespace search
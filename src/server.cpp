@@ -0,0 +1,385 @@
+#include <server.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <disassemble.hpp>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace server {
+
+ListingCache::ListingCache(size_t budget) : budget_(budget) {}
+
+std::optional<std::string> ListingCache::find(size_t function) {
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(function);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+void ListingCache::insert(size_t function, std::string listing) {
+    if (listing.size() > budget_) {
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    if (index_.contains(function)) {
+        return;
+    }
+    bytes_ += listing.size();
+    lru_.emplace_front(function, std::move(listing));
+    index_.emplace(function, lru_.begin());
+    while (bytes_ > budget_) {
+        bytes_ -= lru_.back().second.size();
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+BinaryCache::BinaryCache(size_t capacity) : capacity_(capacity) {}
+
+std::shared_ptr<BinaryCache::Entry> BinaryCache::get(const std::string &path) {
+    auto modified = std::filesystem::last_write_time(path);
+    auto fileSize = std::filesystem::file_size(path);
+    {
+        std::lock_guard lock(mutex_);
+        auto it = index_.find(path);
+        if (it != index_.end()) {
+            auto entry = it->second->second;
+            if (entry->modified == modified && entry->fileSize == fileSize) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return entry;
+            }
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+    }
+
+    // Parse without holding the lock so that clients working on other
+    // files are not blocked behind a large binary.
+    auto entry = std::make_shared<Entry>();
+    entry->binary = binary::fromFile(path);
+    entry->modified = modified;
+    entry->fileSize = fileSize;
+    if (auto elf64 = dynamic_cast<binary::Elf64 *>(entry->binary.get())) {
+        const auto &functions = elf64->getFunctions();
+        entry->symbols.reserve(functions.size());
+        for (size_t i = 0; i < functions.size(); i++) {
+            entry->symbols.emplace(functions[i].name, i);
+        }
+    }
+
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        // Another client loaded it in the meantime.
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+    lru_.emplace_front(path, entry);
+    index_.emplace(path, lru_.begin());
+    while (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+    return entry;
+}
+
+[[nodiscard]] uint64_t parseAddress(std::string_view text) {
+    if (text.starts_with("0x") || text.starts_with("0X")) {
+        text.remove_prefix(2);
+    }
+    uint64_t value = 0;
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    if (ec != std::errc() || end != text.data() + text.size()) {
+        throw std::runtime_error(std::format("Invalid address: {}", text));
+    }
+    return value;
+}
+
+// Splits the last space-separated word off `text`. File names may contain
+// spaces, so arguments are taken from the right.
+[[nodiscard]] std::string_view popLastWord(std::string_view &text) {
+    auto space = text.rfind(' ');
+    if (space == std::string_view::npos) {
+        throw std::runtime_error("Missing argument");
+    }
+    std::string_view word = text.substr(space + 1);
+    text = text.substr(0, space);
+    return word;
+}
+
+[[nodiscard]] const binary::Elf64 &requireElf64(const BinaryCache::Entry &entry) {
+    auto elf64 = dynamic_cast<const binary::Elf64 *>(entry.binary.get());
+    if (elf64 == nullptr) {
+        throw std::runtime_error("Unsupported file type");
+    }
+    return *elf64;
+}
+
+// The listing of `code` at `address`, in the instruction set of `elf`.
+[[nodiscard]] std::string listCode(const binary::Elf64 &elf,
+                                   std::span<const uint8_t> code,
+                                   uint64_t address) {
+    auto resolver = [&elf](uint64_t target) {
+        return elf.getImportName(target);
+    };
+    std::string text;
+    disassemble::withIsa(elf.getHeader().e_machine, [&]<typename Isa>(Isa) {
+        std::vector<typename Isa::Instruction> instructions;
+        Isa::decode(code, address, instructions);
+        for (const auto &ins : instructions) {
+            Isa::format(text, ins, resolver);
+        }
+    });
+    return text;
+}
+
+[[nodiscard]] std::string answer(BinaryCache &cache, std::string_view request) {
+    auto space = request.find(' ');
+    if (space == std::string_view::npos) {
+        throw std::runtime_error("Malformed request");
+    }
+    std::string_view command = request.substr(0, space);
+    std::string_view args = request.substr(space + 1);
+
+    if (command == "function") {
+        std::string_view name = popLastWord(args);
+        auto entry = cache.get(std::string(args));
+        const auto &elf = requireElf64(*entry);
+        auto it = entry->symbols.find(name);
+        if (it == entry->symbols.end()) {
+            // Stripped libraries only name their exports, through the
+            // dynamic symbol table. Those listings are not cached.
+            auto symbol = elf.findDynamicSymbol(name);
+            if (!symbol.has_value()) {
+                throw std::runtime_error(std::format("No function {}", name));
+            }
+            Elf64_Sym sym = elf.getDynamicSymbol(symbol.value());
+            auto code = elf.getBytesAt(sym.st_value, sym.st_size);
+            if (code.size() != sym.st_size) {
+                throw std::runtime_error(
+                    std::format("Function {} is not mapped", name));
+            }
+            return std::format("{}:\n{}", name,
+                               listCode(elf, code, sym.st_value));
+        }
+        if (auto listing = entry->listings.find(it->second)) {
+            return *std::move(listing);
+        }
+        std::string listing = std::format(
+            "{}:\n{}", name,
+            listCode(elf, elf.getFunctionCode(it->second),
+                     elf.getFunctions()[it->second].offset));
+        entry->listings.insert(it->second, listing);
+        return listing;
+    }
+    if (command == "range") {
+        uint64_t end = parseAddress(popLastWord(args));
+        uint64_t start = parseAddress(popLastWord(args));
+        if (end < start) {
+            throw std::runtime_error("Invalid range");
+        }
+        auto entry = cache.get(std::string(args));
+        const auto &elf = requireElf64(*entry);
+        auto code = elf.getBytesAt(start, end - start);
+        if (code.size() != end - start) {
+            throw std::runtime_error("Range is not mapped");
+        }
+        return std::format("{:x}:\n{}", start, listCode(elf, code, start));
+    }
+    if (command == "functions") {
+        auto entry = cache.get(std::string(args));
+        std::string result;
+        for (const auto &function : requireElf64(*entry).getFunctions()) {
+            std::format_to(std::back_inserter(result), "{:x} {} {}\n",
+                           function.offset, function.size, function.name);
+        }
+        return result;
+    }
+    throw std::runtime_error(std::format("Unknown command {}", command));
+}
+
+std::string handleRequest(BinaryCache &cache, std::string_view request) {
+    try {
+        std::string payload = answer(cache, request);
+        return std::format("ok {}\n", payload.size()) + payload;
+    } catch (const std::exception &e) {
+        std::string message = e.what();
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        return std::format("error {}\n", message);
+    }
+}
+
+[[nodiscard]] bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+// Reads from a socket up to the next newline, keeping any extra bytes
+// around for the next call.
+class LineReader {
+  public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    [[nodiscard]] bool readLine(std::string &line) {
+        while (true) {
+            auto newline = buffer_.find('\n');
+            if (newline != std::string::npos) {
+                line.assign(buffer_, 0, newline);
+                buffer_.erase(0, newline + 1);
+                return true;
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+
+    [[nodiscard]] bool readExactly(std::string &data, size_t size) {
+        while (buffer_.size() < size) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        data.assign(buffer_, 0, size);
+        buffer_.erase(0, size);
+        return true;
+    }
+
+  private:
+    [[nodiscard]] bool fill() {
+        char chunk[4096];
+        ssize_t count = read(fd_, chunk, sizeof(chunk));
+        if (count <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, count);
+        return true;
+    }
+
+    int fd_;
+    std::string buffer_;
+};
+
+void serveClient(BinaryCache &cache, int fd) {
+    LineReader reader(fd);
+    std::string line;
+    while (reader.readLine(line)) {
+        if (!writeAll(fd, handleRequest(cache, line))) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+[[nodiscard]] sockaddr_un socketAddress(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+void serve(const Options &options) {
+    sockaddr_un address = socketAddress(options.socketPath);
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw std::runtime_error("Unable to create socket");
+    }
+    // Only a stale socket from an earlier run is replaced, never another
+    // kind of file.
+    struct stat status;
+    if (lstat(options.socketPath.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            close(listener);
+            throw std::runtime_error(std::format(
+                "{} exists and is not a socket", options.socketPath));
+        }
+        unlink(options.socketPath.c_str());
+    }
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        close(listener);
+        throw std::runtime_error(
+            std::format("Unable to listen on {}", options.socketPath));
+    }
+
+    BinaryCache cache(options.cacheCapacity);
+    while (true) {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Out of descriptors or memory: wait for clients to finish
+            // rather than spinning on the listener.
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                errno == ENOMEM) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            close(listener);
+            throw std::runtime_error(std::format("Unable to accept: {}",
+                                                 std::strerror(errno)));
+        }
+        std::thread(serveClient, std::ref(cache), client).detach();
+    }
+}
+
+std::string query(const std::string &socketPath, std::string_view request) {
+    sockaddr_un address = socketAddress(socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address),
+                          sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error(
+            std::format("Unable to connect to {}", socketPath));
+    }
+
+    LineReader reader(fd);
+    std::string header;
+    std::string payload;
+    bool ok = writeAll(fd, std::string(request) + '\n') &&
+              reader.readLine(header);
+    if (ok && header.starts_with("ok ")) {
+        size_t size = 0;
+        std::from_chars(header.data() + 3, header.data() + header.size(),
+                        size);
+        ok = reader.readExactly(payload, size);
+    }
+    close(fd);
+    if (!ok) {
+        throw std::runtime_error("Connection closed by server");
+    }
+    if (header.starts_with("error ")) {
+        throw std::runtime_error(header.substr(6));
+    }
+    return payload;
+}
+
+} // namespace server
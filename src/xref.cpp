@@ -0,0 +1,177 @@
+#include <xref.hpp>
+
+#include <algorithm>
+#include <disassemble.hpp>
+#include <parallel.hpp>
+
+namespace xref {
+
+using disassemble::X86_64::Instruction;
+using disassemble::X86_64::Mnemonic;
+
+namespace {
+
+// Turns (row, value) pairs sorted by row into CSR offsets and values.
+void buildRows(const std::vector<std::pair<uint32_t, uint32_t>> &pairs,
+               size_t rows, std::vector<uint32_t> &offsets,
+               std::vector<uint32_t> &values) {
+    offsets.assign(rows + 1, 0);
+    values.clear();
+    values.reserve(pairs.size());
+    for (const auto &[row, value] : pairs) {
+        offsets[row + 1]++;
+        values.push_back(value);
+    }
+    for (size_t i = 0; i < rows; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+}
+
+} // namespace
+
+Index Index::build(const binary::Elf64 &elf, size_t jobs) {
+    disassemble::requireX86_64(elf.getHeader().e_machine);
+    const auto &functions = elf.getFunctions();
+    Index index;
+
+    // Every worker collects the references of the functions it decodes;
+    // `spans` remembers where each function's references landed.
+    struct Span {
+        uint32_t worker;
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Span> spans(functions.size());
+    std::vector<std::vector<Reference>> found(jobs);
+    std::vector<std::vector<Instruction>> buffers(jobs);
+
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t worker) {
+        std::vector<Reference> &out = found[worker];
+        spans[fn] = Span{(uint32_t)worker, (uint32_t)out.size(), 0};
+        auto code = elf.getFunctionCode(fn);
+        disassemble::X86_64::decode(code, functions[fn].offset,
+                                    disassemble::ReadingMode::LSB,
+                                    buffers[worker]);
+        for (const Instruction &ins : buffers[worker]) {
+            if (auto target = ins.branchTarget()) {
+                out.push_back(Reference{
+                    .from = ins.address,
+                    .to = target.value(),
+                    .function = (uint32_t)fn,
+                    .kind = ins.mnemonic == Mnemonic::Call ? Kind::Call
+                                                           : Kind::Jump,
+                });
+            } else if (auto target = ins.ripTarget()) {
+                out.push_back(Reference{
+                    .from = ins.address,
+                    .to = target.value(),
+                    .function = (uint32_t)fn,
+                    .kind = Kind::Data,
+                });
+            }
+        }
+        spans[fn].end = out.size();
+    });
+
+    index.referenceOffsets_.assign(functions.size() + 1, 0);
+    for (size_t fn = 0; fn < functions.size(); fn++) {
+        index.referenceOffsets_[fn + 1] =
+            index.referenceOffsets_[fn] + spans[fn].end - spans[fn].begin;
+    }
+    index.references_.resize(index.referenceOffsets_.back());
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t) {
+        const Span &span = spans[fn];
+        const auto &source = found[span.worker];
+        std::copy(source.begin() + span.begin, source.begin() + span.end,
+                  index.references_.begin() + index.referenceOffsets_[fn]);
+    });
+    found.clear();
+
+    // Incoming references: reference indices ordered by target.
+    std::vector<uint32_t> byTarget(index.references_.size());
+    for (size_t i = 0; i < byTarget.size(); i++) {
+        byTarget[i] = i;
+    }
+    const auto &references = index.references_;
+    parallel::sort(byTarget, jobs, [&](uint32_t a, uint32_t b) {
+        return references[a].to < references[b].to ||
+               (references[a].to == references[b].to && a < b);
+    });
+    index.incomingOffsets_.push_back(0);
+    for (size_t i = 0; i < byTarget.size(); i++) {
+        uint64_t to = references[byTarget[i]].to;
+        if (index.targets_.empty() || index.targets_.back() != to) {
+            if (!index.targets_.empty()) {
+                index.incomingOffsets_.push_back(i);
+            }
+            index.targets_.push_back(to);
+        }
+    }
+    if (!index.targets_.empty()) {
+        index.incomingOffsets_.push_back(byTarget.size());
+    }
+    index.incoming_ = std::move(byTarget);
+
+    // Call graph edges between functions.
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> edges(jobs);
+    parallel::forEach(functions.size(), jobs, [&](size_t fn, size_t worker) {
+        for (const Reference &reference : index.referencesFrom(fn)) {
+            if (reference.kind != Kind::Call) {
+                continue;
+            }
+            if (auto callee = elf.findFunction(reference.to)) {
+                edges[worker].emplace_back(fn, callee.value());
+            }
+        }
+    });
+    std::vector<std::pair<uint32_t, uint32_t>> calls;
+    for (const auto &workerEdges : edges) {
+        calls.insert(calls.end(), workerEdges.begin(), workerEdges.end());
+    }
+    parallel::sort(calls, jobs, std::less<>());
+    calls.erase(std::unique(calls.begin(), calls.end()), calls.end());
+    buildRows(calls, functions.size(), index.calleeOffsets_, index.callees_);
+    for (auto &[caller, callee] : calls) {
+        std::swap(caller, callee);
+    }
+    parallel::sort(calls, jobs, std::less<>());
+    buildRows(calls, functions.size(), index.callerOffsets_, index.callers_);
+
+    return index;
+}
+
+std::span<const Reference>
+Index::referencesFrom(size_t function) const noexcept {
+    return std::span(references_)
+        .subspan(referenceOffsets_[function],
+                 referenceOffsets_[function + 1] - referenceOffsets_[function]);
+}
+
+std::span<const uint32_t> Index::referencesTo(uint64_t address) const noexcept {
+    auto it = std::lower_bound(targets_.begin(), targets_.end(), address);
+    if (it == targets_.end() || *it != address) {
+        return {};
+    }
+    size_t row = it - targets_.begin();
+    return std::span(incoming_).subspan(incomingOffsets_[row],
+                                        incomingOffsets_[row + 1] -
+                                            incomingOffsets_[row]);
+}
+
+std::span<const uint32_t> Index::callees(size_t function) const noexcept {
+    return std::span(callees_).subspan(
+        calleeOffsets_[function],
+        calleeOffsets_[function + 1] - calleeOffsets_[function]);
+}
+
+std::span<const uint32_t> Index::callers(size_t function) const noexcept {
+    return std::span(callers_).subspan(
+        callerOffsets_[function],
+        callerOffsets_[function + 1] - callerOffsets_[function]);
+}
+
+const std::vector<Reference> &Index::getReferences() const noexcept {
+    return references_;
+}
+
+} // namespace xref
@@ -0,0 +1,198 @@
+// Decodes every truncation of real and crafted x86-64 code from buffers of
+// exactly that size, so a sanitizer build catches any read past the end, and
+// checks the unchecked fast path and the padded tail path agree.
+#include <algorithm>
+#include <binary.hpp>
+#include <cstdint>
+#include <disassemble.hpp>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+using disassemble::ReadingMode;
+using namespace disassemble::X86_64;
+
+namespace {
+
+// Past the decoder's MaxDecodeBytes (40) by a whole instruction, so that
+// slices start on the fast path and finish on the tail one.
+constexpr size_t MaxSlice = 40 + MaxInstructionLength + 1;
+constexpr size_t Filler = 64;
+constexpr uint64_t Address = 0x401000;
+
+size_t failures = 0;
+
+bool same(const Instruction &a, const Instruction &b) {
+    if (a.address != b.address || a.mnemonic != b.mnemonic ||
+        a.length != b.length || a.opcodeMap != b.opcodeMap ||
+        a.opcode != b.opcode || a.prefixes != b.prefixes ||
+        a.segment != b.segment || a.operandCount != b.operandCount) {
+        return false;
+    }
+    return std::ranges::equal(
+        a.getOperands(), b.getOperands(),
+        [](const Operand &x, const Operand &y) {
+            return x.kind == y.kind && x.size == y.size &&
+                   x.base == y.base && x.index == y.index &&
+                   x.scale == y.scale && x.value == y.value;
+        });
+}
+
+void fail(std::span<const uint8_t> code, std::string_view what) {
+    if (++failures > 20) {
+        return;
+    }
+    std::string bytes;
+    for (uint8_t byte : code) {
+        std::format_to(std::back_inserter(bytes), " {:02x}", byte);
+    }
+    std::println(stderr, "{}:{}", what, bytes);
+}
+
+// Decodes `code` followed by `filler`, which puts every instruction starting
+// inside `code` on the fast path.
+std::vector<Instruction> decodePadded(std::span<const uint8_t> code,
+                                      uint8_t filler) {
+    std::vector<uint8_t> padded(code.begin(), code.end());
+    padded.resize(code.size() + Filler, filler);
+    std::vector<Instruction> result;
+    for (const Instruction &ins : decode(padded, Address, ReadingMode::LSB)) {
+        if (ins.address - Address >= code.size()) {
+            break;
+        }
+        result.push_back(ins);
+    }
+    return result;
+}
+
+void check(std::span<const uint8_t> code) {
+    auto reference = decodePadded(code, 0x00);
+    // An instruction that fits must not depend on the bytes after it.
+    auto other = decodePadded(code, 0xff);
+    for (size_t i = 0; i < reference.size() && i < other.size(); i++) {
+        const Instruction &ins = reference[i];
+        if (ins.address - Address + ins.length > code.size()) {
+            break;
+        }
+        if (!same(ins, other[i])) {
+            fail(code, "Decoding depends on the following bytes");
+            return;
+        }
+    }
+
+    std::vector<Instruction> out;
+    for (size_t first = 0; first < reference.size(); first++) {
+        size_t start = reference[first].address - Address;
+        size_t end = std::min(code.size(), start + MaxSlice);
+        for (size_t size = 1; size <= end - start; size++) {
+            // Exactly `size` bytes on the heap, nothing to read past.
+            std::vector<uint8_t> slice(code.begin() + start,
+                                       code.begin() + start + size);
+            decode(slice, Address + start, ReadingMode::LSB, out);
+            size_t offset = 0;
+            for (size_t i = 0; i < out.size(); i++) {
+                const Instruction &ins = out[i];
+                const Instruction &ref = reference[first + i];
+                bool fits = ref.length <= size - offset;
+                bool ok = fits ? same(ins, ref)
+                               : ins.mnemonic == Mnemonic::Unknown &&
+                                     ins.length == size - offset &&
+                                     ins.operandCount == 0 &&
+                                     i + 1 == out.size();
+                if (!ok || ins.length == 0) {
+                    fail(std::span(slice), fits ? "Tail and fast paths differ"
+                                                : "Bad truncation");
+                    return;
+                }
+                offset += ins.length;
+            }
+            if (offset != size) {
+                fail(std::span(slice), "Lengths do not cover the code");
+                return;
+            }
+        }
+    }
+}
+
+void checkRealCode() {
+    auto bin = binary::fromFile("/proc/self/exe");
+    auto elf = dynamic_cast<const binary::Elf64 *>(bin.get());
+    auto text = elf ? elf->findSection(".text") : std::nullopt;
+    if (!text) {
+        fail({}, "No .text in the test binary");
+        return;
+    }
+    auto code = elf->getSectionData(*text);
+    check(code.first(std::min<size_t>(code.size(), 16 * 1024)));
+}
+
+// Runs of legacy prefixes, REX and the three escape maps in front of ModRM
+// forms with SIB, displacements and immediates.
+void checkPrefixHeavy() {
+    constexpr std::array<uint8_t, 10> prefixes = {
+        0x66, 0xf2, 0xf3, 0x2e, 0x3e, 0x26, 0x64, 0x65, 0x67, 0xf0};
+    const std::vector<std::vector<uint8_t>> bodies = {
+        {0x0f, 0x38, 0x00, 0x84, 0x25, 0x78, 0x56, 0x34, 0x12},
+        {0x0f, 0x3a, 0x0f, 0x84, 0xc8, 0x78, 0x56, 0x34, 0x12, 0x07},
+        {0x0f, 0x10, 0x05, 0x78, 0x56, 0x34, 0x12},
+        {0x0f, 0x84, 0x78, 0x56, 0x34, 0x12},
+        {0x81, 0x84, 0x24, 0x78, 0x56, 0x34, 0x12, 0xef, 0xcd, 0xab, 0x89},
+        {0xc7, 0x05, 0x78, 0x56, 0x34, 0x12, 0xef, 0xcd, 0xab, 0x89},
+        {0x69, 0x44, 0x24, 0x08, 0xef, 0xcd, 0xab, 0x89},
+        {0xb8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11},
+        {0xa1, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11},
+        {0xe8, 0x78, 0x56, 0x34, 0x12},
+        {0xc4, 0xe2, 0x79, 0x18, 0x05, 0x78, 0x56, 0x34, 0x12},
+        {0xc5, 0xfd, 0x6f, 0x84, 0x24, 0x78, 0x56, 0x34, 0x12},
+        {0x62, 0xf1, 0x7c, 0x48, 0x10, 0x44, 0x24, 0x01},
+        {0x90},
+    };
+    std::mt19937 random(44);
+    std::vector<uint8_t> code;
+    for (const auto &body : bodies) {
+        for (size_t count = 0; count <= 14; count++) {
+            for (uint8_t rex : {0x00, 0x48, 0x4f}) {
+                code.clear();
+                for (size_t i = 0; i < count; i++) {
+                    code.push_back(prefixes[random() % prefixes.size()]);
+                }
+                if (rex) {
+                    code.push_back(rex);
+                }
+                code.insert(code.end(), body.begin(), body.end());
+                check(code);
+            }
+        }
+    }
+}
+
+// Random bytes, half of them prefixes and escapes.
+void checkRandom() {
+    constexpr std::array<uint8_t, 16> likely = {
+        0x66, 0xf2, 0xf3, 0x2e, 0x64, 0x65, 0x67, 0xf0,
+        0x48, 0x4f, 0x0f, 0x38, 0x3a, 0xc4, 0xc5, 0x62};
+    std::mt19937 random(44);
+    std::vector<uint8_t> code(48);
+    for (size_t round = 0; round < 2000; round++) {
+        for (uint8_t &byte : code) {
+            uint32_t value = random();
+            byte = value & 1 ? likely[(value >> 1) % likely.size()]
+                             : value >> 8;
+        }
+        check(code);
+    }
+}
+
+} // namespace
+
+int main() {
+    checkRealCode();
+    checkPrefixHeavy();
+    checkRandom();
+    if (failures) {
+        std::println(stderr, "{} failures", failures);
+        return 1;
+    }
+    return 0;
+}